@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <dirent.h>
 #include <string.h>
+#include <sys/wait.h>
 #include "lib/collections.c"
 
 typedef struct list_char string;
@@ -117,6 +118,90 @@ void read_file_names_recursive(char *dir,
     }
 }
 
+int is_rm_file(struct list_char *input)
+{
+    return ends_with(input, ".rm");
+}
+
+// The first line of a test says what it should do, `// exit: N` to compile, run and exit with N,
+// or `// error: text` to be rejected with a message containing the text.
+int run_test(char *file_name)
+{
+    FILE *file = fopen(file_name, "r");
+    if (!file) {
+        ERROR("issue opening `%s`", file_name);
+    }
+    char first_line[256] = {0};
+    fgets(first_line, sizeof(first_line), file);
+    fclose(file);
+    first_line[strcspn(first_line, "\n")] = '\0';
+
+    char command[1024] = {0};
+    snprintf(command, sizeof(command), "./rm %s 2>&1", file_name);
+    FILE *rm = popen(command, "r");
+    struct list_char output = list_create(char, 256);
+    char buf[256] = {0};
+    while (fgets(buf, sizeof(buf), rm)) {
+        append_list_char_slice(&output, buf);
+    }
+    list_append(&output, '\0');
+    int rejected = pclose(rm) != 0;
+
+    char *expected_error = "// error: ";
+    if (!strncmp(first_line, expected_error, strlen(expected_error))) {
+        if (rejected && strstr(output.data, first_line + strlen(expected_error))) return 1;
+        fprintf(stderr, "FAIL %s: expected the error `%s`, got:\n%s",
+                file_name, first_line + strlen(expected_error), output.data);
+        return 0;
+    }
+
+    int expected_exit = 0;
+    if (sscanf(first_line, "// exit: %d", &expected_exit) != 1) {
+        fprintf(stderr, "FAIL %s: the first line must be `// exit: N` or `// error: text`\n", file_name);
+        return 0;
+    }
+    if (rejected) {
+        fprintf(stderr, "FAIL %s: rejected by rm:\n%s", file_name, output.data);
+        return 0;
+    }
+
+    // the generated header asserts the size of each struct rm lays out, so this is where a
+    // layout that disagrees with gcc's fails. Qualifiers like `restrict` only change what the
+    // optimiser may assume, so each test is also run optimised.
+    char *levels[] = { "-O0", "-O2" };
+    for (size_t i = 0; i < sizeof(levels) / sizeof(*levels); i++) {
+        snprintf(command, sizeof(command),
+                 "gcc %s -Wall -Wno-unused -Werror -o target/test target/c_output.c -lpthread", levels[i]);
+        if (system(command)) {
+            fprintf(stderr, "FAIL %s: the generated C doesn't compile at %s\n", file_name, levels[i]);
+            return 0;
+        }
+        int status = system("./target/test > /dev/null");
+        int actual_exit = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        if (actual_exit != expected_exit) {
+            fprintf(stderr, "FAIL %s: expected exit %d at %s, got %d\n",
+                    file_name, expected_exit, levels[i], actual_exit);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int run_tests(void)
+{
+    struct list_string files = list_create(string, 32);
+    read_file_names_recursive("tests", &files);
+    struct list_string tests = filter(&files, is_rm_file);
+
+    size_t failed = 0;
+    for (size_t i = 0; i < tests.size; ++i) {
+        list_append(&tests.data[i], '\0');
+        if (!run_test(tests.data[i].data)) failed++;
+    }
+    fprintf(stderr, "%zu of %zu tests passed\n", tests.size - failed, tests.size);
+    return failed == 0;
+}
+
 int main(int argc, char **argv)
 {
     struct list_string files = list_create(string, 100);
@@ -142,5 +227,9 @@ int main(int argc, char **argv)
         ERROR("compilation failed.");
     }
 
+    if (argc > 1 && !strcmp(argv[1], "test")) {
+        return run_tests() ? 0 : 1;
+    }
+
     return 0;
 }
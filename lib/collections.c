@@ -11,6 +11,10 @@ void append_list_char_slice(struct list_char *dest, char *slice) {
         list_append(dest, *slice);
         slice++;
     } while (slice != NULL && *slice != '\0');
+
+    // keep a terminator just past the end, so the data can be read as a C string.
+    list_append(dest, '\0');
+    dest->size -= 1;
 }
 
 int list_char_eq(struct list_char *l, struct list_char *r) {
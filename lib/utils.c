@@ -1,4 +1,5 @@
 #include "utils.h"
+#include <string.h>
 
 unsigned long djb2_hash(char *input)
 {
@@ -12,3 +13,32 @@ unsigned long djb2_hash(char *input)
 
     return hash;
 }
+
+static int is_identifier_char(char c)
+{
+    return (c >= 'a' && c <= 'z')
+        || (c >= 'A' && c <= 'Z')
+        || (c >= '0' && c <= '9')
+        || c == '_';
+}
+
+// Whether `identifier` appears in `text` as a whole C identifier, e.g within inline C.
+int mentions_identifier(char *text, char *identifier)
+{
+    size_t identifier_len = strlen(identifier);
+    size_t text_len = strlen(text);
+    if (identifier_len == 0 || identifier_len > text_len) {
+        return 0;
+    }
+
+    for (size_t i = 0; i + identifier_len <= text_len; i++) {
+        if (strncmp(&text[i], identifier, identifier_len) != 0) continue;
+        int starts = i == 0 || !is_identifier_char(text[i - 1]);
+        int ends = i + identifier_len == text_len || !is_identifier_char(text[i + identifier_len]);
+        if (starts && ends) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
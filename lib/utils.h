@@ -17,5 +17,6 @@
     } while (0)
 
 unsigned long djb2_hash(char *input);
+int mentions_identifier(char *text, char *identifier);
 
 #endif
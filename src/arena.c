@@ -0,0 +1,135 @@
+#include <string.h>
+#include "arena.h"
+#include "../lib/collections.h"
+
+static char *arena_functions[] = {
+    "arena_create",
+    "arena_new",
+    "arena_mark",
+    "arena_rewind",
+    "arena_reset",
+    "arena_free",
+    "arena_report",
+};
+
+// `*arena`, or `*mut arena`.
+struct type *arena_pointer(int mutable)
+{
+    struct type *ty = malloc(sizeof(*ty));
+    *ty = (struct type) {
+        .kind = TY_PRIMITIVE,
+        .modifiers = list_create(type_modifier, 2),
+        .primitive_type = ARENA
+    };
+    list_append(&ty->modifiers, ((struct type_modifier) { .kind = POINTER_MODIFIER_KIND }));
+    if (mutable) {
+        list_append(&ty->modifiers, ((struct type_modifier) { .kind = MUTABLE_MODIFIER_KIND }));
+    }
+    return ty;
+}
+
+struct type *primitive_of(enum primitive_type primitive_type)
+{
+    struct type *ty = malloc(sizeof(*ty));
+    *ty = (struct type) {
+        .kind = TY_PRIMITIVE,
+        .modifiers = list_create(type_modifier, 1),
+        .primitive_type = primitive_type
+    };
+    return ty;
+}
+
+struct list_char *boxed_name(char *name)
+{
+    struct list_char *out = malloc(sizeof(*out));
+    *out = list_create(char, (strlen(name) + 1));
+    append_list_char_slice(out, name);
+    list_append(out, '\0');
+    return out;
+}
+
+void declare_arena_function(char *name,
+                            struct type *return_type,
+                            struct list_key_type_pair params,
+                            struct global_context *global_context)
+{
+    list_append(&global_context->fn_types, ((struct type) {
+        .kind = TY_FUNCTION,
+        .name = boxed_name(name),
+        .modifiers = list_create(type_modifier, 1),
+        .function_type = (struct function_type) {
+            .params = params,
+            .return_type = return_type
+        }
+    }));
+}
+
+struct key_type_pair arena_param(char *name, struct type *ty)
+{
+    return (struct key_type_pair) {
+        .field_name = *boxed_name(name),
+        .field_type = ty
+    };
+}
+
+void declare_arena_functions(struct global_context *global_context)
+{
+    struct list_key_type_pair create = list_create(key_type_pair, 1);
+    list_append(&create, arena_param("capacity", primitive_of(USIZE)));
+    declare_arena_function("arena_create", arena_pointer(1), create, global_context);
+
+    // the value and what's returned are typed at each call, see `arena_allocation_type`.
+    struct type *any = malloc(sizeof(*any));
+    *any = (struct type) { .kind = TY_ANY, .modifiers = list_create(type_modifier, 1) };
+    struct list_key_type_pair new = list_create(key_type_pair, 2);
+    list_append(&new, arena_param("arena", arena_pointer(1)));
+    list_append(&new, arena_param("value", any));
+    struct type *allocated = malloc(sizeof(*allocated));
+    *allocated = arena_allocation_type(any);
+    declare_arena_function("arena_new", allocated, new, global_context);
+
+    struct list_key_type_pair mark = list_create(key_type_pair, 1);
+    list_append(&mark, arena_param("arena", arena_pointer(0)));
+    declare_arena_function("arena_mark", primitive_of(USIZE), mark, global_context);
+
+    struct list_key_type_pair rewind = list_create(key_type_pair, 2);
+    list_append(&rewind, arena_param("arena", arena_pointer(1)));
+    list_append(&rewind, arena_param("mark", primitive_of(USIZE)));
+    declare_arena_function("arena_rewind", primitive_of(VOID), rewind, global_context);
+
+    char *releasing[] = { "arena_reset", "arena_free" };
+    for (size_t i = 0; i < sizeof(releasing) / sizeof(*releasing); i++) {
+        struct list_key_type_pair params = list_create(key_type_pair, 1);
+        list_append(&params, arena_param("arena", arena_pointer(1)));
+        declare_arena_function(releasing[i], primitive_of(VOID), params, global_context);
+    }
+
+    struct list_key_type_pair report = list_create(key_type_pair, 1);
+    list_append(&report, arena_param("arena", arena_pointer(0)));
+    declare_arena_function("arena_report", primitive_of(VOID), report, global_context);
+}
+
+int is_arena_function(struct list_char *name)
+{
+    for (size_t i = 0; i < sizeof(arena_functions) / sizeof(*arena_functions); i++) {
+        if (!strcmp(name->data, arena_functions[i])) return 1;
+    }
+    return 0;
+}
+
+int is_arena_allocation(struct function_expression *fn)
+{
+    return !fn->method_call && !strcmp(fn->function_name->data, "arena_new") && fn->params->size == 2;
+}
+
+struct type arena_allocation_type(struct type *value_type)
+{
+    struct type out = *value_type;
+    out.modifiers = list_create(type_modifier, (value_type->modifiers.size + 2));
+    list_append(&out.modifiers, ((struct type_modifier) { .kind = POINTER_MODIFIER_KIND }));
+    list_append(&out.modifiers, ((struct type_modifier) { .kind = MUTABLE_MODIFIER_KIND }));
+    for (size_t i = 0; i < value_type->modifiers.size; i++) {
+        list_append(&out.modifiers, value_type->modifiers.data[i]);
+    }
+    return out;
+}
@@ -0,0 +1,16 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "ast.h"
+#include "parser.h"
+
+// Declares the functions arenas are used through, `arena_create(capacity)` and the ones called as
+// methods on the `*mut arena` it returns: `new(value)`, `mark()`, `rewind(mark)`, `reset()`,
+// `free()` and `report()`. They've no body, the lowering writes them into the header.
+void declare_arena_functions(struct global_context *global_context);
+int is_arena_function(struct list_char *name);
+// `arena.new(value)` is typed by what it's given, a `*mut` to the value's type.
+int is_arena_allocation(struct function_expression *fn);
+struct type arena_allocation_type(struct type *value_type);
+
+#endif
@@ -18,14 +18,25 @@ enum primitive_type {
     U64   = 193506244L,    // u64
     USIZE = 210730553717L, // usize
     F32   = 193489808L,    // f32
-    F64   = 193489909L     // f64
+    F64   = 193489909L,    // f64
+    ARENA = 210706794604L, // arena
+    F32X4 = 210710404924L, // f32x4
+    F32X8 = 210710404928L, // f32x8
+    I32X4 = 210713962687L, // i32x4
+    I32X8 = 210713962691L, // i32x8
+    U8X16 = 210728447313L, // u8x16
+    U8X32 = 210728447375L  // u8x32
 };
 
 enum type_modifier_kind {
     POINTER_MODIFIER_KIND = 1,
     NULLABLE_MODIFIER_KIND,
     ARRAY_MODIFIER_KIND,
-    MUTABLE_MODIFIER_KIND
+    MUTABLE_MODIFIER_KIND,
+    // `[]T`, a pointer to the elements and their count.
+    SLICE_MODIFIER_KIND,
+    // `atomic T`, only read and written through its methods, with a memory order each time.
+    ATOMIC_MODIFIER_KIND
 };
 
 struct array_type_modifier {
@@ -33,12 +44,27 @@ struct array_type_modifier {
     int literal_size;
     int reference_sized;
     struct list_char *reference_name;
+    // set when the size is an expression, folded into `literal_size` before contextualising.
+    struct expression *size_expression;
+    // the innermost array of a `#[soa]` struct, which lowers to one array per field, see
+    // `mark_soa_arrays`.
+    int soa;
+};
+
+// Set on the outermost pointer of a function's parameters by `qualify_pointer_parameters`.
+struct pointer_type_modifier {
+    // the body never writes through the pointer, nor lets it escape, so it lowers to `const T *`.
+    int const_pointee;
+    // a `*mut` parameter whose pointee no other parameter could reach, going by their types,
+    // lowers to `T *restrict`.
+    int restrict_pointer;
 };
 
 typedef struct type_modifier {
     enum type_modifier_kind kind;
     union {
         struct array_type_modifier array_modifier;
+        struct pointer_type_modifier pointer_modifier;
     };
 } type_modifier;
 
@@ -55,6 +81,8 @@ enum type_kind {
 typedef struct key_type_pair {
     struct list_char field_name;
     struct type *field_type;
+    // of a function parameter, a struct passed as a `const` pointer to the caller's copy.
+    int by_reference;
 } key_type_pair;
 
 struct_list(key_type_pair);
@@ -62,11 +90,20 @@ struct_list(key_type_pair);
 struct function_type {
     struct list_key_type_pair params;
     struct type *return_type;
+    // the struct returned is written through a pointer the caller passes first, `__rm_result`.
+    int returns_through_pointer;
+    // the declaration's `#[...]` attributes, NULL for functions the compiler declares.
+    struct list_attribute *attributes;
+    // `async fn`, whose calls make a `struct <name>_task` that's resumed until it's done. The
+    // declaration keeps the type it returns, its entry in the global context returns the task.
+    int is_async;
 };
 
 struct struct_type {
     struct list_key_type_pair pairs;
     int predefined;
+    // the declaration's `#[...]` attributes, NULL for structs the compiler declares.
+    struct list_attribute *attributes;
 };
 
 struct enum_type {
@@ -95,7 +132,8 @@ enum expression_kind {
     GROUP_EXPRESSION,
     FUNCTION_EXPRESSION,
     VOID_EXPRESSION,
-    MEMBER_ACCESS_EXPRESSION
+    MEMBER_ACCESS_EXPRESSION,
+    INDEX_EXPRESSION
 };
 
 enum literal_expression_kind {
@@ -157,7 +195,9 @@ struct binary_expression {
 enum unary_operator {
     BANG_UNARY = 1,
     STAR_UNARY,
-    MINUS_UNARY
+    MINUS_UNARY,
+    // `await x`, only the whole value of a statement within an `async fn`.
+    AWAIT_UNARY
 };
 
 struct unary_expression {
@@ -168,6 +208,8 @@ struct unary_expression {
 struct function_expression {
     struct list_char *function_name;
     struct list_expression *params;
+    // `x.f(y)`, until type inference resolves `f` against the type of `x`, which is `params[0]`.
+    int method_call;
 };
 
 struct member_access_expression {
@@ -175,6 +217,13 @@ struct member_access_expression {
     struct list_char *member_name;
 };
 
+struct index_expression {
+    struct expression *indexed;
+    struct expression *index;
+    // set when slicing, `indexed[index..end]`.
+    struct expression *end;
+};
+
 typedef struct expression {
     enum expression_kind kind;
     unsigned int id;
@@ -185,6 +234,7 @@ typedef struct expression {
         struct binary_expression binary;
         struct function_expression function;
         struct member_access_expression member_access;
+        struct index_expression index;
     };
 } expression;
 
@@ -199,8 +249,10 @@ enum statement_kind {
     WHILE_LOOP_STATEMENT,
     TYPE_DECLARATION_STATEMENT,
     BREAK_STATEMENT,
+    CONTINUE_STATEMENT,
 	SWITCH_STATEMENT,
-    C_BLOCK_STATEMENT
+    C_BLOCK_STATEMENT,
+    FOR_LOOP_STATEMENT
 };
 
 enum switch_pattern_kind {
@@ -253,9 +305,22 @@ typedef struct switch_pattern {
 
 struct_list(switch_pattern);
 
+// `#[name]` or `#[name(argument)]`, written before a declaration.
+typedef struct attribute {
+    struct list_char name;
+    int has_argument;
+    // set for identifier arguments, like `declared` in `#[repr(declared)]`.
+    struct list_char argument;
+    // set for numeric arguments, like `64` in `#[align(64)]`.
+    double numeric_argument;
+} attribute;
+
+struct_list(attribute);
+
 struct type_declaration_statement {
     struct type type;
     struct list_statement *statements;
+    struct list_attribute attributes;
 };
 
 struct binding_statement {
@@ -265,10 +330,18 @@ struct binding_statement {
     int has_type;
 };
 
+// `#[likely] if` expects the condition to hold, `#[cold] if` expects it not to.
+enum branch_hint {
+    BRANCH_UNHINTED,
+    BRANCH_LIKELY,
+    BRANCH_COLD
+};
+
 struct if_statement {
     struct expression condition;
     struct statement *success_statement;
     struct statement *else_statement;
+    enum branch_hint hint;
 };
 
 struct while_loop_statement {
@@ -276,6 +349,20 @@ struct while_loop_statement {
     struct statement *do_statement;
 };
 
+// `for (x in iterated)` over the elements of a slice or array, or `for (i in iterated..end)` over
+// a range of integers.
+struct for_loop_statement {
+    struct list_char variable_name;
+    struct expression iterated;
+    struct expression *end;
+    struct statement *do_statement;
+    // `parallel for (i in iterated..end)`, whose iterations are shared between threads.
+    int parallel;
+    // set by `qualify_element_pointers` when nothing the body does could write the elements
+    // through another pointer, so they're read through a `restrict` one.
+    int restrict_elements;
+};
+
 typedef struct case_statement {
 	struct switch_pattern pattern;
     struct statement *statement;
@@ -283,9 +370,13 @@ typedef struct case_statement {
 
 struct_list(case_statement);
 
+struct decision_tree;
+
 struct switch_statement {
 	struct expression switch_expression;
 	struct list_case_statement cases;
+	// set by the type checker when the cases destructure objects or arrays.
+	struct decision_tree *decision_tree;
 };
 
 typedef struct statement_metadata {
@@ -309,6 +400,7 @@ typedef struct statement {
         struct if_statement if_statement;
         struct list_statement *statements;
         struct while_loop_statement while_loop_statement;
+        struct for_loop_statement for_loop_statement;
         struct type_declaration_statement type_declaration;
         struct switch_statement switch_statement;
         struct c_block_statement c_block_statement;
@@ -0,0 +1,257 @@
+#include <string.h>
+#include "atomics.h"
+#include "layout.h"
+#include "../lib/collections.h"
+
+struct atomic_info {
+    enum primitive_type primitive;
+    char *name;
+};
+
+static struct atomic_info atomics[] = {
+    { BOOL, "bool" },
+    { U8, "u8" },
+    { I8, "i8" },
+    { U16, "u16" },
+    { I16, "i16" },
+    { U32, "u32" },
+    { I32, "i32" },
+    { U64, "u64" },
+    { I64, "i64" },
+    { USIZE, "usize" },
+};
+
+#define ATOMIC_COUNT (sizeof(atomics) / sizeof(*atomics))
+
+static char *atomic_operations[] = {
+    "load", "store", "exchange", "compare_exchange", "fetch_add", "fetch_sub"
+};
+
+// in the order `enum memory_order` declares its variants.
+static char *memory_orders[] = { "relaxed", "acquire", "release", "acq_rel", "seq_cst" };
+
+#define MEMORY_ORDER_COUNT (sizeof(memory_orders) / sizeof(*memory_orders))
+
+struct atomic_info *find_atomic(enum primitive_type primitive)
+{
+    for (size_t i = 0; i < ATOMIC_COUNT; i++) {
+        if (atomics[i].primitive == primitive) return &atomics[i];
+    }
+    return NULL;
+}
+
+int is_atomic_primitive(enum primitive_type primitive)
+{
+    return find_atomic(primitive) != NULL;
+}
+
+// The modifiers other than `mut`, which says nothing about how the storage is accessed.
+size_t unmuted_modifiers(struct type *ty, enum type_modifier_kind *out, size_t capacity)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        if (ty->modifiers.data[i].kind == MUTABLE_MODIFIER_KIND) continue;
+        if (count < capacity) out[count] = ty->modifiers.data[i].kind;
+        count++;
+    }
+    return count;
+}
+
+int is_atomic_type(struct type *ty)
+{
+    enum type_modifier_kind kinds[1] = {0};
+    return ty->kind == TY_PRIMITIVE
+        && unmuted_modifiers(ty, kinds, 1) == 1
+        && kinds[0] == ATOMIC_MODIFIER_KIND;
+}
+
+int is_atomic_pointer(struct type *ty)
+{
+    enum type_modifier_kind kinds[2] = {0};
+    return ty->kind == TY_PRIMITIVE
+        && unmuted_modifiers(ty, kinds, 2) == 2
+        && kinds[0] == POINTER_MODIFIER_KIND
+        && kinds[1] == ATOMIC_MODIFIER_KIND;
+}
+
+int holds_atomic_storage_within(struct type *ty, struct global_context *global_context, size_t depth)
+{
+    // a struct only holds itself through a pointer, this just bounds a malformed one.
+    if (depth > 64) return 0;
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        enum type_modifier_kind kind = ty->modifiers.data[i].kind;
+        if (kind == POINTER_MODIFIER_KIND || kind == SLICE_MODIFIER_KIND) return 0;
+        if (kind == ATOMIC_MODIFIER_KIND) return 1;
+    }
+    if (ty->kind != TY_STRUCT) return 0;
+
+    struct type *defined = find_data_type(global_context, ty->name);
+    if (defined == NULL || defined->kind != TY_STRUCT) return 0;
+    for (size_t i = 0; i < defined->struct_type.pairs.size; i++) {
+        if (holds_atomic_storage_within(defined->struct_type.pairs.data[i].field_type, global_context, depth + 1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int holds_atomic_storage(struct type *ty, struct global_context *global_context)
+{
+    return holds_atomic_storage_within(ty, global_context, 0);
+}
+
+char *atomic_method_prefix(struct type *receiver)
+{
+    if (!is_atomic_type(receiver) && !is_atomic_pointer(receiver)) return NULL;
+    struct atomic_info *info = find_atomic(receiver->primitive_type);
+    if (info == NULL) return NULL;
+
+    char *prefix = malloc(strlen("atomic_") + strlen(info->name) + 1);
+    strcpy(prefix, "atomic_");
+    strcat(prefix, info->name);
+    return prefix;
+}
+
+struct type *atomic_scalar(enum primitive_type primitive, int atomic)
+{
+    struct type *ty = malloc(sizeof(*ty));
+    *ty = (struct type) {
+        .kind = TY_PRIMITIVE,
+        .modifiers = list_create(type_modifier, 1),
+        .primitive_type = primitive
+    };
+    if (atomic) {
+        list_append(&ty->modifiers, ((struct type_modifier) { .kind = ATOMIC_MODIFIER_KIND }));
+    }
+    return ty;
+}
+
+struct list_char *atomic_boxed_name(char *name)
+{
+    struct list_char *out = malloc(sizeof(*out));
+    *out = list_create(char, (strlen(name) + 1));
+    append_list_char_slice(out, name);
+    list_append(out, '\0');
+    return out;
+}
+
+struct type *memory_order_type(void)
+{
+    struct type *ty = malloc(sizeof(*ty));
+    *ty = (struct type) {
+        .kind = TY_ENUM,
+        .name = atomic_boxed_name("memory_order"),
+        .modifiers = list_create(type_modifier, 1),
+        .enum_type = (struct enum_type) { .predefined = 1 }
+    };
+    return ty;
+}
+
+struct key_type_pair atomic_param(char *name, struct type *ty)
+{
+    return (struct key_type_pair) { .field_name = *atomic_boxed_name(name), .field_type = ty };
+}
+
+void declare_memory_order(struct global_context *global_context)
+{
+    struct list_key_type_pair variants = list_create(key_type_pair, MEMORY_ORDER_COUNT);
+    for (size_t i = 0; i < MEMORY_ORDER_COUNT; i++) {
+        list_append(&variants, atomic_param(memory_orders[i], atomic_scalar(VOID, 0)));
+    }
+
+    list_append(&global_context->data_types, ((struct type) {
+        .kind = TY_ENUM,
+        .name = atomic_boxed_name("memory_order"),
+        .modifiers = list_create(type_modifier, 1),
+        .enum_type = (struct enum_type) { .pairs = variants }
+    }));
+}
+
+void declare_atomic_function(struct atomic_info *info,
+                             char *operation,
+                             struct type *return_type,
+                             struct list_key_type_pair params,
+                             struct global_context *global_context)
+{
+    struct list_char *name = malloc(sizeof(*name));
+    *name = list_create(char, (strlen(info->name) + strlen(operation) + 9));
+    append_list_char_slice(name, "atomic_");
+    append_list_char_slice(name, info->name);
+    append_list_char_slice(name, "_");
+    append_list_char_slice(name, operation);
+    list_append(name, '\0');
+
+    list_append(&global_context->fn_types, ((struct type) {
+        .kind = TY_FUNCTION,
+        .name = name,
+        .modifiers = list_create(type_modifier, 1),
+        .function_type = (struct function_type) {
+            .params = params,
+            .return_type = return_type
+        }
+    }));
+}
+
+void declare_atomic_functions(struct global_context *global_context)
+{
+    declare_memory_order(global_context);
+
+    for (size_t i = 0; i < ATOMIC_COUNT; i++) {
+        struct atomic_info *info = &atomics[i];
+        enum primitive_type value = info->primitive;
+
+        struct list_key_type_pair load = list_create(key_type_pair, 2);
+        list_append(&load, atomic_param("location", atomic_scalar(value, 1)));
+        list_append(&load, atomic_param("order", memory_order_type()));
+        declare_atomic_function(info, "load", atomic_scalar(value, 0), load, global_context);
+
+        struct list_key_type_pair store = list_create(key_type_pair, 3);
+        list_append(&store, atomic_param("location", atomic_scalar(value, 1)));
+        list_append(&store, atomic_param("value", atomic_scalar(value, 0)));
+        list_append(&store, atomic_param("order", memory_order_type()));
+        declare_atomic_function(info, "store", atomic_scalar(VOID, 0), store, global_context);
+
+        struct list_key_type_pair compare_exchange = list_create(key_type_pair, 5);
+        list_append(&compare_exchange, atomic_param("location", atomic_scalar(value, 1)));
+        list_append(&compare_exchange, atomic_param("expected", atomic_scalar(value, 0)));
+        list_append(&compare_exchange, atomic_param("desired", atomic_scalar(value, 0)));
+        list_append(&compare_exchange, atomic_param("success", memory_order_type()));
+        list_append(&compare_exchange, atomic_param("failure", memory_order_type()));
+        declare_atomic_function(info, "compare_exchange", atomic_scalar(BOOL, 0), compare_exchange, global_context);
+
+        // C has no arithmetic on an atomic bool.
+        char *swaps[] = { "exchange", "fetch_add", "fetch_sub" };
+        size_t swap_count = value == BOOL ? 1 : sizeof(swaps) / sizeof(*swaps);
+        for (size_t j = 0; j < swap_count; j++) {
+            struct list_key_type_pair params = list_create(key_type_pair, 3);
+            list_append(&params, atomic_param("location", atomic_scalar(value, 1)));
+            list_append(&params, atomic_param("value", atomic_scalar(value, 0)));
+            list_append(&params, atomic_param("order", memory_order_type()));
+            declare_atomic_function(info, swaps[j], atomic_scalar(value, 0), params, global_context);
+        }
+    }
+}
+
+int atomic_function(struct list_char *name, enum primitive_type *primitive, char **operation)
+{
+    if (strncmp(name->data, "atomic_", 7) != 0) return 0;
+    for (size_t i = 0; i < ATOMIC_COUNT; i++) {
+        char *rest = name->data + 7;
+        size_t length = strlen(atomics[i].name);
+        if (strncmp(rest, atomics[i].name, length) != 0 || rest[length] != '_') continue;
+
+        for (size_t j = 0; j < sizeof(atomic_operations) / sizeof(*atomic_operations); j++) {
+            if (!strcmp(rest + length + 1, atomic_operations[j])) {
+                *primitive = atomics[i].primitive;
+                *operation = atomic_operations[j];
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+char *memory_order_variant(size_t index)
+{
+    return index < MEMORY_ORDER_COUNT ? memory_orders[index] : NULL;
+}
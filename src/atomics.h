@@ -0,0 +1,31 @@
+#ifndef ATOMICS_H
+#define ATOMICS_H
+
+#include "ast.h"
+#include "parser.h"
+
+// `atomic T` is an integer or bool lowered to C11's `_Atomic(T)`. It's only read and written
+// through its methods, which each take how the access is ordered as an `enum memory_order`.
+int is_atomic_primitive(enum primitive_type primitive);
+// The atomic storage itself, `atomic T` or `mut atomic T`, rather than a pointer or array of it.
+int is_atomic_type(struct type *ty);
+// `*atomic T`, which the methods can be called through too.
+int is_atomic_pointer(struct type *ty);
+// Whether a value of the type holds atomic storage itself, as a struct with an atomic field does,
+// rather than only behind a pointer or slice.
+int holds_atomic_storage(struct type *ty, struct global_context *global_context);
+// The receiver's name for its methods, `atomic_<T>`, when it's atomic or points to something atomic.
+char *atomic_method_prefix(struct type *receiver);
+
+// Declares `enum memory_order`, and for each atomic type the methods `load(order)`,
+// `store(value, order)`, `exchange(value, order)` and `compare_exchange(expected, desired,
+// success, failure)`, with `fetch_add(value, order)` and `fetch_sub(value, order)` for integers.
+// They've no body, the lowering writes each call as the `stdatomic.h` one.
+void declare_atomic_functions(struct global_context *global_context);
+// Which atomic function it is, the primitive it's on and the part of its name after the type's.
+int atomic_function(struct list_char *name, enum primitive_type *primitive, char **operation);
+// The variants of `enum memory_order` in order, `NULL` past the last. Each is `stdatomic.h`'s
+// `memory_order_<variant>`.
+char *memory_order_variant(size_t index);
+
+#endif
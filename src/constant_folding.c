@@ -0,0 +1,1483 @@
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include "ast.h"
+#include "parser.h"
+#include "error.h"
+#include "constant_folding.h"
+#include "../lib/collections.h"
+#include "../lib/utils.h"
+
+// Largest magnitude a double holds exactly, past this integer folding isn't trustworthy.
+#define EXACT_INTEGER_LIMIT 9007199254740992.0
+
+typedef struct folded_constant {
+    struct list_char name;
+    struct literal_expression value;
+    // the binding's declared type, NULL when it was left to inference and so is the literal's.
+    struct type *type;
+} folded_constant;
+
+struct_list(folded_constant);
+
+typedef struct unstable_name {
+    struct list_char name;
+} unstable_name;
+
+struct_list(unstable_name);
+
+struct fold_state {
+    struct global_context *global_context;
+    // the file's declarations, where the functions compile time evaluation calls are found.
+    struct list_statement *statements;
+    // immutable bindings, in scope, which have been folded down to a literal.
+    struct list_folded_constant constants;
+    // names assigned to (or touched by inline C) somewhere in the current function.
+    struct list_unstable_name *unstable_names;
+};
+
+static void add_error_inner(struct statement_metadata *metadata,
+                            char *error_message,
+                            struct error *out)
+{
+    add_error(metadata->row, metadata->col, metadata->file_name, out, error_message);
+}
+
+int is_constant_literal(struct expression *e)
+{
+    if (e->kind != LITERAL_EXPRESSION) {
+        return 0;
+    }
+
+    switch (e->literal.kind) {
+        case LITERAL_BOOLEAN:
+        case LITERAL_CHAR:
+        case LITERAL_NUMERIC:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int is_integral(double value)
+{
+    return floor(value) == value && fabs(value) < EXACT_INTEGER_LIMIT;
+}
+
+int fits_i32(double value)
+{
+    return is_integral(value) && value >= -2147483648.0 && value <= 2147483647.0;
+}
+
+int is_unstable_name(struct fold_state *state, struct list_char *name)
+{
+    for (size_t i = 0; i < state->unstable_names->size; i++) {
+        if (list_char_eq(&state->unstable_names->data[i].name, name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void collect_assigned_names(struct expression *e, struct list_unstable_name *out)
+{
+    switch (e->kind) {
+        case BINARY_EXPRESSION:
+        {
+            if (e->binary.binary_op == ASSIGN_BINARY) {
+                struct expression *target = e->binary.l;
+                while (target->kind == GROUP_EXPRESSION) {
+                    target = target->grouped;
+                }
+                if (target->kind == LITERAL_EXPRESSION && target->literal.kind == LITERAL_NAME) {
+                    list_append(out, ((struct unstable_name) { .name = *target->literal.name }));
+                }
+            }
+            collect_assigned_names(e->binary.l, out);
+            collect_assigned_names(e->binary.r, out);
+            return;
+        }
+        case UNARY_EXPRESSION:
+            collect_assigned_names(e->unary.expression, out);
+            return;
+        case GROUP_EXPRESSION:
+            collect_assigned_names(e->grouped, out);
+            return;
+        case FUNCTION_EXPRESSION:
+        {
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                collect_assigned_names(&e->function.params->data[i], out);
+            }
+            return;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+            collect_assigned_names(e->member_access.accessed, out);
+            return;
+        case INDEX_EXPRESSION:
+            collect_assigned_names(e->index.indexed, out);
+            collect_assigned_names(e->index.index, out);
+            if (e->index.end != NULL) {
+                collect_assigned_names(e->index.end, out);
+            }
+            return;
+        case LITERAL_EXPRESSION:
+        case VOID_EXPRESSION:
+            return;
+    }
+}
+
+void collect_unstable_names(struct statement *s,
+                            struct list_statement *c_blocks,
+                            struct list_unstable_name *out)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            collect_assigned_names(&s->binding_statement.value, out);
+            return;
+        case IF_STATEMENT:
+        {
+            collect_assigned_names(&s->if_statement.condition, out);
+            collect_unstable_names(s->if_statement.success_statement, c_blocks, out);
+            if (s->if_statement.else_statement != NULL) {
+                collect_unstable_names(s->if_statement.else_statement, c_blocks, out);
+            }
+            return;
+        }
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+            collect_assigned_names(&s->expression, out);
+            return;
+        case BLOCK_STATEMENT:
+        {
+            for (size_t i = 0; i < s->statements->size; i++) {
+                collect_unstable_names(&s->statements->data[i], c_blocks, out);
+            }
+            return;
+        }
+        case WHILE_LOOP_STATEMENT:
+        {
+            collect_assigned_names(&s->while_loop_statement.condition, out);
+            collect_unstable_names(s->while_loop_statement.do_statement, c_blocks, out);
+            return;
+        }
+        case FOR_LOOP_STATEMENT:
+        {
+            collect_assigned_names(&s->for_loop_statement.iterated, out);
+            if (s->for_loop_statement.end != NULL) {
+                collect_assigned_names(s->for_loop_statement.end, out);
+            }
+            collect_unstable_names(s->for_loop_statement.do_statement, c_blocks, out);
+            return;
+        }
+        case SWITCH_STATEMENT:
+        {
+            collect_assigned_names(&s->switch_statement.switch_expression, out);
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                collect_unstable_names(s->switch_statement.cases.data[i].statement, c_blocks, out);
+            }
+            return;
+        }
+        case C_BLOCK_STATEMENT:
+            list_append(c_blocks, *s);
+            return;
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+            return;
+    }
+}
+
+struct folded_constant *find_constant(struct fold_state *state, struct list_char *name)
+{
+    // walk backwards, so the innermost binding wins.
+    for (size_t i = state->constants.size; i > 0; i--) {
+        struct folded_constant *constant = &state->constants.data[i - 1];
+        if (list_char_eq(&constant->name, name)) {
+            return constant;
+        }
+    }
+    return NULL;
+}
+
+// The names bound anywhere within the statement, nested blocks included.
+void collect_bound_names(struct statement *s, struct list_unstable_name *out)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            list_append(out, ((struct unstable_name) { .name = s->binding_statement.variable_name }));
+            return;
+        case IF_STATEMENT:
+            collect_bound_names(s->if_statement.success_statement, out);
+            if (s->if_statement.else_statement != NULL) {
+                collect_bound_names(s->if_statement.else_statement, out);
+            }
+            return;
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                collect_bound_names(&s->statements->data[i], out);
+            }
+            return;
+        case WHILE_LOOP_STATEMENT:
+            collect_bound_names(s->while_loop_statement.do_statement, out);
+            return;
+        case FOR_LOOP_STATEMENT:
+            collect_bound_names(s->for_loop_statement.do_statement, out);
+            return;
+        case SWITCH_STATEMENT:
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                collect_bound_names(s->switch_statement.cases.data[i].statement, out);
+            }
+            return;
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+        case C_BLOCK_STATEMENT:
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+            return;
+    }
+}
+
+int lookup_constant(struct fold_state *state,
+                    struct list_char *name,
+                    struct literal_expression *out)
+{
+    struct folded_constant *constant = find_constant(state, name);
+    if (constant == NULL) return 0;
+    *out = constant->value;
+    return 1;
+}
+
+// Whether inference gives the literal the type, numbers being `i32`, chars `u8` and booleans
+// `bool`. Otherwise the expressions around a name would change type once it's replaced.
+int literal_has_type(struct literal_expression *value, struct type *ty)
+{
+    if (ty->kind != TY_PRIMITIVE || ty->modifiers.size > 0) return 0;
+    switch (value->kind) {
+        case LITERAL_NUMERIC:
+            return ty->primitive_type == I32;
+        case LITERAL_CHAR:
+            return ty->primitive_type == U8;
+        case LITERAL_BOOLEAN:
+            return ty->primitive_type == BOOL;
+        default:
+            return 0;
+    }
+}
+
+void forget_constant(struct fold_state *state, struct list_char *name)
+{
+    for (size_t i = 0; i < state->constants.size; i++) {
+        if (list_char_eq(&state->constants.data[i].name, name)) {
+            state->constants.data[i].name = (struct list_char) {0};
+        }
+    }
+}
+
+void replace_with_literal(struct expression *e, struct literal_expression literal)
+{
+    unsigned int id = e->id;
+    *e = (struct expression) {
+        .kind = LITERAL_EXPRESSION,
+        .id = id,
+        .literal = literal
+    };
+}
+
+struct literal_expression numeric_literal(double value)
+{
+    return (struct literal_expression) {
+        .kind = LITERAL_NUMERIC,
+        .numeric = value
+    };
+}
+
+struct literal_expression boolean_literal(int value)
+{
+    return (struct literal_expression) {
+        .kind = LITERAL_BOOLEAN,
+        .boolean = value != 0
+    };
+}
+
+// chars compare like the small integers they lower to.
+int literal_as_number(struct literal_expression *l, double *out)
+{
+    switch (l->kind) {
+        case LITERAL_NUMERIC:
+            *out = l->numeric;
+            return 1;
+        case LITERAL_CHAR:
+            *out = (double)l->character;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int fold_arithmetic(enum binary_operator op, double l, double r, struct literal_expression *out)
+{
+    int integral = is_integral(l) && is_integral(r);
+    double result = 0;
+    switch (op) {
+        case PLUS_BINARY:
+            result = l + r;
+            break;
+        case MINUS_BINARY:
+            result = l - r;
+            break;
+        case MULTIPLY_BINARY:
+            result = l * r;
+            break;
+        case BITWISE_OR_BINARY:
+        case BITWISE_AND_BINARY:
+        {
+            if (!fits_i32(l) || !fits_i32(r)) return 0;
+            long long li = (long long)l;
+            long long ri = (long long)r;
+            result = (double)(op == BITWISE_OR_BINARY ? (li | ri) : (li & ri));
+            break;
+        }
+        default:
+            return 0;
+    }
+
+    // integer literals lower to `int`, leave anything that would overflow to the C compiler.
+    if (integral && !fits_i32(result)) return 0;
+    *out = numeric_literal(result);
+    return 1;
+}
+
+int fold_binary_literals(enum binary_operator op,
+                         struct literal_expression *l,
+                         struct literal_expression *r,
+                         struct literal_expression *out)
+{
+    if (l->kind == LITERAL_BOOLEAN && r->kind == LITERAL_BOOLEAN) {
+        switch (op) {
+            case AND_BINARY:
+                *out = boolean_literal(l->boolean && r->boolean);
+                return 1;
+            case OR_BINARY:
+                *out = boolean_literal(l->boolean || r->boolean);
+                return 1;
+            case EQUAL_TO_BINARY:
+                *out = boolean_literal(l->boolean == r->boolean);
+                return 1;
+            default:
+                return 0;
+        }
+    }
+
+    double lv = 0;
+    double rv = 0;
+    if (!literal_as_number(l, &lv) || !literal_as_number(r, &rv)) {
+        return 0;
+    }
+
+    switch (op) {
+        case GREATER_THAN_BINARY:
+            *out = boolean_literal(lv > rv);
+            return 1;
+        case LESS_THAN_BINARY:
+            *out = boolean_literal(lv < rv);
+            return 1;
+        case EQUAL_TO_BINARY:
+            *out = boolean_literal(lv == rv);
+            return 1;
+        case PLUS_BINARY:
+        case MINUS_BINARY:
+        case MULTIPLY_BINARY:
+        case BITWISE_OR_BINARY:
+        case BITWISE_AND_BINARY:
+            if (l->kind != LITERAL_NUMERIC || r->kind != LITERAL_NUMERIC) return 0;
+            return fold_arithmetic(op, lv, rv, out);
+        case OR_BINARY:
+        case AND_BINARY:
+        case ASSIGN_BINARY:
+            return 0;
+    }
+
+    UNREACHABLE("fold_binary_literals fell out of a switch");
+}
+
+// Whether the literal is a value of the type, so it can stand in for one.
+int literal_fits_type(struct type *ty, struct literal_expression *value)
+{
+    if (ty->kind != TY_PRIMITIVE || ty->modifiers.size > 0) {
+        return 0;
+    }
+
+    if (value->kind == LITERAL_BOOLEAN) {
+        return ty->primitive_type == BOOL;
+    }
+
+    double v = 0;
+    if (!literal_as_number(value, &v)) {
+        return 0;
+    }
+
+    switch (ty->primitive_type) {
+        case I8:
+            return is_integral(v) && v >= -128 && v <= 127;
+        case U8:
+            return is_integral(v) && v >= 0 && v <= 255;
+        case I16:
+            return is_integral(v) && v >= -32768 && v <= 32767;
+        case U16:
+            return is_integral(v) && v >= 0 && v <= 65535;
+        case I32:
+            return fits_i32(v);
+        case U32:
+        case U64:
+        case USIZE:
+            return fits_i32(v) && v >= 0;
+        case I64:
+            return fits_i32(v);
+        case F32:
+            return is_integral(v) && fabs(v) <= 16777216.0;
+        case F64:
+            return 1;
+        case BOOL:
+        case VOID:
+        case ARENA:
+        case F32X4:
+        case F32X8:
+        case I32X4:
+        case I32X8:
+        case U8X16:
+        case U8X32:
+            return 0;
+    }
+
+    return 0;
+}
+
+void fold_expression(struct expression *e, struct fold_state *state);
+
+// Calls to pure functions with constant arguments are run here rather than at run time. A function
+// qualifies when it takes and returns only signed integers and bools and holds no inline C, so
+// nothing it does can reach memory, and C's unsigned wrapping and float rounding never come into
+// it. The evaluator gives up, leaving the call to run time, on anything else it meets, a value
+// that doesn't fit its type, or once it has taken `EVALUATION_STEP_BUDGET` steps.
+#define EVALUATION_STEP_BUDGET 100000
+#define EVALUATION_DEPTH_LIMIT 200
+
+struct evaluation {
+    struct list_statement *statements;
+    size_t steps;
+    size_t depth;
+};
+
+typedef struct evaluated_variable {
+    struct list_char name;
+    // the declared type, or the one inference will give the binding.
+    struct type *type;
+    struct literal_expression value;
+} evaluated_variable;
+
+struct_list(evaluated_variable);
+
+typedef struct literal_expression literal_expression;
+
+struct_list(literal_expression);
+
+enum evaluation_flow {
+    FLOW_NEXT = 1,
+    FLOW_RETURN,
+    FLOW_BREAK,
+    FLOW_CONTINUE,
+    FLOW_FAILED
+};
+
+int is_evaluable_type(struct type *ty)
+{
+    if (ty->kind != TY_PRIMITIVE || ty->modifiers.size > 0) {
+        return 0;
+    }
+
+    switch (ty->primitive_type) {
+        case BOOL:
+        case I8:
+        case I16:
+        case I32:
+        case I64:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int is_evaluable_statement(struct statement *s)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            return !s->binding_statement.has_type || is_evaluable_type(&s->binding_statement.variable_type);
+        case IF_STATEMENT:
+            return is_evaluable_statement(s->if_statement.success_statement)
+                && (s->if_statement.else_statement == NULL
+                    || is_evaluable_statement(s->if_statement.else_statement));
+        case BLOCK_STATEMENT:
+        {
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (!is_evaluable_statement(&s->statements->data[i])) return 0;
+            }
+            return 1;
+        }
+        case WHILE_LOOP_STATEMENT:
+            return is_evaluable_statement(s->while_loop_statement.do_statement);
+        case FOR_LOOP_STATEMENT:
+            return s->for_loop_statement.end != NULL
+                && is_evaluable_statement(s->for_loop_statement.do_statement);
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+            return 1;
+        case SWITCH_STATEMENT:
+        case TYPE_DECLARATION_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return 0;
+    }
+
+    UNREACHABLE("is_evaluable_statement fell out of a switch");
+}
+
+struct type_declaration_statement *find_pure_function(struct evaluation *evaluation, struct list_char *name)
+{
+    for (size_t i = 0; i < evaluation->statements->size; i++) {
+        struct statement *s = &evaluation->statements->data[i];
+        if (s->kind != TYPE_DECLARATION_STATEMENT
+            || s->type_declaration.type.kind != TY_FUNCTION
+            || s->type_declaration.statements == NULL
+            || !list_char_eq(s->type_declaration.type.name, name))
+        {
+            continue;
+        }
+
+        struct function_type *fn = &s->type_declaration.type.function_type;
+        // calling an async fn only makes its task.
+        if (fn->is_async) return NULL;
+        if (!is_evaluable_type(fn->return_type)) return NULL;
+        for (size_t p = 0; p < fn->params.size; p++) {
+            if (!is_evaluable_type(fn->params.data[p].field_type)) return NULL;
+        }
+        for (size_t j = 0; j < s->type_declaration.statements->size; j++) {
+            if (!is_evaluable_statement(&s->type_declaration.statements->data[j])) return NULL;
+        }
+        return &s->type_declaration;
+    }
+    return NULL;
+}
+
+struct evaluated_variable *find_variable(struct list_evaluated_variable *variables, struct list_char *name)
+{
+    for (size_t i = variables->size; i > 0; i--) {
+        if (list_char_eq(&variables->data[i - 1].name, name)) {
+            return &variables->data[i - 1];
+        }
+    }
+    return NULL;
+}
+
+int evaluate_call(struct type_declaration_statement *fn,
+                  struct list_literal_expression *arguments,
+                  struct evaluation *evaluation,
+                  struct literal_expression *out);
+
+struct type evaluated_bool_type = { .kind = TY_PRIMITIVE, .primitive_type = BOOL };
+struct type evaluated_char_type = { .kind = TY_PRIMITIVE, .primitive_type = U8 };
+struct type evaluated_numeric_type = { .kind = TY_PRIMITIVE, .primitive_type = I32 };
+
+// The type inference will give the expression, by the same rules: arithmetic takes its left
+// operand's type, so `x + x` on an i8 is an i8 and wraps once bound. NULL when it can't be told.
+struct type *evaluated_type(struct expression *e,
+                            struct evaluation *evaluation,
+                            struct list_evaluated_variable *variables)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            switch (e->literal.kind) {
+                case LITERAL_BOOLEAN:
+                    return &evaluated_bool_type;
+                case LITERAL_CHAR:
+                    return &evaluated_char_type;
+                case LITERAL_NUMERIC:
+                    return &evaluated_numeric_type;
+                case LITERAL_NAME:
+                {
+                    struct evaluated_variable *variable = find_variable(variables, e->literal.name);
+                    return variable == NULL ? NULL : variable->type;
+                }
+                default:
+                    return NULL;
+            }
+        }
+        case GROUP_EXPRESSION:
+            return evaluated_type(e->grouped, evaluation, variables);
+        case UNARY_EXPRESSION:
+            return evaluated_type(e->unary.expression, evaluation, variables);
+        case BINARY_EXPRESSION:
+        {
+            switch (e->binary.binary_op) {
+                case MULTIPLY_BINARY:
+                case PLUS_BINARY:
+                case MINUS_BINARY:
+                case ASSIGN_BINARY:
+                case BITWISE_OR_BINARY:
+                case BITWISE_AND_BINARY:
+                    return evaluated_type(e->binary.l, evaluation, variables);
+                case GREATER_THAN_BINARY:
+                case LESS_THAN_BINARY:
+                case EQUAL_TO_BINARY:
+                case OR_BINARY:
+                case AND_BINARY:
+                    return &evaluated_bool_type;
+            }
+            return NULL;
+        }
+        case FUNCTION_EXPRESSION:
+        {
+            if (e->function.method_call) return NULL;
+            struct type_declaration_statement *fn = find_pure_function(evaluation, e->function.function_name);
+            return fn == NULL ? NULL : fn->type.function_type.return_type;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+        case INDEX_EXPRESSION:
+        case VOID_EXPRESSION:
+            return NULL;
+    }
+
+    UNREACHABLE("evaluated_type fell out of a switch");
+}
+
+int evaluate_expression(struct expression *e,
+                        struct evaluation *evaluation,
+                        struct list_evaluated_variable *variables,
+                        struct literal_expression *out)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            switch (e->literal.kind) {
+                case LITERAL_BOOLEAN:
+                case LITERAL_CHAR:
+                    *out = e->literal;
+                    return 1;
+                case LITERAL_NUMERIC:
+                    *out = e->literal;
+                    return is_integral(e->literal.numeric);
+                case LITERAL_NAME:
+                {
+                    struct evaluated_variable *variable = find_variable(variables, e->literal.name);
+                    if (variable == NULL) return 0;
+                    *out = variable->value;
+                    return 1;
+                }
+                default:
+                    return 0;
+            }
+        }
+        case GROUP_EXPRESSION:
+            return evaluate_expression(e->grouped, evaluation, variables, out);
+        case UNARY_EXPRESSION:
+        {
+            struct literal_expression inner = {0};
+            if (!evaluate_expression(e->unary.expression, evaluation, variables, &inner)) return 0;
+            if (e->unary.unary_operator == BANG_UNARY && inner.kind == LITERAL_BOOLEAN) {
+                *out = boolean_literal(!inner.boolean);
+                return 1;
+            }
+            if (e->unary.unary_operator == MINUS_UNARY && inner.kind == LITERAL_NUMERIC) {
+                *out = numeric_literal(-inner.numeric);
+                return 1;
+            }
+            return 0;
+        }
+        case BINARY_EXPRESSION:
+        {
+            struct binary_expression *binary = &e->binary;
+            if (binary->binary_op == ASSIGN_BINARY) {
+                struct expression *target = binary->l;
+                while (target->kind == GROUP_EXPRESSION) {
+                    target = target->grouped;
+                }
+                if (target->kind != LITERAL_EXPRESSION || target->literal.kind != LITERAL_NAME) return 0;
+                struct evaluated_variable *variable = find_variable(variables, target->literal.name);
+                if (variable == NULL) return 0;
+                if (!evaluate_expression(binary->r, evaluation, variables, out)) return 0;
+                if (!literal_fits_type(variable->type, out)) return 0;
+                variable->value = *out;
+                return 1;
+            }
+
+            struct literal_expression l = {0};
+            struct literal_expression r = {0};
+            if (!evaluate_expression(binary->l, evaluation, variables, &l)) return 0;
+            if (l.kind == LITERAL_BOOLEAN
+                && ((binary->binary_op == AND_BINARY && !l.boolean)
+                    || (binary->binary_op == OR_BINARY && l.boolean)))
+            {
+                *out = l;
+                return 1;
+            }
+            if (!evaluate_expression(binary->r, evaluation, variables, &r)) return 0;
+            return fold_binary_literals(binary->binary_op, &l, &r, out);
+        }
+        case FUNCTION_EXPRESSION:
+        {
+            // a method isn't resolved to its function until type inference.
+            if (e->function.method_call) return 0;
+            struct type_declaration_statement *fn = find_pure_function(evaluation, e->function.function_name);
+            if (fn == NULL || fn->type.function_type.params.size != e->function.params->size) return 0;
+
+            struct list_literal_expression arguments = list_create(literal_expression, (e->function.params->size + 1));
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                struct literal_expression argument = {0};
+                if (!evaluate_expression(&e->function.params->data[i], evaluation, variables, &argument)) {
+                    return 0;
+                }
+                list_append(&arguments, argument);
+            }
+            return evaluate_call(fn, &arguments, evaluation, out);
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+        case INDEX_EXPRESSION:
+        case VOID_EXPRESSION:
+            return 0;
+    }
+
+    UNREACHABLE("evaluate_expression fell out of a switch");
+}
+
+enum evaluation_flow evaluate_statement(struct statement *s,
+                                        struct evaluation *evaluation,
+                                        struct list_evaluated_variable *variables,
+                                        struct literal_expression *return_value);
+
+// Runs a statement in a scope of its own, dropping whatever it binds.
+enum evaluation_flow evaluate_scoped_statement(struct statement *s,
+                                               struct evaluation *evaluation,
+                                               struct list_evaluated_variable *variables,
+                                               struct literal_expression *return_value)
+{
+    size_t variable_count = variables->size;
+    enum evaluation_flow flow = evaluate_statement(s, evaluation, variables, return_value);
+    variables->size = variable_count;
+    return flow;
+}
+
+int evaluate_condition(struct expression *e,
+                       struct evaluation *evaluation,
+                       struct list_evaluated_variable *variables,
+                       int *out)
+{
+    struct literal_expression condition = {0};
+    if (!evaluate_expression(e, evaluation, variables, &condition) || condition.kind != LITERAL_BOOLEAN) {
+        return 0;
+    }
+    *out = condition.boolean;
+    return 1;
+}
+
+enum evaluation_flow evaluate_statement(struct statement *s,
+                                        struct evaluation *evaluation,
+                                        struct list_evaluated_variable *variables,
+                                        struct literal_expression *return_value)
+{
+    if (++evaluation->steps > EVALUATION_STEP_BUDGET) {
+        return FLOW_FAILED;
+    }
+
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+        {
+            struct binding_statement *binding = &s->binding_statement;
+            struct literal_expression value = {0};
+            if (!evaluate_expression(&binding->value, evaluation, variables, &value)) return FLOW_FAILED;
+            struct type *type = binding->has_type
+                ? &binding->variable_type
+                : evaluated_type(&binding->value, evaluation, variables);
+            if (type == NULL || !literal_fits_type(type, &value)) return FLOW_FAILED;
+            list_append(variables, ((struct evaluated_variable) {
+                .name = binding->variable_name,
+                .type = type,
+                .value = value
+            }));
+            return FLOW_NEXT;
+        }
+        case IF_STATEMENT:
+        {
+            int condition = 0;
+            if (!evaluate_condition(&s->if_statement.condition, evaluation, variables, &condition)) {
+                return FLOW_FAILED;
+            }
+            if (condition) {
+                return evaluate_scoped_statement(s->if_statement.success_statement, evaluation, variables, return_value);
+            }
+            if (s->if_statement.else_statement != NULL) {
+                return evaluate_scoped_statement(s->if_statement.else_statement, evaluation, variables, return_value);
+            }
+            return FLOW_NEXT;
+        }
+        case RETURN_STATEMENT:
+            if (!evaluate_expression(&s->expression, evaluation, variables, return_value)) return FLOW_FAILED;
+            return FLOW_RETURN;
+        case ACTION_STATEMENT:
+        {
+            struct literal_expression ignored = {0};
+            return evaluate_expression(&s->expression, evaluation, variables, &ignored) ? FLOW_NEXT : FLOW_FAILED;
+        }
+        case BLOCK_STATEMENT:
+        {
+            size_t variable_count = variables->size;
+            enum evaluation_flow flow = FLOW_NEXT;
+            for (size_t i = 0; i < s->statements->size && flow == FLOW_NEXT; i++) {
+                flow = evaluate_statement(&s->statements->data[i], evaluation, variables, return_value);
+            }
+            variables->size = variable_count;
+            return flow;
+        }
+        case WHILE_LOOP_STATEMENT:
+        {
+            for (;;) {
+                int condition = 0;
+                if (!evaluate_condition(&s->while_loop_statement.condition, evaluation, variables, &condition)) {
+                    return FLOW_FAILED;
+                }
+                if (!condition) return FLOW_NEXT;
+
+                enum evaluation_flow flow =
+                    evaluate_scoped_statement(s->while_loop_statement.do_statement, evaluation, variables, return_value);
+                if (flow == FLOW_BREAK) return FLOW_NEXT;
+                if (flow == FLOW_RETURN || flow == FLOW_FAILED) return flow;
+            }
+        }
+        case FOR_LOOP_STATEMENT:
+        {
+            struct for_loop_statement *for_statement = &s->for_loop_statement;
+            struct literal_expression start = {0};
+            struct literal_expression end = {0};
+            if (for_statement->end == NULL
+                || !evaluate_expression(&for_statement->iterated, evaluation, variables, &start)
+                || !evaluate_expression(for_statement->end, evaluation, variables, &end)
+                || start.kind != LITERAL_NUMERIC
+                || end.kind != LITERAL_NUMERIC
+                || start.numeric < 0)
+            {
+                return FLOW_FAILED;
+            }
+
+            // the variable takes the start's type, or the end's when that isn't a bare number.
+            struct type *type = for_statement->end->kind == LITERAL_EXPRESSION
+                                && for_statement->end->literal.kind == LITERAL_NUMERIC
+                ? evaluated_type(&for_statement->iterated, evaluation, variables)
+                : evaluated_type(for_statement->end, evaluation, variables);
+            if (type == NULL) return FLOW_FAILED;
+
+            // the variable is counted from its value at the end of the body, as the C loop does.
+            double counter = start.numeric;
+            while (counter < end.numeric) {
+                size_t variable_count = variables->size;
+                struct literal_expression value = numeric_literal(counter);
+                if (!literal_fits_type(type, &value)) return FLOW_FAILED;
+                list_append(variables, ((struct evaluated_variable) {
+                    .name = for_statement->variable_name,
+                    .type = type,
+                    .value = value
+                }));
+                enum evaluation_flow flow =
+                    evaluate_scoped_statement(for_statement->do_statement, evaluation, variables, return_value);
+                struct literal_expression after = variables->data[variable_count].value;
+                variables->size = variable_count;
+                if (flow == FLOW_BREAK) return FLOW_NEXT;
+                if (flow == FLOW_RETURN || flow == FLOW_FAILED) return flow;
+                if (after.kind != LITERAL_NUMERIC || !fits_i32(after.numeric + 1)) return FLOW_FAILED;
+                counter = after.numeric + 1;
+            }
+            return FLOW_NEXT;
+        }
+        case BREAK_STATEMENT:
+            return FLOW_BREAK;
+        case CONTINUE_STATEMENT:
+            return FLOW_CONTINUE;
+        case SWITCH_STATEMENT:
+        case TYPE_DECLARATION_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return FLOW_FAILED;
+    }
+
+    UNREACHABLE("evaluate_statement fell out of a switch");
+}
+
+int evaluate_call(struct type_declaration_statement *fn,
+                  struct list_literal_expression *arguments,
+                  struct evaluation *evaluation,
+                  struct literal_expression *out)
+{
+    if (++evaluation->steps > EVALUATION_STEP_BUDGET || evaluation->depth >= EVALUATION_DEPTH_LIMIT) {
+        return 0;
+    }
+
+    struct list_key_type_pair *params = &fn->type.function_type.params;
+    struct list_evaluated_variable variables = list_create(evaluated_variable, (params->size + 8));
+    for (size_t i = 0; i < params->size; i++) {
+        if (!literal_fits_type(params->data[i].field_type, &arguments->data[i])) return 0;
+        list_append(&variables, ((struct evaluated_variable) {
+            .name = params->data[i].field_name,
+            .type = params->data[i].field_type,
+            .value = arguments->data[i]
+        }));
+    }
+
+    evaluation->depth++;
+    enum evaluation_flow flow = FLOW_NEXT;
+    for (size_t i = 0; i < fn->statements->size && flow == FLOW_NEXT; i++) {
+        flow = evaluate_statement(&fn->statements->data[i], evaluation, &variables, out);
+    }
+    evaluation->depth--;
+    free(variables.data);
+
+    // a char returned as an integer is that integer from here on.
+    if (out->kind == LITERAL_CHAR) {
+        *out = numeric_literal((double)out->character);
+    }
+    return flow == FLOW_RETURN && literal_fits_type(fn->type.function_type.return_type, out);
+}
+
+// A call whose arguments folded to literals is replaced by what it returns, when that's a literal
+// the call's type would infer to anyway, an `i32` or a `bool`.
+int evaluate_constant_call(struct expression *e, struct fold_state *state, struct literal_expression *out)
+{
+    assert(e->kind == FUNCTION_EXPRESSION);
+    if (e->function.method_call) return 0;
+    struct list_literal_expression arguments = list_create(literal_expression, (e->function.params->size + 1));
+    for (size_t i = 0; i < e->function.params->size; i++) {
+        struct expression *argument = &e->function.params->data[i];
+        if (!is_constant_literal(argument)) return 0;
+        list_append(&arguments, argument->literal);
+    }
+
+    struct evaluation evaluation = { .statements = state->statements };
+    struct type_declaration_statement *fn = find_pure_function(&evaluation, e->function.function_name);
+    if (fn == NULL || fn->type.function_type.params.size != arguments.size) return 0;
+
+    struct type *return_type = fn->type.function_type.return_type;
+    if (return_type->primitive_type != I32 && return_type->primitive_type != BOOL) return 0;
+    return evaluate_call(fn, &arguments, &evaluation, out);
+}
+
+
+void fold_binary_expression(struct expression *e, struct fold_state *state)
+{
+    assert(e->kind == BINARY_EXPRESSION);
+    struct binary_expression *binary = &e->binary;
+
+    // the target of an assignment is a place, not a value.
+    if (binary->binary_op != ASSIGN_BINARY) {
+        fold_expression(binary->l, state);
+    }
+    fold_expression(binary->r, state);
+
+    if (!is_constant_literal(binary->l)) {
+        return;
+    }
+
+    // short circuiting means the right hand side is never evaluated, so it can go.
+    if (binary->l->literal.kind == LITERAL_BOOLEAN) {
+        int l = binary->l->literal.boolean;
+        if ((binary->binary_op == AND_BINARY && !l) || (binary->binary_op == OR_BINARY && l)) {
+            replace_with_literal(e, boolean_literal(l));
+            return;
+        }
+    }
+
+    if (!is_constant_literal(binary->r)) {
+        return;
+    }
+
+    struct literal_expression folded = {0};
+    if (fold_binary_literals(binary->binary_op, &binary->l->literal, &binary->r->literal, &folded)) {
+        replace_with_literal(e, folded);
+    }
+}
+
+void fold_unary_expression(struct expression *e, struct fold_state *state)
+{
+    assert(e->kind == UNARY_EXPRESSION);
+    struct expression *inner = e->unary.expression;
+    fold_expression(inner, state);
+    if (!is_constant_literal(inner)) {
+        return;
+    }
+
+    switch (e->unary.unary_operator) {
+        case BANG_UNARY:
+        {
+            if (inner->literal.kind == LITERAL_BOOLEAN) {
+                replace_with_literal(e, boolean_literal(!inner->literal.boolean));
+            }
+            return;
+        }
+        case MINUS_UNARY:
+        {
+            if (inner->literal.kind == LITERAL_NUMERIC) {
+                replace_with_literal(e, numeric_literal(-inner->literal.numeric));
+            }
+            return;
+        }
+        case STAR_UNARY:
+        case AWAIT_UNARY:
+            return;
+    }
+}
+
+void fold_expression(struct expression *e, struct fold_state *state)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            switch (e->literal.kind) {
+                case LITERAL_NAME:
+                {
+                    struct folded_constant *constant = find_constant(state, e->literal.name);
+                    if (constant != NULL
+                        && (constant->type == NULL || literal_has_type(&constant->value, constant->type)))
+                    {
+                        replace_with_literal(e, constant->value);
+                    }
+                    return;
+                }
+                case LITERAL_STRUCT:
+                case LITERAL_ENUM:
+                {
+                    struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                    for (size_t i = 0; i < pairs->size; i++) {
+                        fold_expression(pairs->data[i].expression, state);
+                    }
+                    return;
+                }
+                default:
+                    return;
+            }
+        }
+        case UNARY_EXPRESSION:
+            fold_unary_expression(e, state);
+            return;
+        case BINARY_EXPRESSION:
+            fold_binary_expression(e, state);
+            return;
+        case GROUP_EXPRESSION:
+        {
+            fold_expression(e->grouped, state);
+            if (is_constant_literal(e->grouped)) {
+                replace_with_literal(e, e->grouped->literal);
+            }
+            return;
+        }
+        case FUNCTION_EXPRESSION:
+        {
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                fold_expression(&e->function.params->data[i], state);
+            }
+
+            struct literal_expression value = {0};
+            if (evaluate_constant_call(e, state, &value)) {
+                replace_with_literal(e, value);
+            }
+            return;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+            fold_expression(e->member_access.accessed, state);
+            return;
+        case INDEX_EXPRESSION:
+            fold_expression(e->index.indexed, state);
+            fold_expression(e->index.index, state);
+            if (e->index.end != NULL) {
+                fold_expression(e->index.end, state);
+            }
+            return;
+        case VOID_EXPRESSION:
+            return;
+    }
+}
+
+int fold_type(struct type *ty,
+              struct fold_state *state,
+              struct statement_metadata *metadata,
+              struct error *error)
+{
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        struct type_modifier *modifier = &ty->modifiers.data[i];
+        if (modifier->kind != ARRAY_MODIFIER_KIND) continue;
+        struct array_type_modifier *array = &modifier->array_modifier;
+
+        struct literal_expression constant = {0};
+        if (array->reference_sized
+            && lookup_constant(state, array->reference_name, &constant)
+            && constant.kind == LITERAL_NUMERIC
+            && fits_i32(constant.numeric)
+            && constant.numeric >= 0)
+        {
+            array->reference_sized = 0;
+            array->reference_name = NULL;
+            array->literally_sized = 1;
+            array->literal_size = (int)constant.numeric;
+            continue;
+        }
+
+        if (array->size_expression == NULL) continue;
+        fold_expression(array->size_expression, state);
+        struct expression *size = array->size_expression;
+        if (size->kind != LITERAL_EXPRESSION
+            || size->literal.kind != LITERAL_NUMERIC
+            || !fits_i32(size->literal.numeric)
+            || size->literal.numeric < 0)
+        {
+            add_error_inner(metadata, "an array size must be a non-negative compile time constant.", error);
+            return 0;
+        }
+
+        array->literally_sized = 1;
+        array->literal_size = (int)size->literal.numeric;
+        array->size_expression = NULL;
+    }
+
+    switch (ty->kind) {
+        case TY_FUNCTION:
+        {
+            struct list_key_type_pair *params = &ty->function_type.params;
+            for (size_t i = 0; i < params->size; i++) {
+                if (!fold_type(params->data[i].field_type, state, metadata, error)) return 0;
+            }
+            return fold_type(ty->function_type.return_type, state, metadata, error);
+        }
+        case TY_STRUCT:
+        {
+            struct list_key_type_pair *pairs = &ty->struct_type.pairs;
+            for (size_t i = 0; i < pairs->size; i++) {
+                if (!fold_type(pairs->data[i].field_type, state, metadata, error)) return 0;
+            }
+            return 1;
+        }
+        case TY_ENUM:
+        {
+            struct list_key_type_pair *pairs = &ty->enum_type.pairs;
+            for (size_t i = 0; i < pairs->size; i++) {
+                if (!fold_type(pairs->data[i].field_type, state, metadata, error)) return 0;
+            }
+            return 1;
+        }
+        case TY_PRIMITIVE:
+        case TY_ANY:
+            return 1;
+    }
+
+    UNREACHABLE("fold_type fell out of a switch");
+}
+
+int has_modifier(struct type *ty, enum type_modifier_kind kind)
+{
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        if (ty->modifiers.data[i].kind == kind) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Whether substituting the literal for the binding keeps the C semantics of the binding's type.
+int literal_fits_binding(struct binding_statement *binding, struct literal_expression *value)
+{
+    return !binding->has_type || literal_fits_type(&binding->variable_type, value);
+}
+
+void replace_with_empty_block(struct statement *s)
+{
+    struct list_statement *empty = malloc(sizeof(*empty));
+    *empty = list_create(statement, 1);
+    *s = (struct statement) {
+        .kind = BLOCK_STATEMENT,
+        .id = s->id,
+        .statements = empty
+    };
+}
+
+int fold_statement(struct statement *s, struct fold_state *state, struct error *error);
+
+int fold_scoped_statement(struct statement *s, struct fold_state *state, struct error *error)
+{
+    size_t constant_count = state->constants.size;
+    int result = fold_statement(s, state, error);
+    state->constants.size = constant_count;
+    return result;
+}
+
+// A variable bound by a pattern shadows any constant of the same name.
+void forget_pattern_bindings(struct fold_state *state, struct switch_pattern *pattern)
+{
+    switch (pattern->switch_pattern_kind) {
+        case VARIABLE_PATTERN_KIND:
+            forget_constant(state, &pattern->variable_pattern.variable_name);
+            return;
+        case OBJECT_PATTERN_KIND:
+        {
+            for (size_t i = 0; i < pattern->object_pattern.pairs.size; i++) {
+                forget_pattern_bindings(state, pattern->object_pattern.pairs.data[i].pattern);
+            }
+            return;
+        }
+        case ARRAY_PATTERN_KIND:
+        {
+            for (size_t i = 0; i < pattern->array_pattern.patterns->size; i++) {
+                forget_pattern_bindings(state, &pattern->array_pattern.patterns->data[i]);
+            }
+            return;
+        }
+        case NUMBER_PATTERN_KIND:
+        case STRING_PATTERN_KIND:
+        case UNDERSCORE_PATTERN_KIND:
+        case REST_PATTERN_KIND:
+            return;
+    }
+}
+
+// Whether a `break` in `s` leaves the switch it sits in, rather than an inner loop or switch.
+int breaks_out_of_switch(struct statement *s)
+{
+    switch (s->kind) {
+        case BREAK_STATEMENT:
+            return 1;
+        case IF_STATEMENT:
+            return breaks_out_of_switch(s->if_statement.success_statement)
+                || (s->if_statement.else_statement != NULL
+                    && breaks_out_of_switch(s->if_statement.else_statement));
+        case BLOCK_STATEMENT:
+        {
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (breaks_out_of_switch(&s->statements->data[i])) return 1;
+            }
+            return 0;
+        }
+        case C_BLOCK_STATEMENT:
+            return mentions_identifier(s->c_block_statement.raw_c->data, "break");
+        default:
+            return 0;
+    }
+}
+
+// When the switched on value is known, the switch collapses to the arm that matches it.
+void prune_switch_statement(struct statement *s)
+{
+    assert(s->kind == SWITCH_STATEMENT);
+    struct expression *subject = &s->switch_statement.switch_expression;
+    int numeric = subject->kind == LITERAL_EXPRESSION && subject->literal.kind == LITERAL_NUMERIC;
+    int str = subject->kind == LITERAL_EXPRESSION && subject->literal.kind == LITERAL_STR;
+    if (!numeric && !str) {
+        return;
+    }
+
+    for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+        if (breaks_out_of_switch(s->switch_statement.cases.data[i].statement)) return;
+    }
+
+    for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+        struct case_statement *c = &s->switch_statement.cases.data[i];
+        switch (c->pattern.switch_pattern_kind) {
+            case NUMBER_PATTERN_KIND:
+            {
+                if (numeric && c->pattern.number_pattern.number == subject->literal.numeric) {
+                    *s = *c->statement;
+                    return;
+                }
+                break;
+            }
+            case STRING_PATTERN_KIND:
+            {
+                if (str && list_char_eq(&c->pattern.string_pattern.str, subject->literal.str)) {
+                    *s = *c->statement;
+                    return;
+                }
+                break;
+            }
+            case UNDERSCORE_PATTERN_KIND:
+            {
+                *s = *c->statement;
+                return;
+            }
+            case VARIABLE_PATTERN_KIND:
+            case OBJECT_PATTERN_KIND:
+            case ARRAY_PATTERN_KIND:
+            case REST_PATTERN_KIND:
+                return;
+        }
+    }
+
+    replace_with_empty_block(s);
+}
+
+int fold_statement(struct statement *s, struct fold_state *state, struct error *error)
+{
+    struct statement_metadata metadata =
+        lut_get(&state->global_context->metadata_lookup, s->id);
+
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+        {
+            struct binding_statement *binding = &s->binding_statement;
+            fold_expression(&binding->value, state);
+            if (binding->has_type && !fold_type(&binding->variable_type, state, &metadata, error)) {
+                return 0;
+            }
+
+            forget_constant(state, &binding->variable_name);
+            if (is_constant_literal(&binding->value)
+                && !has_modifier(&binding->variable_type, MUTABLE_MODIFIER_KIND)
+                && !is_unstable_name(state, &binding->variable_name)
+                && literal_fits_binding(binding, &binding->value.literal))
+            {
+                struct folded_constant constant = (struct folded_constant) {
+                    .name = binding->variable_name,
+                    .value = binding->value.literal,
+                    .type = binding->has_type ? &binding->variable_type : NULL
+                };
+                list_append(&state->constants, constant);
+            }
+            return 1;
+        }
+        case IF_STATEMENT:
+        {
+            struct if_statement *if_statement = &s->if_statement;
+            fold_expression(&if_statement->condition, state);
+            if (!fold_scoped_statement(if_statement->success_statement, state, error)) return 0;
+            if (if_statement->else_statement != NULL
+                && !fold_scoped_statement(if_statement->else_statement, state, error))
+            {
+                return 0;
+            }
+
+            struct expression *condition = &if_statement->condition;
+            if (condition->kind == LITERAL_EXPRESSION && condition->literal.kind == LITERAL_BOOLEAN) {
+                if (condition->literal.boolean) {
+                    *s = *if_statement->success_statement;
+                } else if (if_statement->else_statement != NULL) {
+                    *s = *if_statement->else_statement;
+                } else {
+                    replace_with_empty_block(s);
+                }
+            }
+            return 1;
+        }
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+            fold_expression(&s->expression, state);
+            return 1;
+        case BLOCK_STATEMENT:
+        {
+            size_t constant_count = state->constants.size;
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (!fold_statement(&s->statements->data[i], state, error)) return 0;
+            }
+            state->constants.size = constant_count;
+            return 1;
+        }
+        case WHILE_LOOP_STATEMENT:
+        {
+            struct while_loop_statement *while_statement = &s->while_loop_statement;
+            fold_expression(&while_statement->condition, state);
+            if (!fold_scoped_statement(while_statement->do_statement, state, error)) return 0;
+
+            struct expression *condition = &while_statement->condition;
+            if (condition->kind == LITERAL_EXPRESSION
+                && condition->literal.kind == LITERAL_BOOLEAN
+                && !condition->literal.boolean)
+            {
+                replace_with_empty_block(s);
+            }
+            return 1;
+        }
+        case FOR_LOOP_STATEMENT:
+        {
+            struct for_loop_statement *for_statement = &s->for_loop_statement;
+            fold_expression(&for_statement->iterated, state);
+            if (for_statement->end != NULL) {
+                fold_expression(for_statement->end, state);
+            }
+            // the loop's variable hides any constant of the same name.
+            forget_constant(state, &for_statement->variable_name);
+            return fold_scoped_statement(for_statement->do_statement, state, error);
+        }
+        case SWITCH_STATEMENT:
+        {
+            fold_expression(&s->switch_statement.switch_expression, state);
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                struct case_statement *c = &s->switch_statement.cases.data[i];
+                forget_pattern_bindings(state, &c->pattern);
+                if (!fold_scoped_statement(c->statement, state, error)) return 0;
+            }
+            prune_switch_statement(s);
+            return 1;
+        }
+        case TYPE_DECLARATION_STATEMENT:
+        {
+            struct type_declaration_statement *declaration = &s->type_declaration;
+            if (!fold_type(&declaration->type, state, &metadata, error)) return 0;
+            if (declaration->type.kind != TY_FUNCTION) {
+                return 1;
+            }
+
+            struct list_unstable_name unstable_names = list_create(unstable_name, 10);
+            struct list_statement c_blocks = list_create(statement, 2);
+            for (size_t i = 0; i < declaration->statements->size; i++) {
+                collect_unstable_names(&declaration->statements->data[i], &c_blocks, &unstable_names);
+            }
+
+            // inline C can do anything with a name it mentions, so those names are never constant.
+            struct list_unstable_name bound_names = list_create(unstable_name, 10);
+            for (size_t i = 0; i < declaration->statements->size; i++) {
+                collect_bound_names(&declaration->statements->data[i], &bound_names);
+            }
+            for (size_t i = 0; i < bound_names.size; i++) {
+                for (size_t c = 0; c < c_blocks.size; c++) {
+                    if (mentions_identifier(c_blocks.data[c].c_block_statement.raw_c->data,
+                                            bound_names.data[i].name.data))
+                    {
+                        list_append(&unstable_names, bound_names.data[i]);
+                    }
+                }
+            }
+
+            state->unstable_names = &unstable_names;
+            state->constants.size = 0;
+            for (size_t i = 0; i < declaration->statements->size; i++) {
+                if (!fold_statement(&declaration->statements->data[i], state, error)) return 0;
+            }
+            state->constants.size = 0;
+            return 1;
+        }
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return 1;
+    }
+
+    UNREACHABLE("fold_statement fell out of a switch");
+}
+
+int fold_constants(struct parsed_file *parsed_file, struct error *error)
+{
+    struct list_unstable_name no_unstable_names = list_create(unstable_name, 1);
+    struct fold_state state = {
+        .global_context = &parsed_file->global_context,
+        .statements = &parsed_file->statements,
+        .constants = list_create(folded_constant, 20),
+        .unstable_names = &no_unstable_names
+    };
+
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        if (!fold_statement(&parsed_file->statements.data[i], &state, error)) return 0;
+    }
+
+    return 1;
+}
@@ -0,0 +1,9 @@
+#ifndef CONSTANT_FOLDING_H
+#define CONSTANT_FOLDING_H
+
+#include "parser.h"
+#include "error.h"
+
+int fold_constants(struct parsed_file *parsed_file, struct error *error);
+
+#endif
@@ -6,6 +6,7 @@
 #include "../lib/collections.h"
 #include "context.h"
 #include "type_inference.h"
+#include "decision_tree.h"
 
 static void add_error_inner(struct statement_metadata *metadata,
                             char *error_message,
@@ -37,9 +38,12 @@ void add_scoped_variable(struct statement *s,
         return;
     }
 
+    // an annotated binding has the type it was annotated with, not what its value inferred to.
     struct scoped_variable var = (struct scoped_variable) {
         .name = s->binding_statement.variable_name,
-        .type = lut_get(expression_types, s->binding_statement.value.id)
+        .type = s->binding_statement.has_type
+            ? s->binding_statement.variable_type
+            : lut_get(expression_types, s->binding_statement.value.id)
     };
 
     list_append(scoped_variables, var);
@@ -52,8 +56,9 @@ int contextualise_statement(struct statement *s,
                             struct error *error)
 {
     struct list_char error_message = list_create(char, 100);
+    struct list_scoped_variable init = {0};
     if (scoped_variables == NULL) {
-        struct list_scoped_variable init = list_create(scoped_variable, 10);
+        init = list_create(scoped_variable, 10);
         scoped_variables = &init;
     }
 
@@ -290,7 +295,44 @@ int contextualise_statement(struct statement *s,
             lut_add(&context->statement_scope_lookup, s->id, while_scope);
             return 1;
         }
+        case FOR_LOOP_STATEMENT:
+        {
+            struct type variable_type = {0};
+            if (!for_loop_variable_type(&s->for_loop_statement,
+                                        global_context,
+                                        context,
+                                        scoped_variables,
+                                        &variable_type,
+                                        &error_message))
+            {
+                struct statement_metadata metadata = lut_get(&global_context->metadata_lookup, s->id);
+                add_error_inner(&metadata, error_message.data, error);
+                return 0;
+            }
+
+            // the loop's variable is only in scope within its body.
+            struct list_scoped_variable for_scoped_variables = copy_scoped_variables(scoped_variables);
+            list_append(&for_scoped_variables, ((struct scoped_variable) {
+                .name = s->for_loop_statement.variable_name,
+                .type = variable_type
+            }));
+            if (!contextualise_statement(s->for_loop_statement.do_statement,
+                                         global_context,
+                                         &for_scoped_variables,
+                                         context,
+                                         error))
+            {
+                return 0;
+            }
+
+            struct statement_scope for_scope = {
+                .scoped_variables = copy_scoped_variables(scoped_variables)
+            };
+            lut_add(&context->statement_scope_lookup, s->id, for_scope);
+            return 1;
+        }
         case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
         {
             struct statement_scope scope = {
                 .scoped_variables = copy_scoped_variables(scoped_variables)
@@ -299,8 +341,60 @@ int contextualise_statement(struct statement *s,
             return 1;
         }
         case SWITCH_STATEMENT:
-            TODO("switch statement, context");
-            return 0;
+        {
+            struct type subject_type = {0};
+            if (!infer_expression_type(&s->switch_statement.switch_expression,
+                                       global_context,
+                                       context,
+                                       scoped_variables,
+                                       &subject_type,
+                                       &error_message))
+            {
+                struct statement_metadata metadata = lut_get(&global_context->metadata_lookup, s->id);
+                add_error_inner(&metadata, error_message.data, error);
+                return 0;
+            }
+
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                struct case_statement *c = &s->switch_statement.cases.data[i];
+                struct list_scoped_variable case_scoped_variables =
+                    copy_scoped_variables(scoped_variables);
+                // variables in the pattern are bound to parts of the switched on value for its arm.
+                struct list_pattern_binding bindings = list_create(pattern_binding, 4);
+                if (!switch_pattern_bindings(&c->pattern,
+                                             &subject_type,
+                                             global_context,
+                                             &bindings,
+                                             &error_message))
+                {
+                    struct statement_metadata metadata = lut_get(&global_context->metadata_lookup, s->id);
+                    add_error_inner(&metadata, error_message.data, error);
+                    return 0;
+                }
+                for (size_t j = 0; j < bindings.size; j++) {
+                    struct scoped_variable var = (struct scoped_variable) {
+                        .name = bindings.data[j].name,
+                        .type = bindings.data[j].type
+                    };
+                    list_append(&case_scoped_variables, var);
+                }
+
+                if (!contextualise_statement(c->statement,
+                                             global_context,
+                                             &case_scoped_variables,
+                                             context,
+                                             error))
+                {
+                    return 0;
+                }
+            }
+
+            struct statement_scope scope = {
+                .scoped_variables = copy_scoped_variables(scoped_variables)
+            };
+            lut_add(&context->statement_scope_lookup, s->id, scope);
+            return 1;
+        }
         case C_BLOCK_STATEMENT:
         {
             struct statement_scope scope = {
@@ -0,0 +1,512 @@
+#include <stdio.h>
+#include <string.h>
+#include "coroutines.h"
+#include "layout.h"
+#include "type_checker.h"
+#include "type_inference.h"
+#include "../lib/collections.h"
+#include "../lib/utils.h"
+
+static void add_error_inner(struct statement_metadata *metadata,
+                            char *error_message,
+                            struct error *out)
+{
+    add_error(metadata->row, metadata->col, metadata->file_name, out, error_message);
+}
+
+static char *task_methods[] = { "resume", "result" };
+
+#define TASK_METHOD_COUNT (sizeof(task_methods) / sizeof(*task_methods))
+
+struct list_char *frame_name(char *text)
+{
+    struct list_char *name = malloc(sizeof(*name));
+    *name = list_create(char, (strlen(text) + 1));
+    append_list_char_slice(name, text);
+    list_append(name, '\0');
+    return name;
+}
+
+struct list_char *suffixed_name(struct list_char *name, char *suffix)
+{
+    struct list_char *out = malloc(sizeof(*out));
+    *out = list_create(char, (strlen(name->data) + strlen(suffix) + 1));
+    append_list_char_slice(out, name->data);
+    append_list_char_slice(out, suffix);
+    list_append(out, '\0');
+    return out;
+}
+
+struct type *task_type(struct list_char *task_name, int pointer)
+{
+    struct type *ty = malloc(sizeof(*ty));
+    *ty = (struct type) {
+        .kind = TY_STRUCT,
+        .name = task_name,
+        .modifiers = list_create(type_modifier, 2),
+        .struct_type = (struct struct_type) { .predefined = 1 }
+    };
+    if (pointer) {
+        list_append(&ty->modifiers, ((struct type_modifier) { .kind = POINTER_MODIFIER_KIND }));
+        list_append(&ty->modifiers, ((struct type_modifier) { .kind = MUTABLE_MODIFIER_KIND }));
+    }
+    return ty;
+}
+
+struct type *frame_scalar(enum primitive_type primitive)
+{
+    struct type *ty = malloc(sizeof(*ty));
+    *ty = (struct type) {
+        .kind = TY_PRIMITIVE,
+        .modifiers = list_create(type_modifier, 1),
+        .primitive_type = primitive
+    };
+    return ty;
+}
+
+void declare_async_tasks(struct global_context *global_context)
+{
+    // the list grows as the methods are declared, so each fn is looked up again by index.
+    size_t fn_count = global_context->fn_types.size;
+    for (size_t i = 0; i < fn_count; i++) {
+        if (!global_context->fn_types.data[i].function_type.is_async) continue;
+        struct list_char *fn_name = global_context->fn_types.data[i].name;
+        struct type *result_type = global_context->fn_types.data[i].function_type.return_type;
+        struct list_char *task_name = suffixed_name(fn_name, "_task");
+
+        list_append(&global_context->data_types, ((struct type) {
+            .kind = TY_STRUCT,
+            .name = task_name,
+            .modifiers = list_create(type_modifier, 1),
+            .struct_type = (struct struct_type) { .pairs = list_create(key_type_pair, 8) }
+        }));
+        global_context->fn_types.data[i].function_type.return_type = task_type(task_name, 0);
+
+        for (size_t j = 0; j < TASK_METHOD_COUNT; j++) {
+            struct list_key_type_pair params = list_create(key_type_pair, 1);
+            list_append(&params, ((struct key_type_pair) {
+                .field_name = *frame_name("task"),
+                .field_type = task_type(task_name, 1)
+            }));
+
+            char suffix[16] = "_";
+            strcat(suffix, task_methods[j]);
+            list_append(&global_context->fn_types, ((struct type) {
+                .kind = TY_FUNCTION,
+                .name = suffixed_name(task_name, suffix),
+                .modifiers = list_create(type_modifier, 1),
+                .function_type = (struct function_type) {
+                    .params = params,
+                    .return_type = j == 0 ? frame_scalar(BOOL) : result_type
+                }
+            }));
+        }
+    }
+}
+
+struct type *async_call(struct expression *e, struct global_context *global_context)
+{
+    if (e->kind != FUNCTION_EXPRESSION || e->function.method_call) return NULL;
+    for (size_t i = 0; i < global_context->fn_types.size; i++) {
+        struct type *fn = &global_context->fn_types.data[i];
+        if (fn->function_type.is_async && list_char_eq(fn->name, e->function.function_name)) return fn;
+    }
+    return NULL;
+}
+
+struct type *task_method(struct list_char *name, struct global_context *global_context, char **method)
+{
+    for (size_t i = 0; i < global_context->fn_types.size; i++) {
+        struct type *fn = &global_context->fn_types.data[i];
+        size_t length = strlen(fn->name->data);
+        if (!fn->function_type.is_async
+            || strncmp(name->data, fn->name->data, length) != 0
+            || strncmp(name->data + length, "_task_", 6) != 0)
+        {
+            continue;
+        }
+        for (size_t j = 0; j < TASK_METHOD_COUNT; j++) {
+            if (!strcmp(name->data + length + 6, task_methods[j])) {
+                *method = task_methods[j];
+                return fn;
+            }
+        }
+    }
+    return NULL;
+}
+
+struct type *async_result_type(struct type *fn, struct global_context *global_context)
+{
+    char *method = NULL;
+    for (size_t i = 0; i < global_context->fn_types.size; i++) {
+        struct type *result = &global_context->fn_types.data[i];
+        if (task_method(result->name, global_context, &method) == fn && !strcmp(method, "result")) {
+            return result->function_type.return_type;
+        }
+    }
+
+    UNREACHABLE("an async fn's `result` method is declared along with its task");
+}
+
+struct expression *awaited(struct statement *s)
+{
+    struct expression *value = NULL;
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            value = &s->binding_statement.value;
+            break;
+        case ACTION_STATEMENT:
+        case RETURN_STATEMENT:
+            value = &s->expression;
+            break;
+        default:
+            return NULL;
+    }
+    return value->kind == UNARY_EXPRESSION && value->unary.unary_operator == AWAIT_UNARY ? value : NULL;
+}
+
+int expression_awaits(struct expression *e)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+            if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    if (expression_awaits(pairs->data[i].expression)) return 1;
+                }
+            }
+            return 0;
+        case UNARY_EXPRESSION:
+            return e->unary.unary_operator == AWAIT_UNARY || expression_awaits(e->unary.expression);
+        case BINARY_EXPRESSION:
+            return expression_awaits(e->binary.l) || expression_awaits(e->binary.r);
+        case GROUP_EXPRESSION:
+            return expression_awaits(e->grouped);
+        case FUNCTION_EXPRESSION:
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                if (expression_awaits(&e->function.params->data[i])) return 1;
+            }
+            return 0;
+        case MEMBER_ACCESS_EXPRESSION:
+            return expression_awaits(e->member_access.accessed);
+        case INDEX_EXPRESSION:
+            return expression_awaits(e->index.indexed)
+                || expression_awaits(e->index.index)
+                || (e->index.end != NULL && expression_awaits(e->index.end));
+        case VOID_EXPRESSION:
+            return 0;
+    }
+
+    UNREACHABLE("expression_awaits fell out of a switch");
+}
+
+int statement_awaits(struct statement *s)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            return expression_awaits(&s->binding_statement.value);
+        case ACTION_STATEMENT:
+        case RETURN_STATEMENT:
+            return expression_awaits(&s->expression);
+        case IF_STATEMENT:
+            return expression_awaits(&s->if_statement.condition)
+                || statement_awaits(s->if_statement.success_statement)
+                || (s->if_statement.else_statement != NULL && statement_awaits(s->if_statement.else_statement));
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (statement_awaits(&s->statements->data[i])) return 1;
+            }
+            return 0;
+        case WHILE_LOOP_STATEMENT:
+            return expression_awaits(&s->while_loop_statement.condition)
+                || statement_awaits(s->while_loop_statement.do_statement);
+        case FOR_LOOP_STATEMENT:
+            return expression_awaits(&s->for_loop_statement.iterated)
+                || (s->for_loop_statement.end != NULL && expression_awaits(s->for_loop_statement.end))
+                || statement_awaits(s->for_loop_statement.do_statement);
+        case SWITCH_STATEMENT:
+            if (expression_awaits(&s->switch_statement.switch_expression)) return 1;
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                if (statement_awaits(s->switch_statement.cases.data[i].statement)) return 1;
+            }
+            return 0;
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return 0;
+    }
+
+    UNREACHABLE("statement_awaits fell out of a switch");
+}
+
+// What's laying out one async fn's frame.
+struct frame_layout {
+    struct list_key_type_pair *pairs;
+    struct global_context *global_context;
+    struct context *context;
+    struct error *error;
+};
+
+struct type *frame_field(struct frame_layout *frame, struct list_char *name)
+{
+    for (size_t i = 0; i < frame->pairs->size; i++) {
+        if (list_char_eq(&frame->pairs->data[i].field_name, name)) return frame->pairs->data[i].field_type;
+    }
+    return NULL;
+}
+
+void add_frame_field(struct frame_layout *frame, struct list_char *name, struct type *ty)
+{
+    if (frame_field(frame, name) != NULL) return;
+    list_append(frame->pairs, ((struct key_type_pair) { .field_name = *name, .field_type = ty }));
+}
+
+// A field named for the statement it's kept for, like `__rm_awaited_12`.
+struct list_char *generated_field_name(char *prefix, unsigned long id)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%s%lu", prefix, id);
+    return frame_name(buffer);
+}
+
+// A local lives across an await when it's in scope there; everything else stays on the C stack.
+void collect_frame(struct statement *s, struct frame_layout *frame)
+{
+    struct expression *await = awaited(s);
+    if (await != NULL) {
+        struct list_scoped_variable scoped_variables =
+            lut_get(&frame->context->statement_scope_lookup, s->id).scoped_variables;
+        for (size_t i = 0; i < scoped_variables.size; i++) {
+            struct type *ty = malloc(sizeof(*ty));
+            *ty = scoped_variables.data[i].type;
+            add_frame_field(frame, &scoped_variables.data[i].name, ty);
+        }
+
+        struct type *callee = async_call(await->unary.expression, frame->global_context);
+        if (callee != NULL) {
+            add_frame_field(frame, generated_field_name("__rm_awaited_", s->id), callee->function_type.return_type);
+        }
+        return;
+    }
+
+    switch (s->kind) {
+        case IF_STATEMENT:
+            collect_frame(s->if_statement.success_statement, frame);
+            if (s->if_statement.else_statement != NULL) {
+                collect_frame(s->if_statement.else_statement, frame);
+            }
+            return;
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                collect_frame(&s->statements->data[i], frame);
+            }
+            return;
+        case WHILE_LOOP_STATEMENT:
+            collect_frame(s->while_loop_statement.do_statement, frame);
+            return;
+        case FOR_LOOP_STATEMENT:
+            collect_frame(s->for_loop_statement.do_statement, frame);
+            return;
+        case SWITCH_STATEMENT:
+        case BINDING_STATEMENT:
+        case ACTION_STATEMENT:
+        case RETURN_STATEMENT:
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return;
+    }
+}
+
+int frame_binding_error(struct statement *s, struct frame_layout *frame, struct list_char *name, char *message)
+{
+    struct list_char error_message = list_create(char, 100);
+    append_list_char_slice(&error_message, "`");
+    append_list_char_slice(&error_message, name->data);
+    append_list_char_slice(&error_message, "` lives across an `await`, so it's kept in the task's frame");
+    append_list_char_slice(&error_message, message);
+    struct statement_metadata metadata = lut_get(&frame->global_context->metadata_lookup, s->id);
+    add_error_inner(&metadata, error_message.data, frame->error);
+    return 0;
+}
+
+// Every binding of a name held in the frame is an assignment to its field, so each has to agree
+// with it. A range loop over a held name keeps its end in the frame too.
+int check_frame_bindings(struct statement *s, struct frame_layout *frame)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+        {
+            struct type *held = frame_field(frame, &s->binding_statement.variable_name);
+            if (held == NULL) return 1;
+            struct type bound = s->binding_statement.has_type
+                ? s->binding_statement.variable_type
+                : lut_get(&frame->context->expression_type_lookup, s->binding_statement.value.id);
+            if (!type_eq(held, &bound)) {
+                return frame_binding_error(s, frame, &s->binding_statement.variable_name,
+                                           ", and can't be bound again with another type.");
+            }
+            return 1;
+        }
+        case FOR_LOOP_STATEMENT:
+        {
+            struct for_loop_statement *for_statement = &s->for_loop_statement;
+            struct type *held = frame_field(frame, &for_statement->variable_name);
+            if (held != NULL && for_statement->end == NULL) {
+                return frame_binding_error(s, frame, &for_statement->variable_name,
+                                           ", and can't also be the variable of a `for` over elements.");
+            }
+            if (held != NULL) {
+                struct list_scoped_variable body_scope =
+                    lut_get(&frame->context->statement_scope_lookup, for_statement->do_statement->id).scoped_variables;
+                struct type *counted = &body_scope.data[body_scope.size - 1].type;
+                if (!type_eq(held, counted)) {
+                    return frame_binding_error(s, frame, &for_statement->variable_name,
+                                               ", and can't be bound again with another type.");
+                }
+                add_frame_field(frame, generated_field_name("__rm_end_", s->id), held);
+            }
+            return check_frame_bindings(for_statement->do_statement, frame);
+        }
+        case SWITCH_STATEMENT:
+        {
+            // a pattern's variables are what's in scope in its arm but not around the switch.
+            struct list_scoped_variable outside =
+                lut_get(&frame->context->statement_scope_lookup, s->id).scoped_variables;
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                struct statement *arm = s->switch_statement.cases.data[i].statement;
+                struct list_scoped_variable inside =
+                    lut_get(&frame->context->statement_scope_lookup, arm->id).scoped_variables;
+                for (size_t j = outside.size; j < inside.size; j++) {
+                    if (frame_field(frame, &inside.data[j].name) != NULL) {
+                        return frame_binding_error(s, frame, &inside.data[j].name,
+                                                   ", and can't also be bound by a pattern.");
+                    }
+                }
+                if (!check_frame_bindings(arm, frame)) return 0;
+            }
+            return 1;
+        }
+        case IF_STATEMENT:
+            return check_frame_bindings(s->if_statement.success_statement, frame)
+                && (s->if_statement.else_statement == NULL
+                    || check_frame_bindings(s->if_statement.else_statement, frame));
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (!check_frame_bindings(&s->statements->data[i], frame)) return 0;
+            }
+            return 1;
+        case WHILE_LOOP_STATEMENT:
+            return check_frame_bindings(s->while_loop_statement.do_statement, frame);
+        case ACTION_STATEMENT:
+        case RETURN_STATEMENT:
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return 1;
+    }
+
+    UNREACHABLE("check_frame_bindings fell out of a switch");
+}
+
+int lay_out_frame(struct statement *s, struct global_context *global_context, struct context *context, struct error *error)
+{
+    struct type *fn = &s->type_declaration.type;
+    struct type *task = find_data_type(global_context, suffixed_name(fn->name, "_task"));
+    struct frame_layout frame = {
+        .pairs = &task->struct_type.pairs,
+        .global_context = global_context,
+        .context = context,
+        .error = error
+    };
+
+    // 0 before the first resume, -1 once it's returned, otherwise the await it stopped at.
+    add_frame_field(&frame, frame_name("__rm_state"), frame_scalar(I32));
+    if (!is_void_type(fn->function_type.return_type)) {
+        add_frame_field(&frame, frame_name("__rm_result"), fn->function_type.return_type);
+    }
+    struct list_key_type_pair *params = &fn->function_type.params;
+    for (size_t i = 0; i < params->size; i++) {
+        add_frame_field(&frame, &params->data[i].field_name, params->data[i].field_type);
+    }
+
+    for (size_t i = 0; i < s->type_declaration.statements->size; i++) {
+        collect_frame(&s->type_declaration.statements->data[i], &frame);
+    }
+    for (size_t i = 0; i < s->type_declaration.statements->size; i++) {
+        if (!check_frame_bindings(&s->type_declaration.statements->data[i], &frame)) return 0;
+    }
+    return 1;
+}
+
+// Whether `ty` holds the struct named `target` within itself rather than behind a pointer, at any
+// depth. `visited` is indexed like `data_types`.
+int holds_by_value(struct type *ty, struct list_char *target, struct global_context *global_context, int *visited)
+{
+    if (ty->kind != TY_STRUCT && ty->kind != TY_ENUM) return 0;
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        enum type_modifier_kind kind = ty->modifiers.data[i].kind;
+        if (kind == POINTER_MODIFIER_KIND || kind == SLICE_MODIFIER_KIND) return 0;
+    }
+    if (list_char_eq(ty->name, target)) return 1;
+
+    struct list_type *data_types = &global_context->data_types;
+    for (size_t i = 0; i < data_types->size; i++) {
+        if (visited[i] || !list_char_eq(data_types->data[i].name, ty->name)) continue;
+        visited[i] = 1;
+        struct list_key_type_pair *pairs = data_types->data[i].kind == TY_STRUCT
+            ? &data_types->data[i].struct_type.pairs
+            : &data_types->data[i].enum_type.pairs;
+        for (size_t j = 0; j < pairs->size; j++) {
+            if (holds_by_value(pairs->data[j].field_type, target, global_context, visited)) return 1;
+        }
+    }
+    return 0;
+}
+
+int lay_out_frames(struct parsed_file *parsed_file, struct context *context, struct error *error)
+{
+    struct global_context *global_context = &parsed_file->global_context;
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        struct statement *s = &parsed_file->statements.data[i];
+        if (s->kind != TYPE_DECLARATION_STATEMENT
+            || s->type_declaration.type.kind != TY_FUNCTION
+            || !s->type_declaration.type.function_type.is_async)
+        {
+            continue;
+        }
+        if (!lay_out_frame(s, global_context, context, error)) return 0;
+    }
+
+    // an awaited fn's frame is kept within the awaiting one's, so they can't await in a cycle.
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        struct statement *s = &parsed_file->statements.data[i];
+        if (s->kind != TYPE_DECLARATION_STATEMENT
+            || s->type_declaration.type.kind != TY_FUNCTION
+            || !s->type_declaration.type.function_type.is_async)
+        {
+            continue;
+        }
+        struct list_char *task_name = suffixed_name(s->type_declaration.type.name, "_task");
+        struct type *task = find_data_type(global_context, task_name);
+        int *visited = calloc(global_context->data_types.size + 1, sizeof(int));
+        for (size_t j = 0; j < task->struct_type.pairs.size; j++) {
+            if (!holds_by_value(task->struct_type.pairs.data[j].field_type, task_name, global_context, visited)) {
+                continue;
+            }
+            struct list_char error_message = list_create(char, 100);
+            append_list_char_slice(&error_message, "`");
+            append_list_char_slice(&error_message, s->type_declaration.type.name->data);
+            append_list_char_slice(&error_message,
+                                   "` awaits itself, directly or through what it awaits, so its frame would hold itself.");
+            struct statement_metadata metadata = lut_get(&global_context->metadata_lookup, s->id);
+            add_error_inner(&metadata, error_message.data, error);
+            return 0;
+        }
+        free(visited);
+    }
+    return 1;
+}
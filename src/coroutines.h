@@ -0,0 +1,36 @@
+#ifndef COROUTINES_H
+#define COROUTINES_H
+
+#include "ast.h"
+#include "context.h"
+#include "parser.h"
+#include "error.h"
+
+// An `async fn f(...) -> T` is a stackless coroutine. Calling it only makes its frame, a
+// `struct f_task` holding the arguments and the locals that live across an `await`, and
+// `t.resume()` runs the body from where it last stopped until it finishes, returning true, or
+// until it awaits something that isn't ready, returning false. `t.result()` is what it returned.
+//
+// `await g(...)` of another async fn keeps g's frame within f's and resumes it in place, `await x`
+// of a bool waits until `x` is true, checking again on each resume.
+
+// Declares each async fn's task struct and its `resume` and `result` methods, and makes calls to
+// the fn return the task. The struct is empty until `lay_out_frames` fills it in.
+void declare_async_tasks(struct global_context *global_context);
+// The async fn a call is to, or NULL.
+struct type *async_call(struct expression *e, struct global_context *global_context);
+// What an async fn returns once it's done, the type its declaration gives.
+struct type *async_result_type(struct type *fn, struct global_context *global_context);
+// The async fn whose task method `name` is, with the method's name, or NULL.
+struct type *task_method(struct list_char *name, struct global_context *global_context, char **method);
+// The `await` that is a binding, action or return statement's whole value, or NULL.
+struct expression *awaited(struct statement *s);
+int expression_awaits(struct expression *e);
+int statement_awaits(struct statement *s);
+
+// Fills each task struct in: its state, the result, the parameters, the locals in scope at an
+// await, and the frame of each async fn awaited. Errors when a local held in the frame is bound
+// again with another type or by a pattern, or when async fns await each other in a cycle.
+int lay_out_frames(struct parsed_file *parsed_file, struct context *context, struct error *error);
+
+#endif
@@ -0,0 +1,549 @@
+#include <assert.h>
+#include "decision_tree.h"
+#include "type_inference.h"
+#include "../lib/collections.h"
+#include "../lib/utils.h"
+
+// Switches over object and array patterns are compiled as a decision tree, following
+// Maranget's "Compiling Pattern Matching to Good Decision Trees". Each case is flattened to
+// the literal tests it makes on parts of the switched on value, then a part is tested once and
+// the remaining cases are split on its outcome, until a case has nothing left to test.
+
+typedef struct pattern_test {
+    struct list_access_step path;
+    struct type type;
+    struct switch_pattern *pattern;
+} pattern_test;
+
+struct_list(pattern_test);
+
+typedef struct pattern_row {
+    struct list_pattern_test tests;
+    size_t arm;
+} pattern_row;
+
+struct_list(pattern_row);
+
+int needs_decision_tree(struct switch_statement *s)
+{
+    for (size_t i = 0; i < s->cases.size; i++) {
+        enum switch_pattern_kind kind = s->cases.data[i].pattern.switch_pattern_kind;
+        if (kind == OBJECT_PATTERN_KIND || kind == ARRAY_PATTERN_KIND) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+struct list_access_step extend_path(struct list_access_step *path, struct access_step step)
+{
+    struct list_access_step output = list_create(access_step, (path->size + 1));
+    for (size_t i = 0; i < path->size; i++) {
+        list_append(&output, path->data[i]);
+    }
+    list_append(&output, step);
+    return output;
+}
+
+int access_step_eq(struct access_step *l, struct access_step *r)
+{
+    if (l->kind != r->kind) {
+        return 0;
+    }
+
+    switch (l->kind) {
+        case FIELD_ACCESS_STEP:
+            return list_char_eq(&l->field_name, &r->field_name);
+        case INDEX_ACCESS_STEP:
+            return l->index == r->index;
+        case VARIANT_ACCESS_STEP:
+            return list_char_eq(&l->field_name, &r->field_name);
+    }
+
+    UNREACHABLE("access_step_eq fell out of a switch");
+}
+
+int path_eq(struct list_access_step *l, struct list_access_step *r)
+{
+    if (l->size != r->size) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < l->size; i++) {
+        if (!access_step_eq(&l->data[i], &r->data[i])) return 0;
+    }
+    return 1;
+}
+
+int path_is_strict_prefix(struct list_access_step *prefix, struct list_access_step *path)
+{
+    if (prefix->size >= path->size) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < prefix->size; i++) {
+        if (!access_step_eq(&prefix->data[i], &path->data[i])) return 0;
+    }
+    return 1;
+}
+
+int literal_pattern_eq(struct switch_pattern *l, struct switch_pattern *r)
+{
+    if (l->switch_pattern_kind != r->switch_pattern_kind) {
+        return 0;
+    }
+
+    switch (l->switch_pattern_kind) {
+        case NUMBER_PATTERN_KIND:
+            return l->number_pattern.number == r->number_pattern.number;
+        case STRING_PATTERN_KIND:
+            return list_char_eq(&l->string_pattern.str, &r->string_pattern.str);
+        case OBJECT_PATTERN_KIND:
+            // an enum's tag is tested against the variant an object pattern names.
+            return list_char_eq(&l->object_pattern.pairs.data[0].key, &r->object_pattern.pairs.data[0].key);
+        default:
+            UNREACHABLE("only literal patterns are tested");
+    }
+}
+
+int find_field_type(struct type *struct_type,
+                    struct list_char *field_name,
+                    struct global_context *global_context,
+                    struct type *out,
+                    struct list_char *error)
+{
+    struct type full = *struct_type;
+    if (!find_struct_definition(global_context, struct_type->name, &full, error)) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < full.struct_type.pairs.size; i++) {
+        struct key_type_pair *pair = &full.struct_type.pairs.data[i];
+        if (list_char_eq(&pair->field_name, field_name)) {
+            *out = *pair->field_type;
+            return 1;
+        }
+    }
+
+    append_list_char_slice(error, "struct `");
+    append_list_char_slice(error, struct_type->name->data);
+    append_list_char_slice(error, "` has no field `");
+    append_list_char_slice(error, field_name->data);
+    append_list_char_slice(error, "`.");
+    return 0;
+}
+
+int find_variant_type(struct type *enum_type,
+                      struct list_char *variant_name,
+                      struct global_context *global_context,
+                      struct type *out,
+                      struct list_char *error)
+{
+    struct type full = *enum_type;
+    if (!find_enum_definition(global_context, enum_type->name, &full, error)) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < full.enum_type.pairs.size; i++) {
+        struct key_type_pair *pair = &full.enum_type.pairs.data[i];
+        if (list_char_eq(&pair->field_name, variant_name)) {
+            *out = *pair->field_type;
+            return 1;
+        }
+    }
+
+    append_list_char_slice(error, "enum `");
+    append_list_char_slice(error, enum_type->name->data);
+    append_list_char_slice(error, "` has no variant `");
+    append_list_char_slice(error, variant_name->data);
+    append_list_char_slice(error, "`.");
+    return 0;
+}
+
+int flatten_pattern(struct switch_pattern *pattern,
+                    struct type *type,
+                    struct list_access_step *path,
+                    struct global_context *global_context,
+                    struct list_pattern_test *tests,
+                    struct list_pattern_binding *bindings,
+                    struct list_char *error);
+
+// `{ variant: pattern }` tests the enum's tag, then matches the payload against the pattern.
+int flatten_variant_pattern(struct switch_pattern *pattern,
+                            struct type *type,
+                            struct list_access_step *path,
+                            struct global_context *global_context,
+                            struct list_pattern_test *tests,
+                            struct list_pattern_binding *bindings,
+                            struct list_char *error)
+{
+    struct list_key_pattern_pair *pairs = &pattern->object_pattern.pairs;
+    if (pairs->size != 1 || pairs->data[0].pattern->switch_pattern_kind == REST_PATTERN_KIND) {
+        append_list_char_slice(error, "an enum pattern matches a single variant, like `{ variant: pattern }`.");
+        return 0;
+    }
+
+    struct type payload_type = {0};
+    if (!find_variant_type(type, &pairs->data[0].key, global_context, &payload_type, error)) {
+        return 0;
+    }
+    list_append(tests, ((struct pattern_test) { .path = *path, .type = *type, .pattern = pattern }));
+
+    struct switch_pattern *payload_pattern = pairs->data[0].pattern;
+    if (is_void_type(&payload_type)) {
+        if (payload_pattern->switch_pattern_kind != UNDERSCORE_PATTERN_KIND) {
+            append_list_char_slice(error, "the variant `");
+            append_list_char_slice(error, pairs->data[0].key.data);
+            append_list_char_slice(error, "` carries nothing to match, use `_`.");
+            return 0;
+        }
+        return 1;
+    }
+
+    struct list_access_step payload_path = extend_path(path, (struct access_step) {
+        .kind = VARIANT_ACCESS_STEP,
+        .field_name = pairs->data[0].key,
+        .enum_name = type->name
+    });
+    return flatten_pattern(payload_pattern,
+                           &payload_type,
+                           &payload_path,
+                           global_context,
+                           tests,
+                           bindings,
+                           error);
+}
+
+int flatten_object_pattern(struct switch_pattern *pattern,
+                           struct type *type,
+                           struct list_access_step *path,
+                           struct global_context *global_context,
+                           struct list_pattern_test *tests,
+                           struct list_pattern_binding *bindings,
+                           struct list_char *error)
+{
+    if (type->kind == TY_ENUM && type->modifiers.size == 0) {
+        return flatten_variant_pattern(pattern, type, path, global_context, tests, bindings, error);
+    }
+
+    if (type->kind != TY_STRUCT || type->modifiers.size > 0) {
+        append_list_char_slice(error, "an object pattern can only match a struct or an enum.");
+        return 0;
+    }
+
+    struct list_key_pattern_pair *pairs = &pattern->object_pattern.pairs;
+    for (size_t i = 0; i < pairs->size; i++) {
+        // `..` just says the fields left out are ignored, which they always are.
+        if (pairs->data[i].pattern->switch_pattern_kind == REST_PATTERN_KIND) {
+            continue;
+        }
+
+        struct type field_type = {0};
+        if (!find_field_type(type, &pairs->data[i].key, global_context, &field_type, error)) {
+            return 0;
+        }
+
+        struct list_access_step field_path = extend_path(path, (struct access_step) {
+            .kind = FIELD_ACCESS_STEP,
+            .field_name = pairs->data[i].key
+        });
+        if (!flatten_pattern(pairs->data[i].pattern,
+                             &field_type,
+                             &field_path,
+                             global_context,
+                             tests,
+                             bindings,
+                             error))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int flatten_array_pattern(struct switch_pattern *pattern,
+                          struct type *type,
+                          struct list_access_step *path,
+                          struct global_context *global_context,
+                          struct list_pattern_test *tests,
+                          struct list_pattern_binding *bindings,
+                          struct list_char *error)
+{
+    if (type->modifiers.size == 0
+        || type->modifiers.data[0].kind != ARRAY_MODIFIER_KIND
+        || !type->modifiers.data[0].array_modifier.literally_sized)
+    {
+        append_list_char_slice(error, "an array pattern can only match an array of a known size.");
+        return 0;
+    }
+    if (type->modifiers.data[0].array_modifier.soa) {
+        append_list_char_slice(error, "an array pattern can't match an array of a `#[soa]` struct, its elements aren't stored whole.");
+        return 0;
+    }
+
+    int length = type->modifiers.data[0].array_modifier.literal_size;
+    struct type element_type = *type;
+    element_type.modifiers = list_create(type_modifier, type->modifiers.size);
+    for (size_t i = 1; i < type->modifiers.size; i++) {
+        list_append(&element_type.modifiers, type->modifiers.data[i]);
+    }
+
+    struct list_switch_pattern *patterns = pattern->array_pattern.patterns;
+    int rest_at = -1;
+    for (size_t i = 0; i < patterns->size; i++) {
+        if (patterns->data[i].switch_pattern_kind != REST_PATTERN_KIND) continue;
+        if (rest_at >= 0) {
+            append_list_char_slice(error, "an array pattern can only contain one `..`.");
+            return 0;
+        }
+        rest_at = i;
+    }
+
+    int element_count = rest_at >= 0 ? patterns->size - 1 : patterns->size;
+    if (element_count > length || (rest_at < 0 && element_count != length)) {
+        append_list_char_slice(error, "an array pattern must match every element of the array, or use `..`.");
+        return 0;
+    }
+
+    for (size_t i = 0; i < patterns->size; i++) {
+        if ((int)i == rest_at) continue;
+
+        // elements after the `..` line up with the end of the array.
+        int index = rest_at >= 0 && (int)i > rest_at ? length - ((int)patterns->size - (int)i) : (int)i;
+        struct list_access_step element_path = extend_path(path, (struct access_step) {
+            .kind = INDEX_ACCESS_STEP,
+            .index = index
+        });
+        if (!flatten_pattern(&patterns->data[i],
+                             &element_type,
+                             &element_path,
+                             global_context,
+                             tests,
+                             bindings,
+                             error))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Splits a pattern into the literal tests it makes and the variables it binds.
+int flatten_pattern(struct switch_pattern *pattern,
+                    struct type *type,
+                    struct list_access_step *path,
+                    struct global_context *global_context,
+                    struct list_pattern_test *tests,
+                    struct list_pattern_binding *bindings,
+                    struct list_char *error)
+{
+    switch (pattern->switch_pattern_kind) {
+        case NUMBER_PATTERN_KIND:
+        {
+            enum switch_subject_kind kind = classify_switch_subject(type);
+            if (kind != SWITCH_ON_INTEGER && kind != SWITCH_ON_FLOAT) {
+                append_list_char_slice(error, "a number pattern can only match a number.");
+                return 0;
+            }
+            if (kind == SWITCH_ON_INTEGER && pattern->number_pattern.number != (long long)pattern->number_pattern.number) {
+                append_list_char_slice(error, "cannot match a fractional number against an integer.");
+                return 0;
+            }
+            list_append(tests, ((struct pattern_test) { .path = *path, .type = *type, .pattern = pattern }));
+            return 1;
+        }
+        case STRING_PATTERN_KIND:
+        {
+            if (classify_switch_subject(type) != SWITCH_ON_STRING) {
+                append_list_char_slice(error, "a string pattern can only match a string.");
+                return 0;
+            }
+            list_append(tests, ((struct pattern_test) { .path = *path, .type = *type, .pattern = pattern }));
+            return 1;
+        }
+        case VARIABLE_PATTERN_KIND:
+        {
+            struct pattern_binding binding = (struct pattern_binding) {
+                .name = pattern->variable_pattern.variable_name,
+                .path = *path,
+                .type = switch_binding_type(type)
+            };
+            list_append(bindings, binding);
+            return 1;
+        }
+        case UNDERSCORE_PATTERN_KIND:
+            return 1;
+        case OBJECT_PATTERN_KIND:
+            return flatten_object_pattern(pattern, type, path, global_context, tests, bindings, error);
+        case ARRAY_PATTERN_KIND:
+            return flatten_array_pattern(pattern, type, path, global_context, tests, bindings, error);
+        case REST_PATTERN_KIND:
+        {
+            append_list_char_slice(error, "`..` can only be used within an object or array pattern.");
+            return 0;
+        }
+    }
+
+    UNREACHABLE("flatten_pattern fell out of a switch");
+}
+
+int switch_pattern_bindings(struct switch_pattern *pattern,
+                            struct type *subject_type,
+                            struct global_context *global_context,
+                            struct list_pattern_binding *out,
+                            struct list_char *error)
+{
+    struct list_pattern_test tests = list_create(pattern_test, 4);
+    struct list_access_step root = list_create(access_step, 1);
+    return flatten_pattern(pattern, subject_type, &root, global_context, &tests, out, error);
+}
+
+int find_test(struct pattern_row *row, struct list_access_step *path)
+{
+    for (size_t i = 0; i < row->tests.size; i++) {
+        if (path_eq(&row->tests.data[i].path, path)) return i;
+    }
+    return -1;
+}
+
+struct pattern_row without_test(struct pattern_row *row, int test)
+{
+    struct pattern_row output = {
+        .tests = list_create(pattern_test, row->tests.size),
+        .arm = row->arm
+    };
+    for (size_t i = 0; i < row->tests.size; i++) {
+        if ((int)i != test) list_append(&output.tests, row->tests.data[i]);
+    }
+    return output;
+}
+
+// Tests one of the first row's parts. Preferring the part most rows test keeps the rows which
+// don't care about it, and get copied down every branch, to a minimum.
+struct pattern_test *choose_test(struct list_pattern_row *rows)
+{
+    struct pattern_row *first = &rows->data[0];
+    struct pattern_test *best = NULL;
+    size_t best_count = 0;
+    for (size_t i = 0; i < first->tests.size; i++) {
+        // a variant's payload is only read once its tag has been tested.
+        int behind_tag = 0;
+        for (size_t j = 0; j < first->tests.size; j++) {
+            behind_tag |= path_is_strict_prefix(&first->tests.data[j].path, &first->tests.data[i].path);
+        }
+        if (behind_tag) continue;
+
+        size_t count = 0;
+        for (size_t r = 0; r < rows->size; r++) {
+            count += find_test(&rows->data[r], &first->tests.data[i].path) >= 0;
+        }
+        if (count > best_count) {
+            best = &first->tests.data[i];
+            best_count = count;
+        }
+    }
+    return best;
+}
+
+struct decision_tree *build_tree(struct list_pattern_row *rows, struct list_int *reached)
+{
+    struct decision_tree *output = malloc(sizeof(*output));
+    if (rows->size == 0) {
+        *output = (struct decision_tree) { .kind = DECISION_FAIL };
+        return output;
+    }
+
+    if (rows->data[0].tests.size == 0) {
+        *output = (struct decision_tree) { .kind = DECISION_MATCH, .arm = rows->data[0].arm };
+        list_append(reached, (int)rows->data[0].arm);
+        return output;
+    }
+
+    struct pattern_test *chosen = choose_test(rows);
+    *output = (struct decision_tree) {
+        .kind = DECISION_TEST,
+        .path = chosen->path,
+        .type = chosen->type,
+        .branches = list_create(decision_branch, 4)
+    };
+
+    struct list_pattern_row otherwise = list_create(pattern_row, rows->size);
+    for (size_t r = 0; r < rows->size; r++) {
+        struct pattern_row *row = &rows->data[r];
+        int test = find_test(row, &chosen->path);
+        if (test < 0) {
+            list_append(&otherwise, *row);
+            continue;
+        }
+
+        struct switch_pattern *pattern = row->tests.data[test].pattern;
+        int seen = 0;
+        for (size_t b = 0; b < output->branches.size; b++) {
+            seen |= literal_pattern_eq(output->branches.data[b].pattern, pattern);
+        }
+        if (seen) continue;
+
+        // every row which either matches this literal, or doesn't test this part at all.
+        struct list_pattern_row specialised = list_create(pattern_row, rows->size);
+        for (size_t s = 0; s < rows->size; s++) {
+            int other_test = find_test(&rows->data[s], &chosen->path);
+            if (other_test < 0) {
+                list_append(&specialised, rows->data[s]);
+            } else if (literal_pattern_eq(rows->data[s].tests.data[other_test].pattern, pattern)) {
+                list_append(&specialised, without_test(&rows->data[s], other_test));
+            }
+        }
+
+        struct decision_branch branch = {
+            .pattern = pattern,
+            .tree = build_tree(&specialised, reached)
+        };
+        list_append(&output->branches, branch);
+    }
+
+    output->otherwise = build_tree(&otherwise, reached);
+    return output;
+}
+
+int compile_decision_tree(struct switch_statement *s,
+                          struct type *subject_type,
+                          struct global_context *global_context,
+                          struct decision_tree **out,
+                          struct list_int *unreachable_arms,
+                          struct list_char *error)
+{
+    struct list_pattern_row rows = list_create(pattern_row, s->cases.size);
+    struct list_pattern_binding *arm_bindings = malloc(sizeof(*arm_bindings) * s->cases.size);
+    for (size_t i = 0; i < s->cases.size; i++) {
+        struct pattern_row row = {
+            .tests = list_create(pattern_test, 4),
+            .arm = i
+        };
+        arm_bindings[i] = list_create(pattern_binding, 4);
+        struct list_access_step root = list_create(access_step, 1);
+        if (!flatten_pattern(&s->cases.data[i].pattern,
+                             subject_type,
+                             &root,
+                             global_context,
+                             &row.tests,
+                             &arm_bindings[i],
+                             error))
+        {
+            return 0;
+        }
+        list_append(&rows, row);
+    }
+
+    struct list_int reached = list_create(int, s->cases.size);
+    *out = build_tree(&rows, &reached);
+    (*out)->arm_bindings = arm_bindings;
+
+    for (size_t i = 0; i < s->cases.size; i++) {
+        int was_reached = 0;
+        for (size_t r = 0; r < reached.size; r++) {
+            was_reached |= reached.data[r] == (int)i;
+        }
+        if (!was_reached) list_append(unreachable_arms, (int)i);
+    }
+    return 1;
+}
@@ -0,0 +1,78 @@
+#ifndef DECISION_TREE_H
+#define DECISION_TREE_H
+
+#include "ast.h"
+#include "context.h"
+
+enum access_step_kind {
+    FIELD_ACCESS_STEP = 1,
+    INDEX_ACCESS_STEP,
+    VARIANT_ACCESS_STEP
+};
+
+// One step from the switched on value towards a part of it, a struct field, array element or the
+// payload of an enum variant.
+typedef struct access_step {
+    enum access_step_kind kind;
+    union {
+        // the field, or the variant, named.
+        struct list_char field_name;
+        int index;
+    };
+    // VARIANT_ACCESS_STEP
+    struct list_char *enum_name;
+} access_step;
+
+struct_list(access_step);
+
+typedef struct pattern_binding {
+    struct list_char name;
+    struct list_access_step path;
+    struct type type;
+} pattern_binding;
+
+struct_list(pattern_binding);
+
+enum decision_kind {
+    DECISION_MATCH = 1,
+    DECISION_FAIL,
+    DECISION_TEST
+};
+
+typedef struct decision_branch {
+    struct switch_pattern *pattern;
+    struct decision_tree *tree;
+} decision_branch;
+
+struct_list(decision_branch);
+
+// Every path from the root tests a given part of the switched on value at most once.
+struct decision_tree {
+    enum decision_kind kind;
+    // DECISION_MATCH
+    size_t arm;
+    // DECISION_TEST
+    struct list_access_step path;
+    struct type type;
+    struct list_decision_branch branches;
+    struct decision_tree *otherwise;
+    // the variables each case binds, indexed by case, only set on the root.
+    struct list_pattern_binding *arm_bindings;
+};
+
+int needs_decision_tree(struct switch_statement *s);
+
+int switch_pattern_bindings(struct switch_pattern *pattern,
+                            struct type *subject_type,
+                            struct global_context *global_context,
+                            struct list_pattern_binding *out,
+                            struct list_char *error);
+
+int compile_decision_tree(struct switch_statement *s,
+                          struct type *subject_type,
+                          struct global_context *global_context,
+                          struct decision_tree **out,
+                          struct list_int *unreachable_arms,
+                          struct list_char *error);
+
+#endif
@@ -2,6 +2,7 @@
 
 #define NO_COLOUR "\x1B[0m"
 #define RED "\x1B[31m"
+#define YELLOW "\x1B[33m"
 
 void add_error(unsigned int row,
                unsigned int col,
@@ -20,7 +21,7 @@ void add_error(unsigned int row,
 
     struct error err = (struct error) {
         .row = row,
-        .col = row,
+        .col = col,
         .file_name = file_name,
         .errored = 1,
         .error_message = error_message,
@@ -54,6 +55,22 @@ void write_error(FILE *f, struct error *err)
     write_error_inner(f, err, 0);
 }
 
+// Warnings don't stop compilation, so they're written out as soon as they're found.
+void write_warning(FILE *f,
+                   unsigned int row,
+                   unsigned int col,
+                   char *file_name,
+                   char *message)
+{
+    fprintf(f, "%s:%d:%d: %sWARNING:%s %s\n",
+        file_name,
+        row,
+        col + 1,
+        YELLOW,
+        NO_COLOUR,
+        message);
+}
+
 void write_raw_error(FILE *f, char *raw)
 {
     fprintf(f, "%sERROR:%s %s\n",
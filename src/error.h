@@ -22,5 +22,10 @@ void add_error(unsigned int row,
 
 void write_error(FILE *f, struct error *error);
 void write_raw_error(FILE *f, char *error);
+void write_warning(FILE *f,
+                   unsigned int row,
+                   unsigned int col,
+                   char *file_name,
+                   char *message);
 
 #endif
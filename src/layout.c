@@ -0,0 +1,675 @@
+#include <assert.h>
+#include <string.h>
+#include "layout.h"
+#include "../lib/collections.h"
+#include "../lib/utils.h"
+
+#define POINTER_SIZE 8
+// structs nested by value deeper than this are taken to contain themselves.
+#define MAX_NESTING 64
+
+struct layout primitive_layout(enum primitive_type primitive)
+{
+    // mirrors the exact width types `write_primitive_type` lowers each primitive to.
+    switch (primitive) {
+        case VOID:
+            return (struct layout) { .size = 0, .align = 1 };
+        case BOOL:
+        case U8:
+        case I8:
+            return (struct layout) { .size = 1, .align = 1 };
+        case I16:
+        case U16:
+            return (struct layout) { .size = 2, .align = 2 };
+        case I32:
+        case U32:
+        case F32:
+            return (struct layout) { .size = 4, .align = 4 };
+        case I64:
+        case U64:
+        case USIZE:
+        case F64:
+            return (struct layout) { .size = 8, .align = 8 };
+        case ARENA:
+            // `struct __rm_arena`, three pointers and six counters.
+            return (struct layout) { .size = 72, .align = 8 };
+        case F32X4:
+        case I32X4:
+        case U8X16:
+            return (struct layout) { .size = 16, .align = 16 };
+        case F32X8:
+        case I32X8:
+        case U8X32:
+            return (struct layout) { .size = 32, .align = 32 };
+    }
+
+    UNREACHABLE("primitive_layout fell out of a switch");
+}
+
+size_t align_up(size_t offset, size_t align)
+{
+    return (offset + align - 1) / align * align;
+}
+
+size_t enum_tag_size(size_t variant_count)
+{
+    // one more value than there are variants is kept free, for a nullable enum's null.
+    if (variant_count < 0xff) return 1;
+    if (variant_count < 0xffff) return 2;
+    return 4;
+}
+
+struct type *find_data_type(struct global_context *global_context, struct list_char *name)
+{
+    for (size_t i = 0; i < global_context->data_types.size; i++) {
+        if (list_char_eq(global_context->data_types.data[i].name, name)) {
+            return &global_context->data_types.data[i];
+        }
+    }
+    return NULL;
+}
+
+int type_layout_inner(struct type *ty, struct global_context *global_context, int depth, struct layout *out);
+
+int is_flexible_array(struct type *ty)
+{
+    return ty->modifiers.size > 0
+        && ty->modifiers.data[0].kind == ARRAY_MODIFIER_KIND
+        && !ty->modifiers.data[0].array_modifier.literally_sized;
+}
+
+int sized_by_field(struct type *data_type, struct list_char **length_field)
+{
+    if (data_type->kind != TY_STRUCT || data_type->struct_type.pairs.size == 0) return 0;
+    struct list_key_type_pair *pairs = &data_type->struct_type.pairs;
+    struct type *last = pairs->data[pairs->size - 1].field_type;
+    if (!is_flexible_array(last) || !last->modifiers.data[0].array_modifier.reference_sized) return 0;
+    *length_field = last->modifiers.data[0].array_modifier.reference_name;
+    return 1;
+}
+
+size_t declared_alignment(struct list_attribute *attributes)
+{
+    if (attributes == NULL) return 1;
+    for (size_t i = 0; i < attributes->size; i++) {
+        struct attribute *attribute = &attributes->data[i];
+        if (strcmp(attribute->name.data, "align") == 0 && attribute->has_argument) {
+            return (size_t)attribute->numeric_argument;
+        }
+    }
+    return 1;
+}
+
+// `#[packed]` sets every field's alignment to 1, like GCC's `packed`, and `#[align(N)]` raises the
+// struct's to at least N.
+int fields_layout(struct struct_type *struct_type,
+                  struct global_context *global_context,
+                  int depth,
+                  struct layout *out)
+{
+    struct list_key_type_pair *pairs = &struct_type->pairs;
+    int packed = has_attribute(struct_type->attributes, "packed", NULL);
+    struct layout output = { .size = 0, .align = 1 };
+    for (size_t i = 0; i < pairs->size; i++) {
+        struct layout field = {0};
+        if (!type_layout_inner(pairs->data[i].field_type, global_context, depth, &field)) return 0;
+        if (packed) field.align = 1;
+        output.size = align_up(output.size, field.align) + field.size;
+        if (field.align > output.align) output.align = field.align;
+    }
+    size_t declared = declared_alignment(struct_type->attributes);
+    if (declared > output.align) output.align = declared;
+    output.size = align_up(output.size, output.align);
+    *out = output;
+    return 1;
+}
+
+int base_type_layout(struct type *ty, struct global_context *global_context, int depth, struct layout *out)
+{
+    switch (ty->kind) {
+        case TY_PRIMITIVE:
+            *out = primitive_layout(ty->primitive_type);
+            return 1;
+        case TY_FUNCTION:
+            *out = (struct layout) { .size = POINTER_SIZE, .align = POINTER_SIZE };
+            return 1;
+        case TY_STRUCT:
+        {
+            if (depth > MAX_NESTING) return 0;
+            struct type *defined = find_data_type(global_context, ty->name);
+            if (defined == NULL || defined->kind != TY_STRUCT) return 0;
+            return fields_layout(&defined->struct_type, global_context, depth + 1, out);
+        }
+        case TY_ENUM:
+        {
+            if (depth > MAX_NESTING) return 0;
+            struct type *defined = find_data_type(global_context, ty->name);
+            if (defined == NULL || defined->kind != TY_ENUM) return 0;
+
+            // a union of one `{ tag, payload }` struct per variant, so a variant with a small
+            // payload isn't padded out to the alignment of another's.
+            size_t tag = enum_tag_size(defined->enum_type.pairs.size);
+            struct layout output = { .size = tag, .align = tag };
+            for (size_t i = 0; i < defined->enum_type.pairs.size; i++) {
+                struct layout payload = {0};
+                if (!type_layout_inner(defined->enum_type.pairs.data[i].field_type,
+                                       global_context,
+                                       depth + 1,
+                                       &payload))
+                {
+                    return 0;
+                }
+                size_t align = payload.align > tag ? payload.align : tag;
+                size_t size = align_up(align_up(tag, payload.align) + payload.size, align);
+                if (size > output.size) output.size = size;
+                if (align > output.align) output.align = align;
+            }
+            output.size = align_up(output.size, output.align);
+            *out = output;
+            return 1;
+        }
+        case TY_ANY:
+            return 0;
+    }
+
+    UNREACHABLE("base_type_layout fell out of a switch");
+}
+
+int is_soa_struct(struct type *ty, struct global_context *global_context)
+{
+    if (ty->kind != TY_STRUCT) return 0;
+    struct type *defined = find_data_type(global_context, ty->name);
+    return defined != NULL
+        && defined->kind == TY_STRUCT
+        && has_attribute(defined->struct_type.attributes, "soa", NULL);
+}
+
+// An array of a `#[soa]` struct is a struct of an array per field, or of a pointer per field when
+// it's sized by a field, the arrays then following the struct that holds it.
+int soa_layout(struct type *element,
+               struct array_type_modifier *array,
+               struct global_context *global_context,
+               int depth,
+               struct layout *out)
+{
+    if (depth > MAX_NESTING) return 0;
+    struct type *defined = find_data_type(global_context, element->name);
+    if (defined == NULL || defined->kind != TY_STRUCT) return 0;
+
+    struct list_key_type_pair *pairs = &defined->struct_type.pairs;
+    struct layout output = { .size = 0, .align = 1 };
+    for (size_t i = 0; i < pairs->size; i++) {
+        struct layout field = { .size = POINTER_SIZE, .align = POINTER_SIZE };
+        if (array->literally_sized) {
+            if (!type_layout_inner(pairs->data[i].field_type, global_context, depth + 1, &field)) return 0;
+            field.size *= array->literal_size;
+        }
+        output.size = align_up(output.size, field.align) + field.size;
+        if (field.align > output.align) output.align = field.align;
+    }
+    output.size = align_up(output.size, output.align);
+    *out = output;
+    return 1;
+}
+
+int type_layout_inner(struct type *ty, struct global_context *global_context, int depth, struct layout *out)
+{
+    // modifiers run from the outermost in, so `[4]*i32` is an array of pointers.
+    size_t count = 1;
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        struct type_modifier *modifier = &ty->modifiers.data[i];
+        switch (modifier->kind) {
+            case POINTER_MODIFIER_KIND:
+            {
+                *out = (struct layout) { .size = POINTER_SIZE * count, .align = POINTER_SIZE };
+                return 1;
+            }
+            case ARRAY_MODIFIER_KIND:
+            {
+                if (modifier->array_modifier.soa) {
+                    struct layout soa = {0};
+                    if (!soa_layout(ty, &modifier->array_modifier, global_context, depth, &soa)) return 0;
+                    *out = (struct layout) { .size = soa.size * count, .align = soa.align };
+                    return 1;
+                }
+                // unsized arrays are flexible array members, which add nothing to the size.
+                count *= modifier->array_modifier.literally_sized ? modifier->array_modifier.literal_size : 0;
+                break;
+            }
+            case NULLABLE_MODIFIER_KIND:
+            {
+                if (nullable_representation(ty, i) != NULLABLE_TAGGED) break;
+
+                // a tag beside the value, unless it fits in the padding of a struct.
+                struct type inner = modifier_inner_type(ty, i);
+                struct layout value = {0};
+                if (!type_layout_inner(&inner, global_context, depth, &value)) return 0;
+                size_t tag_after = 0;
+                size_t size = nullable_tag_slot(&inner, global_context, &tag_after)
+                    ? value.size
+                    : align_up(value.size + 1, value.align);
+                *out = (struct layout) { .size = size * count, .align = value.align };
+                return 1;
+            }
+            case SLICE_MODIFIER_KIND:
+            {
+                // a pointer to the elements, then their count.
+                *out = (struct layout) { .size = 2 * POINTER_SIZE * count, .align = POINTER_SIZE };
+                return 1;
+            }
+            case MUTABLE_MODIFIER_KIND:
+            case ATOMIC_MODIFIER_KIND:
+                // `_Atomic` keeps the size and alignment of the integers rm allows it on.
+                break;
+        }
+    }
+
+    struct layout base = {0};
+    if (!base_type_layout(ty, global_context, depth, &base)) return 0;
+    *out = (struct layout) { .size = base.size * count, .align = base.align };
+    return 1;
+}
+
+int type_layout(struct type *ty, struct global_context *global_context, struct layout *out)
+{
+    return type_layout_inner(ty, global_context, 0, out);
+}
+
+enum nullable_representation nullable_representation(struct type *ty, size_t index)
+{
+    assert(ty->modifiers.data[index].kind == NULLABLE_MODIFIER_KIND);
+    size_t next = index + 1;
+    while (next < ty->modifiers.size && ty->modifiers.data[next].kind == MUTABLE_MODIFIER_KIND) {
+        next++;
+    }
+
+    if (next < ty->modifiers.size) {
+        return ty->modifiers.data[next].kind == POINTER_MODIFIER_KIND
+            ? NULLABLE_POINTER_NICHE
+            : NULLABLE_TAGGED;
+    }
+    if (ty->kind == TY_FUNCTION) return NULLABLE_POINTER_NICHE;
+    if (ty->kind == TY_PRIMITIVE && ty->primitive_type == BOOL) return NULLABLE_BOOL_NICHE;
+    if (ty->kind == TY_ENUM) return NULLABLE_ENUM_NICHE;
+    return NULLABLE_TAGGED;
+}
+
+struct type modifier_inner_type(struct type *ty, size_t index)
+{
+    struct type inner = *ty;
+    inner.modifiers = list_create(type_modifier, (ty->modifiers.size - index));
+    for (size_t i = index + 1; i < ty->modifiers.size; i++) {
+        list_append(&inner.modifiers, ty->modifiers.data[i]);
+    }
+    return inner;
+}
+
+size_t c_declarator_modifier_count(struct list_type_modifier *modifiers)
+{
+    for (size_t i = 0; i < modifiers->size; i++) {
+        if (modifiers->data[i].kind == SLICE_MODIFIER_KIND) return i;
+        if (modifiers->data[i].kind != NULLABLE_MODIFIER_KIND) continue;
+
+        size_t next = i + 1;
+        while (next < modifiers->size && modifiers->data[next].kind == MUTABLE_MODIFIER_KIND) next++;
+        if (next < modifiers->size && modifiers->data[next].kind != POINTER_MODIFIER_KIND) return i;
+    }
+    return modifiers->size;
+}
+
+int first_tagged_nullable(struct type *ty, size_t *out)
+{
+    // `null` on its own has no type to wrap yet.
+    if (ty->kind == TY_ANY) return 0;
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        if (ty->modifiers.data[i].kind == NULLABLE_MODIFIER_KIND
+            && nullable_representation(ty, i) == NULLABLE_TAGGED)
+        {
+            *out = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int first_slice(struct type *ty, size_t *out)
+{
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        if (ty->modifiers.data[i].kind == SLICE_MODIFIER_KIND) {
+            *out = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int nullable_tag_slot(struct type *inner, struct global_context *global_context, size_t *tag_after)
+{
+    if (inner->kind != TY_STRUCT || inner->modifiers.size > 0) return 0;
+    struct type *defined = find_data_type(global_context, inner->name);
+    if (defined == NULL || defined->kind != TY_STRUCT) return 0;
+
+    struct list_key_type_pair *pairs = &defined->struct_type.pairs;
+    if (pairs->size == 0 || is_flexible_array(pairs->data[pairs->size - 1].field_type)) return 0;
+    // the C struct the tag shares wouldn't carry the attributes, nor their padding.
+    struct list_attribute *attributes = defined->struct_type.attributes;
+    if (has_attribute(attributes, "packed", NULL) || has_attribute(attributes, "align", NULL)) return 0;
+
+    struct layout whole = {0};
+    if (!fields_layout(&defined->struct_type, global_context, 1, &whole)) return 0;
+
+    // the first gap between a field's end and where the next one, or the struct, ends.
+    size_t offset = 0;
+    for (size_t i = 0; i < pairs->size; i++) {
+        struct layout field = {0};
+        if (!type_layout(pairs->data[i].field_type, global_context, &field)) return 0;
+        offset = align_up(offset, field.align) + field.size;
+
+        size_t next = whole.size;
+        if (i + 1 < pairs->size) {
+            struct layout next_field = {0};
+            if (!type_layout(pairs->data[i + 1].field_type, global_context, &next_field)) return 0;
+            next = align_up(offset, next_field.align);
+        }
+        if (next > offset) {
+            *tag_after = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int has_attribute(struct list_attribute *attributes, char *name, char *argument)
+{
+    if (attributes == NULL) return 0;
+    for (size_t i = 0; i < attributes->size; i++) {
+        struct attribute *attribute = &attributes->data[i];
+        if (strcmp(attribute->name.data, name) != 0) continue;
+        if (argument == NULL) return 1;
+        if (attribute->has_argument
+            && attribute->argument.data != NULL
+            && strcmp(attribute->argument.data, argument) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Placing fields by descending alignment leaves no padding between them, as every alignment is
+// a power of two. A flexible array member has to stay last.
+void sort_fields(struct list_key_type_pair *pairs, struct layout *field_layouts)
+{
+    for (size_t i = 1; i < pairs->size; i++) {
+        struct key_type_pair pair = pairs->data[i];
+        struct layout layout = field_layouts[i];
+        int flexible = is_flexible_array(pair.field_type);
+        size_t j = i;
+        while (j > 0
+               && !flexible
+               && (is_flexible_array(pairs->data[j - 1].field_type)
+                   || field_layouts[j - 1].align < layout.align))
+        {
+            pairs->data[j] = pairs->data[j - 1];
+            field_layouts[j] = field_layouts[j - 1];
+            j--;
+        }
+        pairs->data[j] = pair;
+        field_layouts[j] = layout;
+    }
+}
+
+struct layout_state {
+    struct parsed_file *parsed_file;
+    FILE *report;
+    // indexes into the file's statements of structs already laid out.
+    struct list_int done;
+};
+
+int is_held_by_value(struct type *ty)
+{
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        if (ty->modifiers.data[i].kind == POINTER_MODIFIER_KIND) return 0;
+    }
+    return 1;
+}
+
+void lay_out_struct(size_t index, struct layout_state *state)
+{
+    for (size_t i = 0; i < state->done.size; i++) {
+        if (state->done.data[i] == (int)index) return;
+    }
+    list_append(&state->done, (int)index);
+
+    struct type_declaration_statement *declaration =
+        &state->parsed_file->statements.data[index].type_declaration;
+    struct global_context *global_context = &state->parsed_file->global_context;
+    FILE *report = state->report;
+    struct type *ty = &declaration->type;
+
+    // structs held by value are settled first, so this one's size is measured with theirs.
+    for (size_t i = 0; i < ty->struct_type.pairs.size; i++) {
+        struct type *field_type = ty->struct_type.pairs.data[i].field_type;
+        if (field_type->kind != TY_STRUCT || !is_held_by_value(field_type)) continue;
+
+        for (size_t j = 0; j < state->parsed_file->statements.size; j++) {
+            struct statement *s = &state->parsed_file->statements.data[j];
+            if (s->kind == TYPE_DECLARATION_STATEMENT
+                && s->type_declaration.type.kind == TY_STRUCT
+                && list_char_eq(s->type_declaration.type.name, field_type->name))
+            {
+                lay_out_struct(j, state);
+            }
+        }
+    }
+
+    struct list_key_type_pair *pairs = &ty->struct_type.pairs;
+    struct layout declared = {0};
+    if (!fields_layout(&ty->struct_type, global_context, 1, &declared)) {
+        // unknown or recursive types are reported by the soundness check.
+        return;
+    }
+
+    int pinned = has_attribute(&declaration->attributes, "repr", "declared");
+    int flexible_misplaced = 0;
+    for (size_t i = 0; i + 1 < pairs->size; i++) {
+        if (is_flexible_array(pairs->data[i].field_type)) flexible_misplaced = 1;
+    }
+    struct layout reordered = declared;
+    if (!pinned && pairs->size > 1) {
+        struct layout *field_layouts = malloc(sizeof(*field_layouts) * pairs->size);
+        for (size_t i = 0; i < pairs->size; i++) {
+            type_layout(pairs->data[i].field_type, global_context, &field_layouts[i]);
+        }
+
+        struct key_type_pair *original = malloc(sizeof(*original) * pairs->size);
+        memcpy(original, pairs->data, sizeof(*original) * pairs->size);
+        sort_fields(pairs, field_layouts);
+        fields_layout(&ty->struct_type, global_context, 1, &reordered);
+
+        // only move fields when it pays off, declaration order is easier to debug. A flexible
+        // array member is moved last whatever it costs, C allows it nowhere else.
+        if (reordered.size >= declared.size && !flexible_misplaced) {
+            memcpy(pairs->data, original, sizeof(*original) * pairs->size);
+            reordered = declared;
+        }
+        free(original);
+        free(field_layouts);
+    }
+
+    if (report != NULL) {
+        fprintf(report, "struct %s: %zu bytes, align %zu", ty->name->data, reordered.size, reordered.align);
+        if (pinned) {
+            fprintf(report, " (declared order kept by #[repr(declared)])\n");
+        } else if (reordered.size < declared.size) {
+            fprintf(report, " (was %zu bytes in declared order)\n", declared.size);
+        } else {
+            fprintf(report, " (declared order is already smallest)\n");
+        }
+    }
+}
+
+// `name_new(length)` allocates a struct and its trailing array in one go, it's defined by the
+// lowering.
+void declare_constructor(struct type *data_type, struct global_context *global_context)
+{
+    struct list_char *length_field = NULL;
+    if (!sized_by_field(data_type, &length_field)) return;
+
+    struct list_char *name = malloc(sizeof(*name));
+    *name = list_create(char, 16);
+    append_list_char_slice(name, data_type->name->data);
+    append_list_char_slice(name, "_new");
+    list_append(name, '\0');
+
+    struct type *length_type = malloc(sizeof(*length_type));
+    *length_type = (struct type) {
+        .kind = TY_PRIMITIVE,
+        .modifiers = list_create(type_modifier, 1),
+        .primitive_type = USIZE
+    };
+    struct list_key_type_pair params = list_create(key_type_pair, 1);
+    list_append(&params, ((struct key_type_pair) {
+        .field_name = *length_field,
+        .field_type = length_type
+    }));
+
+    struct type *return_type = malloc(sizeof(*return_type));
+    *return_type = (struct type) {
+        .kind = TY_STRUCT,
+        .name = data_type->name,
+        .modifiers = list_create(type_modifier, 1)
+    };
+    list_append(&return_type->modifiers, ((struct type_modifier) { .kind = POINTER_MODIFIER_KIND }));
+
+    list_append(&global_context->fn_types, ((struct type) {
+        .kind = TY_FUNCTION,
+        .name = name,
+        .modifiers = list_create(type_modifier, 1),
+        .function_type = (struct function_type) {
+            .params = params,
+            .return_type = return_type
+        }
+    }));
+}
+
+int lay_out_structs(struct parsed_file *parsed_file, FILE *report, struct error *error)
+{
+    struct layout_state state = {
+        .parsed_file = parsed_file,
+        .report = report,
+        .done = list_create(int, 10)
+    };
+
+    // a struct's fields share their storage with its copy in the global context, so reordering
+    // one reorders both.
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        struct statement *s = &parsed_file->statements.data[i];
+        if (s->kind != TYPE_DECLARATION_STATEMENT || s->type_declaration.type.kind != TY_STRUCT) {
+            continue;
+        }
+        lay_out_struct(i, &state);
+    }
+
+    struct global_context *global_context = &parsed_file->global_context;
+    for (size_t i = 0; i < global_context->data_types.size; i++) {
+        declare_constructor(&global_context->data_types.data[i], global_context);
+    }
+    return 1;
+}
+
+int is_soa_array(struct type *ty)
+{
+    return ty->modifiers.size > 0
+        && ty->modifiers.data[0].kind == ARRAY_MODIFIER_KIND
+        && ty->modifiers.data[0].array_modifier.soa;
+}
+
+void mark_soa_type(struct type *ty, struct global_context *global_context)
+{
+    size_t count = ty->modifiers.size;
+    if (count > 0
+        && ty->modifiers.data[count - 1].kind == ARRAY_MODIFIER_KIND
+        && is_soa_struct(ty, global_context))
+    {
+        ty->modifiers.data[count - 1].array_modifier.soa = 1;
+    }
+
+    if (ty->kind != TY_FUNCTION) return;
+    for (size_t i = 0; i < ty->function_type.params.size; i++) {
+        mark_soa_type(ty->function_type.params.data[i].field_type, global_context);
+    }
+    mark_soa_type(ty->function_type.return_type, global_context);
+}
+
+void mark_soa_statement(struct statement *s, struct global_context *global_context)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            if (s->binding_statement.has_type) {
+                mark_soa_type(&s->binding_statement.variable_type, global_context);
+            }
+            return;
+        case IF_STATEMENT:
+            mark_soa_statement(s->if_statement.success_statement, global_context);
+            if (s->if_statement.else_statement != NULL) {
+                mark_soa_statement(s->if_statement.else_statement, global_context);
+            }
+            return;
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                mark_soa_statement(&s->statements->data[i], global_context);
+            }
+            return;
+        case WHILE_LOOP_STATEMENT:
+            mark_soa_statement(s->while_loop_statement.do_statement, global_context);
+            return;
+        case FOR_LOOP_STATEMENT:
+            mark_soa_statement(s->for_loop_statement.do_statement, global_context);
+            return;
+        case SWITCH_STATEMENT:
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                mark_soa_statement(s->switch_statement.cases.data[i].statement, global_context);
+            }
+            return;
+        case TYPE_DECLARATION_STATEMENT:
+        {
+            struct type *ty = &s->type_declaration.type;
+            if (ty->kind != TY_FUNCTION) return;
+            mark_soa_type(ty, global_context);
+            if (s->type_declaration.statements == NULL) return;
+            for (size_t i = 0; i < s->type_declaration.statements->size; i++) {
+                mark_soa_statement(&s->type_declaration.statements->data[i], global_context);
+            }
+            return;
+        }
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return;
+    }
+}
+
+void mark_soa_arrays(struct parsed_file *parsed_file)
+{
+    // struct fields and signatures share their types with the declarations, so marking the
+    // global context's marks those too.
+    struct global_context *global_context = &parsed_file->global_context;
+    for (size_t i = 0; i < global_context->data_types.size; i++) {
+        struct type *data_type = &global_context->data_types.data[i];
+        struct list_key_type_pair *pairs = data_type->kind == TY_STRUCT
+            ? &data_type->struct_type.pairs
+            : &data_type->enum_type.pairs;
+        for (size_t j = 0; j < pairs->size; j++) {
+            mark_soa_type(pairs->data[j].field_type, global_context);
+        }
+    }
+    for (size_t i = 0; i < global_context->fn_types.size; i++) {
+        mark_soa_type(&global_context->fn_types.data[i], global_context);
+    }
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        mark_soa_statement(&parsed_file->statements.data[i], global_context);
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdio.h>
+#include "ast.h"
+#include "parser.h"
+#include "error.h"
+
+// The size and alignment a type has once lowered to C, for the x86-64/aarch64 SysV ABIs.
+struct layout {
+    size_t size;
+    size_t align;
+};
+
+struct type *find_data_type(struct global_context *global_context, struct list_char *name);
+int type_layout(struct type *ty, struct global_context *global_context, struct layout *out);
+// The bytes an enum's tag takes, the narrowest that fits every variant and a null.
+size_t enum_tag_size(size_t variant_count);
+
+enum nullable_representation {
+    // null is the NULL pointer, so `?*T` lowers to a bare `*T`.
+    NULLABLE_POINTER_NICHE = 1,
+    // null is 2, a value a bool never holds.
+    NULLABLE_BOOL_NICHE,
+    // null is a tag one past the last variant.
+    NULLABLE_ENUM_NICHE,
+    // a `present` tag beside the value.
+    NULLABLE_TAGGED
+};
+
+// How the nullable modifier at `index` of the type's modifiers is represented.
+enum nullable_representation nullable_representation(struct type *ty, size_t index);
+// The type the nullable or slice modifier at `index` wraps.
+struct type modifier_inner_type(struct type *ty, size_t index);
+// How many of the modifiers a C declarator writes, the rest sit within the struct of a tagged
+// nullable or a slice.
+size_t c_declarator_modifier_count(struct list_type_modifier *modifiers);
+int first_tagged_nullable(struct type *ty, size_t *out);
+int first_slice(struct type *ty, size_t *out);
+// Whether a nullable of `inner` can keep its tag in the padding of the struct `inner` is, and if so
+// which field the tag follows.
+int nullable_tag_slot(struct type *inner, struct global_context *global_context, size_t *tag_after);
+int has_attribute(struct list_attribute *attributes, char *name, char *argument);
+// The N of `#[align(N)]`, or 1 without one.
+size_t declared_alignment(struct list_attribute *attributes);
+// Whether the type is an array without a size of its own, a C flexible array member.
+int is_flexible_array(struct type *ty);
+// Whether the struct ends in an array sized by another of its fields, a C flexible array member,
+// and if so which field holds its length.
+int sized_by_field(struct type *data_type, struct list_char **length_field);
+
+// Reorders the fields of structs to minimise their padding, unless `#[repr(declared)]` pins the
+// declared order. When `report` isn't NULL each struct's size before and after is written to it.
+int lay_out_structs(struct parsed_file *parsed_file, FILE *report, struct error *error);
+
+// Whether the struct type is declared `#[soa]`.
+int is_soa_struct(struct type *ty, struct global_context *global_context);
+// Marks each array whose elements are a `#[soa]` struct, which lowers to a struct holding an
+// array of each field, so `rows[i].field` reads only that field's array.
+void mark_soa_arrays(struct parsed_file *parsed_file);
+// Whether the type's outermost modifier is such an array, so its elements are only reached a field
+// at a time.
+int is_soa_array(struct type *ty);
+
+#endif
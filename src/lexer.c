@@ -108,6 +108,13 @@ int is_keyword(struct list_char *ident, enum token_type *out)
 		case SWITCH_KEYWORD:
 		case CASE_KEYWORD:
 		case LET_KEYWORD:
+		case CONTINUE_KEYWORD:
+		case FOR_KEYWORD:
+		case IN_KEYWORD:
+		case PARALLEL_KEYWORD:
+		case ATOMIC_KEYWORD:
+		case ASYNC_KEYWORD:
+		case AWAIT_KEYWORD:
             *out = hash;
             return 1;
         default:
@@ -327,6 +334,7 @@ int next_token(struct file_buffer *b, struct token *out)
                 struct list_char *str = malloc(sizeof(*str));
                 *str = list_create(char, 50);
                 read_until(b, str, is_double_quote, 1);
+                list_append(str, '\0');
 
                 int length = b->current_position - str_start_position;
                 assert(length >= 0);
@@ -351,6 +359,7 @@ int next_token(struct file_buffer *b, struct token *out)
                 struct list_char *str = malloc(sizeof(*str));
                 *str = list_create(char, 50);
                 read_until(b, str, is_backtick, 1);
+                list_append(str, '\0');
 
                 int length = b->current_position - str_start_position;
                 assert(length >= 0);
@@ -427,7 +436,7 @@ int next_token(struct file_buffer *b, struct token *out)
                 } else {
                     char *end = NULL;
                     double parsed = strtod(ident->data, &end);
-                    if (end == NULL || *end != ident->data[ident->size]) {
+                    if (end == NULL || *end != ident->data[ident->size - 1]) {
                         *out = (struct token) {
                             .token_type = IDENTIFIER,
                             .identifier = ident,
@@ -44,6 +44,13 @@ enum token_type {
     SWITCH_KEYWORD        = 6954034739063L, // switch
     CASE_KEYWORD          = 6385108193L,    // case
     LET_KEYWORD           = 193498058L,     // let
+    CONTINUE_KEYWORD      = 7572251799911306L, // continue
+    FOR_KEYWORD           = 193491852L,     // for
+    IN_KEYWORD            = 5863484L,       // in
+    PARALLEL_KEYWORD      = 7572787893232626L, // parallel
+    ATOMIC_KEYWORD        = 6953326952418L, // atomic
+    ASYNC_KEYWORD         = 210706852323L,  // async
+    AWAIT_KEYWORD         = 210706969787L,  // await
 
     // parens
     OPEN_ROUND_PAREN,
@@ -1,13 +1,55 @@
 #include "../parser.h"
 #include "../context.h"
+#include "../type_inference.h"
+#include "../decision_tree.h"
+#include "../layout.h"
+#include "../arena.h"
+#include "../qualifiers.h"
+#include "../vectors.h"
+#include "../atomics.h"
+#include "../coroutines.h"
 #include <assert.h>
 #include "c.h"
 #include <regex.h>
 #include "../../lib/utils.h"
 #include <math.h>
+#include <ctype.h>
+#include <sys/stat.h>
 
 void write_type(struct type *ty, FILE *file);
 
+// Where the C written for a statement starts, by byte offset into c_output.c until the source map
+// turns it into a line.
+typedef struct source_mapping {
+    long offset;
+    struct statement_metadata metadata;
+} source_mapping;
+
+struct_list(source_mapping);
+
+// What the code being written sits within.
+static struct {
+    struct global_context *global_context;
+    // the return type of the function being written.
+    struct type *return_type;
+    // and its parameters.
+    struct list_key_type_pair *params;
+    int returns_through_pointer;
+    struct list_source_mapping source_mappings;
+    struct c_options *options;
+    // with `--instrument`, the entry in `__rm_profiles` of the next function written.
+    size_t profiled_functions;
+    // within the body of a `parallel for`, the variables it reaches through `__rm_captured`.
+    struct list_scoped_variable *captures;
+    // within an async fn's resume function, its task's fields, which the variables kept across
+    // an await are read and written through, as `__rm_frame->name`.
+    struct list_key_type_pair *frame;
+    // with a branch profile, the statement each entry of `__rm_counters` counts, in order.
+    struct list_int counted;
+} lowering = {0};
+
+// Every primitive has an exact width, so layouts don't depend on what the C compiler makes of
+// `int` or `long`.
 void write_primitive_type(struct type *ty, FILE *file)
 {
     assert(ty->kind == TY_PRIMITIVE);
@@ -16,28 +58,28 @@ void write_primitive_type(struct type *ty, FILE *file)
             fprintf(file, "void");
             return;
         case I8:
-            fprintf(file, "char");
+            fprintf(file, "int8_t");
             return;
         case U8:
-            fprintf(file, "unsigned char");
+            fprintf(file, "uint8_t");
             return;
         case I16:
-            fprintf(file, "int");
+            fprintf(file, "int16_t");
             return;
         case U16:
-            fprintf(file, "unsigned int");
+            fprintf(file, "uint16_t");
             return;
         case I32:
-            fprintf(file, "int");
+            fprintf(file, "int32_t");
             return;
         case U32:
-            fprintf(file, "unsigned int");
+            fprintf(file, "uint32_t");
             return;
         case I64:
-            fprintf(file, "long");
+            fprintf(file, "int64_t");
             return;
         case U64:
-            fprintf(file, "unsigned long");
+            fprintf(file, "uint64_t");
             return;
         case USIZE:
             fprintf(file, "size_t");
@@ -48,8 +90,19 @@ void write_primitive_type(struct type *ty, FILE *file)
         case F64:
             fprintf(file, "double");
             return;
+        case ARENA:
+            fprintf(file, "struct __rm_arena");
+            return;
+        case F32X4:
+        case F32X8:
+        case I32X4:
+        case I32X8:
+        case U8X16:
+        case U8X32:
+            fprintf(file, "__rm_%s", vector_name(ty->primitive_type));
+            return;
         case BOOL:
-            fprintf(file, "char");
+            fprintf(file, "bool");
             return;
         default:
             UNREACHABLE("primitive type not handled");
@@ -58,13 +111,11 @@ void write_primitive_type(struct type *ty, FILE *file)
 
 void append_int(int input, struct list_char *out)
 {
-    size_t size = (int)(ceil(log10(input)) + 1);
-    char *str = malloc(size);
-    sprintf(str, "%d", input);
-    for (size_t i = 0; i < size && str[i] != '\0'; i++) {
+    char str[16] = {0};
+    snprintf(str, sizeof(str), "%d", input);
+    for (size_t i = 0; i < sizeof(str) && str[i] != '\0'; i++) {
         list_append(out, str[i]);
     }
-    free(str);
 }
 
 struct list_char apply_type_modifier(struct type_modifier modifier, struct list_char input)
@@ -86,6 +137,11 @@ struct list_char apply_type_modifier(struct type_modifier modifier, struct list_
         }
         case ARRAY_MODIFIER_KIND:
         {
+            // an array of a `#[soa]` struct is a struct, named by `write_type`.
+            if (modifier.array_modifier.soa) {
+                copy_list_char(&output, &input);
+                break;
+            }
             list_append(&output, '(');
             copy_list_char(&output, &input);
             list_append(&output, '[');
@@ -97,7 +153,16 @@ struct list_char apply_type_modifier(struct type_modifier modifier, struct list_
             break;
         }
         case MUTABLE_MODIFIER_KIND:
-            // TODO: this makes it tricky. Revisit.
+            // C's `const` is worked out per parameter instead, see `write_function_type`.
+            copy_list_char(&output, &input);
+            break;
+        case SLICE_MODIFIER_KIND:
+            // a slice is a struct, its modifiers never reach a declarator.
+            copy_list_char(&output, &input);
+            break;
+        case ATOMIC_MODIFIER_KIND:
+            // `_Atomic(T)` is written with the base type, see `write_type`.
+            copy_list_char(&output, &input);
             break;
         }
     list_append(&output, '\0');
@@ -106,13 +171,159 @@ struct list_char apply_type_modifier(struct type_modifier modifier, struct list_
 
 struct list_char apply_type_modifiers(struct list_type_modifier modifiers, struct list_char input)
 {
+    // modifiers within a tagged nullable belong to its struct, not the declarator.
     struct list_char output = input;
-    for (size_t i = 0; i < modifiers.size; i++) {
+    size_t count = c_declarator_modifier_count(&modifiers);
+    for (size_t i = 0; i < count; i++) {
         output = apply_type_modifier(modifiers.data[i], output);
     }
     return output;
 }
 
+char *primitive_type_name(enum primitive_type primitive)
+{
+    switch (primitive) {
+        case VOID: return "void";
+        case BOOL: return "bool";
+        case U8: return "u8";
+        case I8: return "i8";
+        case I16: return "i16";
+        case U16: return "u16";
+        case I32: return "i32";
+        case U32: return "u32";
+        case I64: return "i64";
+        case U64: return "u64";
+        case USIZE: return "usize";
+        case F32: return "f32";
+        case F64: return "f64";
+        case ARENA: return "arena";
+        case F32X4:
+        case F32X8:
+        case I32X4:
+        case I32X8:
+        case U8X16:
+        case U8X32:
+            return vector_name(primitive);
+    }
+
+    UNREACHABLE("primitive_type_name fell out of a switch");
+}
+
+// A C identifier naming the type, so each distinct type gets its own nullable struct.
+void append_type_mangle(struct type *ty, struct list_char *out)
+{
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        struct type_modifier *modifier = &ty->modifiers.data[i];
+        switch (modifier->kind) {
+            case POINTER_MODIFIER_KIND:
+                append_list_char_slice(out, "ptr_");
+                break;
+            case NULLABLE_MODIFIER_KIND:
+                append_list_char_slice(out, "nullable_");
+                break;
+            case ARRAY_MODIFIER_KIND:
+                append_list_char_slice(out, "arr");
+                if (modifier->array_modifier.literally_sized) {
+                    append_int(modifier->array_modifier.literal_size, out);
+                }
+                list_append(out, '_');
+                break;
+            case SLICE_MODIFIER_KIND:
+                append_list_char_slice(out, "slice_");
+                break;
+            case ATOMIC_MODIFIER_KIND:
+                append_list_char_slice(out, "atomic_");
+                break;
+            case MUTABLE_MODIFIER_KIND:
+                break;
+        }
+    }
+
+    switch (ty->kind) {
+        case TY_PRIMITIVE:
+            append_list_char_slice(out, primitive_type_name(ty->primitive_type));
+            break;
+        case TY_STRUCT:
+            append_list_char_slice(out, "struct_");
+            append_list_char_slice(out, ty->name->data);
+            break;
+        case TY_ENUM:
+            append_list_char_slice(out, "enum_");
+            append_list_char_slice(out, ty->name->data);
+            break;
+        case TY_FUNCTION:
+            append_list_char_slice(out, "fn_");
+            append_list_char_slice(out, ty->name->data);
+            break;
+        case TY_ANY:
+            append_list_char_slice(out, "any");
+            break;
+    }
+}
+
+struct list_char nullable_type_name(struct type *ty, size_t index)
+{
+    struct type inner = modifier_inner_type(ty, index);
+    struct list_char output = list_create(char, 32);
+    append_list_char_slice(&output, "__nullable_");
+    append_type_mangle(&inner, &output);
+    list_append(&output, '\0');
+    return output;
+}
+
+struct list_char slice_type_name(struct type *ty, size_t index)
+{
+    struct type element = modifier_inner_type(ty, index);
+    struct list_char output = list_create(char, 32);
+    append_list_char_slice(&output, "__slice_");
+    append_type_mangle(&element, &output);
+    list_append(&output, '\0');
+    return output;
+}
+
+// The struct an array of a `#[soa]` struct lowers to, whose innermost modifier is that array.
+struct list_char soa_type_name(struct type *ty)
+{
+    struct array_type_modifier *array = &ty->modifiers.data[ty->modifiers.size - 1].array_modifier;
+    struct list_char output = list_create(char, 32);
+    append_list_char_slice(&output, "__soa_");
+    append_list_char_slice(&output, ty->name->data);
+    if (array->literally_sized) {
+        list_append(&output, '_');
+        append_int(array->literal_size, &output);
+    }
+    list_append(&output, '\0');
+    return output;
+}
+
+int has_soa_array(struct type *ty)
+{
+    return ty->modifiers.size > 0
+        && ty->modifiers.data[ty->modifiers.size - 1].kind == ARRAY_MODIFIER_KIND
+        && ty->modifiers.data[ty->modifiers.size - 1].array_modifier.soa;
+}
+
+// The outermost modifier, when it makes the type nullable.
+int outer_nullable(struct type *ty, size_t *index)
+{
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        enum type_modifier_kind kind = ty->modifiers.data[i].kind;
+        if (kind == MUTABLE_MODIFIER_KIND) continue;
+        if (kind != NULLABLE_MODIFIER_KIND || ty->kind == TY_ANY) return 0;
+        *index = i;
+        return 1;
+    }
+    return 0;
+}
+
+// Where a tagged nullable keeps its tag, `tagged.present` when it's in the padding of the value.
+char *nullable_tag_member(struct type *ty, size_t index)
+{
+    struct type inner = modifier_inner_type(ty, index);
+    size_t tag_after = 0;
+    return nullable_tag_slot(&inner, lowering.global_context, &tag_after) ? "tagged.present" : "present";
+}
+
 void write_struct_type(struct type *ty, int full, FILE *file)
 {
     assert(ty->kind == TY_STRUCT);
@@ -130,9 +341,29 @@ void write_struct_type(struct type *ty, int full, FILE *file)
         fprintf(file, " %s", modified.data);
         fprintf(file, ";");
     }
-    fprintf(file, "};");
+    fprintf(file, "}");
+    struct list_attribute *attributes = ty->struct_type.attributes;
+    if (has_attribute(attributes, "packed", NULL)) {
+        fprintf(file, " __attribute__((packed))");
+    }
+    if (has_attribute(attributes, "align", NULL)) {
+        fprintf(file, " __attribute__((aligned(%zu)))", declared_alignment(attributes));
+    }
+    fprintf(file, ";");
+}
+
+char *c_tag_type(size_t tag_size)
+{
+    switch (tag_size) {
+        case 1: return "uint8_t";
+        case 2: return "uint16_t";
+        default: return "uint32_t";
+    }
 }
 
+// An enum is a union of one `{ tag, payload }` struct per variant. Every member starts with the
+// tag, so it can be read through the union whichever variant is stored, and the C enum only names
+// the tag's values.
 void write_enum_type(struct type *ty, int full, FILE *file)
 {
     assert(ty->kind == TY_ENUM);
@@ -141,77 +372,113 @@ void write_enum_type(struct type *ty, int full, FILE *file)
         return;
     }
 
+    char *name = ty->name->data;
     size_t variant_count = ty->enum_type.pairs.size;
-    fprintf(file, "enum %s_kind {", ty->name->data);
+    fprintf(file, "enum %s_kind {", name);
     for (size_t i = 0; i < variant_count; i++) {
-        fprintf(file, "%s_kind_%s", ty->name->data, ty->enum_type.pairs.data[i].field_name.data);
+        fprintf(file, "%s_kind_%s", name, ty->enum_type.pairs.data[i].field_name.data);
         if (i < variant_count - 1) {
             fprintf(file, ",");
         }
     }
-
     fprintf(file, "}; ");
-    fprintf(file, "struct %s_type { enum %s_kind %s_kind; union {",
-            ty->name->data, ty->name->data, ty->name->data);
 
+    char *tag = c_tag_type(enum_tag_size(variant_count));
+    fprintf(file, "struct %s_type {union {%s %s_kind;", name, tag, name);
     for (size_t i = 0; i < variant_count; i++) {
         struct key_type_pair pair = ty->enum_type.pairs.data[i];
+        if (is_void_type(pair.field_type)) continue;
+
+        struct list_char payload = list_create(char, 8);
+        append_list_char_slice(&payload, "payload");
+        list_append(&payload, '\0');
+        fprintf(file, " struct {%s %s_kind; ", tag, name);
         write_type(pair.field_type, file);
-        struct list_char union_name = list_create(char, pair.field_name.size * 2);
-        for (size_t j = 0; j < ty->name->size; j++) {
-            char to_add = ty->name->data[j];
-            if (to_add != '\0') {
-                list_append(&union_name, ty->name->data[j]);
-            }
-        } 
-        append_list_char_slice(&union_name, "_type_");
-        for (size_t j = 0; j < pair.field_name.size; j++) {
-            list_append(&union_name, pair.field_name.data[j]);
-        } 
-        struct list_char modified = apply_type_modifiers(pair.field_type->modifiers, union_name);
-        fprintf(file, " %s;", modified.data);
+        fprintf(file,
+                " %s;} %s_type_%s;",
+                apply_type_modifiers(pair.field_type->modifiers, payload).data,
+                name,
+                pair.field_name.data);
     }
     fprintf(file, "};};");
-    //
-    // TODO: current idea is to generate constructor functions per enum variant
-    //
-    // struct person { int age; };
-    // enum result_kind {
-    //     result_kind_ok,
-    //     result_kind_error
-    // };
-    // struct result_type {
-    //     enum result_kind result_kind;
-    //     union {
-    //      struct person result_type_ok;
-    //      char result_type_error;
-    //     };
-    // };
-    //
-    // would produce the following:
-    // struct result_type result_type_ok(struct person p);
-    // struct result_type result_type_error(char err);
-    // Then when we write the binding expressions for enums we can map to these functions
+}
+
+// A function's attributes as GCC's, written ahead of its prototype and its definition. Only the
+// definition is `inline`, so it's still an external one and the function can be called through
+// a pointer. `inline` stays a hint rather than `always_inline`, which GCC refuses on a function
+// that recurses, directly or through another.
+void write_function_attributes(struct type *fn, int definition, FILE *file)
+{
+    struct list_attribute *attributes = fn->function_type.attributes;
+    char *hints[][2] = {
+        { "hot", "hot" },
+        { "cold", "cold" },
+        { "noinline", "noinline" },
+        { "flatten", "flatten" }
+    };
+    for (size_t i = 0; i < sizeof(hints) / sizeof(*hints); i++) {
+        if (has_attribute(attributes, hints[i][0], NULL)) {
+            fprintf(file, "__attribute__((%s)) ", hints[i][1]);
+        }
+    }
+    if (has_attribute(attributes, "align", NULL)) {
+        fprintf(file, "__attribute__((aligned(%zu))) ", declared_alignment(attributes));
+    }
+    if (definition && has_attribute(attributes, "inline", NULL)) {
+        fprintf(file, "inline ");
+    }
+}
+
+// A parameter as its function declares it, with the qualifiers its pointer was given, around the
+// declarator `name`.
+void write_parameter(struct key_type_pair *pair, struct list_char *declarator, FILE *file)
+{
+    struct list_char name = *declarator;
+    struct list_type_modifier modifiers = pair->field_type->modifiers;
+    if (modifiers.size > 0 && modifiers.data[0].kind == POINTER_MODIFIER_KIND) {
+        struct pointer_type_modifier pointer = modifiers.data[0].pointer_modifier;
+        if (pointer.const_pointee) {
+            fprintf(file, "const ");
+        }
+        if (pointer.restrict_pointer) {
+            name = list_create(char, declarator->size + 10);
+            append_list_char_slice(&name, "restrict ");
+            append_list_char_slice(&name, declarator->data);
+        }
+    }
+    if (pair->by_reference) {
+        fprintf(file, "const ");
+        write_type(pair->field_type, file);
+        fprintf(file, " *%s", name.data);
+    } else {
+        write_type(pair->field_type, file);
+        struct list_char modified = apply_type_modifiers(modifiers, name);
+        fprintf(file, " %s", modified.data);
+    }
 }
 
 void write_function_type(struct type *ty, FILE *file)
 {
     assert(ty->kind == TY_FUNCTION);
-    write_type(ty->function_type.return_type, file);
-    struct list_type_modifier return_modifiers = ty->function_type.return_type->modifiers;
-    for (size_t i = 0; i < return_modifiers.size; i++) {
-        if (return_modifiers.data[i].kind == POINTER_MODIFIER_KIND) {
-            fprintf(file, "*");
+    size_t param_count = ty->function_type.params.size;
+    if (ty->function_type.returns_through_pointer) {
+        fprintf(file, "void %s(", ty->name->data);
+        write_type(ty->function_type.return_type, file);
+        fprintf(file, " *restrict __rm_result%s", param_count > 0 ? ", " : "");
+    } else {
+        write_type(ty->function_type.return_type, file);
+        struct list_type_modifier return_modifiers = ty->function_type.return_type->modifiers;
+        for (size_t i = 0; i < c_declarator_modifier_count(&return_modifiers); i++) {
+            if (return_modifiers.data[i].kind == POINTER_MODIFIER_KIND) {
+                fprintf(file, "*");
+            }
         }
+        fprintf(file, " %s(", ty->name->data);
     }
-    fprintf(file, " %s(", ty->name->data);
 
-    size_t param_count = ty->function_type.params.size;
     for (size_t i = 0; i < param_count; i++) {
-        struct key_type_pair pair = ty->function_type.params.data[i];
-        write_type(pair.field_type, file);
-        struct list_char modified = apply_type_modifiers(pair.field_type->modifiers, pair.field_name);
-        fprintf(file, " %s", modified.data);
+        struct key_type_pair *pair = &ty->function_type.params.data[i];
+        write_parameter(pair, &pair->field_name, file);
         if (i < param_count - 1) {
             fprintf(file, ", ");
         }
@@ -220,11 +487,41 @@ void write_function_type(struct type *ty, FILE *file)
 }
 
 void write_type(struct type *ty, FILE *file) {
+    size_t nullable_index = 0;
+    size_t slice_index = 0;
+    int has_nullable = first_tagged_nullable(ty, &nullable_index);
+    if (first_slice(ty, &slice_index) && (!has_nullable || slice_index < nullable_index)) {
+        fprintf(file, "struct %s", slice_type_name(ty, slice_index).data);
+        return;
+    }
+    if (has_nullable) {
+        fprintf(file, "struct %s", nullable_type_name(ty, nullable_index).data);
+        return;
+    }
+
     switch (ty->kind) {
         case TY_PRIMITIVE:
+            // a `?bool` keeps its null, 2, in a byte a C `bool` would squash to 1.
+            if (ty->primitive_type == BOOL
+                && ty->modifiers.size > 0
+                && ty->modifiers.data[ty->modifiers.size - 1].kind == NULLABLE_MODIFIER_KIND)
+            {
+                fprintf(file, "uint8_t");
+                break;
+            }
+            if (ty->modifiers.size > 0 && ty->modifiers.data[ty->modifiers.size - 1].kind == ATOMIC_MODIFIER_KIND) {
+                fprintf(file, "_Atomic(");
+                write_primitive_type(ty, file);
+                fprintf(file, ")");
+                break;
+            }
             write_primitive_type(ty, file);
             break;
         case TY_STRUCT:
+            if (has_soa_array(ty)) {
+                fprintf(file, "struct %s", soa_type_name(ty).data);
+                break;
+            }
             write_struct_type(ty, 0, file);
             break;
         case TY_FUNCTION:
@@ -244,6 +541,210 @@ void write_expression(struct expression *e,
                       struct list_scoped_variable *scoped_variables,
                       FILE *file);
 
+struct type *enum_variant_type(struct list_char *enum_name, struct list_char *variant_name)
+{
+    struct type definition = {0};
+    struct list_char error = list_create(char, 10);
+    if (!find_enum_definition(lowering.global_context, enum_name, &definition, &error)) return NULL;
+    for (size_t i = 0; i < definition.enum_type.pairs.size; i++) {
+        if (strcmp(definition.enum_type.pairs.data[i].field_name.data, variant_name->data) == 0) {
+            return definition.enum_type.pairs.data[i].field_type;
+        }
+    }
+    return NULL;
+}
+
+size_t enum_variant_count(struct list_char *enum_name)
+{
+    struct type definition = {0};
+    struct list_char error = list_create(char, 10);
+    if (!find_enum_definition(lowering.global_context, enum_name, &definition, &error)) return 0;
+    return definition.enum_type.pairs.size;
+}
+
+int is_null_literal(struct expression *e)
+{
+    return e->kind == LITERAL_EXPRESSION && e->literal.kind == LITERAL_NULL;
+}
+
+// `null`, as the nullable type it's stored in.
+void write_null(struct type *target, FILE *file)
+{
+    size_t index = 0;
+    if (!outer_nullable(target, &index)) {
+        fprintf(file, target->kind == TY_STRUCT && target->modifiers.size == 0 ? "{0}" : "0");
+        return;
+    }
+
+    switch (nullable_representation(target, index)) {
+        case NULLABLE_POINTER_NICHE:
+            fprintf(file, "NULL");
+            return;
+        case NULLABLE_BOOL_NICHE:
+            fprintf(file, "2");
+            return;
+        case NULLABLE_ENUM_NICHE:
+            fprintf(file,
+                    "(struct %s_type) {.%s_kind = %zu}",
+                    target->name->data,
+                    target->name->data,
+                    enum_variant_count(target->name));
+            return;
+        case NULLABLE_TAGGED:
+            fprintf(file,
+                    "(struct %s) {.%s = 0}",
+                    nullable_type_name(target, index).data,
+                    nullable_tag_member(target, index));
+            return;
+    }
+}
+
+// Writes `e` for the value it holds, read out of a tagged nullable through `.value`, which a null
+// one leaves zero. Niches hold the value as it is.
+void write_value(struct expression *e,
+                 struct context *context,
+                 struct list_scoped_variable *scoped_variables,
+                 FILE *file)
+{
+    struct type value_type = lut_get(&context->expression_type_lookup, e->id);
+    size_t index = 0;
+    if (!outer_nullable(&value_type, &index) || nullable_representation(&value_type, index) != NULLABLE_TAGGED) {
+        write_expression(e, context, scoped_variables, file);
+        return;
+    }
+    fprintf(file, "(");
+    write_expression(e, context, scoped_variables, file);
+    fprintf(file, ").value");
+}
+
+// Writes `e` as a value of `target`, wrapping values stored into a tagged nullable and reading
+// them out of one stored into anything else.
+void write_expression_as(struct expression *e,
+                         struct type *target,
+                         struct context *context,
+                         struct list_scoped_variable *scoped_variables,
+                         FILE *file)
+{
+    size_t index = 0;
+    if (target == NULL || target->kind == TY_ANY) {
+        write_expression(e, context, scoped_variables, file);
+        return;
+    }
+    if (!outer_nullable(target, &index)) {
+        write_value(e, context, scoped_variables, file);
+        return;
+    }
+    if (is_null_literal(e)) {
+        write_null(target, file);
+        return;
+    }
+
+    // niches hold the value as it is, and a nullable is copied as it is.
+    struct type value_type = lut_get(&context->expression_type_lookup, e->id);
+    size_t value_index = 0;
+    if (nullable_representation(target, index) != NULLABLE_TAGGED || outer_nullable(&value_type, &value_index)) {
+        write_expression(e, context, scoped_variables, file);
+        return;
+    }
+
+    struct list_char name = nullable_type_name(target, index);
+    if (strcmp(nullable_tag_member(target, index), "present") == 0) {
+        fprintf(file, "(struct %s) {.value = ", name.data);
+        write_expression(e, context, scoped_variables, file);
+        fprintf(file, ", .present = 1}");
+    } else {
+        fprintf(file, "%s_some(", name.data);
+        write_expression(e, context, scoped_variables, file);
+        fprintf(file, ")");
+    }
+}
+
+// A null check is a single compare, against the niche or the tag.
+void write_null_check(struct expression *checked,
+                      struct type *checked_type,
+                      size_t index,
+                      struct context *context,
+                      struct list_scoped_variable *scoped_variables,
+                      FILE *file)
+{
+    switch (nullable_representation(checked_type, index)) {
+        case NULLABLE_POINTER_NICHE:
+            write_expression(checked, context, scoped_variables, file);
+            fprintf(file, " == NULL");
+            return;
+        case NULLABLE_BOOL_NICHE:
+            write_expression(checked, context, scoped_variables, file);
+            fprintf(file, " == 2");
+            return;
+        case NULLABLE_ENUM_NICHE:
+            fprintf(file, "(");
+            write_expression(checked, context, scoped_variables, file);
+            fprintf(file,
+                    ").%s_kind == %zu",
+                    checked_type->name->data,
+                    enum_variant_count(checked_type->name));
+            return;
+        case NULLABLE_TAGGED:
+            fprintf(file, "(");
+            write_expression(checked, context, scoped_variables, file);
+            fprintf(file, ").%s == 0", nullable_tag_member(checked_type, index));
+            return;
+    }
+}
+
+struct type *struct_field_type(struct list_char *struct_name, struct list_char *field_name)
+{
+    struct type definition = {0};
+    struct list_char error = list_create(char, 10);
+    if (!find_struct_definition(lowering.global_context, struct_name, &definition, &error)) return NULL;
+    for (size_t i = 0; i < definition.struct_type.pairs.size; i++) {
+        if (strcmp(definition.struct_type.pairs.data[i].field_name.data, field_name->data) == 0) {
+            return definition.struct_type.pairs.data[i].field_type;
+        }
+    }
+    return NULL;
+}
+
+int is_captured(struct list_char *name)
+{
+    if (lowering.captures == NULL) return 0;
+    for (size_t i = 0; i < lowering.captures->size; i++) {
+        if (list_char_eq(&lowering.captures->data[i].name, name)) return 1;
+    }
+    return 0;
+}
+
+int is_frame_variable(struct list_char *name)
+{
+    if (lowering.frame == NULL) return 0;
+    for (size_t i = 0; i < lowering.frame->size; i++) {
+        if (list_char_eq(&lowering.frame->data[i].field_name, name)) return 1;
+    }
+    return 0;
+}
+
+// A struct parameter passed by reference is read through its pointer wherever it's named.
+// The parameter of the function being written with the name, NULL when there's none.
+struct key_type_pair *find_parameter(struct list_char *name)
+{
+    if (lowering.params == NULL) return NULL;
+    for (size_t i = 0; i < lowering.params->size; i++) {
+        if (list_char_eq(&lowering.params->data[i].field_name, name)) return &lowering.params->data[i];
+    }
+    return NULL;
+}
+
+int is_reference_parameter(struct list_char *name)
+{
+    if (lowering.params == NULL) return 0;
+    for (size_t i = 0; i < lowering.params->size; i++) {
+        if (lowering.params->data[i].by_reference && list_char_eq(&lowering.params->data[i].field_name, name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 void write_literal_expression(struct literal_expression *e,
                               struct context *context,
                               struct list_scoped_variable *scoped_variables,
@@ -252,7 +753,7 @@ void write_literal_expression(struct literal_expression *e,
     switch (e->kind) {
         case LITERAL_BOOLEAN:
         {
-            fprintf(file, "%d", e->boolean);
+            fprintf(file, e->boolean ? "true" : "false");
             break;
         }
         case LITERAL_CHAR:
@@ -267,12 +768,24 @@ void write_literal_expression(struct literal_expression *e,
         }
         case LITERAL_NUMERIC:
         {
-            fprintf(file, "%d", (int)e->numeric); // TODO
+            if (floor(e->numeric) == e->numeric && fabs(e->numeric) < 9007199254740992.0) {
+                fprintf(file, "%lld", (long long)e->numeric);
+            } else {
+                fprintf(file, "%.17g", e->numeric);
+            }
             break;
         }
         case LITERAL_NAME:
         {
-            fprintf(file, "%s", e->name->data);
+            if (is_captured(e->name)) {
+                fprintf(file, "(*__rm_captured->%s)", e->name->data);
+                break;
+            }
+            if (is_frame_variable(e->name)) {
+                fprintf(file, "__rm_frame->%s", e->name->data);
+                break;
+            }
+            fprintf(file, is_reference_parameter(e->name) ? "(*%s)" : "%s", e->name->data);
             break;
         }
         case LITERAL_HOLE:
@@ -285,7 +798,11 @@ void write_literal_expression(struct literal_expression *e,
             for (size_t i = 0; i < pair_count; i++) {
                 struct key_expression pair = e->struct_enum.key_expr_pairs.data[i];
                 fprintf(file, ".%s = ", pair.key->data);
-                write_expression(pair.expression, context, scoped_variables, file);
+                write_expression_as(pair.expression,
+                                    struct_field_type(e->struct_enum.name, pair.key),
+                                    context,
+                                    scoped_variables,
+                                    file);
                 if (i + 1 < pair_count) {
                     fprintf(file, ",");
                 }
@@ -294,10 +811,29 @@ void write_literal_expression(struct literal_expression *e,
             break;
         }
         case LITERAL_ENUM:
-            TODO("literal enum");
+        {
+            char *name = e->struct_enum.name->data;
+            struct key_expression pair = e->struct_enum.key_expr_pairs.data[0];
+            struct type *payload_type = enum_variant_type(e->struct_enum.name, pair.key);
+            if (payload_type == NULL || is_void_type(payload_type)) {
+                fprintf(file, "(struct %s_type) {.%s_kind = %s_kind_%s}", name, name, name, pair.key->data);
+                break;
+            }
+
+            fprintf(file,
+                    "(struct %s_type) {.%s_type_%s = {.%s_kind = %s_kind_%s, .payload = ",
+                    name,
+                    name,
+                    pair.key->data,
+                    name,
+                    name,
+                    pair.key->data);
+            write_expression_as(pair.expression, payload_type, context, scoped_variables, file);
+            fprintf(file, "}}");
             break;
+        }
         case LITERAL_NULL:
-            // TODO: this is tmp
+            // where the nullable type `null` is stored in is known, it's written by `write_null`.
             fprintf(file, "NULL");
             break;
         }
@@ -322,7 +858,7 @@ void write_unary_expression(struct unary_expression *e,
             UNREACHABLE("unary operator not handled");
     }
 
-    write_expression(e->expression, context, scoped_variables, file);
+    write_value(e->expression, context, scoped_variables, file);
 }
 
 int expression_is_pointer(struct expression *e,
@@ -355,6 +891,7 @@ int expression_is_pointer(struct expression *e,
         case FUNCTION_EXPRESSION:
         case VOID_EXPRESSION:
         case MEMBER_ACCESS_EXPRESSION:
+        case INDEX_EXPRESSION:
             break;
     }
 
@@ -366,7 +903,36 @@ void write_binary_expression(struct binary_expression *e,
                              struct list_scoped_variable *scoped_variables,
                              FILE *file)
 {
-    write_expression(e->l, context, scoped_variables, file);
+    if (e->binary_op == EQUAL_TO_BINARY && (is_null_literal(e->l) || is_null_literal(e->r))) {
+        struct expression *checked = is_null_literal(e->r) ? e->l : e->r;
+        struct type checked_type = lut_get(&context->expression_type_lookup, checked->id);
+        size_t index = 0;
+        if (outer_nullable(&checked_type, &index)) {
+            write_null_check(checked, &checked_type, index, context, scoped_variables, file);
+            return;
+        }
+    }
+
+    if (e->binary_op == ASSIGN_BINARY) {
+        struct type assigned_type = lut_get(&context->expression_type_lookup, e->l->id);
+        write_expression(e->l, context, scoped_variables, file);
+        fprintf(file, " = ");
+        write_expression_as(e->r, &assigned_type, context, scoped_variables, file);
+        return;
+    }
+
+    // GCC compares vectors into lanes of its own choosing, they're cast to the mask rm types them as.
+    struct type left_type = lut_get(&context->expression_type_lookup, e->l->id);
+    int vector_comparison = is_vector_type(&left_type)
+        && (e->binary_op == GREATER_THAN_BINARY || e->binary_op == LESS_THAN_BINARY || e->binary_op == EQUAL_TO_BINARY);
+    if (vector_comparison) {
+        struct type mask = { .kind = TY_PRIMITIVE, .primitive_type = vector_mask(left_type.primitive_type) };
+        fprintf(file, "((");
+        write_type(&mask, file);
+        fprintf(file, ")(");
+    }
+
+    write_value(e->l, context, scoped_variables, file);
     switch (e->binary_op) {
         case PLUS_BINARY:
             fprintf(file, " + ");
@@ -404,7 +970,10 @@ void write_binary_expression(struct binary_expression *e,
         default:
             UNREACHABLE("binary operator not handled");
     }
-    write_expression(e->r, context, scoped_variables, file);
+    write_value(e->r, context, scoped_variables, file);
+    if (vector_comparison) {
+        fprintf(file, "))");
+    }
 }
 
 void write_grouped_expression(struct expression *e,
@@ -417,93 +986,512 @@ void write_grouped_expression(struct expression *e,
     fprintf(file, ")");
 }
 
+void write_subscript(struct index_expression *index,
+                     struct type *indexed_type,
+                     struct context *context,
+                     struct list_scoped_variable *scoped_variables,
+                     FILE *file);
+
 void write_member_access_expression(struct member_access_expression *e,
                                     struct context *context,
                                     struct list_scoped_variable *scoped_variables,
                                     FILE *file)
 {
-    write_expression(e->accessed, context, scoped_variables, file);
-    fprintf(file, ".%s", e->member_name->data);
-}
-
-void write_function_expression(struct function_expression *e,
-                               struct context *context,
-                               struct list_scoped_variable *scoped_variables,
-                               FILE *file)
-{
-    fprintf(file, "%s(", e->function_name->data);
-    size_t param_count = e->params->size;
-    for (size_t i = 0; i < param_count; i++) {
-        write_expression(&e->params->data[i], context, scoped_variables, file);
-        if (i < param_count - 1) {
-            fprintf(file, ", ");
+    // `rows[i].field` of an array of a `#[soa]` struct is `rows.field[i]`, the field's own array.
+    struct expression *accessed = e->accessed;
+    while (accessed->kind == GROUP_EXPRESSION) {
+        accessed = accessed->grouped;
+    }
+    if (accessed->kind == INDEX_EXPRESSION) {
+        struct type indexed_type = lut_get(&context->expression_type_lookup, accessed->index.indexed->id);
+        if (is_soa_array(&indexed_type)) {
+            write_expression(accessed->index.indexed, context, scoped_variables, file);
+            fprintf(file, ".%s", e->member_name->data);
+            write_subscript(&accessed->index, &indexed_type, context, scoped_variables, file);
+            return;
         }
     }
-    fprintf(file, ")");
+
+    // fields are reached through a pointer to a struct as they are through the struct, and through
+    // a nullable one as through what it holds.
+    struct type accessed_type = lut_get(&context->expression_type_lookup, e->accessed->id);
+    size_t outer = 0;
+    while (outer < accessed_type.modifiers.size
+           && (accessed_type.modifiers.data[outer].kind == MUTABLE_MODIFIER_KIND
+               || accessed_type.modifiers.data[outer].kind == NULLABLE_MODIFIER_KIND))
+    {
+        outer++;
+    }
+    int through_pointer = outer < accessed_type.modifiers.size
+        && accessed_type.modifiers.data[outer].kind == POINTER_MODIFIER_KIND;
+    write_value(e->accessed, context, scoped_variables, file);
+    fprintf(file, "%s%s", through_pointer ? "->" : ".", e->member_name->data);
 }
 
-void write_expression(struct expression *e,
-                      struct context *context,
-                      struct list_scoped_variable *scoped_variables,
-                      FILE *file)
+// Whether writing the expression twice reads the same value, without doing anything else.
+int is_reread_safe(struct expression *e)
 {
     switch (e->kind) {
         case LITERAL_EXPRESSION:
-            write_literal_expression(&e->literal, context, scoped_variables, file);
-            return;
-        case UNARY_EXPRESSION:
-            write_unary_expression(&e->unary, context, scoped_variables, file);
-            return;
-        case BINARY_EXPRESSION:
-            write_binary_expression(&e->binary, context, scoped_variables, file);
-            return;
+            return e->literal.kind == LITERAL_NAME;
         case GROUP_EXPRESSION:
-            write_grouped_expression(e->grouped, context, scoped_variables, file);
-            return;
-        case FUNCTION_EXPRESSION:
-            write_function_expression(&e->function, context, scoped_variables, file);
-            return;
+            return is_reread_safe(e->grouped);
         case MEMBER_ACCESS_EXPRESSION:
-            write_member_access_expression(&e->member_access, context, scoped_variables, file);
-            return;
-        case VOID_EXPRESSION:
-            return;
+            return is_reread_safe(e->member_access.accessed);
+        case UNARY_EXPRESSION:
+            return e->unary.unary_operator == STAR_UNARY && is_reread_safe(e->unary.expression);
         default:
-            UNREACHABLE("expression kind not handled");
+            return 0;
     }
 }
 
-void write_statement(struct statement *s, struct context *context, FILE *file);
-
-void write_type_default(struct type *type, struct type *defined_type, FILE *file)
+// Whether the length of the indexed array or slice is known where it's indexed. The length of an
+// array sized by a field is read from the same struct, so it's only known when the struct can be
+// reread, and likewise for a slice.
+int has_known_length(struct expression *indexed, struct type *indexed_type)
 {
-    // TODO: derive default C values 
-    struct type *ty = type->kind == TY_ANY ? defined_type : type;
-    if (ty->kind == TY_STRUCT) {
-        fprintf(file, "{0}");
-    } else {
-        fprintf(file, "0");
+    struct type_modifier *outer = &indexed_type->modifiers.data[0];
+    while (indexed->kind == GROUP_EXPRESSION) {
+        indexed = indexed->grouped;
     }
+
+    if (outer->kind == SLICE_MODIFIER_KIND) return is_reread_safe(indexed);
+    if (outer->array_modifier.literally_sized) return 1;
+    return outer->array_modifier.reference_sized
+        && indexed->kind == MEMBER_ACCESS_EXPRESSION
+        && is_reread_safe(indexed->member_access.accessed);
 }
 
-void write_binding_statement(struct statement *s,
-                             struct context *context,
-                             FILE *file)
+void write_length(struct expression *indexed,
+                  struct type *indexed_type,
+                  struct context *context,
+                  struct list_scoped_variable *scoped_variables,
+                  FILE *file)
 {
-    assert(s->kind == BINDING_STATEMENT);
-    struct type value_type = lut_get(&context->expression_type_lookup, s->binding_statement.value.id);
-    if (value_type.kind != TY_ANY) {
-        write_type(&value_type, file);
-    } else {
-        write_type(&s->binding_statement.variable_type, file);
+    struct type_modifier *outer = &indexed_type->modifiers.data[0];
+    if (outer->kind == SLICE_MODIFIER_KIND) {
+        write_expression(indexed, context, scoped_variables, file);
+        fprintf(file, ".len");
+        return;
+    }
+    if (outer->array_modifier.literally_sized) {
+        fprintf(file, "%d", outer->array_modifier.literal_size);
+        return;
+    }
+
+    while (indexed->kind == GROUP_EXPRESSION) {
+        indexed = indexed->grouped;
+    }
+    struct member_access_expression length = {
+        .accessed = indexed->member_access.accessed,
+        .member_name = outer->array_modifier.reference_name
+    };
+    write_member_access_expression(&length, context, scoped_variables, file);
+}
+
+void write_elements(struct expression *indexed,
+                    struct type *indexed_type,
+                    struct context *context,
+                    struct list_scoped_variable *scoped_variables,
+                    FILE *file)
+{
+    write_expression(indexed, context, scoped_variables, file);
+    if (indexed_type->modifiers.data[0].kind == SLICE_MODIFIER_KIND) {
+        fprintf(file, ".data");
+    }
+}
+
+void write_subscript(struct index_expression *index,
+                     struct type *indexed_type,
+                     struct context *context,
+                     struct list_scoped_variable *scoped_variables,
+                     FILE *file)
+{
+    fprintf(file, "[");
+    if (has_known_length(index->indexed, indexed_type)) {
+        fprintf(file, "__checked_index(");
+        write_expression(index->index, context, scoped_variables, file);
+        fprintf(file, ", ");
+        write_length(index->indexed, indexed_type, context, scoped_variables, file);
+        fprintf(file, ")");
+    } else {
+        write_expression(index->index, context, scoped_variables, file);
+    }
+    fprintf(file, "]");
+}
+
+// Indexes are checked against the length through `__checked_index`, which the C compiler drops
+// wherever it already knows the index is in bounds, like within `while (i < s.len)`. Slicing is
+// checked by the slice type's `_of` function.
+void write_index_expression(struct expression *e,
+                            struct context *context,
+                            struct list_scoped_variable *scoped_variables,
+                            FILE *file)
+{
+    struct index_expression *index = &e->index;
+    struct type indexed_type = lut_get(&context->expression_type_lookup, index->indexed->id);
+    if (is_vector_type(&indexed_type)) {
+        write_expression(index->indexed, context, scoped_variables, file);
+        fprintf(file, "[__checked_index(");
+        write_expression(index->index, context, scoped_variables, file);
+        fprintf(file, ", %zu)]", vector_lanes(indexed_type.primitive_type));
+        return;
+    }
+
+    int known_length = has_known_length(index->indexed, &indexed_type);
+
+    if (index->end != NULL) {
+        struct type slice_type = lut_get(&context->expression_type_lookup, e->id);
+        fprintf(file, "%s_of(", slice_type_name(&slice_type, 0).data);
+        write_elements(index->indexed, &indexed_type, context, scoped_variables, file);
+        fprintf(file, ", ");
+        write_expression(index->index, context, scoped_variables, file);
+        fprintf(file, ", ");
+        write_expression(index->end, context, scoped_variables, file);
+        fprintf(file, ", ");
+        if (known_length) {
+            write_length(index->indexed, &indexed_type, context, scoped_variables, file);
+        } else {
+            fprintf(file, "SIZE_MAX");
+        }
+        fprintf(file, ")");
+        return;
+    }
+
+    write_elements(index->indexed, &indexed_type, context, scoped_variables, file);
+    write_subscript(index, &indexed_type, context, scoped_variables, file);
+}
+
+// Whether the C an expression lowers to can have its address taken.
+int is_addressable(struct expression *e, struct context *context)
+{
+    switch (e->kind) {
+        case GROUP_EXPRESSION:
+            return is_addressable(e->grouped, context);
+        case LITERAL_EXPRESSION:
+            // a struct literal is a compound literal.
+            return e->literal.kind == LITERAL_NAME || e->literal.kind == LITERAL_STRUCT;
+        case UNARY_EXPRESSION:
+            return e->unary.unary_operator == STAR_UNARY;
+        case INDEX_EXPRESSION:
+            return e->index.end == NULL;
+        case MEMBER_ACCESS_EXPRESSION:
+        {
+            struct type accessed_type = lut_get(&context->expression_type_lookup, e->member_access.accessed->id);
+            return (accessed_type.modifiers.size > 0
+                    && accessed_type.modifiers.data[0].kind == POINTER_MODIFIER_KIND)
+                || is_addressable(e->member_access.accessed, context);
+        }
+        default:
+            return 0;
+    }
+}
+
+// A struct passed by reference is passed where the caller keeps it, or from a one element array
+// literal when it's a value like a call's result.
+void write_reference_argument(struct expression *e,
+                              struct type *param_type,
+                              struct context *context,
+                              struct list_scoped_variable *scoped_variables,
+                              FILE *file)
+{
+    if (is_addressable(e, context)) {
+        fprintf(file, "&(");
+    } else {
+        fprintf(file, "(");
+        write_type(param_type, file);
+        fprintf(file, "[1]){");
+    }
+    write_expression_as(e, param_type, context, scoped_variables, file);
+    fprintf(file, is_addressable(e, context) ? ")" : "}");
+}
+
+// `arena.new(value)` bumps the arena for the value's type and copies the value in.
+void write_arena_allocation(struct function_expression *e,
+                            struct context *context,
+                            struct list_scoped_variable *scoped_variables,
+                            FILE *file)
+{
+    struct expression *value = &e->params->data[1];
+    struct type value_type = lut_get(&context->expression_type_lookup, value->id);
+
+    fprintf(file, "({");
+    write_type(&value_type, file);
+    fprintf(file, " *__rm_allocated = __rm_arena_alloc(");
+    write_expression(&e->params->data[0], context, scoped_variables, file);
+    fprintf(file, ", sizeof(");
+    write_type(&value_type, file);
+    fprintf(file, "), _Alignof(");
+    write_type(&value_type, file);
+    fprintf(file, ")); *__rm_allocated = ");
+    write_expression_as(value, &value_type, context, scoped_variables, file);
+    fprintf(file, "; __rm_allocated;})");
+}
+
+struct type *find_function_type(struct list_char *name)
+{
+    struct type *function_type = NULL;
+    for (size_t i = 0; i < lowering.global_context->fn_types.size; i++) {
+        if (list_char_eq(name, lowering.global_context->fn_types.data[i].name)) {
+            function_type = &lowering.global_context->fn_types.data[i];
+        }
+    }
+    return function_type;
+}
+
+// The call an expression is, when it's to a function returning through a pointer.
+struct function_expression *result_pointer_call(struct expression *e)
+{
+    while (e->kind == GROUP_EXPRESSION) {
+        e = e->grouped;
+    }
+    if (e->kind != FUNCTION_EXPRESSION) return NULL;
+    struct type *function_type = find_function_type(e->function.function_name);
+    return function_type != NULL && function_type->function_type.returns_through_pointer ? &e->function : NULL;
+}
+
+// `result` is where a function returning through a pointer writes its struct.
+void write_call(struct function_expression *e,
+                char *result,
+                struct context *context,
+                struct list_scoped_variable *scoped_variables,
+                FILE *file)
+{
+    struct type *function_type = find_function_type(e->function_name);
+    fprintf(file, "%s(", e->function_name->data);
+    if (result != NULL) {
+        fprintf(file, "%s%s", result, e->params->size > 0 ? ", " : "");
+    }
+    size_t param_count = e->params->size;
+    for (size_t i = 0; i < param_count; i++) {
+        struct type *param_type = function_type != NULL && i < function_type->function_type.params.size
+            ? function_type->function_type.params.data[i].field_type
+            : NULL;
+        if (function_type != NULL
+            && i < function_type->function_type.params.size
+            && function_type->function_type.params.data[i].by_reference)
+        {
+            write_reference_argument(&e->params->data[i], param_type, context, scoped_variables, file);
+        } else {
+            write_expression_as(&e->params->data[i], param_type, context, scoped_variables, file);
+        }
+        if (i < param_count - 1) {
+            fprintf(file, ", ");
+        }
+    }
+    fprintf(file, ")");
+}
+
+// A literal memory order is `stdatomic.h`'s constant, any other is looked up by its tag.
+void write_memory_order(struct expression *e,
+                        struct context *context,
+                        struct list_scoped_variable *scoped_variables,
+                        FILE *file)
+{
+    struct expression *order = e;
+    while (order->kind == GROUP_EXPRESSION) {
+        order = order->grouped;
+    }
+    if (order->kind == LITERAL_EXPRESSION && order->literal.kind == LITERAL_ENUM) {
+        fprintf(file, "memory_order_%s", order->literal.struct_enum.key_expr_pairs.data[0].key->data);
+        return;
+    }
+
+    fprintf(file, "((memory_order[]){");
+    for (size_t i = 0; memory_order_variant(i) != NULL; i++) {
+        fprintf(file, "%smemory_order_%s", i == 0 ? "" : ", ", memory_order_variant(i));
+    }
+    fprintf(file, "})[(");
+    write_expression(e, context, scoped_variables, file);
+    fprintf(file, ").memory_order_kind]");
+}
+
+// An atomic's method is the `stdatomic.h` call on its address, or on the pointer it's called
+// through. C's compare and exchange writes what it found over the expected value, which rm's
+// leaves be, so it's given a copy.
+void write_atomic_call(struct function_expression *e,
+                       struct context *context,
+                       struct list_scoped_variable *scoped_variables,
+                       FILE *file)
+{
+    enum primitive_type primitive = 0;
+    char *operation = NULL;
+    atomic_function(e->function_name, &primitive, &operation);
+    struct list_key_type_pair *params = &find_function_type(e->function_name)->function_type.params;
+    int compare_exchange = !strcmp(operation, "compare_exchange");
+
+    if (compare_exchange) {
+        fprintf(file, "({");
+        write_type(params->data[1].field_type, file);
+        fprintf(file, " __rm_expected = ");
+        write_expression_as(&e->params->data[1], params->data[1].field_type, context, scoped_variables, file);
+        fprintf(file, "; atomic_compare_exchange_strong_explicit(");
+    } else {
+        fprintf(file, "atomic_%s_explicit(", operation);
+    }
+
+    struct expression *location = &e->params->data[0];
+    struct type location_type = lut_get(&context->expression_type_lookup, location->id);
+    int through_pointer = is_atomic_pointer(&location_type);
+    fprintf(file, through_pointer ? "" : "&(");
+    write_expression(location, context, scoped_variables, file);
+    fprintf(file, through_pointer ? "" : ")");
+
+    for (size_t i = 1; i < e->params->size; i++) {
+        fprintf(file, ", ");
+        if (compare_exchange && i == 1) {
+            fprintf(file, "&__rm_expected");
+        } else if (params->data[i].field_type->kind == TY_ENUM) {
+            write_memory_order(&e->params->data[i], context, scoped_variables, file);
+        } else {
+            write_expression_as(&e->params->data[i], params->data[i].field_type, context, scoped_variables, file);
+        }
+    }
+    fprintf(file, compare_exchange ? ");})" : ")");
+}
+
+// A task's methods take a pointer to it, so it's resumed where it's kept.
+void write_task_call(struct function_expression *e,
+                     struct context *context,
+                     struct list_scoped_variable *scoped_variables,
+                     FILE *file)
+{
+    struct expression *task = &e->params->data[0];
+    struct type task_type = lut_get(&context->expression_type_lookup, task->id);
+    fprintf(file, "%s(", e->function_name->data);
+    if (task_type.modifiers.size > 0 && task_type.modifiers.data[0].kind == POINTER_MODIFIER_KIND) {
+        write_expression(task, context, scoped_variables, file);
+    } else {
+        write_reference_argument(task, &task_type, context, scoped_variables, file);
+    }
+    fprintf(file, ")");
+}
+
+void write_function_expression(struct function_expression *e,
+                               struct context *context,
+                               struct list_scoped_variable *scoped_variables,
+                               FILE *file)
+{
+    enum primitive_type primitive = 0;
+    char *operation = NULL;
+    if (is_arena_allocation(e)) {
+        write_arena_allocation(e, context, scoped_variables, file);
+        return;
+    }
+    if (atomic_function(e->function_name, &primitive, &operation)) {
+        write_atomic_call(e, context, scoped_variables, file);
+        return;
+    }
+    if (task_method(e->function_name, lowering.global_context, &operation) != NULL) {
+        write_task_call(e, context, scoped_variables, file);
+        return;
+    }
+
+    struct type *function_type = find_function_type(e->function_name);
+    if (function_type == NULL || !function_type->function_type.returns_through_pointer) {
+        write_call(e, NULL, context, scoped_variables, file);
+        return;
+    }
+
+    // where nothing names the result's storage, it's a temporary.
+    fprintf(file, "({");
+    write_type(function_type->function_type.return_type, file);
+    fprintf(file, " __rm_returned; ");
+    write_call(e, "&__rm_returned", context, scoped_variables, file);
+    fprintf(file, "; __rm_returned;})");
+}
+
+void write_expression(struct expression *e,
+                      struct context *context,
+                      struct list_scoped_variable *scoped_variables,
+                      FILE *file)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+            write_literal_expression(&e->literal, context, scoped_variables, file);
+            return;
+        case UNARY_EXPRESSION:
+            write_unary_expression(&e->unary, context, scoped_variables, file);
+            return;
+        case BINARY_EXPRESSION:
+            write_binary_expression(&e->binary, context, scoped_variables, file);
+            return;
+        case GROUP_EXPRESSION:
+            write_grouped_expression(e->grouped, context, scoped_variables, file);
+            return;
+        case FUNCTION_EXPRESSION:
+            write_function_expression(&e->function, context, scoped_variables, file);
+            return;
+        case MEMBER_ACCESS_EXPRESSION:
+            write_member_access_expression(&e->member_access, context, scoped_variables, file);
+            return;
+        case INDEX_EXPRESSION:
+            write_index_expression(e, context, scoped_variables, file);
+            return;
+        case VOID_EXPRESSION:
+            return;
+        default:
+            UNREACHABLE("expression kind not handled");
+    }
+}
+
+void write_statement(struct statement *s, struct context *context, FILE *file);
+
+void write_binding_statement(struct statement *s,
+                             struct context *context,
+                             FILE *file)
+{
+    assert(s->kind == BINDING_STATEMENT);
+    struct type value_type = lut_get(&context->expression_type_lookup, s->binding_statement.value.id);
+    struct list_scoped_variable scoped_variables =
+        lut_get(&context->statement_scope_lookup, s->id).scoped_variables;
+
+    // a struct returned through a pointer is written straight into the variable, unless the call
+    // reads a variable the binding shadows.
+    struct function_expression *call = result_pointer_call(&s->binding_statement.value);
+    struct type *variable_type = s->binding_statement.has_type ? &s->binding_statement.variable_type : &value_type;
+    int reads_shadowed = 0;
+    for (size_t i = 0; call != NULL && i < call->params->size; i++) {
+        reads_shadowed |= mentions_name(&call->params->data[i], &s->binding_statement.variable_name);
     }
-    fprintf(file, " %s = ", s->binding_statement.variable_name.data);
-    if (s->binding_statement.value.kind == LITERAL_EXPRESSION
-        && s->binding_statement.value.literal.kind == LITERAL_NULL) {
-        write_type_default(&value_type, &s->binding_statement.variable_type, file);
+    // a variable an async fn keeps in its frame is assigned to where it's bound.
+    int in_frame = is_frame_variable(&s->binding_statement.variable_name);
+    if (call != NULL && variable_type->modifiers.size == 0 && !reads_shadowed) {
+        if (!in_frame) {
+            write_type(variable_type, file);
+            fprintf(file, " %s; ", s->binding_statement.variable_name.data);
+        }
+        struct list_char result = list_create(char, (s->binding_statement.variable_name.size + 16));
+        append_list_char_slice(&result, in_frame ? "&__rm_frame->" : "&");
+        append_list_char_slice(&result, s->binding_statement.variable_name.data);
+        write_call(call, result.data, context, &scoped_variables, file);
+        fprintf(file, ";");
+        return;
+    }
+
+    if (in_frame) {
+        fprintf(file, "__rm_frame->%s = ", s->binding_statement.variable_name.data);
+    } else if (s->binding_statement.has_type) {
+        struct type *variable_type = &s->binding_statement.variable_type;
+        write_type(variable_type, file);
+        struct list_char modified =
+            apply_type_modifiers(variable_type->modifiers, s->binding_statement.variable_name);
+        fprintf(file, " %s = ", modified.data);
+    } else {
+        write_type(&value_type, file);
+        struct list_char modified =
+            apply_type_modifiers(value_type.modifiers, s->binding_statement.variable_name);
+        fprintf(file, " %s = ", modified.data);
+    }
+    if (s->binding_statement.has_type) {
+        write_expression_as(&s->binding_statement.value,
+                            &s->binding_statement.variable_type,
+                            context,
+                            &scoped_variables,
+                            file);
+    } else if (is_null_literal(&s->binding_statement.value)) {
+        write_null(&value_type, file);
     } else {
-        struct list_scoped_variable scoped_variables =
-            lut_get(&context->statement_scope_lookup, s->id).scoped_variables;
         write_expression(&s->binding_statement.value, context, &scoped_variables, file);
     }
     fprintf(file, ";");
@@ -512,10 +1500,24 @@ void write_binding_statement(struct statement *s,
 void write_if_statement(struct statement *s, struct context *context, FILE *file)
 {
     assert(s->kind == IF_STATEMENT);
+    enum branch_hint hint = s->if_statement.hint;
     fprintf(file, "if (");
+    if (hint != BRANCH_UNHINTED) {
+        fprintf(file, "__builtin_expect(!!(");
+    }
+    if (lowering.options->branch_profile != NULL) {
+        fprintf(file, "__rm_count(%zu, ", lowering.counted.size);
+        list_append(&lowering.counted, (int)s->id);
+    }
     struct list_scoped_variable scoped_variables =
         lut_get(&context->statement_scope_lookup, s->id).scoped_variables;
     write_expression(&s->if_statement.condition, context, &scoped_variables, file);
+    if (lowering.options->branch_profile != NULL) {
+        fprintf(file, ")");
+    }
+    if (hint != BRANCH_UNHINTED) {
+        fprintf(file, "), %d)", hint == BRANCH_LIKELY);
+    }
     fprintf(file, ")");
     write_statement(s->if_statement.success_statement, context, file);
     if (s->if_statement.else_statement != NULL) {
@@ -527,11 +1529,35 @@ void write_if_statement(struct statement *s, struct context *context, FILE *file
 void write_return_statement(struct statement *s, struct context *context, FILE *file)
 {
     assert(s->kind == RETURN_STATEMENT);
-    fprintf(file, "return ");
     struct list_scoped_variable scoped_variables =
         lut_get(&context->statement_scope_lookup, s->id).scoped_variables;
-    write_expression(&s->expression, context, &scoped_variables, file);
-    fprintf(file, ";");
+    // an async fn's result is kept in its frame, and resuming it again does nothing.
+    if (lowering.frame != NULL) {
+        if (s->expression.kind != VOID_EXPRESSION) {
+            fprintf(file, "__rm_frame->__rm_result = ");
+            write_expression_as(&s->expression, lowering.return_type, context, &scoped_variables, file);
+            fprintf(file, ";");
+        }
+        fprintf(file, "__rm_frame->__rm_state = -1; return true;");
+        return;
+    }
+    if (!lowering.returns_through_pointer) {
+        fprintf(file, "return ");
+        write_expression_as(&s->expression, lowering.return_type, context, &scoped_variables, file);
+        fprintf(file, ";");
+        return;
+    }
+
+    // a call returning through a pointer too is handed this function's, a struct literal is built
+    // where the caller wants it.
+    struct function_expression *call = result_pointer_call(&s->expression);
+    if (call != NULL) {
+        write_call(call, "__rm_result", context, &scoped_variables, file);
+    } else {
+        fprintf(file, "*__rm_result = ");
+        write_expression_as(&s->expression, lowering.return_type, context, &scoped_variables, file);
+    }
+    fprintf(file, "; return;");
 }
 
 void write_block_statement(struct list_statement *statements, struct context *context, FILE *file) {
@@ -562,91 +1588,806 @@ void write_while_statement(struct statement *s, struct context *context, FILE *f
     write_statement(s->while_loop_statement.do_statement, context, file);
 }
 
-void write_type_declaration_statement(struct type_declaration_statement *s,
-                                      struct context *context,
-                                      FILE *file)
+// The type a range's variable counts in, the end's unless that's a bare number.
+struct type range_variable_type(struct for_loop_statement *for_statement, struct context *context)
+{
+    int end_is_literal = for_statement->end->kind == LITERAL_EXPRESSION
+        && for_statement->end->literal.kind == LITERAL_NUMERIC;
+    return lut_get(&context->expression_type_lookup,
+                   end_is_literal ? for_statement->iterated.id : for_statement->end->id);
+}
+
+// A `parallel for` hands the count of its range to `__rm_parallel_for`, along with its body,
+// written ahead of the function as one of its own, and pointers to the variables the body reads.
+void write_parallel_for_statement(struct statement *s, struct context *context, FILE *file)
+{
+    struct for_loop_statement *for_statement = &s->for_loop_statement;
+    struct list_scoped_variable scoped_variables =
+        lut_get(&context->statement_scope_lookup, s->id).scoped_variables;
+    struct type variable_type = range_variable_type(for_statement, context);
+
+    fprintf(file, "{");
+    write_type(&variable_type, file);
+    fprintf(file, " __start_%lu = ", s->id);
+    write_expression(&for_statement->iterated, context, &scoped_variables, file);
+    fprintf(file, ", __end_%lu = ", s->id);
+    write_expression(for_statement->end, context, &scoped_variables, file);
+    fprintf(file, "; struct __rm_parallel_%lu __captured_%lu = {__start_%lu", s->id, s->id, s->id);
+    for (size_t i = 0; i < scoped_variables.size; i++) {
+        struct list_char *name = &scoped_variables.data[i].name;
+        if (list_char_eq(name, &for_statement->variable_name)
+            || !statement_mentions_name(for_statement->do_statement, name))
+        {
+            continue;
+        }
+        // a struct passed by reference is already a pointer.
+        fprintf(file, is_reference_parameter(name) ? ", %s" : ", &%s", name->data);
+    }
+    fprintf(file,
+            "}; __rm_parallel_for(__rm_parallel_%lu, &__captured_%lu, "
+            "__end_%lu > __start_%lu ? (size_t)(__end_%lu - __start_%lu) : 0);}",
+            s->id, s->id, s->id, s->id, s->id, s->id);
+}
+
+void write_parallel_body(struct statement *s, struct context *context, FILE *file)
+{
+    struct for_loop_statement *for_statement = &s->for_loop_statement;
+    struct list_scoped_variable scoped_variables =
+        lut_get(&context->statement_scope_lookup, s->id).scoped_variables;
+    struct type variable_type = range_variable_type(for_statement, context);
+
+    struct list_scoped_variable captures = list_create(scoped_variable, (scoped_variables.size + 1));
+    fprintf(file, "struct __rm_parallel_%lu {", s->id);
+    write_type(&variable_type, file);
+    fprintf(file, " start;");
+    for (size_t i = 0; i < scoped_variables.size; i++) {
+        struct scoped_variable *variable = &scoped_variables.data[i];
+        if (list_char_eq(&variable->name, &for_statement->variable_name)
+            || !statement_mentions_name(for_statement->do_statement, &variable->name))
+        {
+            continue;
+        }
+        list_append(&captures, *variable);
+        if (is_reference_parameter(&variable->name)) {
+            fprintf(file, "const ");
+            write_type(&variable->type, file);
+            fprintf(file, " *%s;", variable->name.data);
+            continue;
+        }
+        struct list_char pointer = list_create(char, (variable->name.size + 4));
+        append_list_char_slice(&pointer, "(*");
+        append_list_char_slice(&pointer, variable->name.data);
+        list_append(&pointer, ')');
+        list_append(&pointer, '\0');
+        // a parameter is pointed to as it's declared, keeping the `const` and `restrict` it was given.
+        struct key_type_pair *param = find_parameter(&variable->name);
+        if (param != NULL) {
+            write_parameter(param, &pointer, file);
+            fprintf(file, ";");
+            continue;
+        }
+        write_type(&variable->type, file);
+        fprintf(file, " %s;", apply_type_modifiers(variable->type.modifiers, pointer).data);
+    }
+    fprintf(file, "};");
+
+    fprintf(file,
+            "static void __rm_parallel_%lu(void *captured, size_t begin, size_t end) {"
+            "struct __rm_parallel_%lu *__rm_captured = captured;"
+            "for (size_t __i = begin; __i < end; __i++) {",
+            s->id,
+            s->id);
+    write_type(&variable_type, file);
+    fprintf(file, " %s = __rm_captured->start + (", for_statement->variable_name.data);
+    write_type(&variable_type, file);
+    // a body that doesn't use its index still runs once per index.
+    fprintf(file, ")__i; (void)%s;", for_statement->variable_name.data);
+
+    struct list_key_type_pair *params = lowering.params;
+    lowering.params = NULL;
+    lowering.captures = &captures;
+    write_statement(for_statement->do_statement, context, file);
+    lowering.captures = NULL;
+    lowering.params = params;
+    fprintf(file, "}}\n");
+}
+
+// The bodies of the statement's `parallel for` loops, written ahead of the function they're in.
+void write_parallel_bodies(struct statement *s, struct context *context, FILE *file)
+{
+    switch (s->kind) {
+        case IF_STATEMENT:
+            write_parallel_bodies(s->if_statement.success_statement, context, file);
+            if (s->if_statement.else_statement != NULL) {
+                write_parallel_bodies(s->if_statement.else_statement, context, file);
+            }
+            return;
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                write_parallel_bodies(&s->statements->data[i], context, file);
+            }
+            return;
+        case WHILE_LOOP_STATEMENT:
+            write_parallel_bodies(s->while_loop_statement.do_statement, context, file);
+            return;
+        case FOR_LOOP_STATEMENT:
+            if (s->for_loop_statement.parallel) {
+                write_parallel_body(s, context, file);
+            } else {
+                write_parallel_bodies(s->for_loop_statement.do_statement, context, file);
+            }
+            return;
+        case SWITCH_STATEMENT:
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                write_parallel_bodies(s->switch_statement.cases.data[i].statement, context, file);
+            }
+            return;
+        case BINDING_STATEMENT:
+        case ACTION_STATEMENT:
+        case RETURN_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+        case TYPE_DECLARATION_STATEMENT:
+            return;
+    }
+
+    UNREACHABLE("write_parallel_bodies fell out of a switch");
+}
+
+int has_parallel_loop(struct statement *s)
+{
+    switch (s->kind) {
+        case IF_STATEMENT:
+            return has_parallel_loop(s->if_statement.success_statement)
+                || (s->if_statement.else_statement != NULL && has_parallel_loop(s->if_statement.else_statement));
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (has_parallel_loop(&s->statements->data[i])) return 1;
+            }
+            return 0;
+        case WHILE_LOOP_STATEMENT:
+            return has_parallel_loop(s->while_loop_statement.do_statement);
+        case FOR_LOOP_STATEMENT:
+            return s->for_loop_statement.parallel || has_parallel_loop(s->for_loop_statement.do_statement);
+        case SWITCH_STATEMENT:
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                if (has_parallel_loop(s->switch_statement.cases.data[i].statement)) return 1;
+            }
+            return 0;
+        case TYPE_DECLARATION_STATEMENT:
+            if (s->type_declaration.type.kind != TY_FUNCTION || s->type_declaration.statements == NULL) return 0;
+            for (size_t i = 0; i < s->type_declaration.statements->size; i++) {
+                if (has_parallel_loop(&s->type_declaration.statements->data[i])) return 1;
+            }
+            return 0;
+        case BINDING_STATEMENT:
+        case ACTION_STATEMENT:
+        case RETURN_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return 0;
+    }
+
+    UNREACHABLE("has_parallel_loop fell out of a switch");
+}
+
+// Both kinds of for loop lower to a counted C loop, whose bound is read once before it starts and
+// whose elements are read through a `restrict` pointer, the shape GCC's vectoriser looks for.
+void write_for_statement(struct statement *s, struct context *context, FILE *file)
+{
+    assert(s->kind == FOR_LOOP_STATEMENT);
+    struct for_loop_statement *for_statement = &s->for_loop_statement;
+    struct list_scoped_variable scoped_variables =
+        lut_get(&context->statement_scope_lookup, s->id).scoped_variables;
+    struct type iterated_type = lut_get(&context->expression_type_lookup, for_statement->iterated.id);
+    char *name = for_statement->variable_name.data;
+
+    if (for_statement->parallel) {
+        write_parallel_for_statement(s, context, file);
+        return;
+    }
+    // a variable kept in an async fn's frame counts there, towards an end kept there too.
+    if (for_statement->end != NULL && is_frame_variable(&for_statement->variable_name)) {
+        fprintf(file, "for (__rm_frame->%s = ", name);
+        write_expression(&for_statement->iterated, context, &scoped_variables, file);
+        fprintf(file, ", __rm_frame->__rm_end_%lu = ", s->id);
+        write_expression(for_statement->end, context, &scoped_variables, file);
+        fprintf(file, "; __rm_frame->%s < __rm_frame->__rm_end_%lu; __rm_frame->%s++)", name, s->id, name);
+        write_statement(for_statement->do_statement, context, file);
+        return;
+    }
+    if (for_statement->end != NULL) {
+        struct type variable_type = range_variable_type(for_statement, context);
+        fprintf(file, "for (");
+        write_type(&variable_type, file);
+        fprintf(file, " %s = ", name);
+        write_expression(&for_statement->iterated, context, &scoped_variables, file);
+        fprintf(file, ", __end_%lu = ", s->id);
+        write_expression(for_statement->end, context, &scoped_variables, file);
+        fprintf(file, "; %s < __end_%lu; %s++)", name, s->id, name);
+        write_statement(for_statement->do_statement, context, file);
+        return;
+    }
+
+    struct type element = modifier_inner_type(&iterated_type, 0);
+    struct list_char data_name = list_create(char, 24);
+    append_list_char_slice(&data_name, for_statement->restrict_elements ? "(*restrict __data_" : "(*__data_");
+    append_int((int)s->id, &data_name);
+    list_append(&data_name, ')');
+    list_append(&data_name, '\0');
+
+    // the iterated value is evaluated once, a slice into a copy its pointer and length come from.
+    fprintf(file, "{");
+    if (iterated_type.modifiers.data[0].kind == SLICE_MODIFIER_KIND) {
+        write_type(&iterated_type, file);
+        fprintf(file, " __items_%lu = ", s->id);
+        write_expression(&for_statement->iterated, context, &scoped_variables, file);
+        fprintf(file, ";");
+        write_type(&element, file);
+        fprintf(file, " %s = __items_%lu.data;", apply_type_modifiers(element.modifiers, data_name).data, s->id);
+        fprintf(file, "size_t __len_%lu = __items_%lu.len;", s->id, s->id);
+    } else {
+        write_type(&element, file);
+        fprintf(file, " %s = ", apply_type_modifiers(element.modifiers, data_name).data);
+        write_expression(&for_statement->iterated, context, &scoped_variables, file);
+        fprintf(file, ";size_t __len_%lu = %d;",
+                s->id,
+                iterated_type.modifiers.data[0].array_modifier.literal_size);
+    }
+
+    fprintf(file, "for (size_t __i_%lu = 0; __i_%lu < __len_%lu; __i_%lu++) {", s->id, s->id, s->id, s->id);
+    write_type(&element, file);
+    fprintf(file, " %s = __data_%lu[__i_%lu];",
+            apply_type_modifiers(element.modifiers, for_statement->variable_name).data,
+            s->id,
+            s->id);
+    write_statement(for_statement->do_statement, context, file);
+    fprintf(file, "}}");
+}
+
+// With `--instrument` a function's body is written under another name, behind a wrapper that
+// records each call into the function's entry in `__rm_profiles`. Returns the body's type.
+struct type write_profiling_wrapper(struct type *fn, FILE *file)
+{
+    struct type body = *fn;
+    body.name = malloc(sizeof(*body.name));
+    *body.name = list_create(char, fn->name->size + 16);
+    append_list_char_slice(body.name, "__rm_body_");
+    append_list_char_slice(body.name, fn->name->data);
+
+    fprintf(file, "static ");
+    write_function_attributes(&body, 0, file);
+    write_function_type(&body, file);
+    fprintf(file, ";");
+    write_function_attributes(fn, 1, file);
+    write_function_type(fn, file);
+    size_t index = lowering.profiled_functions++;
+    fprintf(file, "{struct __rm_frame __frame = __rm_enter(&__rm_profiles[%zu]);", index);
+
+    struct type *return_type = fn->function_type.return_type;
+    int returns = !is_void_type(return_type) && !fn->function_type.returns_through_pointer;
+    if (returns) {
+        struct list_char result = list_create(char, 16);
+        append_list_char_slice(&result, "__result");
+        write_type(return_type, file);
+        fprintf(file, " %s = ", apply_type_modifiers(return_type->modifiers, result).data);
+    }
+    fprintf(file, "%s(", body.name->data);
+    struct list_key_type_pair *params = &fn->function_type.params;
+    if (fn->function_type.returns_through_pointer) {
+        fprintf(file, "__rm_result%s", params->size > 0 ? ", " : "");
+    }
+    for (size_t i = 0; i < params->size; i++) {
+        fprintf(file, "%s%s", i == 0 ? "" : ", ", params->data[i].field_name.data);
+    }
+    fprintf(file, ");__rm_exit(&__rm_profiles[%zu], __frame);", index);
+    fprintf(file, returns ? "return __result;}" : "}");
+
+    fprintf(file, "static ");
+    write_function_attributes(&body, 1, file);
+    return body;
+}
+
+// An async fn is written as the function its calls go to, which only copies the arguments into a
+// new task, and the task's resume function, whose body is the fn's within a switch on where it
+// last stopped, each await a case of it.
+void write_async_function(struct type_declaration_statement *s, struct context *context, FILE *file)
+{
+    struct type *constructor = find_function_type(s->type.name);
+    char *name = s->type.name->data;
+    struct list_key_type_pair *params = &s->type.function_type.params;
+    write_function_attributes(constructor, 1, file);
+    write_function_type(constructor, file);
+    fprintf(file, "{struct %s_task __rm_task = {0};", name);
+    for (size_t i = 0; i < params->size; i++) {
+        char *param = params->data[i].field_name.data;
+        struct list_type_modifier *modifiers = &params->data[i].field_type->modifiers;
+        if (modifiers->size > 0 && modifiers->data[0].kind == ARRAY_MODIFIER_KIND) {
+            fprintf(file, "memcpy(__rm_task.%s, %s, sizeof(__rm_task.%s));", param, param, param);
+        } else {
+            fprintf(file, "__rm_task.%s = %s;", param, param);
+        }
+    }
+    fprintf(file, "return __rm_task;}");
+
+    struct type *task = find_data_type(lowering.global_context, constructor->function_type.return_type->name);
+    lowering.frame = &task->struct_type.pairs;
+    lowering.return_type = s->type.function_type.return_type;
+    lowering.params = params;
+    lowering.returns_through_pointer = 0;
+    fprintf(file,
+            "bool %s_task_resume(struct %s_task *__rm_frame) {"
+            "switch (__rm_frame->__rm_state) {case -1: return true; case 0:;",
+            name,
+            name);
+    for (size_t i = 0; i < s->statements->size; i++) {
+        write_statement(&s->statements->data[i], context, file);
+    }
+    fprintf(file, "}__rm_frame->__rm_state = -1; return true;}\n");
+    lowering.frame = NULL;
+}
+
+// `id` is the declaration's statement, which a branch profile counts a function's calls under.
+void write_type_declaration_statement(struct type_declaration_statement *s,
+                                      unsigned long id,
+                                      struct context *context,
+                                      FILE *file)
+{
+    if (s->type.kind == TY_FUNCTION && s->type.function_type.is_async) {
+        write_async_function(s, context, file);
+        return;
+    }
+    struct type declared = s->type;
+    if (s->type.kind == TY_FUNCTION) {
+        lowering.params = &s->type.function_type.params;
+        for (size_t i = 0; i < s->statements->size; i++) {
+            write_parallel_bodies(&s->statements->data[i], context, file);
+        }
+    }
+    if (s->type.kind == TY_FUNCTION && lowering.options->instrument) {
+        declared = write_profiling_wrapper(&s->type, file);
+    } else if (s->type.kind == TY_FUNCTION) {
+        write_function_attributes(&s->type, 1, file);
+    }
+    write_type(&declared, file);
+    if (s->type.kind == TY_FUNCTION) {
+		assert(s->statements != NULL);
+        lowering.return_type = s->type.function_type.return_type;
+        lowering.params = &s->type.function_type.params;
+        lowering.returns_through_pointer = s->type.function_type.returns_through_pointer;
+        if (lowering.options->branch_profile == NULL) {
+            write_block_statement(s->statements, context, file);
+            return;
+        }
+        fprintf(file, "{__rm_count(%zu, true);", lowering.counted.size);
+        list_append(&lowering.counted, (int)id);
+        write_block_statement(s->statements, context, file);
+        fprintf(file, "}");
+    }
+}
+
+void write_break_statement(FILE *file)
+{
+    fprintf(file, "break;");
+}
+
+void write_continue_statement(FILE *file)
+{
+    fprintf(file, "continue;");
+}
+
+// The number of bytes a C string literal holds, once its escapes are read.
+size_t c_string_length(struct list_char *str)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < str->size && str->data[i] != '\0'; i++) {
+        length += 1;
+        if (str->data[i] != '\\' || i + 1 >= str->size) {
+            continue;
+        }
+
+        i += 1;
+        if (str->data[i] == 'x') {
+            while (i + 1 < str->size && isxdigit(str->data[i + 1])) i++;
+        } else if (str->data[i] >= '0' && str->data[i] <= '7') {
+            for (int digits = 1; digits < 3 && i + 1 < str->size
+                 && str->data[i + 1] >= '0' && str->data[i + 1] <= '7'; digits++)
+            {
+                i++;
+            }
+        }
+    }
+    return length;
+}
+
+void write_switch_subject(struct statement *s, struct type *subject_type, struct context *context, FILE *file)
+{
+    struct list_scoped_variable scoped_variables =
+        lut_get(&context->statement_scope_lookup, s->id).scoped_variables;
+    struct type binding_type = switch_binding_type(subject_type);
+    struct list_char name = list_create(char, 20);
+    append_list_char_slice(&name, "__switch_");
+    append_int(s->id, &name);
+    list_append(&name, '\0');
+
+    write_type(&binding_type, file);
+    struct list_char modified = apply_type_modifiers(binding_type.modifiers, name);
+    fprintf(file, " %s = ", modified.data);
+    write_expression(&s->switch_statement.switch_expression, context, &scoped_variables, file);
+    fprintf(file, ";");
+}
+
+void write_case_body(struct statement *s,
+                     struct case_statement *c,
+                     struct type *subject_type,
+                     struct context *context,
+                     FILE *file)
+{
+    fprintf(file, "{");
+    if (c->pattern.switch_pattern_kind == VARIABLE_PATTERN_KIND) {
+        struct type binding_type = switch_binding_type(subject_type);
+        write_type(&binding_type, file);
+        struct list_char modified =
+            apply_type_modifiers(binding_type.modifiers, c->pattern.variable_pattern.variable_name);
+        fprintf(file, " %s = __switch_%lu;", modified.data, s->id);
+    }
+    write_statement(c->statement, context, file);
+    fprintf(file, "}");
+}
+
+struct case_statement *find_catch_all_case(struct switch_statement *s)
+{
+    for (size_t i = 0; i < s->cases.size; i++) {
+        enum switch_pattern_kind kind = s->cases.data[i].pattern.switch_pattern_kind;
+        if (kind == VARIABLE_PATTERN_KIND || kind == UNDERSCORE_PATTERN_KIND) {
+            return &s->cases.data[i];
+        }
+    }
+    return NULL;
+}
+
+// Integer cases become a native C `switch`, so the C compiler is free to build a jump table.
+void write_integer_switch(struct statement *s, struct type *subject_type, struct context *context, FILE *file)
+{
+    struct switch_statement *switch_statement = &s->switch_statement;
+    fprintf(file, "switch (__switch_%lu) {", s->id);
+    for (size_t i = 0; i < switch_statement->cases.size; i++) {
+        struct case_statement *c = &switch_statement->cases.data[i];
+        if (c->pattern.switch_pattern_kind == NUMBER_PATTERN_KIND) {
+            fprintf(file, "case %lld:", (long long)c->pattern.number_pattern.number);
+        } else {
+            fprintf(file, "default:");
+        }
+        write_case_body(s, c, subject_type, context, file);
+        fprintf(file, "break;");
+    }
+    fprintf(file, "}");
+}
+
+// Floats can't be `case` labels, so they're compared in order. The `switch (0)` keeps a
+// `break` within an arm leaving the switch, as it does for the other kinds.
+void write_float_switch(struct statement *s, struct type *subject_type, struct context *context, FILE *file)
+{
+    struct switch_statement *switch_statement = &s->switch_statement;
+    fprintf(file, "switch (0) {default:");
+    for (size_t i = 0; i < switch_statement->cases.size; i++) {
+        struct case_statement *c = &switch_statement->cases.data[i];
+        if (i > 0) {
+            fprintf(file, " else ");
+        }
+        if (c->pattern.switch_pattern_kind == NUMBER_PATTERN_KIND) {
+            fprintf(file, "if (__switch_%lu == %.17g)", s->id, c->pattern.number_pattern.number);
+        }
+        write_case_body(s, c, subject_type, context, file);
+    }
+    fprintf(file, "}");
+}
+
+// Strings dispatch on their length first, so only the patterns of a matching length are
+// compared, rather than a `strcmp` against every case.
+void write_string_switch(struct statement *s, struct type *subject_type, struct context *context, FILE *file)
+{
+    struct switch_statement *switch_statement = &s->switch_statement;
+    struct case_statement *catch_all = find_catch_all_case(switch_statement);
+    struct list_int lengths = list_create(int, switch_statement->cases.size);
+    for (size_t i = 0; i < switch_statement->cases.size; i++) {
+        struct case_statement *c = &switch_statement->cases.data[i];
+        if (c->pattern.switch_pattern_kind != STRING_PATTERN_KIND) continue;
+
+        int length = c_string_length(&c->pattern.string_pattern.str);
+        int seen = 0;
+        for (size_t j = 0; j < lengths.size; j++) {
+            seen |= lengths.data[j] == length;
+        }
+        if (!seen) list_append(&lengths, length);
+    }
+
+    fprintf(file, "switch (strlen((const char *)__switch_%lu)) {", s->id);
+    for (size_t i = 0; i < lengths.size; i++) {
+        fprintf(file, "case %d:", lengths.data[i]);
+        for (size_t j = 0; j < switch_statement->cases.size; j++) {
+            struct case_statement *c = &switch_statement->cases.data[j];
+            if (c->pattern.switch_pattern_kind != STRING_PATTERN_KIND
+                || c_string_length(&c->pattern.string_pattern.str) != lengths.data[i])
+            {
+                continue;
+            }
+            fprintf(file,
+                    "if (memcmp(__switch_%lu, \"%s\", %d) == 0) {",
+                    s->id,
+                    c->pattern.string_pattern.str.data,
+                    lengths.data[i]);
+            write_case_body(s, c, subject_type, context, file);
+            fprintf(file, "break;}");
+        }
+        if (catch_all != NULL) {
+            fprintf(file, "goto __switch_%lu_default;", s->id);
+        } else {
+            fprintf(file, "break;");
+        }
+    }
+
+    if (catch_all != NULL) {
+        fprintf(file, "default:");
+        if (lengths.size > 0) {
+            fprintf(file, "__switch_%lu_default:", s->id);
+        }
+        write_case_body(s, catch_all, subject_type, context, file);
+        fprintf(file, "break;");
+    }
+    fprintf(file, "}");
+}
+
+void write_access_path(struct statement *s, struct list_access_step *path, FILE *file)
+{
+    fprintf(file, "__switch_%lu", s->id);
+    for (size_t i = 0; i < path->size; i++) {
+        switch (path->data[i].kind) {
+            case FIELD_ACCESS_STEP:
+                fprintf(file, ".%s", path->data[i].field_name.data);
+                break;
+            case INDEX_ACCESS_STEP:
+                fprintf(file, "[%d]", path->data[i].index);
+                break;
+            case VARIANT_ACCESS_STEP:
+                fprintf(file, ".%s_type_%s.payload", path->data[i].enum_name->data, path->data[i].field_name.data);
+                break;
+        }
+    }
+}
+
+// The tree only picks which case matched, the case bodies are written once after it.
+void write_decision_tree(struct statement *s, struct decision_tree *tree, FILE *file)
+{
+    switch (tree->kind) {
+        case DECISION_MATCH:
+            fprintf(file, "__arm_%lu = %zu;", s->id, tree->arm);
+            return;
+        case DECISION_FAIL:
+            return;
+        case DECISION_TEST:
+            break;
+    }
+
+    if (tree->type.kind == TY_ENUM) {
+        char *name = tree->type.name->data;
+        fprintf(file, "switch (");
+        write_access_path(s, &tree->path, file);
+        fprintf(file, ".%s_kind) {", name);
+        for (size_t i = 0; i < tree->branches.size; i++) {
+            struct decision_branch *branch = &tree->branches.data[i];
+            fprintf(file, "case %s_kind_%s:{", name, branch->pattern->object_pattern.pairs.data[0].key.data);
+            write_decision_tree(s, branch->tree, file);
+            fprintf(file, "}break;");
+        }
+        fprintf(file, "default:{");
+        write_decision_tree(s, tree->otherwise, file);
+        fprintf(file, "}break;}");
+        return;
+    }
+
+    if (classify_switch_subject(&tree->type) == SWITCH_ON_INTEGER) {
+        fprintf(file, "switch (");
+        write_access_path(s, &tree->path, file);
+        fprintf(file, ") {");
+        for (size_t i = 0; i < tree->branches.size; i++) {
+            struct decision_branch *branch = &tree->branches.data[i];
+            fprintf(file, "case %lld:{", (long long)branch->pattern->number_pattern.number);
+            write_decision_tree(s, branch->tree, file);
+            fprintf(file, "}break;");
+        }
+        fprintf(file, "default:{");
+        write_decision_tree(s, tree->otherwise, file);
+        fprintf(file, "}break;}");
+        return;
+    }
+
+    for (size_t i = 0; i < tree->branches.size; i++) {
+        struct decision_branch *branch = &tree->branches.data[i];
+        fprintf(file, "if (");
+        if (branch->pattern->switch_pattern_kind == NUMBER_PATTERN_KIND) {
+            write_access_path(s, &tree->path, file);
+            fprintf(file, " == %.17g", branch->pattern->number_pattern.number);
+        } else {
+            fprintf(file, "strcmp((const char *)");
+            write_access_path(s, &tree->path, file);
+            fprintf(file, ", \"%s\") == 0", branch->pattern->string_pattern.str.data);
+        }
+        fprintf(file, ") {");
+        write_decision_tree(s, branch->tree, file);
+        fprintf(file, "} else ");
+    }
+    fprintf(file, "{");
+    write_decision_tree(s, tree->otherwise, file);
+    fprintf(file, "}");
+}
+
+void write_decision_tree_switch(struct statement *s, struct context *context, FILE *file)
 {
-    write_type(&s->type, file);
-    if (s->type.kind == TY_FUNCTION) {
-		assert(s->statements != NULL);
-        write_block_statement(s->statements, context, file);
+    struct switch_statement *switch_statement = &s->switch_statement;
+    struct decision_tree *tree = switch_statement->decision_tree;
+    fprintf(file, "int __arm_%lu = -1;", s->id);
+    write_decision_tree(s, tree, file);
+
+    fprintf(file, "switch (__arm_%lu) {", s->id);
+    for (size_t i = 0; i < switch_statement->cases.size; i++) {
+        fprintf(file, "case %zu:{", i);
+        struct list_pattern_binding *bindings = &tree->arm_bindings[i];
+        for (size_t j = 0; j < bindings->size; j++) {
+            write_type(&bindings->data[j].type, file);
+            struct list_char modified =
+                apply_type_modifiers(bindings->data[j].type.modifiers, bindings->data[j].name);
+            fprintf(file, " %s = ", modified.data);
+            write_access_path(s, &bindings->data[j].path, file);
+            fprintf(file, ";");
+        }
+        write_statement(switch_statement->cases.data[i].statement, context, file);
+        fprintf(file, "}break;");
     }
+    fprintf(file, "}");
 }
 
-void write_break_statement(FILE *file)
+void write_switch_statement(struct statement *s, struct context *context, FILE *file)
 {
-    fprintf(file, "break;");
-}
+    assert(s->kind == SWITCH_STATEMENT);
+    struct type subject_type =
+        lut_get(&context->expression_type_lookup, s->switch_statement.switch_expression.id);
 
-void write_case_predicate(struct switch_pattern *p,
-                          const char *switch_name,
-                          FILE *file)
-{
-    // Just hacking this together for now, to play.
-    switch (p->switch_pattern_kind) {
-        case OBJECT_PATTERN_KIND:
-        {
-            break;
-        }
-        case ARRAY_PATTERN_KIND:
-            break;
-        case NUMBER_PATTERN_KIND:
-        {
-            fprintf(file, "if (*%s == %lf)", switch_name, p->number_pattern.number);
-            break;
-        }
-        case STRING_PATTERN_KIND:
-        {
-            fprintf(file, "if (strcmp(%s, \"%s\") == 0)", switch_name, p->string_pattern.str.data);
+    fprintf(file, "{");
+    write_switch_subject(s, &subject_type, context, file);
+    if (s->switch_statement.decision_tree != NULL) {
+        write_decision_tree_switch(s, context, file);
+        fprintf(file, "}");
+        return;
+    }
+
+    switch (classify_switch_subject(&subject_type)) {
+        case SWITCH_ON_INTEGER:
+            write_integer_switch(s, &subject_type, context, file);
             break;
-        }
-        case VARIABLE_PATTERN_KIND:
-        {
-            fprintf(file, "if (1)");
+        case SWITCH_ON_FLOAT:
+            write_float_switch(s, &subject_type, context, file);
             break;
-        }
-        case UNDERSCORE_PATTERN_KIND:
-        {
-            fprintf(file, "if (1)");
+        case SWITCH_ON_STRING:
+            write_string_switch(s, &subject_type, context, file);
             break;
+        case SWITCH_ON_OTHER:
+            UNREACHABLE("switch subjects are checked before lowering");
+    }
+    fprintf(file, "}");
+}
+
+void write_c_block(struct c_block_statement *s, FILE *file)
+{
+    // within an async fn, the C names the variables kept in its frame as it would locals.
+    struct list_key_type_pair *frame = lowering.frame;
+    for (size_t i = 0; frame != NULL && i < frame->size; i++) {
+        char *name = frame->data[i].field_name.data;
+        if (mentions_identifier(s->raw_c->data, name)) {
+            fprintf(file, "\n#define %s (__rm_frame->%s)\n", name, name);
         }
-        case REST_PATTERN_KIND:
-            UNREACHABLE("todo error handling");
+    }
+    fprintf(file, "%s\n", s->raw_c->data);
+    for (size_t i = 0; frame != NULL && i < frame->size; i++) {
+        char *name = frame->data[i].field_name.data;
+        if (mentions_identifier(s->raw_c->data, name)) {
+            fprintf(file, "#undef %s\n", name);
         }
+    }
 }
 
-void write_case_statement(struct case_statement *s,
-                          const char *switch_name,
-                          FILE *file)
+// Writes `text` inside a C string or JSON string literal.
+void write_escaped(char *text, FILE *file)
 {
-    // write_case_predicate(&s->pattern, switch_name, scope, file);
-    // fprintf(file, "{");
-    // write_statement(s->statement, file);
-    // fprintf(file, "}");
+    for (char *c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
 }
 
-void write_switch_statement(struct switch_statement *s, FILE *file)
+// Points the C compiler, and so debuggers, profilers and sanitizers, at the rm the statement came
+// from.
+void write_line_directive(struct statement *s, FILE *file)
 {
-    // struct type inferred_type = {0};
-    // if (infer_type(&s->switch_expression, scope, &inferred_type)) {
-    //     write_type(&inferred_type, file);
-    //     fprintf(file, " *t = &");
-    //     write_expression(&s->switch_expression, scope, file);
-    //     fprintf(file, ";");
-    // }
-    //
-    // for (size_t i = 0; i < s->cases.size; i++) {
-    //     write_case_statement(&s->cases.data[i], "t", scope, file);
-    // }
+    struct statement_metadata metadata = lut_get(&lowering.global_context->metadata_lookup, s->id);
+    if (metadata.file_name == NULL) return;
+
+    fprintf(file, "\n#line %u \"", metadata.row);
+    write_escaped(metadata.file_name, file);
+    fprintf(file, "\"\n");
+    list_append(&lowering.source_mappings, ((struct source_mapping) {
+        .offset = ftell(file),
+        .metadata = metadata
+    }));
 }
 
-void write_c_block(struct c_block_statement *s, FILE *file)
+// Where an async fn can stop, its state the statement's id plus one, as 0 is a task not yet
+// started. An awaited async fn's frame is made within this one's and resumed in place until it's
+// done, a bool is checked again on each resume until it's true.
+void write_await_statement(struct statement *s, struct expression *await, struct context *context, FILE *file)
 {
-    fprintf(file, "%s\n", s->raw_c->data);
+    struct list_scoped_variable scoped_variables =
+        lut_get(&context->statement_scope_lookup, s->id).scoped_variables;
+    struct expression *operand = await->unary.expression;
+    struct type *callee = async_call(operand, lowering.global_context);
+    if (callee != NULL) {
+        fprintf(file, "__rm_frame->__rm_awaited_%lu = ", s->id);
+        write_expression(operand, context, &scoped_variables, file);
+        fprintf(file, ";");
+    }
+    fprintf(file, "__rm_frame->__rm_state = %lu; case %lu:;", s->id + 1, s->id + 1);
+    if (callee != NULL) {
+        fprintf(file, "if (!%s_task_resume(&__rm_frame->__rm_awaited_%lu)) return false;", callee->name->data, s->id);
+    } else {
+        fprintf(file, "if (!(");
+        write_expression(operand, context, &scoped_variables, file);
+        fprintf(file, ")) return false;");
+    }
+
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+        {
+            struct list_char *name = &s->binding_statement.variable_name;
+            if (is_frame_variable(name)) {
+                fprintf(file, "__rm_frame->%s", name->data);
+            } else {
+                struct type variable_type = s->binding_statement.has_type
+                    ? s->binding_statement.variable_type
+                    : lut_get(&context->expression_type_lookup, await->id);
+                write_type(&variable_type, file);
+                fprintf(file, " %s", apply_type_modifiers(variable_type.modifiers, *name).data);
+            }
+            fprintf(file, " = __rm_frame->__rm_awaited_%lu.__rm_result;", s->id);
+            return;
+        }
+        case RETURN_STATEMENT:
+            if (callee != NULL && !is_void_type(lowering.return_type)) {
+                fprintf(file, "__rm_frame->__rm_result = __rm_frame->__rm_awaited_%lu.__rm_result;", s->id);
+            }
+            fprintf(file, "__rm_frame->__rm_state = -1; return true;");
+            return;
+        default:
+            return;
+    }
 }
 
 void write_statement(struct statement *s, struct context *context, FILE *file)
 {
+    // a block's statements each get their own.
+    if (s->kind != BLOCK_STATEMENT) {
+        write_line_directive(s, file);
+    }
+
+    struct expression *await = lowering.frame != NULL ? awaited(s) : NULL;
+    if (await != NULL) {
+        write_await_statement(s, await, context, file);
+        return;
+    }
+
     switch (s->kind) {
         case BINDING_STATEMENT:
             write_binding_statement(s, context, file);
@@ -666,14 +2407,20 @@ void write_statement(struct statement *s, struct context *context, FILE *file)
         case WHILE_LOOP_STATEMENT:
             write_while_statement(s, context, file);
             break;
+        case FOR_LOOP_STATEMENT:
+            write_for_statement(s, context, file);
+            break;
         case TYPE_DECLARATION_STATEMENT:
-            write_type_declaration_statement(&s->type_declaration, context, file);
+            write_type_declaration_statement(&s->type_declaration, s->id, context, file);
             break;
         case BREAK_STATEMENT:
             write_break_statement(file);
             break;
+        case CONTINUE_STATEMENT:
+            write_continue_statement(file);
+            break;
         case SWITCH_STATEMENT:
-            //write_switch_statement(&s->switch_statement, file);
+            write_switch_statement(s, context, file);
             break;
         case C_BLOCK_STATEMENT:
             write_c_block(&s->c_block_statement, file);
@@ -688,10 +2435,201 @@ struct generated_c_state {
     struct list_type *fn_types;
 };
 
+// Each field's array of a `#[soa]` array sized by a field follows the struct, aligned for the
+// field, and the struct's pointers are set to them. A size that overflows or an allocation that
+// fails aborts.
+void write_soa_constructor(struct type *data_type,
+                           struct list_char *length_field,
+                           struct type *array_type,
+                           FILE *file)
+{
+    struct list_key_type_pair *pairs = &data_type->struct_type.pairs;
+    char *name = data_type->name->data;
+    char *array_field = pairs->data[pairs->size - 1].field_name.data;
+    char *length = length_field->data;
+
+    struct type element = {0};
+    struct list_char error = list_create(char, 10);
+    find_struct_definition(lowering.global_context, array_type->name, &element, &error);
+    struct list_key_type_pair *columns = &element.struct_type.pairs;
+
+    fprintf(file,
+            "struct %s *%s_new(size_t %s) {struct %s *output = NULL; size_t size = sizeof(struct %s), column; size_t at[%zu];",
+            name, name, length, name, name, columns->size + 1);
+    for (size_t i = 0; i < columns->size; i++) {
+        char *column = columns->data[i].field_name.data;
+        fprintf(file,
+                "if (__builtin_add_overflow(size, __alignof__(*output->%s.%s) - 1, &size)) abort();"
+                "at[%zu] = size = size / __alignof__(*output->%s.%s) * __alignof__(*output->%s.%s);"
+                "if (__builtin_mul_overflow(%s, sizeof(*output->%s.%s), &column)"
+                " || __builtin_add_overflow(size, column, &size)) abort();",
+                array_field, column, i, array_field, column, array_field, column,
+                length, array_field, column);
+    }
+    fprintf(file, "output = malloc(size); if (output == NULL) abort(); output->%s = %s;", length, length);
+    for (size_t i = 0; i < columns->size; i++) {
+        char *column = columns->data[i].field_name.data;
+        fprintf(file, "output->%s.%s = (void *)((char *)output + at[%zu]);", array_field, column, i);
+    }
+    fprintf(file, "return output;}\n");
+}
+
+// A struct ending in an array sized by one of its fields is allocated along with the array. A
+// length too large for the size to fit, or a failed allocation, aborts like the arena does.
+void write_constructor(struct type *data_type, FILE *file)
+{
+    struct list_char *length_field = NULL;
+    if (!sized_by_field(data_type, &length_field)) return;
+
+    struct list_key_type_pair *pairs = &data_type->struct_type.pairs;
+    char *name = data_type->name->data;
+    char *array_field = pairs->data[pairs->size - 1].field_name.data;
+    struct type *array_type = pairs->data[pairs->size - 1].field_type;
+    if (has_soa_array(array_type)) {
+        write_soa_constructor(data_type, length_field, array_type, file);
+        return;
+    }
+    fprintf(file,
+            "struct %s *%s_new(size_t %s) {"
+            "struct %s *output = NULL; size_t size;"
+            "if (__builtin_mul_overflow(%s, sizeof(output->%s[0]), &size)"
+            " || __builtin_add_overflow(size, sizeof(struct %s), &size)) abort();"
+            "output = malloc(size); if (output == NULL) abort();"
+            "output->%s = %s; return output;}\n",
+            name, name, length_field->data,
+            name,
+            length_field->data, array_field,
+            name,
+            length_field->data, length_field->data);
+}
+
+// The table `--instrument` records into, one entry per function in the order they're written, and
+// the hooks around each call. Time is in TSC cycles on x86, nanoseconds elsewhere. Exclusive time
+// leaves out the callees, inclusive time is only added once the outermost of a recursive function's
+// calls returns. The report goes to stderr at exit, or on the next return after a SIGUSR1.
+// `parallel for` bodies call functions from several threads at once, so the call stack's state is
+// kept per thread and the totals are added to atomically.
+void write_profiling_runtime(struct parsed_file *parsed_file, FILE *file)
+{
+    fprintf(file,
+            "#include <signal.h>\n"
+            "#include <time.h>\n"
+            "struct __rm_profile {const char *name; uint64_t calls; uint64_t inclusive; uint64_t exclusive;};"
+            "struct __rm_frame {uint64_t children; uint64_t start;};"
+            "static struct __rm_profile __rm_profiles[] = {");
+    size_t count = 0;
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        struct statement *s = &parsed_file->statements.data[i];
+        // an async fn's work is done across its task's resumes, which aren't wrapped.
+        if (s->kind != TYPE_DECLARATION_STATEMENT
+            || s->type_declaration.type.kind != TY_FUNCTION
+            || s->type_declaration.type.function_type.is_async)
+        {
+            continue;
+        }
+        fprintf(file, "%s{\"%s\"}", count == 0 ? "" : ", ", s->type_declaration.type.name->data);
+        count++;
+    }
+    if (count == 0) {
+        fprintf(file, "{0}");
+    }
+    fprintf(file,
+            "};"
+            "static const size_t __rm_profile_count = %zu;"
+            "static _Thread_local uint64_t __rm_children;"
+            "static _Thread_local uint32_t __rm_active[sizeof(__rm_profiles) / sizeof(__rm_profiles[0])];"
+            "static volatile sig_atomic_t __rm_dump_requested;"
+            "static inline uint64_t __rm_now(void) {"
+            "\n#if defined(__x86_64__) || defined(__i386__)\n"
+            "return __builtin_ia32_rdtsc();"
+            "\n#else\n"
+            "struct timespec now; clock_gettime(CLOCK_MONOTONIC, &now);"
+            "return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;"
+            "\n#endif\n"
+            "}"
+            "static int __rm_by_exclusive(const void *l, const void *r) {"
+            "uint64_t a = ((const struct __rm_profile *)l)->exclusive, b = ((const struct __rm_profile *)r)->exclusive;"
+            "return (a < b) - (a > b);}"
+            "static void __rm_dump_profile(void) {"
+            "struct __rm_profile sorted[sizeof(__rm_profiles) / sizeof(__rm_profiles[0])];"
+            "for (size_t i = 0; i < __rm_profile_count; i++) {"
+            "sorted[i].name = __rm_profiles[i].name;"
+            "sorted[i].calls = __atomic_load_n(&__rm_profiles[i].calls, __ATOMIC_RELAXED);"
+            "sorted[i].inclusive = __atomic_load_n(&__rm_profiles[i].inclusive, __ATOMIC_RELAXED);"
+            "sorted[i].exclusive = __atomic_load_n(&__rm_profiles[i].exclusive, __ATOMIC_RELAXED);}"
+            "qsort(sorted, __rm_profile_count, sizeof(sorted[0]), __rm_by_exclusive);"
+            "fprintf(stderr, \"%%-32s %%12s %%20s %%20s\\n\", \"function\", \"calls\", \"inclusive\", \"exclusive\");"
+            "for (size_t i = 0; i < __rm_profile_count; i++) {"
+            "if (sorted[i].calls == 0) continue;"
+            "fprintf(stderr, \"%%-32s %%12llu %%20llu %%20llu\\n\", sorted[i].name, (unsigned long long)sorted[i].calls,"
+            " (unsigned long long)sorted[i].inclusive, (unsigned long long)sorted[i].exclusive);}}"
+            "static inline struct __rm_frame __rm_enter(struct __rm_profile *p) {"
+            "__rm_active[p - __rm_profiles]++; struct __rm_frame frame = {__rm_children, __rm_now()}; __rm_children = 0;"
+            "return frame;}"
+            "static inline void __rm_exit(struct __rm_profile *p, struct __rm_frame frame) {"
+            "uint64_t elapsed = __rm_now() - frame.start;"
+            "__atomic_fetch_add(&p->calls, 1, __ATOMIC_RELAXED);"
+            "__atomic_fetch_add(&p->exclusive, elapsed - __rm_children, __ATOMIC_RELAXED);"
+            "if (--__rm_active[p - __rm_profiles] == 0) __atomic_fetch_add(&p->inclusive, elapsed, __ATOMIC_RELAXED);"
+            "__rm_children = frame.children + elapsed;"
+            "if (__rm_dump_requested && __atomic_exchange_n(&__rm_dump_requested, 0, __ATOMIC_RELAXED)) __rm_dump_profile();}"
+            "static void __rm_request_dump(int signal_number) {(void)signal_number; __rm_dump_requested = 1;}"
+            "__attribute__((constructor)) static void __rm_start_profiling(void) {"
+            "atexit(__rm_dump_profile); signal(SIGUSR1, __rm_request_dump);}\n",
+            count);
+}
+
+// With a branch profile, each `if` and each function counts into its entry of `__rm_counters`:
+// an `if` a hit when its condition held and a miss when it didn't, a function a hit per call. The
+// table is only defined once every entry has been handed out, at the end of the file.
+void write_branch_counting_runtime(FILE *file)
+{
+    fprintf(file,
+            "struct __rm_counter {unsigned long id; uint64_t hits; uint64_t misses;};"
+            "extern struct __rm_counter __rm_counters[];"
+            "static inline bool __rm_count(size_t index, bool taken) {"
+            "__atomic_fetch_add(taken ? &__rm_counters[index].hits : &__rm_counters[index].misses, 1, __ATOMIC_RELAXED);"
+            "return taken;}\n");
+}
+
+// The counters, and the destructor that appends them to the branch profile, so every run of the
+// training command adds to it.
+void write_branch_counters(FILE *file)
+{
+    fprintf(file, "struct __rm_counter __rm_counters[] = {");
+    for (size_t i = 0; i < lowering.counted.size; i++) {
+        fprintf(file, "%s{%d}", i == 0 ? "" : ", ", lowering.counted.data[i]);
+    }
+    if (lowering.counted.size == 0) {
+        fprintf(file, "{0}");
+    }
+    fprintf(file, "};__attribute__((destructor)) static void __rm_write_counters(void) {FILE *profile = fopen(\"");
+    for (char *c = lowering.options->branch_profile; *c != '\0'; c++) {
+        fprintf(file, *c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+    }
+    fprintf(file,
+            "\", \"a\"); if (profile == NULL) return;"
+            "for (size_t i = 0; i < %zu; i++) {"
+            "fprintf(profile, \"%%lu %%llu %%llu\\n\", __rm_counters[i].id,"
+            " (unsigned long long)__rm_counters[i].hits, (unsigned long long)__rm_counters[i].misses);}"
+            "fclose(profile);}\n",
+            lowering.counted.size);
+}
+
 static void generate_c_file(struct parsed_file *file, struct context *context)
 {
     FILE *output_file = fopen("target/c_output.c", "w");
     fprintf(output_file, "#include \"c_output.h\"\n");
+    if (lowering.options->instrument) {
+        write_profiling_runtime(file, output_file);
+    }
+    if (lowering.options->branch_profile != NULL) {
+        write_branch_counting_runtime(output_file);
+    }
+
+    for (size_t i = 0; i < file->global_context.data_types.size; i++) {
+        write_constructor(&file->global_context.data_types.data[i], output_file);
+    }
 
     for (size_t i = 0; i < file->statements.size; i++) {
         struct statement s = file->statements.data[i];
@@ -721,8 +2659,10 @@ static void generate_c_file(struct parsed_file *file, struct context *context)
 			case BLOCK_STATEMENT:
 			case ACTION_STATEMENT:
 			case WHILE_LOOP_STATEMENT:
+			case FOR_LOOP_STATEMENT:
             case SWITCH_STATEMENT:
 			case BREAK_STATEMENT:
+			case CONTINUE_STATEMENT:
 			case C_BLOCK_STATEMENT:
 			{
 				fprintf(stderr, "woops");
@@ -730,40 +2670,647 @@ static void generate_c_file(struct parsed_file *file, struct context *context)
 			}
         }
     }
+
+    if (lowering.options->branch_profile != NULL) {
+        write_branch_counters(output_file);
+    }
+    fclose(output_file);
+}
+
+typedef struct defined_struct {
+    struct list_char name;
+} defined_struct;
+
+struct_list(defined_struct);
+
+void define_generated_structs(struct type *ty, struct list_defined_struct *defined, FILE *header);
+
+// A tagged nullable is a struct of its value and a `present` tag. When the value is a struct with
+// padding, the tag is kept in it, by overlaying the value with a copy of its fields that has the
+// tag in the gap.
+void define_nullable(struct type *ty, size_t index, struct list_defined_struct *defined, FILE *header)
+{
+    struct list_char name = nullable_type_name(ty, index);
+    for (size_t i = 0; i < defined->size; i++) {
+        if (list_char_eq(&defined->data[i].name, &name)) return;
+    }
+    list_append(defined, ((struct defined_struct) { .name = name }));
+
+    struct type inner = modifier_inner_type(ty, index);
+    define_generated_structs(&inner, defined, header);
+
+    struct list_char value = list_create(char, 8);
+    append_list_char_slice(&value, "value");
+    list_append(&value, '\0');
+
+    size_t tag_after = 0;
+    if (!nullable_tag_slot(&inner, lowering.global_context, &tag_after)) {
+        fprintf(header, "struct %s {", name.data);
+        write_type(&inner, header);
+        fprintf(header, " %s; uint8_t present;};", apply_type_modifiers(inner.modifiers, value).data);
+        return;
+    }
+
+    struct type definition = {0};
+    struct list_char error = list_create(char, 10);
+    find_struct_definition(lowering.global_context, inner.name, &definition, &error);
+    fprintf(header, "struct %s {union {", name.data);
+    write_type(&inner, header);
+    fprintf(header, " value; struct {");
+    for (size_t i = 0; i < definition.struct_type.pairs.size; i++) {
+        struct key_type_pair pair = definition.struct_type.pairs.data[i];
+        write_type(pair.field_type, header);
+        fprintf(header, " %s;", apply_type_modifiers(pair.field_type->modifiers, pair.field_name).data);
+        if (i == tag_after) {
+            fprintf(header, " uint8_t present;");
+        }
+    }
+    fprintf(header, "} tagged;};};");
+
+    // storing a struct may store its padding too, so the tag is only set once the value is in.
+    fprintf(header, "static inline struct %s %s_some(", name.data, name.data);
+    write_type(&inner, header);
+    fprintf(header,
+            " value) {struct %s output; output.value = value; output.tagged.present = 1; return output;}",
+            name.data);
+}
+
+// A slice is a pointer to its elements and their count. Its `_of` function slices an array or
+// another slice, checking the range is within its length.
+void define_slice(struct type *ty, size_t index, struct list_defined_struct *defined, FILE *header)
+{
+    struct list_char name = slice_type_name(ty, index);
+    for (size_t i = 0; i < defined->size; i++) {
+        if (list_char_eq(&defined->data[i].name, &name)) return;
+    }
+    list_append(defined, ((struct defined_struct) { .name = name }));
+
+    struct type element = modifier_inner_type(ty, index);
+    define_generated_structs(&element, defined, header);
+
+    struct list_char data_name = list_create(char, 8);
+    append_list_char_slice(&data_name, "(*data)");
+    list_append(&data_name, '\0');
+    char *data_declarator = apply_type_modifiers(element.modifiers, data_name).data;
+
+    fprintf(header, "struct %s {", name.data);
+    write_type(&element, header);
+    fprintf(header, " %s; size_t len;};", data_declarator);
+    fprintf(header, "static inline struct %s %s_of(", name.data, name.data);
+    write_type(&element, header);
+    fprintf(header,
+            " %s, size_t start, size_t end, size_t length) {"
+            "\n#ifndef RM_UNCHECKED\n"
+            "if (__builtin_expect(start > end || end > length, 0)) abort();"
+            "\n#endif\n"
+            "return (struct %s) {data + start, end - start};}\n",
+            data_declarator,
+            name.data);
+}
+
+// An array of a `#[soa]` struct is a struct of an array of each field. One sized by another field
+// holds a pointer to each instead, into the storage its struct's constructor allocates after it.
+void define_soa(struct type *ty, struct list_defined_struct *defined, FILE *header)
+{
+    struct list_char name = soa_type_name(ty);
+    for (size_t i = 0; i < defined->size; i++) {
+        if (list_char_eq(&defined->data[i].name, &name)) return;
+    }
+    list_append(defined, ((struct defined_struct) { .name = name }));
+
+    struct type definition = {0};
+    struct list_char error = list_create(char, 10);
+    find_struct_definition(lowering.global_context, ty->name, &definition, &error);
+    struct list_key_type_pair *pairs = &definition.struct_type.pairs;
+    for (size_t i = 0; i < pairs->size; i++) {
+        define_generated_structs(pairs->data[i].field_type, defined, header);
+    }
+
+    struct array_type_modifier *array = &ty->modifiers.data[ty->modifiers.size - 1].array_modifier;
+    fprintf(header, "struct %s {", name.data);
+    for (size_t i = 0; i < pairs->size; i++) {
+        struct key_type_pair pair = pairs->data[i];
+        struct list_char column = list_create(char, 16);
+        if (array->literally_sized) {
+            append_list_char_slice(&column, pair.field_name.data);
+            list_append(&column, '[');
+            append_int(array->literal_size, &column);
+            list_append(&column, ']');
+        } else {
+            append_list_char_slice(&column, "(*");
+            append_list_char_slice(&column, pair.field_name.data);
+            list_append(&column, ')');
+        }
+        list_append(&column, '\0');
+        write_type(pair.field_type, header);
+        fprintf(header, " %s;", apply_type_modifiers(pair.field_type->modifiers, column).data);
+    }
+    fprintf(header, "};");
+}
+
+// Defines the structs nullables, slices and `#[soa]` arrays within the type lower to, inner ones
+// first.
+void define_generated_structs(struct type *ty, struct list_defined_struct *defined, FILE *header)
+{
+    if (has_soa_array(ty)) {
+        define_soa(ty, defined, header);
+    }
+
+    size_t nullable_index = 0;
+    size_t slice_index = 0;
+    int has_nullable = first_tagged_nullable(ty, &nullable_index);
+    if (first_slice(ty, &slice_index) && (!has_nullable || slice_index < nullable_index)) {
+        define_slice(ty, slice_index, defined, header);
+    } else if (has_nullable) {
+        define_nullable(ty, nullable_index, defined, header);
+    }
+}
+
+void define_statement_structs(struct statement *s, struct list_defined_struct *defined, FILE *header)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            if (s->binding_statement.has_type) {
+                define_generated_structs(&s->binding_statement.variable_type, defined, header);
+            }
+            return;
+        case IF_STATEMENT:
+            define_statement_structs(s->if_statement.success_statement, defined, header);
+            if (s->if_statement.else_statement != NULL) {
+                define_statement_structs(s->if_statement.else_statement, defined, header);
+            }
+            return;
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                define_statement_structs(&s->statements->data[i], defined, header);
+            }
+            return;
+        case WHILE_LOOP_STATEMENT:
+            define_statement_structs(s->while_loop_statement.do_statement, defined, header);
+            return;
+        case FOR_LOOP_STATEMENT:
+            define_statement_structs(s->for_loop_statement.do_statement, defined, header);
+            return;
+        case SWITCH_STATEMENT:
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                define_statement_structs(s->switch_statement.cases.data[i].statement, defined, header);
+            }
+            return;
+        case TYPE_DECLARATION_STATEMENT:
+            if (s->type_declaration.type.kind == TY_FUNCTION && s->type_declaration.statements != NULL) {
+                for (size_t i = 0; i < s->type_declaration.statements->size; i++) {
+                    define_statement_structs(&s->type_declaration.statements->data[i], defined, header);
+                }
+            }
+            return;
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return;
+    }
+}
+
+// Struct reordering trusts the sizes the layout module computes, the C compiler checks them.
+void write_size_assertion(struct type *data_type, struct global_context *global_context, FILE *header)
+{
+    struct layout layout = {0};
+    if (!type_layout(data_type, global_context, &layout)) return;
+
+    struct list_char c_type = list_create(char, 32);
+    append_list_char_slice(&c_type, "struct ");
+    append_list_char_slice(&c_type, data_type->name->data);
+    if (data_type->kind == TY_ENUM) {
+        append_list_char_slice(&c_type, "_type");
+    }
+    fprintf(header,
+            "\n_Static_assert(sizeof(%s) == %zu, \"%s is laid out as rm computed\");\n",
+            c_type.data,
+            layout.size,
+            c_type.data);
+}
+
+// Arenas hand out memory by bumping a cursor through malloc'd chunks, each twice the size of the
+// last, and give it all back at once. A mark is how far into the arena the cursor is, counting
+// every chunk before the current one whole.
+void write_arena_runtime(FILE *header)
+{
+    fprintf(header,
+            "struct __rm_arena_chunk {struct __rm_arena_chunk *previous; size_t start; size_t capacity; _Alignas(16) char data[];};"
+            "struct __rm_arena {struct __rm_arena_chunk *chunk; char *cursor; char *end; size_t chunk_size;"
+            "size_t allocations; size_t bytes; size_t peak; size_t chunks; size_t resets;};"
+            "\n_Static_assert(sizeof(struct __rm_arena) == 72, \"struct __rm_arena is laid out as rm computed\");\n"
+            "static inline size_t arena_mark(struct __rm_arena *arena) {"
+            "return arena->chunk == NULL ? 0 : arena->chunk->start + (size_t)(arena->cursor - arena->chunk->data);}"
+            // the cursor only moves back on a rewind or reset, so that's when the peak is taken.
+            "static inline void __rm_arena_note_peak(struct __rm_arena *arena) {"
+            "size_t used = arena_mark(arena); if (used > arena->peak) arena->peak = used;}"
+            "static inline void *__rm_arena_grow(struct __rm_arena *arena, size_t size, size_t align);"
+            "static inline void *__rm_arena_alloc(struct __rm_arena *arena, size_t size, size_t align) {"
+            "uintptr_t at = ((uintptr_t)arena->cursor + align - 1) & ~(uintptr_t)(align - 1);"
+            "if (__builtin_expect(arena->end == NULL || at + size > (uintptr_t)arena->end, 0)) return __rm_arena_grow(arena, size, align);"
+            "arena->cursor = (char *)(at + size); arena->allocations++; arena->bytes += size;"
+            "return (void *)at;}"
+            "static inline void *__rm_arena_grow(struct __rm_arena *arena, size_t size, size_t align) {"
+            "if (arena->chunk_size == 0) arena->chunk_size = 4096;"
+            "size_t capacity = arena->chunk_size > size + align ? arena->chunk_size : size + align;"
+            "struct __rm_arena_chunk *chunk = malloc(sizeof(*chunk) + capacity);"
+            "if (chunk == NULL) abort();"
+            "chunk->previous = arena->chunk;"
+            "chunk->start = arena->chunk == NULL ? 0 : arena->chunk->start + arena->chunk->capacity;"
+            "chunk->capacity = capacity;"
+            "arena->chunk = chunk; arena->cursor = chunk->data; arena->end = chunk->data + capacity;"
+            "arena->chunk_size *= 2; arena->chunks++;"
+            "return __rm_arena_alloc(arena, size, align);}"
+            "static inline struct __rm_arena *arena_create(size_t capacity) {"
+            "struct __rm_arena *arena = calloc(1, sizeof(*arena));"
+            "if (arena == NULL) abort();"
+            "arena->chunk_size = capacity; return arena;}"
+            "static inline void arena_rewind(struct __rm_arena *arena, size_t mark) {"
+            "if (arena->chunk == NULL || mark > arena_mark(arena)) return;"
+            "__rm_arena_note_peak(arena);"
+            "while (arena->chunk != NULL && arena->chunk->start > mark) {"
+            "struct __rm_arena_chunk *previous = arena->chunk->previous; free(arena->chunk); arena->chunk = previous;}"
+            "arena->cursor = arena->chunk->data + (mark - arena->chunk->start);"
+            "arena->end = arena->chunk->data + arena->chunk->capacity;}"
+            // the newest chunk is kept rather than the first, so a workload that outgrew the first
+            // chunk fits in one from then on.
+            "static inline void arena_reset(struct __rm_arena *arena) {"
+            "__rm_arena_note_peak(arena); arena->resets++;"
+            "if (arena->chunk == NULL) return;"
+            "struct __rm_arena_chunk *chunk = arena->chunk->previous;"
+            "while (chunk != NULL) {struct __rm_arena_chunk *previous = chunk->previous; free(chunk); chunk = previous;}"
+            "arena->chunk->previous = NULL; arena->chunk->start = 0;"
+            "arena->cursor = arena->chunk->data; arena->end = arena->chunk->data + arena->chunk->capacity;}"
+            "static inline void arena_free(struct __rm_arena *arena) {"
+            "struct __rm_arena_chunk *chunk = arena->chunk;"
+            "while (chunk != NULL) {struct __rm_arena_chunk *previous = chunk->previous; free(chunk); chunk = previous;}"
+            "free(arena);}"
+            "static inline void arena_report(struct __rm_arena *arena) {"
+            "__rm_arena_note_peak(arena);"
+            "fprintf(stderr, \"arena %%p: %%zu allocations, %%zu bytes, %%zu in use, %%zu peak, %%zu chunks, %%zu resets\\n\","
+            "(void *)arena, arena->allocations, arena->bytes, arena_mark(arena), arena->peak, arena->chunks, arena->resets);}\n");
+}
+
+// `__rm_parallel_for` splits a range between the calling thread and a pool of workers, started on
+// the first call, one per further CPU or `RM_THREADS` in all. Each thread takes chunks from the
+// front of its own share, and when that runs out steals the back half of another's. A loop run
+// from within another's iterations runs on the thread it's called from.
+void write_parallel_runtime(FILE *header)
+{
+    fprintf(header,
+            "#include <pthread.h>\n"
+            "#define __RM_MAX_THREADS 64\n"
+            "typedef void (*__rm_parallel_body)(void *captured, size_t begin, size_t end);"
+            "struct __rm_share {pthread_mutex_t lock; size_t next; size_t end;} __attribute__((aligned(64)));"
+            "static struct {pthread_mutex_t lock; pthread_cond_t start; pthread_cond_t done;"
+            "int started; size_t workers; size_t generation; size_t running;"
+            "__rm_parallel_body body; void *captured; size_t chunk;"
+            "struct __rm_share shares[__RM_MAX_THREADS];} __rm_pool = {"
+            ".lock = PTHREAD_MUTEX_INITIALIZER, .start = PTHREAD_COND_INITIALIZER, .done = PTHREAD_COND_INITIALIZER};"
+            "static __thread int __rm_in_parallel;"
+            "static inline int __rm_take(size_t self, size_t *begin, size_t *end) {"
+            "struct __rm_share *share = &__rm_pool.shares[self]; int taken = 0;"
+            "pthread_mutex_lock(&share->lock);"
+            "if (share->next < share->end) {"
+            "*begin = share->next;"
+            "*end = share->end - share->next > __rm_pool.chunk ? share->next + __rm_pool.chunk : share->end;"
+            "share->next = *end; taken = 1;}"
+            "pthread_mutex_unlock(&share->lock); return taken;}"
+            "static inline int __rm_steal(size_t self, size_t victim) {"
+            "struct __rm_share *share = &__rm_pool.shares[victim]; size_t begin = 0, end = 0;"
+            "pthread_mutex_lock(&share->lock);"
+            "size_t left = share->end - share->next;"
+            "if (left > 0) {size_t half = left > __rm_pool.chunk ? left / 2 : left;"
+            "begin = share->end - half; end = share->end; share->end = begin;}"
+            "pthread_mutex_unlock(&share->lock);"
+            "if (begin == end) return 0;"
+            "struct __rm_share *own = &__rm_pool.shares[self];"
+            "pthread_mutex_lock(&own->lock); own->next = begin; own->end = end; pthread_mutex_unlock(&own->lock);"
+            "return 1;}"
+            "static inline void __rm_parallel_work(size_t self) {"
+            "size_t threads = __rm_pool.workers + 1;"
+            "for (;;) {size_t begin, end;"
+            "if (__rm_take(self, &begin, &end)) {__rm_pool.body(__rm_pool.captured, begin, end); continue;}"
+            "int stolen = 0;"
+            "for (size_t i = 1; i < threads && !stolen; i++) stolen = __rm_steal(self, (self + i) %% threads);"
+            "if (!stolen) return;}}"
+            "static inline void *__rm_worker(void *argument) {"
+            "size_t self = (size_t)argument; size_t seen = 0; __rm_in_parallel = 1;"
+            "pthread_mutex_lock(&__rm_pool.lock);"
+            "for (;;) {"
+            "while (__rm_pool.generation == seen) pthread_cond_wait(&__rm_pool.start, &__rm_pool.lock);"
+            "seen = __rm_pool.generation; pthread_mutex_unlock(&__rm_pool.lock);"
+            "__rm_parallel_work(self);"
+            "pthread_mutex_lock(&__rm_pool.lock);"
+            "if (--__rm_pool.running == 0) pthread_cond_signal(&__rm_pool.done);}"
+            "return NULL;}"
+            "static inline void __rm_start_pool(void) {"
+            "long threads = sysconf(_SC_NPROCESSORS_ONLN);"
+            "char *requested = getenv(\"RM_THREADS\");"
+            "if (requested != NULL && atol(requested) > 0) threads = atol(requested);"
+            "if (threads < 1) threads = 1;"
+            "if (threads > __RM_MAX_THREADS) threads = __RM_MAX_THREADS;"
+            "for (size_t i = 0; i < __RM_MAX_THREADS; i++) pthread_mutex_init(&__rm_pool.shares[i].lock, NULL);"
+            "for (long i = 1; i < threads; i++) {pthread_t thread;"
+            "if (pthread_create(&thread, NULL, __rm_worker, (void *)(size_t)i) != 0) break;"
+            "pthread_detach(thread); __rm_pool.workers++;}"
+            "__rm_pool.started = 1;}"
+            "static inline void __rm_parallel_for(__rm_parallel_body body, void *captured, size_t count) {"
+            "if (count == 0) return;"
+            "if (__rm_in_parallel) {body(captured, 0, count); return;}"
+            "pthread_mutex_lock(&__rm_pool.lock);"
+            "if (!__rm_pool.started) __rm_start_pool();"
+            "size_t threads = __rm_pool.workers + 1;"
+            "if (threads == 1 || count == 1) {pthread_mutex_unlock(&__rm_pool.lock); body(captured, 0, count); return;}"
+            // chunks small enough to even out, big enough that taking one costs little beside it.
+            "__rm_pool.chunk = count / (threads * 8) > 0 ? count / (threads * 8) : 1;"
+            "for (size_t i = 0; i < threads; i++) {"
+            "__rm_pool.shares[i].next = count / threads * i;"
+            "__rm_pool.shares[i].end = i + 1 == threads ? count : count / threads * (i + 1);}"
+            "__rm_pool.body = body; __rm_pool.captured = captured;"
+            "__rm_pool.running = __rm_pool.workers; __rm_pool.generation++;"
+            "pthread_cond_broadcast(&__rm_pool.start); pthread_mutex_unlock(&__rm_pool.lock);"
+            "__rm_in_parallel = 1; __rm_parallel_work(0); __rm_in_parallel = 0;"
+            "pthread_mutex_lock(&__rm_pool.lock);"
+            "while (__rm_pool.running > 0) pthread_cond_wait(&__rm_pool.done, &__rm_pool.lock);"
+            "pthread_mutex_unlock(&__rm_pool.lock);}\n");
+}
+
+int mentions_primitive(struct type *ty, int (*matches)(enum primitive_type))
+{
+    if (ty->kind == TY_PRIMITIVE) return matches(ty->primitive_type);
+    if (ty->kind != TY_FUNCTION) return 0;
+    for (size_t i = 0; i < ty->function_type.params.size; i++) {
+        if (mentions_primitive(ty->function_type.params.data[i].field_type, matches)) return 1;
+    }
+    return mentions_primitive(ty->function_type.return_type, matches);
+}
+
+// Whether any function, data type or expression has a primitive `matches` picks out.
+int uses_primitive(struct global_context *global_context,
+                   struct context *context,
+                   int (*matches)(enum primitive_type))
+{
+    for (size_t i = 0; i < global_context->fn_types.size; i++) {
+        if (mentions_primitive(&global_context->fn_types.data[i], matches)) return 1;
+    }
+    for (size_t i = 0; i < global_context->data_types.size; i++) {
+        struct type *data_type = &global_context->data_types.data[i];
+        struct list_key_type_pair *pairs = data_type->kind == TY_STRUCT
+            ? &data_type->struct_type.pairs
+            : &data_type->enum_type.pairs;
+        for (size_t j = 0; j < pairs->size; j++) {
+            if (pairs->data[j].field_type != NULL && mentions_primitive(pairs->data[j].field_type, matches)) {
+                return 1;
+            }
+        }
+    }
+    struct list_int *keys = context->expression_type_lookup.keys;
+    for (size_t i = 0; i < keys->size; i++) {
+        if (mentions_primitive(&lut_get(&context->expression_type_lookup, keys->data[i]), matches)) return 1;
+    }
+    return 0;
+}
+
+int is_arena_primitive(enum primitive_type primitive)
+{
+    return primitive == ARENA;
+}
+
+// Each vector primitive is a GCC vector of its lanes.
+void write_vector_types(FILE *header)
+{
+    enum primitive_type vectors[] = { F32X4, F32X8, I32X4, I32X8, U8X16, U8X32 };
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(*vectors); i++) {
+        struct type element = { .kind = TY_PRIMITIVE, .primitive_type = vector_element(vectors[i]) };
+        struct layout layout = {0};
+        type_layout(&element, lowering.global_context, &layout);
+        fprintf(header, "typedef ");
+        write_type(&element, header);
+        fprintf(header,
+                " __rm_%s __attribute__((vector_size(%zu)));",
+                vector_name(vectors[i]),
+                layout.size * vector_lanes(vectors[i]));
+    }
+    fprintf(header, "\n");
+}
+
+// The vector functions called are defined in the header, loads and stores are checked against the
+// slice like an index is.
+void write_vector_function(struct type *fn, FILE *header)
+{
+    enum primitive_type vector = 0;
+    char *operation = NULL;
+    vector_function(fn->name, &vector, &operation);
+    size_t lanes = vector_lanes(vector);
+
+    fprintf(header, "static inline ");
+    write_function_type(fn, header);
+    if (!strcmp(operation, "splat")) {
+        fprintf(header, "{return (__rm_%s){0} + value;}", vector_name(vector));
+    } else if (!strcmp(operation, "load")) {
+        fprintf(header,
+                "{__checked_index(at + %zu, from.len); __rm_%s out; memcpy(&out, from.data + at, sizeof(out)); return out;}",
+                lanes - 1,
+                vector_name(vector));
+    } else if (!strcmp(operation, "store")) {
+        fprintf(header,
+                "{__checked_index(at + %zu, to.len); memcpy(to.data + at, &vector, sizeof(vector));}",
+                lanes - 1);
+    } else if (!strcmp(operation, "shuffle")) {
+        fprintf(header, "{return __builtin_shuffle(vector, mask);}");
+    } else {
+        struct type element = { .kind = TY_PRIMITIVE, .primitive_type = vector_element(vector) };
+        char *combine = !strcmp(operation, "sum") ? "out += vector[i];"
+            : !strcmp(operation, "min") ? "if (vector[i] < out) out = vector[i];"
+            : "if (vector[i] > out) out = vector[i];";
+        fprintf(header, "{");
+        write_type(&element, header);
+        fprintf(header, " out = vector[0]; for (size_t i = 1; i < %zu; i++) {%s} return out;}", lanes, combine);
+    }
+    fprintf(header, "\n");
+}
+
+// Defines a struct or enum after those it holds by value, which C needs complete first. An async
+// fn's task is declared after the user's types but can be held by them, and holds their values.
+void define_data_type(size_t index, int *written, struct list_defined_struct *defined, FILE *header)
+{
+    struct global_context *global_context = lowering.global_context;
+    if (written[index]) return;
+    written[index] = 1;
+
+    struct type *data_type = &global_context->data_types.data[index];
+    struct list_key_type_pair *pairs = data_type->kind == TY_STRUCT
+        ? &data_type->struct_type.pairs
+        : &data_type->enum_type.pairs;
+    for (size_t i = 0; i < pairs->size; i++) {
+        struct type *field_type = pairs->data[i].field_type;
+        int held = field_type->kind == TY_STRUCT || field_type->kind == TY_ENUM;
+        for (size_t j = 0; j < field_type->modifiers.size; j++) {
+            enum type_modifier_kind kind = field_type->modifiers.data[j].kind;
+            if (kind == POINTER_MODIFIER_KIND || kind == SLICE_MODIFIER_KIND) held = 0;
+        }
+        // the struct of a `#[soa]` array is defined with the field, behind a pointer or not.
+        if (has_soa_array(field_type)) held = 1;
+        for (size_t j = 0; held && j < global_context->data_types.size; j++) {
+            if (list_char_eq(global_context->data_types.data[j].name, field_type->name)) {
+                define_data_type(j, written, defined, header);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < pairs->size; i++) {
+        define_generated_structs(pairs->data[i].field_type, defined, header);
+    }
+    if (data_type->kind == TY_STRUCT) {
+        write_struct_type(data_type, 1, header);
+    } else if (data_type->kind == TY_ENUM) {
+        write_enum_type(data_type, 1, header);
+    } else {
+        UNREACHABLE("generating data types in c header");
+    }
+    write_size_assertion(data_type, global_context, header);
+}
+
+// A task's `resume` is defined with its async fn, `result` only reads the frame.
+void write_task_method(struct type *fn, char *method, FILE *header)
+{
+    if (!strcmp(method, "resume")) {
+        write_function_type(fn, header);
+        fprintf(header, ";");
+        return;
+    }
+    fprintf(header, "static inline ");
+    write_function_type(fn, header);
+    fprintf(header, is_void_type(fn->function_type.return_type) ? "{(void)task;}" : "{return task->__rm_result;}");
 }
 
-void generate_c_header(struct parsed_file *parsed_file)
+void generate_c_header(struct parsed_file *parsed_file, struct context *context)
 {
     struct global_context *global_context = &parsed_file->global_context;
     FILE *header = fopen("target/c_output.h", "w");
     fprintf(header, "#ifndef C_OUTPUT_H\n#define C_OUTPUT_H\n");
+    fprintf(header, "#include <stdatomic.h>\n");
+    fprintf(header, "#include <stdbool.h>\n");
+    fprintf(header, "#include <stdint.h>\n");
     fprintf(header, "#include <stdio.h>\n");
     fprintf(header, "#include <stdlib.h>\n");
+    fprintf(header, "#include <string.h>\n");
     fprintf(header, "#include <unistd.h>\n");
+    // indexes out of bounds abort, unless the C is compiled with `-DRM_UNCHECKED`.
+    fprintf(header,
+            "static inline size_t __checked_index(size_t index, size_t length) {"
+            "\n#ifndef RM_UNCHECKED\n"
+            "if (__builtin_expect(index >= length, 0)) abort();"
+            "\n#endif\n"
+            "return index;}\n");
+
+    // a struct can hold an arena by value without any arena function being reached.
+    if (uses_primitive(global_context, context, is_arena_primitive)) {
+        write_arena_runtime(header);
+    }
+    if (uses_primitive(global_context, context, is_vector_primitive)) {
+        write_vector_types(header);
+    }
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        if (has_parallel_loop(&parsed_file->statements.data[i])) {
+            write_parallel_runtime(header);
+            break;
+        }
+    }
 
+    // nullable and slice structs are defined ahead of the first type that holds them.
+    struct list_defined_struct defined = list_create(defined_struct, 10);
+    int *written = calloc(global_context->data_types.size + 1, sizeof(int));
     for (size_t i = 0; i < global_context->data_types.size; i++) {
-        struct type data_type = global_context->data_types.data[i];
-        if (data_type.kind == TY_STRUCT) {
-            write_struct_type(&global_context->data_types.data[i], 1, header);
-        } else if (data_type.kind == TY_ENUM) {
-            write_enum_type(&global_context->data_types.data[i], 1, header);
-        } else {
-            UNREACHABLE("generating data types in c header");
+        define_data_type(i, written, &defined, header);
+    }
+
+    for (size_t i = 0; i < global_context->fn_types.size; i++) {
+        struct function_type *function_type = &global_context->fn_types.data[i].function_type;
+        define_generated_structs(function_type->return_type, &defined, header);
+        for (size_t j = 0; j < function_type->params.size; j++) {
+            define_generated_structs(function_type->params.data[j].field_type, &defined, header);
         }
     }
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        define_statement_structs(&parsed_file->statements.data[i], &defined, header);
+    }
+    for (size_t i = 0; i < context->expression_type_lookup.keys->size; i++) {
+        int key = context->expression_type_lookup.keys->data[i];
+        define_generated_structs(&lut_get(&context->expression_type_lookup, key), &defined, header);
+    }
 
     for (size_t i = 0; i < global_context->fn_types.size; i++) {
-        write_function_type(&global_context->fn_types.data[i], header);
+        struct type *fn = &global_context->fn_types.data[i];
+        enum primitive_type vector = 0;
+        char *operation = NULL;
+        // the arena functions are defined by the runtime above, the vector ones once their slices
+        // are, and the atomic ones are written as `stdatomic.h` calls where they're called.
+        if (is_arena_function(fn->name) || atomic_function(fn->name, &vector, &operation)) continue;
+        if (vector_function(fn->name, &vector, &operation)) {
+            write_vector_function(fn, header);
+            continue;
+        }
+        if (task_method(fn->name, global_context, &operation) != NULL) {
+            write_task_method(fn, operation, header);
+            continue;
+        }
+        write_function_attributes(fn, 0, header);
+        write_function_type(fn, header);
         fprintf(header, ";");
     }
 
     fprintf(header, "\n#endif");
+    fclose(header);
+}
+
+// Maps each line of c_output.c that starts a statement to the rm it came from, for tools that read
+// the C rather than its `#line` directives.
+void write_source_map(void)
+{
+    FILE *c_file = fopen("target/c_output.c", "r");
+    FILE *map = fopen("target/c_output.map.json", "w");
+    fprintf(map, "{\"version\": 1, \"file\": \"c_output.c\", \"mappings\": [");
+
+    struct list_source_mapping *mappings = &lowering.source_mappings;
+    size_t line = 1;
+    long offset = 0;
+    size_t next = 0;
+    while (next < mappings->size) {
+        if (mappings->data[next].offset == offset) {
+            struct statement_metadata metadata = mappings->data[next].metadata;
+            fprintf(map, "%s\n{\"line\": %zu, \"source\": \"", next == 0 ? "" : ",", line);
+            write_escaped(metadata.file_name, map);
+            fprintf(map, "\", \"row\": %u, \"col\": %u}", metadata.row, metadata.col + 1);
+            next++;
+            continue;
+        }
+
+        int c = fgetc(c_file);
+        if (c == EOF) break;
+        if (c == '\n') line++;
+        offset++;
+    }
+
+    fprintf(map, "\n]}\n");
+    fclose(map);
+    fclose(c_file);
 }
 
 void generate_c(struct parsed_file *parsed_file,
-                struct context *context)
+                struct context *context,
+                struct c_options *options)
 {
-    // TODO
-    // generate_c_header(parsed_file);
-    // generate_c_file(parsed_file, context);
+    mkdir("target", 0755);
+    lowering.global_context = &parsed_file->global_context;
+    lowering.options = options;
+    lowering.source_mappings = list_create(source_mapping, 64);
+    lowering.profiled_functions = 0;
+    lowering.counted = list_create(int, 64);
+    generate_c_header(parsed_file, context);
+    generate_c_file(parsed_file, context);
+    write_source_map();
 }
@@ -4,7 +4,16 @@
 #include "../context.h"
 #include "../parser.h"
 
+struct c_options {
+    // wraps every function in hooks that count its calls and time them, reported at exit.
+    int instrument;
+    // with `--pgo`, the file the training build appends how often each `if` went either way and
+    // each function was called to, as `<statement id> <hits> <misses>` lines.
+    char *branch_profile;
+};
+
 void generate_c(struct parsed_file *parsed_file,
-                struct context *context);
+                struct context *context,
+                struct c_options *options);
 
 #endif
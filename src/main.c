@@ -3,14 +3,33 @@
 #include "lexer.h"
 #include "error.h"
 #include "context.h"
+#include "constant_folding.h"
+#include "tail_calls.h"
+#include "layout.h"
+#include "arena.h"
+#include "vectors.h"
+#include "atomics.h"
+#include "coroutines.h"
 #include "soundness.h"
 #include "type_checker.h"
+#include "qualifiers.h"
+#include "reachability.h"
 #include "lowering/c.h"
+#include "pgo.h"
 #include <sys/time.h>
 #include <unistd.h>
 
-int compile(char *file_name, struct error *error)
+struct compile_options {
+    char *file_name;
+    int layout_report;
+    int instrument;
+    // with `--pgo <command>`, the command that exercises `target/bin/<name>` to profile it.
+    char *training_command;
+};
+
+int compile(struct compile_options *options, struct error *error)
 {
+    char *file_name = options->file_name;
     FILE *f = fopen(file_name, "r");
     if (f == NULL) {
         write_raw_error(stderr, "input file not found.");
@@ -22,10 +41,37 @@ int compile(char *file_name, struct error *error)
     struct context c = {0};
 
     if (!parse_file(&tb, &parsed, error))     return 0;
+    if (!fold_constants(&parsed, error))      return 0;
+    if (!eliminate_tail_calls(&parsed, error)) return 0;
+    mark_soa_arrays(&parsed);
+    if (!lay_out_structs(&parsed, options->layout_report ? stdout : NULL, error)) return 0;
+    declare_arena_functions(&parsed.global_context);
+    declare_vector_functions(&parsed.global_context);
+    declare_atomic_functions(&parsed.global_context);
+    declare_async_tasks(&parsed.global_context);
     if (!contextualise(&parsed, &c, error))   return 0;
     if (!soundness_check(&parsed, &c, error)) return 0;
     if (!type_check(&parsed, &c, error))      return 0;
-    generate_c(&parsed, &c);
+    if (!lay_out_frames(&parsed, &c, error))  return 0;
+    eliminate_unreachable(&parsed, &c);
+    qualify_pointer_parameters(&parsed);
+    choose_struct_passing(&parsed, &c);
+    qualify_element_pointers(&parsed, &c);
+    struct c_options c_options = { .instrument = options->instrument };
+    // a first training run counts the branches, so the C profiled by GCC already has their hints.
+    if (options->training_command != NULL) {
+        c_options.branch_profile = branch_profile_path();
+        if (c_options.branch_profile == NULL) {
+            write_raw_error(stderr, "the working directory couldn't be read for the branch profile.");
+            return 0;
+        }
+        generate_c(&parsed, &c, &c_options);
+        if (!apply_branch_profile(&parsed, file_name, options->training_command, c_options.branch_profile)) {
+            return 0;
+        }
+        c_options.branch_profile = NULL;
+    }
+    generate_c(&parsed, &c, &c_options);
 
     return 1;
 }
@@ -33,16 +79,42 @@ int compile(char *file_name, struct error *error)
 int main(int argc, char **argv)
 {
     struct error error = {0};
+    struct compile_options options = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--layout-report")) {
+            options.layout_report = 1;
+        } else if (!strcmp(argv[i], "--instrument")) {
+            options.instrument = 1;
+        } else if (!strcmp(argv[i], "--pgo")) {
+            if (i + 1 >= argc) {
+                write_raw_error(stderr, "--pgo needs a training command.");
+                return 1;
+            }
+            options.training_command = argv[++i];
+        } else if (argv[i][0] == '-') {
+            write_raw_error(stderr, "unknown option.");
+            return 1;
+        } else {
+            options.file_name = argv[i];
+        }
+    }
 
-    if (argc <= 1 || !strcmp(argv[1], "")) {
+    if (options.file_name == NULL || !strcmp(options.file_name, "")) {
         write_raw_error(stderr, "no input file provided.");
         return 1;
     }
 
-    if (!compile(argv[1], &error)) {
+    if (!compile(&options, &error)) {
         write_error(stderr, &error);
         return 1;
     }
 
+    if (options.training_command != NULL
+        && !build_with_profile(options.file_name, options.training_command))
+    {
+        return 1;
+    }
+
     return 0;
 }
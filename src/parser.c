@@ -75,6 +75,13 @@ int is_primitive(struct list_char *raw, enum primitive_type *out)
 		case USIZE:
 		case F32:
 		case F64:
+		case ARENA:
+		case F32X4:
+		case F32X8:
+		case I32X4:
+		case I32X8:
+		case U8X16:
+		case U8X32:
             *out = hash;
             return 1;
         default:
@@ -118,6 +125,8 @@ int parse_nullable_type_modifier(struct parser_state *s,
     return 1;
 }
 
+int parse_expression(struct parser_state *s, struct expression *out, struct error *error);
+
 int parse_array_type_modifier(struct parser_state *s,
                               struct type_modifier *out,
                               struct error *error)
@@ -127,7 +136,15 @@ int parse_array_type_modifier(struct parser_state *s,
     int literally_sized = 0;
     int reference_sized = 0;
     struct list_char *reference_name = NULL;
+    struct expression *size_expression = NULL;
     if (!get_token_type(s->buffer, &tmp, OPEN_SQUARE_PAREN))  return 0;
+    if (get_token_type(s->buffer, &tmp, CLOSE_SQUARE_PAREN)) {
+        *out = (struct type_modifier) {
+            .kind = SLICE_MODIFIER_KIND
+        };
+        return 1;
+    }
+
     if (get_token_type(s->buffer, &tmp, NUMERIC)) {
         literally_sized = 1;
         literal_size = (int)tmp.numeric; // TODO: numeric token needs improving
@@ -135,14 +152,27 @@ int parse_array_type_modifier(struct parser_state *s,
         reference_sized = 1;
         reference_name = tmp.identifier;
     }
-    if (!get_token_type(s->buffer, &tmp, CLOSE_SQUARE_PAREN)) return 0;
+
+    if (!get_token_type(s->buffer, &tmp, CLOSE_SQUARE_PAREN)) {
+        // not a plain size, e.g `[4 * N]`, which constant folding has to resolve.
+        if (!literally_sized && !reference_sized) return 0;
+        seek_back_token(s->buffer, 1);
+        literally_sized = 0;
+        reference_sized = 0;
+        reference_name = NULL;
+        size_expression = malloc(sizeof(*size_expression));
+        if (!parse_expression(s, size_expression, error))          return 0;
+        if (!get_token_type(s->buffer, &tmp, CLOSE_SQUARE_PAREN)) return 0;
+    }
+
     *out = (struct type_modifier) {
         .kind = ARRAY_MODIFIER_KIND,
         .array_modifier = (struct array_type_modifier) {
             .literal_size = literal_size,
             .literally_sized = literally_sized,
             .reference_sized = reference_sized,
-            .reference_name = reference_name
+            .reference_name = reference_name,
+            .size_expression = size_expression
         }
     };
 
@@ -162,12 +192,26 @@ int parse_mutable_type_modifier(struct parser_state *s,
     return 1;
 }
 
+int parse_atomic_type_modifier(struct parser_state *s,
+                               struct type_modifier *out,
+                               struct error *error)
+{
+    struct token tmp = {0};
+    if (!get_token_type(s->buffer, &tmp, ATOMIC_KEYWORD)) return 0;
+    *out = (struct type_modifier) {
+        .kind = ATOMIC_MODIFIER_KIND,
+    };
+
+    return 1;
+}
+
 int parse_type_modifier(struct parser_state *s, struct type_modifier *out, struct error *error)
 {
     return try_parse(s, out, error, (parser_t)parse_pointer_type_modifier)
         || try_parse(s, out, error, (parser_t)parse_nullable_type_modifier)
         || try_parse(s, out, error, (parser_t)parse_array_type_modifier)
-        || try_parse(s, out, error, (parser_t)parse_mutable_type_modifier);
+        || try_parse(s, out, error, (parser_t)parse_mutable_type_modifier)
+        || try_parse(s, out, error, (parser_t)parse_atomic_type_modifier);
 }
 
 struct list_type_modifier parse_modifiers(struct parser_state *s, struct error *error)
@@ -498,9 +542,17 @@ int parse_struct_enum_literal_expression(struct parser_state *s,
         struct key_expression pair = {0};
         if (!get_token_type(s->buffer, &tmp, IDENTIFIER)) return 0;
         pair.key = tmp.identifier;
-        if (!get_token_type(s->buffer, &tmp, EQ)) return 0;
         struct expression *e = malloc(sizeof(*e));
-        if (!parse_expression(s, e, error)) return 0;
+        if (kind == LITERAL_ENUM && !get_token_type(s->buffer, &tmp, EQ)) {
+            // a variant without a payload, `enum message { quit }`.
+            *e = (struct expression) {
+                .id = s->next_expression_id++,
+                .kind = VOID_EXPRESSION
+            };
+        } else {
+            if (kind == LITERAL_STRUCT && !get_token_type(s->buffer, &tmp, EQ)) return 0;
+            if (!parse_expression(s, e, error)) return 0;
+        }
         pair.expression = e;
         list_append(&pairs, pair);
         should_continue = get_token_type(s->buffer, &tmp, COMMA);
@@ -565,6 +617,11 @@ int parse_unary_operator(struct token_buffer *s,
         return 1;
     }
 
+    if (get_token_type(s, &tmp, AWAIT_KEYWORD)) {
+        *out = AWAIT_UNARY;
+        return 1;
+    }
+
     return 0;
 }
 
@@ -627,17 +684,10 @@ int parse_binary_operator(struct token_buffer *s, enum binary_operator *out, str
     return 0;
 }
 
-int parse_function_expression(struct parser_state *s,
-                              struct function_expression *out,
-                              struct error *error)
+// The comma separated values of a call, following its `(`.
+int parse_call_arguments(struct parser_state *s, struct list_expression *params, struct error *error)
 {
     struct token tmp = {0};
-    struct token name = {0};
-    if (!get_token_type(s->buffer, &name, IDENTIFIER))      return 0;
-    if (!get_token_type(s->buffer, &tmp, OPEN_ROUND_PAREN)) return 0;
-
-    struct list_expression *params = malloc(sizeof(*params));
-    *params = list_create(expression, 10);
     int should_continue = 1;
 
     while (should_continue) {
@@ -653,6 +703,22 @@ int parse_function_expression(struct parser_state *s,
         return 0;
     }
 
+    return 1;
+}
+
+int parse_function_expression(struct parser_state *s,
+                              struct function_expression *out,
+                              struct error *error)
+{
+    struct token tmp = {0};
+    struct token name = {0};
+    if (!get_token_type(s->buffer, &name, IDENTIFIER))      return 0;
+    if (!get_token_type(s->buffer, &tmp, OPEN_ROUND_PAREN)) return 0;
+
+    struct list_expression *params = malloc(sizeof(*params));
+    *params = list_create(expression, 10);
+    if (!parse_call_arguments(s, params, error)) return 0;
+
     *out = (struct function_expression) {
         .function_name = name.identifier,
         .params = params
@@ -661,14 +727,18 @@ int parse_function_expression(struct parser_state *s,
     return 1;
 }
 
+int parse_postfix_expression(struct parser_state *s, struct expression *l, struct error *error);
+
 int parse_expression_inner(struct parser_state *s, struct expression *out, struct error *error)
 {
     struct token tmp = {0};
     enum unary_operator unary_op;
 
+    // postfix binds tighter, `!t.resume()` is `!(t.resume())`, as in C.
     if (parse_unary_operator(s->buffer, &unary_op)) {
         struct expression *nested = malloc(sizeof(*nested));
         if (!parse_expression_inner(s, nested, error)) return 0;
+        if (!parse_postfix_expression(s, nested, error)) return 0;
 
         *out = (struct expression) {
             .kind = UNARY_EXPRESSION,
@@ -716,27 +786,89 @@ int parse_expression_inner(struct parser_state *s, struct expression *out, struc
     return 0;
 }
 
-int parse_member_access_expression(struct parser_state *s,
-                                   struct expression *l,
-                                   struct expression *out,
-                                   struct error *error)
+// `..`, between the start and end of a range.
+int peek_range(struct parser_state *s)
+{
+    struct token tmp = {0};
+    if (!get_token_type(s->buffer, &tmp, DOT)) return 0;
+    int is_range = peek_token_type(s->buffer, DOT);
+    seek_back_token(s->buffer, 1);
+    return is_range;
+}
+
+int parse_range(struct parser_state *s)
 {
     struct token tmp = {0};
-    int succeeded = 0;
-    while (get_token_type(s->buffer, &tmp, DOT) && get_token_type(s->buffer, &tmp, IDENTIFIER))
-    {
-        succeeded = 1;
+    if (!peek_range(s)) return 0;
+    get_token_type(s->buffer, &tmp, DOT);
+    get_token_type(s->buffer, &tmp, DOT);
+    return 1;
+}
+
+// any chain of `.field`, `[index]` and `[start..end]` following an expression.
+int parse_postfix_expression(struct parser_state *s, struct expression *l, struct error *error)
+{
+    struct token tmp = {0};
+    for (;;) {
+        if (peek_range(s)) break;
+        if (!peek_token_type(s->buffer, DOT) && !peek_token_type(s->buffer, OPEN_SQUARE_PAREN)) break;
+
         struct expression *g = malloc(sizeof(*g));
         struct expression *cpy_l = malloc(sizeof(*cpy_l));
         *cpy_l = *l;
-        *g = (struct expression) {
-            .kind = MEMBER_ACCESS_EXPRESSION,
-            .id = s->next_expression_id++,
-            .member_access = (struct member_access_expression) {
-                .accessed = cpy_l,
-                .member_name = tmp.identifier
+        if (get_token_type(s->buffer, &tmp, DOT)) {
+            if (!get_token_type(s->buffer, &tmp, IDENTIFIER)) {
+                add_error_inner(s->buffer, error, "expected a field name after `.`.");
+                return 0;
             }
-        };
+            struct list_char *member_name = tmp.identifier;
+            if (get_token_type(s->buffer, &tmp, OPEN_ROUND_PAREN)) {
+                // `x.f(y)`, a call with `x` first.
+                struct list_expression *params = malloc(sizeof(*params));
+                *params = list_create(expression, 10);
+                list_append(params, *cpy_l);
+                if (!parse_call_arguments(s, params, error)) return 0;
+                *g = (struct expression) {
+                    .kind = FUNCTION_EXPRESSION,
+                    .id = s->next_expression_id++,
+                    .function = (struct function_expression) {
+                        .function_name = member_name,
+                        .params = params,
+                        .method_call = 1
+                    }
+                };
+            } else {
+                *g = (struct expression) {
+                    .kind = MEMBER_ACCESS_EXPRESSION,
+                    .id = s->next_expression_id++,
+                    .member_access = (struct member_access_expression) {
+                        .accessed = cpy_l,
+                        .member_name = member_name
+                    }
+                };
+            }
+        } else if (get_token_type(s->buffer, &tmp, OPEN_SQUARE_PAREN)) {
+            struct expression *index = malloc(sizeof(*index));
+            struct expression *end = NULL;
+            if (!parse_expression(s, index, error)) return 0;
+            if (parse_range(s)) {
+                end = malloc(sizeof(*end));
+                if (!parse_expression(s, end, error)) return 0;
+            }
+            if (!get_token_type(s->buffer, &tmp, CLOSE_SQUARE_PAREN)) {
+                add_error_inner(s->buffer, error, "expected a `]` to close the index.");
+                return 0;
+            }
+            *g = (struct expression) {
+                .kind = INDEX_EXPRESSION,
+                .id = s->next_expression_id++,
+                .index = (struct index_expression) {
+                    .indexed = cpy_l,
+                    .index = index,
+                    .end = end
+                }
+            };
+        }
 
         *l = (struct expression) {
             .kind = GROUP_EXPRESSION,
@@ -745,29 +877,69 @@ int parse_member_access_expression(struct parser_state *s,
         };
     }
 
-    if (succeeded) {
-        *out = *l;
+    return 1;
+}
+
+// Mirrors C's precedence table, since binary expressions are lowered verbatim.
+int binary_operator_precedence(enum binary_operator op)
+{
+    switch (op) {
+        case MULTIPLY_BINARY:
+            return 10;
+        case PLUS_BINARY:
+        case MINUS_BINARY:
+            return 9;
+        case GREATER_THAN_BINARY:
+        case LESS_THAN_BINARY:
+            return 7;
+        case EQUAL_TO_BINARY:
+            return 6;
+        case BITWISE_AND_BINARY:
+            return 5;
+        case BITWISE_OR_BINARY:
+            return 3;
+        case AND_BINARY:
+            return 2;
+        case OR_BINARY:
+            return 1;
+        case ASSIGN_BINARY:
+            return 0;
     }
 
-    return succeeded;
+    UNREACHABLE("binary_operator_precedence fell out of a switch");
 }
 
-int parse_expression(struct parser_state *s, struct expression *out, struct error *error)
+int parse_binary_expression(struct parser_state *s,
+                            struct expression *out,
+                            int min_precedence,
+                            struct error *error)
 {
     enum binary_operator op;
-    int parsed_left = 0;
     struct expression *l = malloc(sizeof(*l));
-    struct expression *r = malloc(sizeof(*r));
 
-    if (parse_expression_inner(s, l, error)) {
-        parsed_left = 1;
-    } else {
-        return 0;
-    }
+    if (!parse_expression_inner(s, l, error)) return 0;
+    if (!parse_postfix_expression(s, l, error)) return 0;
 
-    if (peek_token_type(s->buffer, DOT) && !parse_member_access_expression(s, l, out, error)) return 0;
-    if (parse_binary_operator(s->buffer, &op, error) && parse_expression(s, r, error)) {
-        *out = (struct expression) {
+    for (;;) {
+        size_t start = s->buffer->current_position;
+        if (!parse_binary_operator(s->buffer, &op, error)) break;
+
+        int precedence = binary_operator_precedence(op);
+        if (precedence < min_precedence) {
+            seek_back_token(s->buffer, s->buffer->current_position - start);
+            break;
+        }
+
+        // assignment is the only right associative operator.
+        int next_precedence = op == ASSIGN_BINARY ? precedence : precedence + 1;
+        struct expression *r = malloc(sizeof(*r));
+        if (!parse_binary_expression(s, r, next_precedence, error)) {
+            seek_back_token(s->buffer, s->buffer->current_position - start);
+            break;
+        }
+
+        struct expression *combined = malloc(sizeof(*combined));
+        *combined = (struct expression) {
             .kind = BINARY_EXPRESSION,
             .id = s->next_expression_id++,
             .binary = (struct binary_expression) {
@@ -776,15 +948,16 @@ int parse_expression(struct parser_state *s, struct expression *out, struct erro
                 .r = r
             }
         };
-        return 1;
+        l = combined;
     }
 
-    if (parsed_left) {
-        *out = *l;
-        return 1;
-    }
+    *out = *l;
+    return 1;
+}
 
-    return 0;
+int parse_expression(struct parser_state *s, struct expression *out, struct error *error)
+{
+    return parse_binary_expression(s, out, 0, error);
 }
 
 int parse_switch_pattern(struct parser_state *s, struct switch_pattern *out, struct error *error);
@@ -905,14 +1078,25 @@ int parse_key_pattern_pair(struct parser_state *s,
         return 1;
     }
     key = *tmp.identifier;
-    if (!get_token_type(s->buffer, &tmp, COLON)) return 0;
-    if (parse_switch_pattern(s, pattern, error)) return 0;
+    // `{ field }` binds the field to a variable of the same name, as `{ field: field }` does.
+    if (!get_token_type(s->buffer, &tmp, COLON)) {
+        *pattern = (struct switch_pattern) {
+            .switch_pattern_kind = VARIABLE_PATTERN_KIND,
+            .variable_pattern = (struct variable_pattern) { .variable_name = key }
+        };
+        *out = (struct key_pattern_pair) {
+            .key = key,
+            .pattern = pattern
+        };
+        return 1;
+    }
+    if (!parse_switch_pattern(s, pattern, error)) return 0;
     *out = (struct key_pattern_pair) {
         .key = key,
         .pattern = pattern
     };
 
-    return 0;
+    return 1;
 }
 
 int parse_object_pattern(struct parser_state *s,
@@ -925,10 +1109,17 @@ int parse_object_pattern(struct parser_state *s,
 
     if (!get_token_type(s->buffer, &tmp, OPEN_CURLY_PAREN)) return 0;
     while (should_continue) {
+        // a trailing comma, or `{}`.
+        if (get_token_type(s->buffer, &tmp, CLOSE_CURLY_PAREN)) {
+            seek_back_token(s->buffer, 1);
+            break;
+        }
         struct key_pattern_pair p = {0};
-        if (parse_key_pattern_pair(s, &p, error)) {
-            list_append(&pairs, p);
+        if (!parse_key_pattern_pair(s, &p, error)) {
+            add_error_inner(s->buffer, error, "expected a field's pattern, as in `{ field: pattern }` or `{ field }`.");
+            return 0;
         }
+        list_append(&pairs, p);
         should_continue = get_token_type(s->buffer, &tmp, COMMA);
     }
     if (!get_token_type(s->buffer, &tmp, CLOSE_CURLY_PAREN)) return 0;
@@ -974,6 +1165,24 @@ int parse_break_statement(struct parser_state *s, struct statement *out, struct
     return 1;
 }
 
+int parse_continue_statement(struct parser_state *s, struct statement *out, struct error *error)
+{
+    struct statement_metadata metadata = get_statement_metadata(s->buffer);
+    struct token tmp = {0};
+    if (!get_token_type(s->buffer, &tmp, CONTINUE_KEYWORD)) return 0;
+    if (!get_token_type(s->buffer, &tmp, SEMICOLON)) {
+        add_error_inner(s->buffer, error, "a continue statement must end with a semicolon.");
+        return 0;
+    }
+
+    *out = (struct statement) {
+        .kind = CONTINUE_STATEMENT,
+        .id = s->next_statement_id++
+    };
+    lut_add(s->metadata_lookup, out->id, metadata);
+    return 1;
+}
+
 int parse_return_statement(struct parser_state *s,
                            struct statement *out,
                            struct error *error)
@@ -1117,6 +1326,39 @@ int parse_block_statement(struct parser_state *s,
     return 1;
 }
 
+int parse_attributes(struct parser_state *s, struct list_attribute *out, struct error *error);
+
+// an `if`'s attributes, which can only say which way it's expected to go.
+int parse_branch_hint(struct parser_state *s, enum branch_hint *out, struct error *error)
+{
+    struct list_attribute attributes = {0};
+    if (!parse_attributes(s, &attributes, error)) return 0;
+
+    *out = BRANCH_UNHINTED;
+    for (size_t i = 0; i < attributes.size; i++) {
+        char *name = attributes.data[i].name.data;
+        enum branch_hint hint = BRANCH_UNHINTED;
+        if (strcmp(name, "likely") == 0) {
+            hint = BRANCH_LIKELY;
+        } else if (strcmp(name, "cold") == 0) {
+            hint = BRANCH_COLD;
+        } else {
+            add_error_inner(s->buffer, error, "an `if` can only be given `likely` or `cold`.");
+            return 0;
+        }
+        if (attributes.data[i].has_argument) {
+            add_error_inner(s->buffer, error, "`likely` and `cold` take no argument.");
+            return 0;
+        }
+        if (*out != BRANCH_UNHINTED && *out != hint) {
+            add_error_inner(s->buffer, error, "`likely` and `cold` can't both be given.");
+            return 0;
+        }
+        *out = hint;
+    }
+    return 1;
+}
+
 int parse_if_statement(struct parser_state *s,
                        struct statement *out,
                        struct error *error)
@@ -1126,7 +1368,9 @@ int parse_if_statement(struct parser_state *s,
     struct expression condition = {0};
     struct statement *success_statement = malloc(sizeof(*success_statement));
     struct statement *else_statement = NULL;
+    enum branch_hint hint = BRANCH_UNHINTED;
 
+    if (!parse_branch_hint(s, &hint, error)) return 0;
     if (!get_token_type(s->buffer, &tmp, IF_KEYWORD)) return 0;
     if (!parse_expression(s, &condition, error)) return 0;
     if (!parse_block_statement(s, success_statement, error)) {
@@ -1150,7 +1394,8 @@ int parse_if_statement(struct parser_state *s,
         .if_statement = (struct if_statement) {
             .condition = condition,
             .success_statement = success_statement,
-            .else_statement = else_statement
+            .else_statement = else_statement,
+            .hint = hint
         }
     };
     lut_add(s->metadata_lookup, out->id, metadata);
@@ -1215,21 +1460,155 @@ int parse_while_loop_statement(struct parser_state *s,
     return 1;
 }
 
+int parse_for_loop_statement(struct parser_state *s,
+                             struct statement *out,
+                             struct error *error)
+{
+    struct statement_metadata metadata = get_statement_metadata(s->buffer);
+    struct token tmp = {0};
+    struct token name = {0};
+    struct statement *do_statement = malloc(sizeof(*do_statement));
+    struct expression iterated = {0};
+    struct expression *end = NULL;
+
+    int parallel = get_token_type(s->buffer, &tmp, PARALLEL_KEYWORD);
+    if (!get_token_type(s->buffer, &tmp, FOR_KEYWORD)) {
+        if (parallel) add_error_inner(s->buffer, error, "`parallel` must be followed by a `for` loop.");
+        return 0;
+    }
+    if (!get_token_type(s->buffer, &tmp, OPEN_ROUND_PAREN)) {
+        add_error_inner(s->buffer, error, "`for` must be followed by `(name in ...)`.");
+        return 0;
+    }
+
+    if (!get_token_type(s->buffer, &name, IDENTIFIER) || !get_token_type(s->buffer, &tmp, IN_KEYWORD)) {
+        add_error_inner(s->buffer, error, "expected the loop's variable and `in`.");
+        return 0;
+    }
+
+    if (!parse_expression(s, &iterated, error)) return 0;
+    if (parse_range(s)) {
+        end = malloc(sizeof(*end));
+        if (!parse_expression(s, end, error)) return 0;
+    }
+
+    if (!get_token_type(s->buffer, &tmp, CLOSE_ROUND_PAREN)) {
+        add_error_inner(s->buffer, error, "missing a closing round parenthesis, `)`.");
+        return 0;
+    }
+
+    if (!parse_block_statement(s, do_statement, error)) {
+        add_error_inner(s->buffer, error, "invalid for block.");
+        return 0;
+    }
+
+    *out = (struct statement) {
+        .kind = FOR_LOOP_STATEMENT,
+        .id = s->next_statement_id++,
+        .for_loop_statement = (struct for_loop_statement) {
+            .variable_name = *name.identifier,
+            .iterated = iterated,
+            .end = end,
+            .do_statement = do_statement,
+            .parallel = parallel
+        }
+    };
+    lut_add(s->metadata_lookup, out->id, metadata);
+    return 1;
+}
+
+int parse_attribute(struct parser_state *s, struct attribute *out, struct error *error)
+{
+    struct token tmp = {0};
+    if (!get_token_type(s->buffer, &tmp, IDENTIFIER)) return 0;
+    *out = (struct attribute) {
+        .name = *tmp.identifier
+    };
+
+    if (!get_token_type(s->buffer, &tmp, OPEN_ROUND_PAREN)) return 1;
+    if (get_token_type(s->buffer, &tmp, IDENTIFIER)) {
+        out->argument = *tmp.identifier;
+    } else if (get_token_type(s->buffer, &tmp, NUMERIC)) {
+        out->numeric_argument = tmp.numeric;
+    } else {
+        add_error_inner(s->buffer, error, "an attribute's argument must be a name or a number.");
+        return 0;
+    }
+    out->has_argument = 1;
+
+    if (!get_token_type(s->buffer, &tmp, CLOSE_ROUND_PAREN)) {
+        add_error_inner(s->buffer, error, "expected a `)` to close the attribute's argument.");
+        return 0;
+    }
+    return 1;
+}
+
+// any number of `#[a, b(c)]` groups, which may be empty.
+int parse_attributes(struct parser_state *s, struct list_attribute *out, struct error *error)
+{
+    struct token tmp = {0};
+    *out = list_create(attribute, 2);
+    while (get_token_type(s->buffer, &tmp, HASH)) {
+        if (!get_token_type(s->buffer, &tmp, OPEN_SQUARE_PAREN)) {
+            add_error_inner(s->buffer, error, "`#` must be followed by `[` to start an attribute.");
+            return 0;
+        }
+
+        int should_continue = 1;
+        while (should_continue) {
+            struct attribute attribute = {0};
+            if (!parse_attribute(s, &attribute, error)) {
+                add_error_inner(s->buffer, error, "expected an attribute.");
+                return 0;
+            }
+            list_append(out, attribute);
+            should_continue = get_token_type(s->buffer, &tmp, COMMA);
+        }
+
+        if (!get_token_type(s->buffer, &tmp, CLOSE_SQUARE_PAREN)) {
+            add_error_inner(s->buffer, error, "expected a `]` to close the attribute.");
+            return 0;
+        }
+    }
+    return 1;
+}
+
 int parse_type_declaration(struct parser_state *s,
                            struct statement *out,
                            struct error *error)
 {
+    struct list_attribute attributes = {0};
+    if (!parse_attributes(s, &attributes, error)) return 0;
+
     struct statement_metadata metadata = get_statement_metadata(s->buffer);
     struct type type = {0};
+    struct token tmp = {0};
+    int is_async = get_token_type(s->buffer, &tmp, ASYNC_KEYWORD);
 
     if (!parse_type(s, &type, 1, 0, error)) return 0;
+    if (is_async && type.kind != TY_FUNCTION) {
+        add_error_inner(s->buffer, error, "only a function can be `async`.");
+        return 0;
+    }
+
+    // the lowering and layout read attributes off the type, the copy in the global context included.
+    struct list_attribute *shared = malloc(sizeof(*shared));
+    *shared = attributes;
+    if (type.kind == TY_FUNCTION) {
+        type.function_type.attributes = shared;
+        type.function_type.is_async = is_async;
+    } else if (type.kind == TY_STRUCT) {
+        type.struct_type.attributes = shared;
+    }
+
     if (type.kind != TY_FUNCTION) {
         *out = (struct statement) {
             .kind = TYPE_DECLARATION_STATEMENT,
             .id = s->next_statement_id++,
             .type_declaration = (struct type_declaration_statement) {
                 .type = type,
-                .statements = NULL
+                .statements = NULL,
+                .attributes = attributes
             }
         };
         lut_add(s->metadata_lookup, out->id, metadata);
@@ -1247,7 +1626,8 @@ int parse_type_declaration(struct parser_state *s,
         .id = s->next_statement_id++,
         .type_declaration = (struct type_declaration_statement) {
             .type = type,
-            .statements = body.statements
+            .statements = body.statements,
+            .attributes = attributes
         }
     };
     lut_add(s->metadata_lookup, out->id, metadata);
@@ -1335,10 +1715,12 @@ int parse_statement(struct parser_state *s,
     return try_parse(s, out, error, (parser_t)parse_return_statement)
         || try_parse(s, out, error, (parser_t)parse_binding_statement)
         || try_parse(s, out, error, (parser_t)parse_break_statement)
+        || try_parse(s, out, error, (parser_t)parse_continue_statement)
         || try_parse(s, out, error, (parser_t)parse_action_statement)
         || try_parse(s, out, error, (parser_t)parse_if_statement)
         || try_parse(s, out, error, (parser_t)parse_block_statement)
         || try_parse(s, out, error, (parser_t)parse_while_loop_statement)
+        || try_parse(s, out, error, (parser_t)parse_for_loop_statement)
         || try_parse(s, out, error, (parser_t)parse_switch_statement)
         || try_parse(s, out, error, (parser_t)parse_c_block_statement);
 }
@@ -1408,7 +1790,9 @@ int parse_file(struct token_buffer *s,
             .data_types = data_types,
             .metadata_lookup = metadata_lookup,
         },
-        .statements = statements
+        .statements = statements,
+        .next_expression_id = state.next_expression_id,
+        .next_statement_id = state.next_statement_id
     };
     return 1;
 }
@@ -14,6 +14,9 @@ struct global_context {
 struct parsed_file {
     struct global_context global_context;
     struct list_statement statements;
+    // passes which synthesise statements and expressions take their ids from here.
+    unsigned long next_expression_id;
+    unsigned long next_statement_id;
 };
 
 int parse_file(struct token_buffer *s,
@@ -0,0 +1,251 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "error.h"
+#include "layout.h"
+#include "pgo.h"
+
+// FNV-1a over the file, so profiles are only used with the C they were recorded from.
+int hash_file(char *path, uint64_t *hash)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return 0;
+
+    int c = 0;
+    while ((c = fgetc(file)) != EOF) {
+        *hash ^= (uint64_t)(unsigned char)c;
+        *hash *= 1099511628211u;
+    }
+    fclose(file);
+    return 1;
+}
+
+// The rm file's name without its directories or extension.
+void program_name(char *file_name, char *out, size_t size)
+{
+    char *base = strrchr(file_name, '/');
+    base = base == NULL ? file_name : base + 1;
+    snprintf(out, size, "%s", base);
+    char *extension = strrchr(out, '.');
+    if (extension != NULL && extension != out) {
+        *extension = '\0';
+    }
+}
+
+int make_directory(char *path)
+{
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        write_raw_error(stderr, "a directory for the profile guided build couldn't be made.");
+        return 0;
+    }
+    return 1;
+}
+
+int run_command(char *command, char *error)
+{
+    if (system(command) != 0) {
+        write_raw_error(stderr, error);
+        return 0;
+    }
+    return 1;
+}
+
+char *c_compiler(void)
+{
+    char *compiler = getenv("CC");
+    return compiler == NULL || compiler[0] == '\0' ? "cc" : compiler;
+}
+
+// an rm program's exit status is whatever `main` returns, only a command that didn't run fails.
+int run_training(char *training_command)
+{
+    int status = system(training_command);
+    if (status == -1 || (WIFEXITED(status) && WEXITSTATUS(status) == 127)) {
+        write_raw_error(stderr, "the training command couldn't be run.");
+        return 0;
+    }
+    return 1;
+}
+
+char *branch_profile_path(void)
+{
+    char directory[PATH_MAX] = {0};
+    if (getcwd(directory, sizeof(directory)) == NULL) return NULL;
+    char *path = malloc(strlen(directory) + 32);
+    sprintf(path, "%s/target/pgo/branches", directory);
+    return path;
+}
+
+typedef struct branch_count {
+    unsigned long id;
+    uint64_t hits;
+    uint64_t misses;
+} branch_count;
+
+struct_list(branch_count);
+
+// The counts of every run of the training command, summed by statement.
+int read_branch_counts(char *path, struct list_branch_count *out)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return 0;
+
+    *out = list_create(branch_count, 64);
+    unsigned long id = 0;
+    unsigned long long hits = 0, misses = 0;
+    while (fscanf(file, "%lu %llu %llu", &id, &hits, &misses) == 3) {
+        size_t i = 0;
+        while (i < out->size && out->data[i].id != id) i++;
+        if (i == out->size) {
+            list_append(out, ((struct branch_count) { .id = id }));
+        }
+        out->data[i].hits += hits;
+        out->data[i].misses += misses;
+    }
+    fclose(file);
+    return 1;
+}
+
+struct branch_count *find_branch_count(struct list_branch_count *counts, unsigned long id)
+{
+    for (size_t i = 0; i < counts->size; i++) {
+        if (counts->data[i].id == id) return &counts->data[i];
+    }
+    return NULL;
+}
+
+// An `if` that went one way at least nine times in ten is hinted that way, unless it already is.
+void hint_branches(struct statement *s, struct list_branch_count *counts)
+{
+    if (s == NULL) return;
+    switch (s->kind) {
+        case IF_STATEMENT:
+        {
+            struct branch_count *count = find_branch_count(counts, s->id);
+            uint64_t total = count == NULL ? 0 : count->hits + count->misses;
+            if (s->if_statement.hint == BRANCH_UNHINTED && total > 0) {
+                if (count->hits * 10 >= total * 9) {
+                    s->if_statement.hint = BRANCH_LIKELY;
+                } else if (count->hits * 10 <= total) {
+                    s->if_statement.hint = BRANCH_COLD;
+                }
+            }
+            hint_branches(s->if_statement.success_statement, counts);
+            hint_branches(s->if_statement.else_statement, counts);
+            return;
+        }
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                hint_branches(&s->statements->data[i], counts);
+            }
+            return;
+        case WHILE_LOOP_STATEMENT:
+            hint_branches(s->while_loop_statement.do_statement, counts);
+            return;
+        case FOR_LOOP_STATEMENT:
+            hint_branches(s->for_loop_statement.do_statement, counts);
+            return;
+        case SWITCH_STATEMENT:
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                hint_branches(s->switch_statement.cases.data[i].statement, counts);
+            }
+            return;
+        default:
+            return;
+    }
+}
+
+// A function the training never called is `#[cold]`, unless it's already `#[hot]` or `#[cold]`.
+void hint_function(struct type_declaration_statement *fn, struct branch_count *count)
+{
+    struct list_attribute *attributes = fn->type.function_type.attributes;
+    if (count == NULL
+        || count->hits > 0
+        || attributes == NULL
+        || has_attribute(attributes, "hot", NULL)
+        || has_attribute(attributes, "cold", NULL))
+    {
+        return;
+    }
+    struct attribute cold = { .name = list_create(char, 8) };
+    append_list_char_slice(&cold.name, "cold");
+    list_append(attributes, cold);
+}
+
+int apply_branch_profile(struct parsed_file *parsed,
+                         char *file_name,
+                         char *training_command,
+                         char *branch_profile)
+{
+    char name[256] = {0};
+    program_name(file_name, name, sizeof(name));
+    if (!make_directory("target/bin") || !make_directory("target/pgo")) return 0;
+    char command[4096] = {0};
+    snprintf(command, sizeof(command),
+             "%s -O2 -o target/bin/%s target/c_output.c -lm -lpthread", c_compiler(), name);
+    if (!run_command(command, "the branch counting build failed.")) return 0;
+
+    remove(branch_profile);
+    if (!run_training(training_command)) return 0;
+
+    struct list_branch_count counts = {0};
+    if (!read_branch_counts(branch_profile, &counts)) {
+        write_raw_error(stderr, "the training command never ran the program to count its branches.");
+        return 0;
+    }
+
+    for (size_t i = 0; i < parsed->statements.size; i++) {
+        struct statement *s = &parsed->statements.data[i];
+        if (s->kind != TYPE_DECLARATION_STATEMENT
+            || s->type_declaration.type.kind != TY_FUNCTION
+            || s->type_declaration.statements == NULL)
+        {
+            continue;
+        }
+        hint_function(&s->type_declaration, find_branch_count(&counts, s->id));
+        for (size_t j = 0; j < s->type_declaration.statements->size; j++) {
+            hint_branches(&s->type_declaration.statements->data[j], &counts);
+        }
+    }
+    return 1;
+}
+
+int build_with_profile(char *file_name, char *training_command)
+{
+    char *compiler = c_compiler();
+
+    uint64_t hash = 14695981039346656037u;
+    if (!hash_file("target/c_output.c", &hash) || !hash_file("target/c_output.h", &hash)) {
+        write_raw_error(stderr, "generated C not found for the profile guided build.");
+        return 0;
+    }
+
+    // the .gcda files GCC writes live beside the C they profile, stale ones are never read.
+    char profile_dir[64] = {0};
+    snprintf(profile_dir, sizeof(profile_dir), "target/pgo/%016llx", (unsigned long long)hash);
+    if (!make_directory("target/bin") || !make_directory("target/pgo") || !make_directory(profile_dir)) {
+        return 0;
+    }
+
+    char name[256] = {0};
+    program_name(file_name, name, sizeof(name));
+    char command[4096] = {0};
+
+    snprintf(command, sizeof(command),
+             "%s -O2 -fprofile-generate=%s -o target/bin/%s target/c_output.c -lm -lpthread",
+             compiler, profile_dir, name);
+    if (!run_command(command, "the instrumented build failed.")) return 0;
+
+    if (!run_training(training_command)) return 0;
+
+    snprintf(command, sizeof(command),
+             "%s -O2 -fprofile-use=%s -fprofile-correction -o target/bin/%s target/c_output.c -lm -lpthread",
+             compiler, profile_dir, name);
+    return run_command(command, "the profile guided build failed.");
+}
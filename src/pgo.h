@@ -0,0 +1,22 @@
+#ifndef PGO_H
+#define PGO_H
+
+#include "parser.h"
+
+// Where the branch counting build appends its counts, under `target/pgo` in the working directory,
+// so a training command that runs the program from elsewhere still adds to it.
+char *branch_profile_path(void);
+
+// Builds the generated C, which counts its branches into `branch_profile`, runs `training_command`
+// and hints the `if`s and functions of `parsed` with what it counted, so the C written next
+// carries `likely` and `cold` where the training found them.
+int apply_branch_profile(struct parsed_file *parsed,
+                         char *file_name,
+                         char *training_command,
+                         char *branch_profile);
+
+// Builds the generated C into `target/bin/<name>` with profile guided optimisation: an instrumented
+// build, a run of `training_command`, then a rebuild with the profile it wrote.
+int build_with_profile(char *file_name, char *training_command);
+
+#endif
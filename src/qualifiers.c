@@ -0,0 +1,1138 @@
+#include <string.h>
+#include "arena.h"
+#include "ast.h"
+#include "context.h"
+#include "layout.h"
+#include "parser.h"
+#include "qualifiers.h"
+#include "../lib/collections.h"
+#include "../lib/utils.h"
+
+// Structs up to this size are passed and returned in registers by the SysV ABIs, larger ones are
+// copied through memory for each call.
+#define REGISTER_PASSED_STRUCT_SIZE 16
+
+// What a function body does with one of its pointer parameters.
+struct parameter_use {
+    struct list_char *name;
+    // something is assigned through it, `*p = x`, `p.x = y` or `p[i] = z`.
+    int written;
+    // it reaches somewhere its pointee could be written from, a call, another variable, a slice.
+    int escapes;
+    // the parameter itself is assigned, as tail call elimination does.
+    int reassigned;
+    // a variable of the same name is bound within the body.
+    int shadowed;
+};
+
+struct expression *ungrouped(struct expression *e)
+{
+    while (e->kind == GROUP_EXPRESSION) {
+        e = e->grouped;
+    }
+    return e;
+}
+
+int is_parameter_name(struct expression *e, struct list_char *name)
+{
+    e = ungrouped(e);
+    return e->kind == LITERAL_EXPRESSION
+        && e->literal.kind == LITERAL_NAME
+        && list_char_eq(e->literal.name, name);
+}
+
+// Follows member accesses, indexes and dereferences to the expression they start from.
+struct expression *access_base(struct expression *e)
+{
+    for (;;) {
+        switch (e->kind) {
+            case GROUP_EXPRESSION:
+                e = e->grouped;
+                break;
+            case MEMBER_ACCESS_EXPRESSION:
+                e = e->member_access.accessed;
+                break;
+            case INDEX_EXPRESSION:
+                e = e->index.indexed;
+                break;
+            case UNARY_EXPRESSION:
+                if (e->unary.unary_operator != STAR_UNARY) return e;
+                e = e->unary.expression;
+                break;
+            default:
+                return e;
+        }
+    }
+}
+
+int mentions_name(struct expression *e, struct list_char *name)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            if (e->literal.kind == LITERAL_NAME) {
+                return list_char_eq(e->literal.name, name);
+            }
+
+            if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    if (mentions_name(pairs->data[i].expression, name)) return 1;
+                }
+            }
+            return 0;
+        }
+        case UNARY_EXPRESSION:
+            return mentions_name(e->unary.expression, name);
+        case BINARY_EXPRESSION:
+            return mentions_name(e->binary.l, name) || mentions_name(e->binary.r, name);
+        case GROUP_EXPRESSION:
+            return mentions_name(e->grouped, name);
+        case FUNCTION_EXPRESSION:
+        {
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                if (mentions_name(&e->function.params->data[i], name)) return 1;
+            }
+            return 0;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+            return mentions_name(e->member_access.accessed, name);
+        case INDEX_EXPRESSION:
+            return mentions_name(e->index.indexed, name)
+                || mentions_name(e->index.index, name)
+                || (e->index.end != NULL && mentions_name(e->index.end, name));
+        case VOID_EXPRESSION:
+            return 0;
+    }
+
+    UNREACHABLE("mentions_name fell out of a switch");
+}
+
+int statement_mentions_name(struct statement *s, struct list_char *name)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            return mentions_name(&s->binding_statement.value, name);
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+            return mentions_name(&s->expression, name);
+        case IF_STATEMENT:
+            return mentions_name(&s->if_statement.condition, name)
+                || statement_mentions_name(s->if_statement.success_statement, name)
+                || (s->if_statement.else_statement != NULL
+                    && statement_mentions_name(s->if_statement.else_statement, name));
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (statement_mentions_name(&s->statements->data[i], name)) return 1;
+            }
+            return 0;
+        case WHILE_LOOP_STATEMENT:
+            return mentions_name(&s->while_loop_statement.condition, name)
+                || statement_mentions_name(s->while_loop_statement.do_statement, name);
+        case FOR_LOOP_STATEMENT:
+            return mentions_name(&s->for_loop_statement.iterated, name)
+                || (s->for_loop_statement.end != NULL && mentions_name(s->for_loop_statement.end, name))
+                || statement_mentions_name(s->for_loop_statement.do_statement, name);
+        case SWITCH_STATEMENT:
+            if (mentions_name(&s->switch_statement.switch_expression, name)) return 1;
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                if (statement_mentions_name(s->switch_statement.cases.data[i].statement, name)) return 1;
+            }
+            return 0;
+        case C_BLOCK_STATEMENT:
+            return mentions_identifier(s->c_block_statement.raw_c->data, name->data);
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+            return 0;
+    }
+
+    UNREACHABLE("statement_mentions_name fell out of a switch");
+}
+
+// Reading through the parameter is fine, `*p`, `p.x`, `p[i]` and comparing it too, any other use
+// of the bare name hands the pointer on.
+void scan_expression(struct expression *e, struct parameter_use *use)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            if (e->literal.kind == LITERAL_NAME) {
+                if (list_char_eq(e->literal.name, use->name)) use->escapes = 1;
+                return;
+            }
+
+            if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    scan_expression(pairs->data[i].expression, use);
+                }
+            }
+            return;
+        }
+        case UNARY_EXPRESSION:
+            if (e->unary.unary_operator == STAR_UNARY && is_parameter_name(e->unary.expression, use->name)) return;
+            scan_expression(e->unary.expression, use);
+            return;
+        case BINARY_EXPRESSION:
+        {
+            struct binary_expression *binary = &e->binary;
+            if (binary->binary_op == ASSIGN_BINARY) {
+                if (is_parameter_name(binary->l, use->name)) {
+                    use->reassigned = 1;
+                } else {
+                    if (is_parameter_name(access_base(binary->l), use->name)) use->written = 1;
+                    // the target's own reads, like the index in `a[p.x] = y`.
+                    struct expression *target = ungrouped(binary->l);
+                    if (!is_parameter_name(target, use->name)) scan_expression(target, use);
+                }
+                scan_expression(binary->r, use);
+                return;
+            }
+
+            int comparison = binary->binary_op == EQUAL_TO_BINARY
+                || binary->binary_op == LESS_THAN_BINARY
+                || binary->binary_op == GREATER_THAN_BINARY;
+            if (!comparison || !is_parameter_name(binary->l, use->name)) scan_expression(binary->l, use);
+            if (!comparison || !is_parameter_name(binary->r, use->name)) scan_expression(binary->r, use);
+            return;
+        }
+        case GROUP_EXPRESSION:
+            scan_expression(e->grouped, use);
+            return;
+        case FUNCTION_EXPRESSION:
+        {
+            // a callee could write through the pointer, or through an array field it decays to.
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                if (mentions_name(&e->function.params->data[i], use->name)) use->escapes = 1;
+            }
+            return;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+            if (is_parameter_name(e->member_access.accessed, use->name)) return;
+            scan_expression(e->member_access.accessed, use);
+            return;
+        case INDEX_EXPRESSION:
+        {
+            // a slice of the pointee holds a plain pointer to it.
+            if (e->index.end != NULL && is_parameter_name(access_base(e->index.indexed), use->name)) {
+                use->escapes = 1;
+            }
+            if (!is_parameter_name(e->index.indexed, use->name)) scan_expression(e->index.indexed, use);
+            scan_expression(e->index.index, use);
+            if (e->index.end != NULL) scan_expression(e->index.end, use);
+            return;
+        }
+        case VOID_EXPRESSION:
+            return;
+    }
+
+    UNREACHABLE("scan_expression fell out of a switch");
+}
+
+int pattern_binds(struct switch_pattern *pattern, struct list_char *name)
+{
+    switch (pattern->switch_pattern_kind) {
+        case VARIABLE_PATTERN_KIND:
+            return list_char_eq(&pattern->variable_pattern.variable_name, name);
+        case OBJECT_PATTERN_KIND:
+        {
+            struct list_key_pattern_pair *pairs = &pattern->object_pattern.pairs;
+            for (size_t i = 0; i < pairs->size; i++) {
+                if (pattern_binds(pairs->data[i].pattern, name)) return 1;
+            }
+            return 0;
+        }
+        case ARRAY_PATTERN_KIND:
+        {
+            struct list_switch_pattern *patterns = pattern->array_pattern.patterns;
+            for (size_t i = 0; i < patterns->size; i++) {
+                if (pattern_binds(&patterns->data[i], name)) return 1;
+            }
+            return 0;
+        }
+        case NUMBER_PATTERN_KIND:
+        case STRING_PATTERN_KIND:
+        case UNDERSCORE_PATTERN_KIND:
+        case REST_PATTERN_KIND:
+            return 0;
+    }
+
+    UNREACHABLE("pattern_binds fell out of a switch");
+}
+
+// A variable shadowing the parameter counts as an escape, the scan goes by name alone.
+void scan_statement(struct statement *s, struct parameter_use *use)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            if (list_char_eq(&s->binding_statement.variable_name, use->name)) {
+                use->escapes = 1;
+                use->shadowed = 1;
+            }
+            scan_expression(&s->binding_statement.value, use);
+            return;
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+            scan_expression(&s->expression, use);
+            return;
+        case IF_STATEMENT:
+            scan_expression(&s->if_statement.condition, use);
+            scan_statement(s->if_statement.success_statement, use);
+            if (s->if_statement.else_statement != NULL) {
+                scan_statement(s->if_statement.else_statement, use);
+            }
+            return;
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                scan_statement(&s->statements->data[i], use);
+            }
+            return;
+        case WHILE_LOOP_STATEMENT:
+            scan_expression(&s->while_loop_statement.condition, use);
+            scan_statement(s->while_loop_statement.do_statement, use);
+            return;
+        case FOR_LOOP_STATEMENT:
+        {
+            struct for_loop_statement *for_statement = &s->for_loop_statement;
+            if (list_char_eq(&for_statement->variable_name, use->name)) {
+                use->escapes = 1;
+                use->shadowed = 1;
+            }
+            // the elements are walked through a plain pointer.
+            if (for_statement->end == NULL) {
+                if (mentions_name(&for_statement->iterated, use->name)) use->escapes = 1;
+            } else {
+                scan_expression(&for_statement->iterated, use);
+                scan_expression(for_statement->end, use);
+            }
+            scan_statement(for_statement->do_statement, use);
+            return;
+        }
+        case SWITCH_STATEMENT:
+        {
+            struct switch_statement *switch_statement = &s->switch_statement;
+            if (mentions_name(&switch_statement->switch_expression, use->name)) use->escapes = 1;
+            for (size_t i = 0; i < switch_statement->cases.size; i++) {
+                struct case_statement *c = &switch_statement->cases.data[i];
+                if (pattern_binds(&c->pattern, use->name)) {
+                    use->escapes = 1;
+                    use->shadowed = 1;
+                }
+                scan_statement(c->statement, use);
+            }
+            return;
+        }
+        case C_BLOCK_STATEMENT:
+            if (mentions_identifier(s->c_block_statement.raw_c->data, use->name->data)) {
+                use->escapes = 1;
+                use->reassigned = 1;
+            }
+            return;
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+            return;
+    }
+
+    UNREACHABLE("scan_statement fell out of a switch");
+}
+
+// Whether `const` can go on the pointee, it has to be the base type the declarator is written
+// after, not a further pointer.
+int pointee_takes_const(struct type *ty)
+{
+    if (ty->kind != TY_PRIMITIVE && ty->kind != TY_STRUCT && ty->kind != TY_ENUM) return 0;
+    size_t count = c_declarator_modifier_count(&ty->modifiers);
+    for (size_t i = 1; i < count; i++) {
+        if (ty->modifiers.data[i].kind == POINTER_MODIFIER_KIND) return 0;
+    }
+    return 1;
+}
+
+// How deep `reaches_overlap` follows struct fields, past which it assumes overlap.
+#define OVERLAP_DEPTH 8
+
+int is_indirection(enum type_modifier_kind kind)
+{
+    return kind == POINTER_MODIFIER_KIND || kind == SLICE_MODIFIER_KIND;
+}
+
+int same_base_type(struct type *l, struct type *r)
+{
+    if (l->kind != r->kind) return 0;
+    if (l->kind == TY_PRIMITIVE) return l->primitive_type == r->primitive_type;
+    return l->name != NULL && r->name != NULL && list_char_eq(l->name, r->name);
+}
+
+// Whether storage of `outer`'s base type holds a value of `inner`'s base type, itself or within
+// its fields, behind no pointer.
+int holds_inline(struct type *outer, struct type *inner, struct global_context *global_context, int depth)
+{
+    if (same_base_type(outer, inner)) return 1;
+    if (outer->kind != TY_STRUCT && outer->kind != TY_ENUM) return 0;
+    if (depth == 0) return 1;
+    struct type *defined = find_data_type(global_context, outer->name);
+    if (defined == NULL) return 1;
+    struct list_key_type_pair *pairs = defined->kind == TY_STRUCT
+        ? &defined->struct_type.pairs
+        : &defined->enum_type.pairs;
+    for (size_t i = 0; i < pairs->size; i++) {
+        struct type *field = pairs->data[i].field_type;
+        int indirect = 0;
+        for (size_t m = 0; m < field->modifiers.size; m++) {
+            if (is_indirection(field->modifiers.data[m].kind)) indirect = 1;
+        }
+        if (!indirect && holds_inline(field, inner, global_context, depth - 1)) return 1;
+    }
+    return 0;
+}
+
+// Whether an object of one base type could be accessed as the other, bytes being readable as
+// anything.
+int base_types_overlap(struct type *l, struct type *r, struct global_context *global_context)
+{
+    if (l->kind == TY_ANY || r->kind == TY_ANY) return 1;
+    for (int i = 0; i < 2; i++) {
+        struct type *ty = i == 0 ? l : r;
+        if (ty->kind == TY_PRIMITIVE && (ty->primitive_type == I8 || ty->primitive_type == U8)) return 1;
+    }
+    return holds_inline(l, r, global_context, OVERLAP_DEPTH)
+        || holds_inline(r, l, global_context, OVERLAP_DEPTH);
+}
+
+// Whether a value of `ty` could point, directly or through the structs it reaches, to memory
+// holding `target`'s base type.
+int reaches_overlap(struct type *ty, struct type *target, struct global_context *global_context, int depth)
+{
+    if (ty->kind == TY_ANY || depth == 0) return 1;
+    for (size_t m = 0; m < ty->modifiers.size; m++) {
+        if (is_indirection(ty->modifiers.data[m].kind)
+            && base_types_overlap(ty, target, global_context))
+        {
+            return 1;
+        }
+    }
+    if (ty->kind != TY_STRUCT && ty->kind != TY_ENUM) return 0;
+    struct type *defined = find_data_type(global_context, ty->name);
+    if (defined == NULL) return 1;
+    struct list_key_type_pair *pairs = defined->kind == TY_STRUCT
+        ? &defined->struct_type.pairs
+        : &defined->enum_type.pairs;
+    for (size_t i = 0; i < pairs->size; i++) {
+        if (reaches_overlap(pairs->data[i].field_type, target, global_context, depth - 1)) return 1;
+    }
+    return 0;
+}
+
+// `restrict` is only sound when nothing else the function is given could reach the pointee: no
+// other parameter, nor a pointer kept within the pointee itself. Two pointers to types that can't
+// overlap never point to the same object, whatever the callers pass.
+int pointee_unreachable_otherwise(struct list_key_type_pair *params,
+                                  size_t index,
+                                  struct global_context *global_context)
+{
+    struct type *pointee = params->data[index].field_type;
+    for (size_t i = 0; i < params->size; i++) {
+        if (i != index && reaches_overlap(params->data[i].field_type, pointee, global_context, OVERLAP_DEPTH)) {
+            return 0;
+        }
+    }
+    if (pointee->kind != TY_STRUCT && pointee->kind != TY_ENUM) return 1;
+    struct type *defined = find_data_type(global_context, pointee->name);
+    if (defined == NULL) return 0;
+    struct list_key_type_pair *pairs = defined->kind == TY_STRUCT
+        ? &defined->struct_type.pairs
+        : &defined->enum_type.pairs;
+    for (size_t i = 0; i < pairs->size; i++) {
+        if (reaches_overlap(pairs->data[i].field_type, pointee, global_context, OVERLAP_DEPTH)) return 0;
+    }
+    return 1;
+}
+
+void qualify_function(struct type_declaration_statement *declaration, struct global_context *global_context)
+{
+    struct list_key_type_pair *params = &declaration->type.function_type.params;
+    for (size_t i = 0; i < params->size; i++) {
+        struct type *param_type = params->data[i].field_type;
+        if (param_type->modifiers.size == 0
+            || param_type->modifiers.data[0].kind != POINTER_MODIFIER_KIND)
+        {
+            continue;
+        }
+
+        struct parameter_use use = { .name = &params->data[i].field_name };
+        for (size_t j = 0; j < declaration->statements->size; j++) {
+            scan_statement(&declaration->statements->data[j], &use);
+        }
+
+        int mutable_pointee = param_type->modifiers.size > 1
+            && param_type->modifiers.data[1].kind == MUTABLE_MODIFIER_KIND;
+        struct pointer_type_modifier *pointer = &param_type->modifiers.data[0].pointer_modifier;
+        pointer->const_pointee = !mutable_pointee
+            && !use.written
+            && !use.escapes
+            && pointee_takes_const(param_type);
+        pointer->restrict_pointer = mutable_pointee
+            && !use.reassigned
+            && pointee_unreachable_otherwise(params, i, global_context);
+    }
+}
+
+void qualify_pointer_parameters(struct parsed_file *parsed_file)
+{
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        struct statement *s = &parsed_file->statements.data[i];
+        // an async fn's parameters are copied into its frame, which outlives the call.
+        if (s->kind == TYPE_DECLARATION_STATEMENT
+            && s->type_declaration.type.kind == TY_FUNCTION
+            && s->type_declaration.statements != NULL
+            && !s->type_declaration.type.function_type.is_async)
+        {
+            qualify_function(&s->type_declaration, &parsed_file->global_context);
+        }
+    }
+}
+
+// A value that could hold a pointer, bound or assigned to a name.
+typedef struct pointer_copy {
+    struct list_char *target;
+    struct expression *value;
+} pointer_copy;
+
+struct_list(pointer_copy);
+
+typedef struct shared_name {
+    struct list_char *name;
+} shared_name;
+
+struct_list(shared_name);
+
+// Whether a value of the type could hold a pointer, so a copy of it reaches the same memory.
+int carries_pointer(struct type *ty)
+{
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        enum type_modifier_kind kind = ty->modifiers.data[i].kind;
+        if (kind == POINTER_MODIFIER_KIND || kind == SLICE_MODIFIER_KIND) return 1;
+    }
+    return ty->kind == TY_STRUCT || ty->kind == TY_ENUM;
+}
+
+void collect_expression_copies(struct expression *e, struct context *context, struct list_pointer_copy *out)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    collect_expression_copies(pairs->data[i].expression, context, out);
+                }
+            }
+            return;
+        }
+        case UNARY_EXPRESSION:
+            collect_expression_copies(e->unary.expression, context, out);
+            return;
+        case BINARY_EXPRESSION:
+        {
+            struct expression *target = ungrouped(e->binary.l);
+            struct type value_type = lut_get(&context->expression_type_lookup, e->binary.r->id);
+            if (e->binary.binary_op == ASSIGN_BINARY
+                && target->kind == LITERAL_EXPRESSION
+                && target->literal.kind == LITERAL_NAME
+                && carries_pointer(&value_type))
+            {
+                list_append(out, ((struct pointer_copy) { .target = target->literal.name, .value = e->binary.r }));
+            }
+            collect_expression_copies(e->binary.l, context, out);
+            collect_expression_copies(e->binary.r, context, out);
+            return;
+        }
+        case GROUP_EXPRESSION:
+            collect_expression_copies(e->grouped, context, out);
+            return;
+        case FUNCTION_EXPRESSION:
+        {
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                collect_expression_copies(&e->function.params->data[i], context, out);
+            }
+            return;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+            collect_expression_copies(e->member_access.accessed, context, out);
+            return;
+        case INDEX_EXPRESSION:
+            collect_expression_copies(e->index.indexed, context, out);
+            collect_expression_copies(e->index.index, context, out);
+            if (e->index.end != NULL) collect_expression_copies(e->index.end, context, out);
+            return;
+        case VOID_EXPRESSION:
+            return;
+    }
+
+    UNREACHABLE("collect_expression_copies fell out of a switch");
+}
+
+void collect_copies(struct statement *s, struct context *context, struct list_pointer_copy *out)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+        {
+            struct type value_type = lut_get(&context->expression_type_lookup, s->binding_statement.value.id);
+            if (carries_pointer(&value_type)) {
+                list_append(out, ((struct pointer_copy) {
+                    .target = &s->binding_statement.variable_name,
+                    .value = &s->binding_statement.value
+                }));
+            }
+            collect_expression_copies(&s->binding_statement.value, context, out);
+            return;
+        }
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+            collect_expression_copies(&s->expression, context, out);
+            return;
+        case IF_STATEMENT:
+            collect_expression_copies(&s->if_statement.condition, context, out);
+            collect_copies(s->if_statement.success_statement, context, out);
+            if (s->if_statement.else_statement != NULL) {
+                collect_copies(s->if_statement.else_statement, context, out);
+            }
+            return;
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                collect_copies(&s->statements->data[i], context, out);
+            }
+            return;
+        case WHILE_LOOP_STATEMENT:
+            collect_expression_copies(&s->while_loop_statement.condition, context, out);
+            collect_copies(s->while_loop_statement.do_statement, context, out);
+            return;
+        case FOR_LOOP_STATEMENT:
+            collect_copies(s->for_loop_statement.do_statement, context, out);
+            return;
+        case SWITCH_STATEMENT:
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                collect_copies(s->switch_statement.cases.data[i].statement, context, out);
+            }
+            return;
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return;
+    }
+
+    UNREACHABLE("collect_copies fell out of a switch");
+}
+
+void collect_mentioned_names(struct expression *e, struct list_shared_name *out)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            if (e->literal.kind == LITERAL_NAME) {
+                list_append(out, ((struct shared_name) { .name = e->literal.name }));
+            }
+            if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    collect_mentioned_names(pairs->data[i].expression, out);
+                }
+            }
+            return;
+        }
+        case UNARY_EXPRESSION:
+            collect_mentioned_names(e->unary.expression, out);
+            return;
+        case BINARY_EXPRESSION:
+            collect_mentioned_names(e->binary.l, out);
+            collect_mentioned_names(e->binary.r, out);
+            return;
+        case GROUP_EXPRESSION:
+            collect_mentioned_names(e->grouped, out);
+            return;
+        case FUNCTION_EXPRESSION:
+        {
+            // what an arena hands out is memory nothing points to yet, not the arena's.
+            size_t first = is_arena_allocation(&e->function) ? 1 : 0;
+            for (size_t i = first; i < e->function.params->size; i++) {
+                collect_mentioned_names(&e->function.params->data[i], out);
+            }
+            return;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+            collect_mentioned_names(e->member_access.accessed, out);
+            return;
+        case INDEX_EXPRESSION:
+            collect_mentioned_names(e->index.indexed, out);
+            collect_mentioned_names(e->index.index, out);
+            if (e->index.end != NULL) collect_mentioned_names(e->index.end, out);
+            return;
+        case VOID_EXPRESSION:
+            return;
+    }
+
+    UNREACHABLE("collect_mentioned_names fell out of a switch");
+}
+
+int in_shared_names(struct list_shared_name *names, struct list_char *name)
+{
+    for (size_t i = 0; i < names->size; i++) {
+        if (list_char_eq(names->data[i].name, name)) return 1;
+    }
+    return 0;
+}
+
+int may_share_memory(struct list_statement *body,
+                     struct list_char *name,
+                     struct list_char *other,
+                     struct context *context)
+{
+    if (list_char_eq(name, other)) return 1;
+
+    struct list_pointer_copy copies = list_create(pointer_copy, 16);
+    for (size_t i = 0; i < body->size; i++) {
+        collect_copies(&body->data[i], context, &copies);
+    }
+
+    // each copy joins its target with every name its value mentions, until no copy joins another.
+    struct list_shared_name shared = list_create(shared_name, 8);
+    list_append(&shared, ((struct shared_name) { .name = name }));
+    int grew = 1;
+    while (grew) {
+        grew = 0;
+        for (size_t i = 0; i < copies.size; i++) {
+            struct list_shared_name joined = list_create(shared_name, 4);
+            list_append(&joined, ((struct shared_name) { .name = copies.data[i].target }));
+            collect_mentioned_names(copies.data[i].value, &joined);
+
+            int touches = 0;
+            for (size_t j = 0; j < joined.size && !touches; j++) {
+                touches = in_shared_names(&shared, joined.data[j].name);
+            }
+            for (size_t j = 0; j < joined.size && touches; j++) {
+                if (in_shared_names(&shared, joined.data[j].name)) continue;
+                list_append(&shared, joined.data[j]);
+                grew = 1;
+            }
+            free(joined.data);
+        }
+    }
+
+    int shares = in_shared_names(&shared, other);
+    free(shared.data);
+    free(copies.data);
+    return shares;
+}
+
+// What a function does to memory it doesn't own, to tell whether a struct it's given can be read
+// from wherever the caller keeps it.
+struct memory_use {
+    struct global_context *global_context;
+    struct context *context;
+    // it stores through a pointer or a slice, runs C, or calls a function it can't name.
+    int writes;
+    // when set, a store through a pointer is only a write if what's stored could overlap it.
+    struct type *stored_type;
+    // the functions it calls, by index into fn_types.
+    struct list_int callees;
+    // by index into fn_types, functions named other than by a call, which could then be called
+    // from somewhere that doesn't know their signature.
+    int *referenced;
+};
+
+int function_index(struct global_context *global_context, struct list_char *name)
+{
+    for (size_t i = 0; i < global_context->fn_types.size; i++) {
+        if (list_char_eq(name, global_context->fn_types.data[i].name)) return (int)i;
+    }
+    return -1;
+}
+
+int is_indirect(struct expression *e, struct context *context)
+{
+    struct type ty = lut_get(&context->expression_type_lookup, e->id);
+    return ty.modifiers.size > 0
+        && (ty.modifiers.data[0].kind == POINTER_MODIFIER_KIND
+            || ty.modifiers.data[0].kind == SLICE_MODIFIER_KIND);
+}
+
+// Whether assigning to the target stores through a pointer or slice, rather than into a variable.
+int stores_through_pointer(struct expression *target, struct context *context)
+{
+    for (;;) {
+        switch (target->kind) {
+            case GROUP_EXPRESSION:
+                target = target->grouped;
+                break;
+            case MEMBER_ACCESS_EXPRESSION:
+                if (is_indirect(target->member_access.accessed, context)) return 1;
+                target = target->member_access.accessed;
+                break;
+            case INDEX_EXPRESSION:
+                if (is_indirect(target->index.indexed, context)) return 1;
+                target = target->index.indexed;
+                break;
+            case LITERAL_EXPRESSION:
+                return target->literal.kind != LITERAL_NAME;
+            default:
+                return 1;
+        }
+    }
+}
+
+void scan_memory_expression(struct expression *e, struct memory_use *use)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            if (e->literal.kind == LITERAL_NAME) {
+                int index = function_index(use->global_context, e->literal.name);
+                if (index >= 0) use->referenced[index] = 1;
+                return;
+            }
+
+            if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    scan_memory_expression(pairs->data[i].expression, use);
+                }
+            }
+            return;
+        }
+        case UNARY_EXPRESSION:
+            scan_memory_expression(e->unary.expression, use);
+            return;
+        case BINARY_EXPRESSION:
+            if (e->binary.binary_op == ASSIGN_BINARY && stores_through_pointer(e->binary.l, use->context)) {
+                struct type stored = lut_get(&use->context->expression_type_lookup, e->binary.l->id);
+                if (use->stored_type == NULL
+                    || base_types_overlap(&stored, use->stored_type, use->global_context))
+                {
+                    use->writes = 1;
+                }
+            }
+            scan_memory_expression(e->binary.l, use);
+            scan_memory_expression(e->binary.r, use);
+            return;
+        case GROUP_EXPRESSION:
+            scan_memory_expression(e->grouped, use);
+            return;
+        case FUNCTION_EXPRESSION:
+        {
+            int index = function_index(use->global_context, e->function.function_name);
+            if (index < 0) {
+                use->writes = 1;
+            } else {
+                list_append(&use->callees, index);
+            }
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                scan_memory_expression(&e->function.params->data[i], use);
+            }
+            return;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+            scan_memory_expression(e->member_access.accessed, use);
+            return;
+        case INDEX_EXPRESSION:
+            scan_memory_expression(e->index.indexed, use);
+            scan_memory_expression(e->index.index, use);
+            if (e->index.end != NULL) scan_memory_expression(e->index.end, use);
+            return;
+        case VOID_EXPRESSION:
+            return;
+    }
+
+    UNREACHABLE("scan_memory_expression fell out of a switch");
+}
+
+void scan_memory_statement(struct statement *s, struct memory_use *use)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            scan_memory_expression(&s->binding_statement.value, use);
+            return;
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+            scan_memory_expression(&s->expression, use);
+            return;
+        case IF_STATEMENT:
+            scan_memory_expression(&s->if_statement.condition, use);
+            scan_memory_statement(s->if_statement.success_statement, use);
+            if (s->if_statement.else_statement != NULL) {
+                scan_memory_statement(s->if_statement.else_statement, use);
+            }
+            return;
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                scan_memory_statement(&s->statements->data[i], use);
+            }
+            return;
+        case WHILE_LOOP_STATEMENT:
+            scan_memory_expression(&s->while_loop_statement.condition, use);
+            scan_memory_statement(s->while_loop_statement.do_statement, use);
+            return;
+        case FOR_LOOP_STATEMENT:
+            scan_memory_expression(&s->for_loop_statement.iterated, use);
+            if (s->for_loop_statement.end != NULL) scan_memory_expression(s->for_loop_statement.end, use);
+            scan_memory_statement(s->for_loop_statement.do_statement, use);
+            return;
+        case SWITCH_STATEMENT:
+        {
+            scan_memory_expression(&s->switch_statement.switch_expression, use);
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                scan_memory_statement(s->switch_statement.cases.data[i].statement, use);
+            }
+            return;
+        }
+        case C_BLOCK_STATEMENT:
+        {
+            use->writes = 1;
+            struct list_type *fn_types = &use->global_context->fn_types;
+            for (size_t i = 0; i < fn_types->size; i++) {
+                if (mentions_identifier(s->c_block_statement.raw_c->data, fn_types->data[i].name->data)) {
+                    use->referenced[i] = 1;
+                }
+            }
+            return;
+        }
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+            return;
+    }
+
+    UNREACHABLE("scan_memory_statement fell out of a switch");
+}
+
+// Whether a field of the struct is an array held by value, which decays to a plain pointer into
+// wherever the struct is kept.
+int holds_array(struct type *ty, struct global_context *global_context)
+{
+    struct type *data_type = find_data_type(global_context, ty->name);
+    if (data_type == NULL || data_type->kind != TY_STRUCT) return 0;
+
+    struct list_key_type_pair *pairs = &data_type->struct_type.pairs;
+    for (size_t i = 0; i < pairs->size; i++) {
+        struct type *field_type = pairs->data[i].field_type;
+        int behind_pointer = 0;
+        for (size_t j = 0; j < field_type->modifiers.size && !behind_pointer; j++) {
+            enum type_modifier_kind kind = field_type->modifiers.data[j].kind;
+            if (kind == ARRAY_MODIFIER_KIND) return 1;
+            behind_pointer = kind == POINTER_MODIFIER_KIND || kind == SLICE_MODIFIER_KIND;
+        }
+        if (!behind_pointer && field_type->kind == TY_STRUCT && holds_array(field_type, global_context)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int is_memory_passed_struct(struct type *ty, struct global_context *global_context)
+{
+    struct layout layout = {0};
+    return ty->kind == TY_STRUCT
+        && ty->modifiers.size == 0
+        && type_layout(ty, global_context, &layout)
+        && layout.size > REGISTER_PASSED_STRUCT_SIZE;
+}
+
+int passes_by_reference(struct key_type_pair *param,
+                        struct type_declaration_statement *declaration,
+                        struct global_context *global_context)
+{
+    struct type *param_type = param->field_type;
+    if (!is_memory_passed_struct(param_type, global_context) || holds_array(param_type, global_context)) {
+        return 0;
+    }
+
+    struct parameter_use use = { .name = &param->field_name };
+    for (size_t i = 0; i < declaration->statements->size; i++) {
+        scan_statement(&declaration->statements->data[i], &use);
+    }
+    return !use.written && !use.reassigned && !use.shadowed;
+}
+
+// Fills in, by index into fn_types, which functions write memory a caller could see and which
+// are named other than by a call, and returns each one's declaration.
+struct type_declaration_statement **scan_functions_memory(struct parsed_file *parsed_file,
+                                                          struct context *context,
+                                                          int *writes,
+                                                          int *referenced)
+{
+    struct global_context *global_context = &parsed_file->global_context;
+    size_t fn_count = global_context->fn_types.size;
+    struct list_int *callees = calloc(fn_count + 1, sizeof(*callees));
+    struct type_declaration_statement **declarations = calloc(fn_count + 1, sizeof(*declarations));
+
+    // functions without a body, the constructors and the arena runtime, could write anything.
+    for (size_t i = 0; i < fn_count; i++) {
+        writes[i] = 1;
+        callees[i] = list_create(int, 1);
+    }
+
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        struct statement *s = &parsed_file->statements.data[i];
+        if (s->kind != TYPE_DECLARATION_STATEMENT
+            || s->type_declaration.type.kind != TY_FUNCTION
+            || s->type_declaration.statements == NULL)
+        {
+            continue;
+        }
+
+        int index = function_index(global_context, s->type_declaration.type.name);
+        if (index < 0) continue;
+        struct memory_use use = {
+            .global_context = global_context,
+            .context = context,
+            .callees = list_create(int, 8),
+            .referenced = referenced
+        };
+        for (size_t j = 0; j < s->type_declaration.statements->size; j++) {
+            scan_memory_statement(&s->type_declaration.statements->data[j], &use);
+        }
+        writes[index] = use.writes;
+        callees[index] = use.callees;
+        declarations[index] = &s->type_declaration;
+    }
+
+    // a function writes whatever the functions it calls write.
+    for (int changed = 1; changed;) {
+        changed = 0;
+        for (size_t i = 0; i < fn_count; i++) {
+            for (size_t j = 0; j < callees[i].size && !writes[i]; j++) {
+                if (writes[callees[i].data[j]]) {
+                    writes[i] = 1;
+                    changed = 1;
+                }
+            }
+        }
+    }
+    return declarations;
+}
+
+int *functions_writing_memory(struct parsed_file *parsed_file, struct context *context)
+{
+    size_t fn_count = parsed_file->global_context.fn_types.size;
+    int *writes = calloc(fn_count + 1, sizeof(int));
+    int *referenced = calloc(fn_count + 1, sizeof(int));
+    scan_functions_memory(parsed_file, context, writes, referenced);
+    return writes;
+}
+
+void choose_struct_passing(struct parsed_file *parsed_file, struct context *context)
+{
+    struct global_context *global_context = &parsed_file->global_context;
+    size_t fn_count = global_context->fn_types.size;
+    int *writes = calloc(fn_count + 1, sizeof(int));
+    int *referenced = calloc(fn_count + 1, sizeof(int));
+    struct type_declaration_statement **declarations =
+        scan_functions_memory(parsed_file, context, writes, referenced);
+
+    for (size_t i = 0; i < fn_count; i++) {
+        struct type_declaration_statement *declaration = declarations[i];
+        // what's called from C, or through a function value, keeps the by-value signature, as does
+        // an async fn, which copies its arguments into the task it returns.
+        if (declaration == NULL
+            || referenced[i]
+            || declaration->type.function_type.is_async
+            || !strcmp(declaration->type.name->data, "main")
+            || has_attribute(&declaration->attributes, "export", NULL))
+        {
+            continue;
+        }
+
+        int returns_through_pointer = is_memory_passed_struct(declaration->type.function_type.return_type,
+                                                              global_context);
+        declaration->type.function_type.returns_through_pointer = returns_through_pointer;
+        global_context->fn_types.data[i].function_type.returns_through_pointer = returns_through_pointer;
+        if (writes[i]) continue;
+
+        struct list_key_type_pair *params = &declaration->type.function_type.params;
+        struct list_key_type_pair *declared_params = &global_context->fn_types.data[i].function_type.params;
+        for (size_t j = 0; j < params->size; j++) {
+            int by_reference = passes_by_reference(&params->data[j], declaration, global_context);
+            params->data[j].by_reference = by_reference;
+            if (j < declared_params->size) declared_params->data[j].by_reference = by_reference;
+        }
+    }
+}
+
+void qualify_loops(struct statement *s, struct context *context, struct global_context *global_context, int *writes)
+{
+    switch (s->kind) {
+        case IF_STATEMENT:
+            qualify_loops(s->if_statement.success_statement, context, global_context, writes);
+            if (s->if_statement.else_statement != NULL) {
+                qualify_loops(s->if_statement.else_statement, context, global_context, writes);
+            }
+            return;
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                qualify_loops(&s->statements->data[i], context, global_context, writes);
+            }
+            return;
+        case WHILE_LOOP_STATEMENT:
+            qualify_loops(s->while_loop_statement.do_statement, context, global_context, writes);
+            return;
+        case SWITCH_STATEMENT:
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                qualify_loops(s->switch_statement.cases.data[i].statement, context, global_context, writes);
+            }
+            return;
+        case FOR_LOOP_STATEMENT:
+        {
+            struct for_loop_statement *for_statement = &s->for_loop_statement;
+            qualify_loops(for_statement->do_statement, context, global_context, writes);
+            if (for_statement->end != NULL || for_statement->parallel) return;
+
+            struct type iterated_type = lut_get(&context->expression_type_lookup, for_statement->iterated.id);
+            struct type element = modifier_inner_type(&iterated_type, 0);
+            struct memory_use use = {
+                .global_context = global_context,
+                .context = context,
+                .stored_type = &element,
+                .callees = list_create(int, 4),
+                .referenced = calloc(global_context->fn_types.size + 1, sizeof(int))
+            };
+            scan_memory_statement(for_statement->do_statement, &use);
+            for (size_t i = 0; i < use.callees.size; i++) {
+                if (writes[use.callees.data[i]]) use.writes = 1;
+            }
+            for_statement->restrict_elements = !use.writes;
+            free(use.callees.data);
+            free(use.referenced);
+            return;
+        }
+        case BINDING_STATEMENT:
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+        case C_BLOCK_STATEMENT:
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+            return;
+    }
+
+    UNREACHABLE("qualify_loops fell out of a switch");
+}
+
+void qualify_element_pointers(struct parsed_file *parsed_file, struct context *context)
+{
+    int *writes = functions_writing_memory(parsed_file, context);
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        struct statement *s = &parsed_file->statements.data[i];
+        if (s->kind != TYPE_DECLARATION_STATEMENT
+            || s->type_declaration.type.kind != TY_FUNCTION
+            || s->type_declaration.statements == NULL)
+        {
+            continue;
+        }
+        for (size_t j = 0; j < s->type_declaration.statements->size; j++) {
+            qualify_loops(&s->type_declaration.statements->data[j], context, &parsed_file->global_context, writes);
+        }
+    }
+    free(writes);
+}
@@ -0,0 +1,35 @@
+#ifndef QUALIFIERS_H
+#define QUALIFIERS_H
+
+#include "context.h"
+#include "parser.h"
+
+// Marks which pointer parameters lower to `const T *` and which to `T *restrict`, see
+// `struct pointer_type_modifier`.
+void qualify_pointer_parameters(struct parsed_file *parsed_file);
+// Marks the struct parameters lowered to a `const T *` to the caller's struct, see
+// `by_reference`. They're the ones too big for registers that the function doesn't change, when
+// nothing the function does could change the caller's struct either. Functions returning a struct
+// that big return it through a pointer instead, see `returns_through_pointer`.
+void choose_struct_passing(struct parsed_file *parsed_file, struct context *context);
+// Marks the `for` loops over slices and arrays whose elements are read through a `restrict`
+// pointer, see `restrict_elements`. The body mustn't store anything that could overlap an element
+// through a pointer or slice, nor call a function that writes memory.
+void qualify_element_pointers(struct parsed_file *parsed_file, struct context *context);
+int mentions_name(struct expression *e, struct list_char *name);
+int statement_mentions_name(struct statement *s, struct list_char *name);
+int pattern_binds(struct switch_pattern *pattern, struct list_char *name);
+int function_index(struct global_context *global_context, struct list_char *name);
+// Whether the expression is a pointer or a slice, so accessing through it reaches shared memory.
+int is_indirect(struct expression *e, struct context *context);
+// Whether `name` could point where `other` does within the body, being `other`, or linked to it
+// through bindings and assignments of values that could hold a pointer. Goes by name alone, a
+// pointer read out of memory isn't followed.
+int may_share_memory(struct list_statement *body,
+                     struct list_char *name,
+                     struct list_char *other,
+                     struct context *context);
+// Which functions, by index into fn_types, write memory their callers could see.
+int *functions_writing_memory(struct parsed_file *parsed_file, struct context *context);
+
+#endif
@@ -0,0 +1,362 @@
+#include <assert.h>
+#include <string.h>
+#include "arena.h"
+#include "ast.h"
+#include "atomics.h"
+#include "context.h"
+#include "coroutines.h"
+#include "layout.h"
+#include "parser.h"
+#include "reachability.h"
+#include "vectors.h"
+#include "../lib/collections.h"
+#include "../lib/utils.h"
+
+struct reachability {
+    struct parsed_file *parsed_file;
+    struct context *context;
+    // indexed like `fn_types` and `data_types`.
+    int *reached_functions;
+    int *reached_types;
+    // `fn_types` indexes whose bodies are still to be walked.
+    struct list_int pending_functions;
+    // the expressions within reached bodies.
+    struct list_int expression_ids;
+};
+
+int find_function_index(struct reachability *r, struct list_char *name, size_t *out)
+{
+    struct list_type *fn_types = &r->parsed_file->global_context.fn_types;
+    for (size_t i = 0; i < fn_types->size; i++) {
+        if (list_char_eq(fn_types->data[i].name, name)) {
+            *out = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+struct type_declaration_statement *find_function_declaration(struct reachability *r, struct list_char *name)
+{
+    struct list_statement *statements = &r->parsed_file->statements;
+    for (size_t i = 0; i < statements->size; i++) {
+        struct statement *s = &statements->data[i];
+        if (s->kind == TYPE_DECLARATION_STATEMENT
+            && s->type_declaration.type.kind == TY_FUNCTION
+            && list_char_eq(s->type_declaration.type.name, name))
+        {
+            return &s->type_declaration;
+        }
+    }
+    return NULL;
+}
+
+void reach_type(struct reachability *r, struct type *ty);
+
+void reach_function(struct reachability *r, size_t index)
+{
+    if (r->reached_functions[index]) return;
+    r->reached_functions[index] = 1;
+    list_append(&r->pending_functions, (int)index);
+    reach_type(r, &r->parsed_file->global_context.fn_types.data[index]);
+}
+
+void reach_type_named(struct reachability *r, struct list_char *name)
+{
+    struct list_type *data_types = &r->parsed_file->global_context.data_types;
+    for (size_t i = 0; i < data_types->size; i++) {
+        if (r->reached_types[i] || !list_char_eq(data_types->data[i].name, name)) continue;
+        r->reached_types[i] = 1;
+        struct type *data_type = &data_types->data[i];
+        struct list_key_type_pair *pairs = data_type->kind == TY_STRUCT
+            ? &data_type->struct_type.pairs
+            : &data_type->enum_type.pairs;
+        for (size_t j = 0; j < pairs->size; j++) {
+            reach_type(r, pairs->data[j].field_type);
+        }
+        return;
+    }
+}
+
+void reach_type(struct reachability *r, struct type *ty)
+{
+    switch (ty->kind) {
+        case TY_STRUCT:
+        case TY_ENUM:
+            if (ty->name != NULL) {
+                reach_type_named(r, ty->name);
+            }
+            return;
+        case TY_FUNCTION:
+        {
+            struct list_key_type_pair *params = &ty->function_type.params;
+            for (size_t i = 0; i < params->size; i++) {
+                reach_type(r, params->data[i].field_type);
+            }
+            if (ty->function_type.return_type != NULL) {
+                reach_type(r, ty->function_type.return_type);
+            }
+            return;
+        }
+        case TY_PRIMITIVE:
+        case TY_ANY:
+            return;
+    }
+}
+
+// A name in an expression is a call, a function passed as a value or a struct or enum literal.
+void reach_name(struct reachability *r, struct list_char *name)
+{
+    size_t index = 0;
+    if (find_function_index(r, name, &index)) {
+        reach_function(r, index);
+    }
+    reach_type_named(r, name);
+}
+
+void reach_expression(struct reachability *r, struct expression *e)
+{
+    list_append(&r->expression_ids, (int)e->id);
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            if (e->literal.kind == LITERAL_NAME) {
+                reach_name(r, e->literal.name);
+            } else if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                reach_type_named(r, e->literal.struct_enum.name);
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    reach_expression(r, pairs->data[i].expression);
+                }
+            }
+            return;
+        }
+        case UNARY_EXPRESSION:
+            reach_expression(r, e->unary.expression);
+            return;
+        case BINARY_EXPRESSION:
+            reach_expression(r, e->binary.l);
+            reach_expression(r, e->binary.r);
+            return;
+        case GROUP_EXPRESSION:
+            reach_expression(r, e->grouped);
+            return;
+        case FUNCTION_EXPRESSION:
+        {
+            reach_name(r, e->function.function_name);
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                reach_expression(r, &e->function.params->data[i]);
+            }
+            return;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+            reach_expression(r, e->member_access.accessed);
+            return;
+        case INDEX_EXPRESSION:
+            reach_expression(r, e->index.indexed);
+            reach_expression(r, e->index.index);
+            if (e->index.end != NULL) {
+                reach_expression(r, e->index.end);
+            }
+            return;
+        case VOID_EXPRESSION:
+            return;
+    }
+}
+
+// Inline C can call or name anything it mentions.
+void reach_c_block(struct reachability *r, struct c_block_statement *c_block)
+{
+    struct global_context *global_context = &r->parsed_file->global_context;
+    for (size_t i = 0; i < global_context->fn_types.size; i++) {
+        if (mentions_identifier(c_block->raw_c->data, global_context->fn_types.data[i].name->data)) {
+            reach_function(r, i);
+        }
+    }
+    for (size_t i = 0; i < global_context->data_types.size; i++) {
+        struct list_char *name = global_context->data_types.data[i].name;
+        if (mentions_identifier(c_block->raw_c->data, name->data)) {
+            reach_type_named(r, name);
+        }
+    }
+}
+
+void reach_statement(struct reachability *r, struct statement *s)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            if (s->binding_statement.has_type) {
+                reach_type(r, &s->binding_statement.variable_type);
+            }
+            reach_expression(r, &s->binding_statement.value);
+            return;
+        case IF_STATEMENT:
+            reach_expression(r, &s->if_statement.condition);
+            reach_statement(r, s->if_statement.success_statement);
+            if (s->if_statement.else_statement != NULL) {
+                reach_statement(r, s->if_statement.else_statement);
+            }
+            return;
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+            reach_expression(r, &s->expression);
+            return;
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                reach_statement(r, &s->statements->data[i]);
+            }
+            return;
+        case WHILE_LOOP_STATEMENT:
+            reach_expression(r, &s->while_loop_statement.condition);
+            reach_statement(r, s->while_loop_statement.do_statement);
+            return;
+        case FOR_LOOP_STATEMENT:
+            reach_expression(r, &s->for_loop_statement.iterated);
+            if (s->for_loop_statement.end != NULL) {
+                reach_expression(r, s->for_loop_statement.end);
+            }
+            reach_statement(r, s->for_loop_statement.do_statement);
+            return;
+        case SWITCH_STATEMENT:
+            reach_expression(r, &s->switch_statement.switch_expression);
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                reach_statement(r, s->switch_statement.cases.data[i].statement);
+            }
+            return;
+        case C_BLOCK_STATEMENT:
+            reach_c_block(r, &s->c_block_statement);
+            return;
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+            return;
+    }
+}
+
+int is_reached_declaration(struct reachability *r, struct type *ty)
+{
+    struct global_context *global_context = &r->parsed_file->global_context;
+    struct list_type *types = ty->kind == TY_FUNCTION ? &global_context->fn_types : &global_context->data_types;
+    int *reached = ty->kind == TY_FUNCTION ? r->reached_functions : r->reached_types;
+    for (size_t i = 0; i < types->size; i++) {
+        if (list_char_eq(types->data[i].name, ty->name)) return reached[i];
+    }
+    return 1;
+}
+
+void eliminate_unreachable(struct parsed_file *parsed_file, struct context *context)
+{
+    struct global_context *global_context = &parsed_file->global_context;
+    struct reachability r = {
+        .parsed_file = parsed_file,
+        .context = context,
+        .reached_functions = calloc(global_context->fn_types.size + 1, sizeof(int)),
+        .reached_types = calloc(global_context->data_types.size + 1, sizeof(int)),
+        .pending_functions = list_create(int, 16),
+        .expression_ids = list_create(int, 256)
+    };
+
+    int has_main = 0;
+    for (size_t i = 0; i < global_context->fn_types.size; i++) {
+        if (strcmp(global_context->fn_types.data[i].name->data, "main") == 0) {
+            reach_function(&r, i);
+            has_main = 1;
+        }
+    }
+    if (!has_main) return;
+
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        struct statement *s = &parsed_file->statements.data[i];
+        if (s->kind != TYPE_DECLARATION_STATEMENT
+            || !has_attribute(&s->type_declaration.attributes, "export", NULL))
+        {
+            continue;
+        }
+
+        size_t index = 0;
+        if (s->type_declaration.type.kind == TY_FUNCTION
+            && find_function_index(&r, s->type_declaration.type.name, &index))
+        {
+            reach_function(&r, index);
+        } else {
+            reach_type_named(&r, s->type_declaration.type.name);
+        }
+    }
+
+    while (r.pending_functions.size > 0) {
+        size_t index = (size_t)r.pending_functions.data[--r.pending_functions.size];
+        struct type_declaration_statement *declaration =
+            find_function_declaration(&r, global_context->fn_types.data[index].name);
+        if (declaration == NULL || declaration->statements == NULL) continue;
+        for (size_t i = 0; i < declaration->statements->size; i++) {
+            reach_statement(&r, &declaration->statements->data[i]);
+        }
+    }
+
+    // whatever type a reached expression has is reached too, which covers inferred bindings.
+    int max_id = 0;
+    struct list_int *keys = context->expression_type_lookup.keys;
+    for (size_t i = 0; i < keys->size; i++) {
+        if (keys->data[i] > max_id) max_id = keys->data[i];
+    }
+    char *kept_ids = calloc((size_t)max_id + 1, 1);
+    for (size_t i = 0; i < r.expression_ids.size; i++) {
+        if (r.expression_ids.data[i] <= max_id) kept_ids[r.expression_ids.data[i]] = 1;
+    }
+    struct list_int *kept_keys = create_boxed_list_int(keys->size + 1);
+    for (size_t i = 0; i < keys->size; i++) {
+        if (!kept_ids[keys->data[i]]) continue;
+        list_append(kept_keys, keys->data[i]);
+        reach_type(&r, &lut_get(&context->expression_type_lookup, keys->data[i]));
+    }
+    context->expression_type_lookup.keys = kept_keys;
+
+    // constructors have no body, they go with the struct they build, as a task's methods go with
+    // its async fn, whose resume calls its awaited fns' too. The arena, vector and atomic
+    // functions are kept when they're called.
+    for (size_t i = 0; i < global_context->fn_types.size; i++) {
+        struct type *fn = &global_context->fn_types.data[i];
+        enum primitive_type primitive = 0;
+        char *operation = NULL;
+        struct type *async_fn = task_method(fn->name, global_context, &operation);
+        size_t async_index = 0;
+        if (async_fn != NULL && find_function_index(&r, async_fn->name, &async_index)) {
+            r.reached_functions[i] = r.reached_functions[async_index];
+            continue;
+        }
+        if (find_function_declaration(&r, fn->name) == NULL
+            && !is_arena_function(fn->name)
+            && !vector_function(fn->name, &primitive, &operation)
+            && !atomic_function(fn->name, &primitive, &operation))
+        {
+            struct type *returned = fn->function_type.return_type;
+            r.reached_functions[i] = returned->kind != TY_STRUCT || is_reached_declaration(&r, returned);
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        struct statement *s = &parsed_file->statements.data[i];
+        if (s->kind == TYPE_DECLARATION_STATEMENT && !is_reached_declaration(&r, &s->type_declaration.type)) {
+            continue;
+        }
+        parsed_file->statements.data[kept++] = *s;
+    }
+    parsed_file->statements.size = kept;
+
+    kept = 0;
+    for (size_t i = 0; i < global_context->fn_types.size; i++) {
+        if (r.reached_functions[i]) {
+            global_context->fn_types.data[kept++] = global_context->fn_types.data[i];
+        }
+    }
+    global_context->fn_types.size = kept;
+
+    kept = 0;
+    for (size_t i = 0; i < global_context->data_types.size; i++) {
+        if (r.reached_types[i]) {
+            global_context->data_types.data[kept++] = global_context->data_types.data[i];
+        }
+    }
+    global_context->data_types.size = kept;
+}
@@ -0,0 +1,11 @@
+#ifndef REACHABILITY_H
+#define REACHABILITY_H
+
+#include "context.h"
+#include "parser.h"
+
+// Drops the functions and types nothing reachable from `main`, or from a declaration marked
+// `#[export]`, uses, so they're never lowered. A file without a `main` is left whole.
+void eliminate_unreachable(struct parsed_file *parsed_file, struct context *context);
+
+#endif
@@ -1,11 +1,17 @@
 #include "soundness.h"
 #include "ast.h"
 #include "context.h"
+#include "type_inference.h"
 #include "parser.h"
 #include "error.h"
+#include "atomics.h"
+#include "coroutines.h"
+#include "layout.h"
+#include "qualifiers.h"
 #include "../lib/collections.h"
 #include "../lib/utils.h"
 #include <assert.h>
+#include <string.h>
 
 typedef struct string {
     struct list_char name;
@@ -13,6 +19,13 @@ typedef struct string {
 
 struct_list(string);
 
+// The function whose body is being checked, which tells what its variables could have been copied
+// from.
+static struct {
+    struct list_statement *body;
+    struct context *context;
+} checked_function;
+
 static void add_error_inner(struct statement_metadata *metadata,
                             char *error_message,
                             struct error *out)
@@ -30,6 +43,56 @@ int check_expression_soundness(struct expression *e,
                                struct list_scoped_variable *scoped_variables,
                                struct list_char *error);
 
+// An enum literal names one variant, with a payload unless the variant is declared `void`.
+int check_enum_literal_soundness(struct literal_expression *e,
+                                 struct global_context *global_context,
+                                 struct list_scoped_variable *scoped_variables,
+                                 struct list_char *error)
+{
+    struct type *data_type = NULL;
+    for (size_t i = 0; i < global_context->data_types.size && data_type == NULL; i++) {
+        if (global_context->data_types.data[i].kind == TY_ENUM
+            && list_char_eq(global_context->data_types.data[i].name, e->struct_enum.name))
+        {
+            data_type = &global_context->data_types.data[i];
+        }
+    }
+    if (data_type == NULL) {
+        append_list_char_slice(error, "enum `");
+        append_list_char_slice(error, e->struct_enum.name->data);
+        append_list_char_slice(error, "` does not exist.");
+        return 0;
+    }
+
+    if (e->struct_enum.key_expr_pairs.size != 1) {
+        append_list_char_slice(error, "an enum literal must name exactly one variant.");
+        return 0;
+    }
+
+    struct key_expression *literal_pair = &e->struct_enum.key_expr_pairs.data[0];
+    for (size_t i = 0; i < data_type->enum_type.pairs.size; i++) {
+        struct key_type_pair *variant = &data_type->enum_type.pairs.data[i];
+        if (!list_char_eq(literal_pair->key, &variant->field_name)) continue;
+
+        int has_payload = literal_pair->expression->kind != VOID_EXPRESSION;
+        if (has_payload == is_void_type(variant->field_type)) {
+            append_list_char_slice(error, "the variant `");
+            append_list_char_slice(error, variant->field_name.data);
+            append_list_char_slice(error, has_payload ? "` carries no payload." : "` needs a payload.");
+            return 0;
+        }
+        return !has_payload
+            || check_expression_soundness(literal_pair->expression, global_context, scoped_variables, error);
+    }
+
+    append_list_char_slice(error, "enum `");
+    append_list_char_slice(error, e->struct_enum.name->data);
+    append_list_char_slice(error, "` has no variant `");
+    append_list_char_slice(error, literal_pair->key->data);
+    append_list_char_slice(error, "`.");
+    return 0;
+}
+
 int check_literal_expression_soundness(struct literal_expression *e,
                                        struct global_context *global_context,
                                        struct list_scoped_variable *scoped_variables,
@@ -57,22 +120,15 @@ int check_literal_expression_soundness(struct literal_expression *e,
             append_list_char_slice(error, "` is not in the current scope.");
             return 0;
         }
-        case LITERAL_STRUCT:
         case LITERAL_ENUM:
+            return check_enum_literal_soundness(e, global_context, scoped_variables, error);
+        case LITERAL_STRUCT:
         {
             struct list_char *name = e->struct_enum.name;
             for (size_t i = 0; i < global_context->data_types.size; i++) {
                 struct type *data_type = &global_context->data_types.data[i];
-                if (list_char_eq(data_type->name, name)) {
-                    struct list_key_type_pair *pairs = NULL;
-                    if (data_type->kind != TY_ENUM) {
-                        pairs = &data_type->enum_type.pairs;
-                    } else if (data_type->kind != TY_STRUCT) {
-                        pairs = &data_type->struct_type.pairs;
-                    } else {
-                        UNREACHABLE("data types are either enums or structs.");
-                    }
-                    assert(pairs);
+                if (data_type->kind == TY_STRUCT && list_char_eq(data_type->name, name)) {
+                    struct list_key_type_pair *pairs = &data_type->struct_type.pairs;
 
                     if (pairs->size < e->struct_enum.key_expr_pairs.size) {
                         append_list_char_slice(error, "too many fields provided.");
@@ -126,6 +182,84 @@ int expression_is_literal_name(struct expression *e)
     return e->kind == LITERAL_EXPRESSION && e->literal.kind == LITERAL_NAME;
 }
 
+int is_mutable_pointer(struct type *ty)
+{
+    return ty->modifiers.size > 1
+        && ty->modifiers.data[0].kind == POINTER_MODIFIER_KIND
+        && ty->modifiers.data[1].kind == MUTABLE_MODIFIER_KIND;
+}
+
+// A `*mut` parameter is meant to be the only way the callee reaches its pointee, so the variable
+// passed to it can't be passed to another pointer parameter of the same call, nor can a copy of
+// it. Going by names, this misses pointers read out of memory or returned by calls, which is why
+// `restrict` is only emitted where the parameters' types rule aliasing out.
+int check_exclusive_arguments(struct function_expression *call,
+                              struct global_context *global_context,
+                              struct list_char *error)
+{
+    struct type *fn = NULL;
+    for (size_t i = 0; i < global_context->fn_types.size && fn == NULL; i++) {
+        if (list_char_eq(call->function_name, global_context->fn_types.data[i].name)) {
+            fn = &global_context->fn_types.data[i];
+        }
+    }
+    if (fn == NULL || fn->function_type.params.size != call->params->size) return 1;
+
+    struct list_key_type_pair *params = &fn->function_type.params;
+    for (size_t i = 0; i < params->size; i++) {
+        struct expression *argument = &call->params->data[i];
+        while (argument->kind == GROUP_EXPRESSION) {
+            argument = argument->grouped;
+        }
+        if (!is_mutable_pointer(params->data[i].field_type) || !expression_is_literal_name(argument)) {
+            continue;
+        }
+
+        for (size_t j = 0; j < params->size; j++) {
+            struct expression *other = &call->params->data[j];
+            while (other->kind == GROUP_EXPRESSION) {
+                other = other->grouped;
+            }
+            struct type *other_type = params->data[j].field_type;
+            if (j == i
+                || other_type->modifiers.size == 0
+                || other_type->modifiers.data[0].kind != POINTER_MODIFIER_KIND
+                || !expression_is_literal_name(other))
+            {
+                continue;
+            }
+
+            int same = list_char_eq(argument->literal.name, other->literal.name);
+            if (!same
+                && (checked_function.body == NULL
+                    || !may_share_memory(checked_function.body,
+                                         argument->literal.name,
+                                         other->literal.name,
+                                         checked_function.context)))
+            {
+                continue;
+            }
+
+            append_list_char_slice(error, "`");
+            append_list_char_slice(error, argument->literal.name->data);
+            append_list_char_slice(error, "` is passed to `");
+            append_list_char_slice(error, params->data[i].field_name.data);
+            if (same) {
+                append_list_char_slice(error, "`, a `*mut` parameter, so it can't also be passed to `");
+            } else {
+                append_list_char_slice(error, "`, a `*mut` parameter, so `");
+                append_list_char_slice(error, other->literal.name->data);
+                append_list_char_slice(error, "`, which could point where it does, can't be passed to `");
+            }
+            append_list_char_slice(error, params->data[j].field_name.data);
+            append_list_char_slice(error, "`.");
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 int check_expression_soundness(struct expression *e,
                                struct global_context *global_context,
                                struct list_scoped_variable *scoped_variables,
@@ -151,9 +285,12 @@ int check_expression_soundness(struct expression *e,
             return check_expression_soundness(e->binary.l, global_context, scoped_variables, error)
                 && check_expression_soundness(e->binary.r, global_context, scoped_variables, error);
         case FUNCTION_EXPRESSION:
-        {
-            return 1;
-        }
+            return check_exclusive_arguments(&e->function, global_context, error);
+        case INDEX_EXPRESSION:
+            return check_expression_soundness(e->index.indexed, global_context, scoped_variables, error)
+                && check_expression_soundness(e->index.index, global_context, scoped_variables, error)
+                && (e->index.end == NULL
+                    || check_expression_soundness(e->index.end, global_context, scoped_variables, error));
         case VOID_EXPRESSION:
         case MEMBER_ACCESS_EXPRESSION:
             return 1;
@@ -162,6 +299,35 @@ int check_expression_soundness(struct expression *e,
     return 1;
 }
 
+// `atomic` goes last, on an integer or bool, behind pointers and arrays alone. Only storage that
+// stays put holds one by value, as a copy of it would be a plain access.
+int check_atomic_type_soundness(struct type *ty, int stays_put, struct list_char *error)
+{
+    int behind_pointer = 0;
+    for (size_t m = 0; m < ty->modifiers.size; m++) {
+        enum type_modifier_kind kind = ty->modifiers.data[m].kind;
+        if (kind == POINTER_MODIFIER_KIND) behind_pointer = 1;
+        if (kind != ATOMIC_MODIFIER_KIND) continue;
+
+        if (m != ty->modifiers.size - 1 || ty->kind != TY_PRIMITIVE || !is_atomic_primitive(ty->primitive_type)) {
+            append_list_char_slice(error, "`atomic` goes on an integer or `bool`, as in `atomic u64`.");
+            return 0;
+        }
+        for (size_t before = 0; before < m; before++) {
+            enum type_modifier_kind outer = ty->modifiers.data[before].kind;
+            if (outer != POINTER_MODIFIER_KIND && outer != ARRAY_MODIFIER_KIND && outer != MUTABLE_MODIFIER_KIND) {
+                append_list_char_slice(error, "an atomic can only be behind a pointer or in an array, as in `*atomic u64`.");
+                return 0;
+            }
+        }
+        if (!stays_put && !behind_pointer) {
+            append_list_char_slice(error, "parameters, return values and enum payloads are copies, an atomic is passed by pointer.");
+            return 0;
+        }
+    }
+    return 1;
+}
+
 int check_struct_soundness(struct type *type,
                            struct global_context *global_context,
                            struct list_char *error)
@@ -202,6 +368,27 @@ int check_struct_soundness(struct type *type,
 
     for (size_t i = 0; i < pairs.size; i++) {
         struct type *ty = pairs.data[i].field_type;
+        if (!check_atomic_type_soundness(ty, 1, error)) return 0;
+        int by_value = ty->modifiers.size == 0 || ty->modifiers.data[0].kind != POINTER_MODIFIER_KIND;
+        if (by_value
+            && ty->modifiers.size > 0
+            && ty->modifiers.data[ty->modifiers.size - 1].kind == ATOMIC_MODIFIER_KIND
+            && has_attribute(type->struct_type.attributes, "packed", NULL))
+        {
+            append_list_char_slice(error, "`packed` would misalign the atomic field `");
+            append_list_char_slice(error, pairs.data[i].field_name.data);
+            append_list_char_slice(error, "`.");
+            return 0;
+        }
+        // each field of a `#[soa]` struct becomes an array, and C has no arrays of flexible arrays.
+        if (is_flexible_array(ty) && has_attribute(type->struct_type.attributes, "soa", NULL)) {
+            append_list_char_slice(error, "`soa` can't split `");
+            append_list_char_slice(error, type->name->data);
+            append_list_char_slice(error, "`, its field `");
+            append_list_char_slice(error, pairs.data[i].field_name.data);
+            append_list_char_slice(error, "` has no fixed size.");
+            return 0;
+        }
         for (size_t m = 0; m < ty->modifiers.size; m++) {
             struct type_modifier *modifier = &ty->modifiers.data[m];
             if (modifier->kind == ARRAY_MODIFIER_KIND)
@@ -235,7 +422,17 @@ int check_struct_soundness(struct type *type,
                         append_list_char_slice(error, "`");
                         return 0;
                     }
-                } else {
+
+                    // it lowers to a flexible array member, which C only allows at the end.
+                    if (m != 0 || i != pairs.size - 1) {
+                        append_list_char_slice(error, "field `");
+                        append_list_char_slice(error, pairs.data[i].field_name.data);
+                        append_list_char_slice(error, "` of struct `");
+                        append_list_char_slice(error, type->name->data);
+                        append_list_char_slice(error, "` is sized by a field, so must be its last field.");
+                        return 0;
+                    }
+                } else if (!modifier->array_modifier.literally_sized) {
                     // It's not sized, let's ensure it's a pointer.
                     if (m >= 1 && ty->modifiers.data[m - 1].kind == POINTER_MODIFIER_KIND) {
                         continue;
@@ -255,11 +452,70 @@ int check_struct_soundness(struct type *type,
     return 1;
 }
 
-int check_enum_soundness(struct enum_type type,
+int check_enum_soundness(struct type *type,
                          struct global_context *global_context,
-                         struct error *error)
+                         struct list_char *error)
 {
-    TODO("check_enum_soundness");
+    assert(type->kind == TY_ENUM);
+    int enum_count = 0;
+    for (size_t i = 0; i < global_context->data_types.size; i++) {
+        if (list_char_eq(type->name, global_context->data_types.data[i].name)) {
+            enum_count += 1;
+            if (enum_count > 1) {
+                append_list_char_slice(error, "`enum ");
+                append_list_char_slice(error, type->name->data);
+                append_list_char_slice(error, "` already exists.");
+                return 0;
+            }
+        }
+    }
+
+    struct list_key_type_pair pairs = type->enum_type.pairs;
+    if (pairs.size == 0) {
+        append_list_char_slice(error, "`enum ");
+        append_list_char_slice(error, type->name->data);
+        append_list_char_slice(error, "` must have at least one variant.");
+        return 0;
+    }
+
+    for (size_t i = 0; i < pairs.size; i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (list_char_eq(&pairs.data[j].field_name, &pairs.data[i].field_name)) {
+                append_list_char_slice(error, "variant `");
+                append_list_char_slice(error, pairs.data[i].field_name.data);
+                append_list_char_slice(error, "` already exists on enum `");
+                append_list_char_slice(error, type->name->data);
+                append_list_char_slice(error, "`.");
+                return 0;
+            }
+        }
+
+        // a payload is stored inline, so it needs a size known up front.
+        struct type *ty = pairs.data[i].field_type;
+        if (!check_atomic_type_soundness(ty, 0, error)) return 0;
+        int by_value = 1;
+        for (size_t m = 0; m < ty->modifiers.size && by_value; m++) {
+            struct type_modifier *modifier = &ty->modifiers.data[m];
+            by_value = modifier->kind != POINTER_MODIFIER_KIND;
+            if (by_value && modifier->kind == ARRAY_MODIFIER_KIND && !modifier->array_modifier.literally_sized) {
+                append_list_char_slice(error, "variant `");
+                append_list_char_slice(error, pairs.data[i].field_name.data);
+                append_list_char_slice(error, "` of enum `");
+                append_list_char_slice(error, type->name->data);
+                append_list_char_slice(error, "` must have a pointer modifier or known length.");
+                return 0;
+            }
+        }
+
+        if (by_value && ty->kind == TY_ENUM && list_char_eq(ty->name, type->name)) {
+            append_list_char_slice(error, "variant `");
+            append_list_char_slice(error, pairs.data[i].field_name.data);
+            append_list_char_slice(error, "` holds its own enum, it needs a pointer modifier.");
+            return 0;
+        }
+    }
+
+    return 1;
 }
 
 int check_fn_soundness(struct type_declaration_statement *type_declaration,
@@ -268,6 +524,8 @@ int check_fn_soundness(struct type_declaration_statement *type_declaration,
                        struct error *error)
 {
     assert(type_declaration->type.kind == TY_FUNCTION);
+    checked_function.body = type_declaration->statements;
+    checked_function.context = context;
     for (size_t i = 0; i < type_declaration->statements->size; i++) {
         struct statement *this = &type_declaration->statements->data[i];
         if (!check_statement_soundness(this, global_context, context, error)) return 0;
@@ -310,10 +568,12 @@ int check_binding_statement_soundness(struct statement *s,
         }
     }
 
-    if (!check_expression_soundness(&s->binding_statement.value,
-                                    global_context,
-                                    scoped_variables,
-                                    &error_message))
+    if ((s->binding_statement.has_type
+         && !check_atomic_type_soundness(&s->binding_statement.variable_type, 1, &error_message))
+        || !check_expression_soundness(&s->binding_statement.value,
+                                       global_context,
+                                       scoped_variables,
+                                       &error_message))
     {
         struct statement_metadata metadata =
             lut_get(&global_context->metadata_lookup, s->id);
@@ -465,6 +725,296 @@ int check_while_statement_soundness(struct statement *s,
     return 1;
 }
 
+// Whether the expression assigns to an element of the array or slice `name`, as in `name[i] = x`.
+int is_access(struct expression *e);
+struct expression *accessed_by(struct expression *e);
+struct list_char *access_root_name(struct expression *e);
+
+typedef struct path_step {
+    struct expression *step;
+} path_step;
+
+struct_list(path_step);
+
+// The accesses from the variable the expression starts at out to the expression, groups left out.
+struct list_path_step access_path(struct expression *e)
+{
+    struct list_path_step reversed = list_create(path_step, 8);
+    for (; is_access(e); e = accessed_by(e)) {
+        if (e->kind != GROUP_EXPRESSION) list_append(&reversed, ((struct path_step) { .step = e }));
+    }
+    list_append(&reversed, ((struct path_step) { .step = e }));
+
+    struct list_path_step path = list_create(path_step, (reversed.size + 1));
+    for (size_t i = reversed.size; i > 0; i--) {
+        list_append(&path, reversed.data[i - 1]);
+    }
+    free(reversed.data);
+    return path;
+}
+
+// Whether any access from `from` on follows a pointer or slice, past which it could be anywhere.
+// Those before it are shared with the path it's compared to.
+int follows_pointer(struct list_path_step *path, size_t from, struct context *context)
+{
+    for (size_t i = from; i < path->size; i++) {
+        struct expression *step = path->data[i].step;
+        if (step->kind == UNARY_EXPRESSION
+            || (step->kind == MEMBER_ACCESS_EXPRESSION && is_indirect(step->member_access.accessed, context))
+            || (step->kind == INDEX_EXPRESSION && is_indirect(step->index.indexed, context)))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Whether assigning `target` could write what `iterated` holds, or the other way around. Fields of
+// the same variable are told apart by name, unless a pointer is followed past where they part.
+// Indexes aren't told apart, nor are variables that could be copies of each other.
+int could_overlap(struct expression *target, struct expression *iterated, struct context *context)
+{
+    struct list_path_step target_path = access_path(target);
+    struct list_path_step iterated_path = access_path(iterated);
+    struct expression *target_root = target_path.data[0].step;
+    struct expression *iterated_root = iterated_path.data[0].step;
+
+    // a value made for the loop isn't reached any other way.
+    int overlaps = 0;
+    if (iterated_root->kind != LITERAL_EXPRESSION || iterated_root->literal.kind != LITERAL_NAME) {
+        overlaps = 0;
+    } else if (target_root->kind != LITERAL_EXPRESSION || target_root->literal.kind != LITERAL_NAME) {
+        overlaps = 1;
+    } else if (!list_char_eq(target_root->literal.name, iterated_root->literal.name)) {
+        overlaps = checked_function.body != NULL
+            && may_share_memory(checked_function.body,
+                                target_root->literal.name,
+                                iterated_root->literal.name,
+                                context);
+    } else {
+        overlaps = 1;
+        size_t common = target_path.size < iterated_path.size ? target_path.size : iterated_path.size;
+        for (size_t i = 1; i < common; i++) {
+            struct expression *l = target_path.data[i].step;
+            struct expression *r = iterated_path.data[i].step;
+            if (l->kind == MEMBER_ACCESS_EXPRESSION
+                && r->kind == MEMBER_ACCESS_EXPRESSION
+                && !list_char_eq(l->member_access.member_name, r->member_access.member_name))
+            {
+                overlaps = follows_pointer(&target_path, i + 1, context)
+                    || follows_pointer(&iterated_path, i + 1, context);
+                break;
+            }
+        }
+    }
+
+    free(target_path.data);
+    free(iterated_path.data);
+    return overlaps;
+}
+
+int assigns_into(struct expression *e, struct expression *iterated, struct context *context)
+{
+    switch (e->kind) {
+        case BINARY_EXPRESSION:
+            if (e->binary.binary_op == ASSIGN_BINARY && could_overlap(e->binary.l, iterated, context)) return 1;
+            return assigns_into(e->binary.l, iterated, context) || assigns_into(e->binary.r, iterated, context);
+        case UNARY_EXPRESSION:
+            return assigns_into(e->unary.expression, iterated, context);
+        case GROUP_EXPRESSION:
+            return assigns_into(e->grouped, iterated, context);
+        case FUNCTION_EXPRESSION:
+        {
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                if (assigns_into(&e->function.params->data[i], iterated, context)) return 1;
+            }
+            return 0;
+        }
+        case INDEX_EXPRESSION:
+            return assigns_into(e->index.indexed, iterated, context)
+                || assigns_into(e->index.index, iterated, context)
+                || (e->index.end != NULL && assigns_into(e->index.end, iterated, context));
+        case MEMBER_ACCESS_EXPRESSION:
+            return assigns_into(e->member_access.accessed, iterated, context);
+        case LITERAL_EXPRESSION:
+        case VOID_EXPRESSION:
+            return 0;
+    }
+    return 0;
+}
+
+int statement_assigns_into(struct statement *s, struct expression *iterated, struct context *context)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            return assigns_into(&s->binding_statement.value, iterated, context);
+        case RETURN_STATEMENT:
+        case ACTION_STATEMENT:
+            return assigns_into(&s->expression, iterated, context);
+        case IF_STATEMENT:
+            return assigns_into(&s->if_statement.condition, iterated, context)
+                || statement_assigns_into(s->if_statement.success_statement, iterated, context)
+                || (s->if_statement.else_statement != NULL
+                    && statement_assigns_into(s->if_statement.else_statement, iterated, context));
+        case BLOCK_STATEMENT:
+        {
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (statement_assigns_into(&s->statements->data[i], iterated, context)) return 1;
+            }
+            return 0;
+        }
+        case WHILE_LOOP_STATEMENT:
+            return assigns_into(&s->while_loop_statement.condition, iterated, context)
+                || statement_assigns_into(s->while_loop_statement.do_statement, iterated, context);
+        case FOR_LOOP_STATEMENT:
+            return statement_assigns_into(s->for_loop_statement.do_statement, iterated, context);
+        case SWITCH_STATEMENT:
+        {
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                if (statement_assigns_into(s->switch_statement.cases.data[i].statement, iterated, context)) return 1;
+            }
+            return 0;
+        }
+        case TYPE_DECLARATION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return 0;
+    }
+    return 0;
+}
+
+int check_for_statement_soundness(struct statement *s,
+                                  struct global_context *global_context,
+                                  struct context *context,
+                                  struct error *error)
+{
+    assert(s->kind == FOR_LOOP_STATEMENT);
+    struct for_loop_statement *for_statement = &s->for_loop_statement;
+    struct list_char error_message = list_create(char, 100);
+    struct list_scoped_variable *scoped_variables =
+        &lut_get(&context->statement_scope_lookup, s->id).scoped_variables;
+    struct statement_metadata metadata =
+        lut_get(&global_context->metadata_lookup, s->id);
+
+    if (!check_expression_soundness(&for_statement->iterated, global_context, scoped_variables, &error_message)
+        || (for_statement->end != NULL
+            && !check_expression_soundness(for_statement->end, global_context, scoped_variables, &error_message)))
+    {
+        add_error_inner(&metadata, error_message.data, error);
+        return 0;
+    }
+
+    // the elements are read through a `restrict` pointer, so the body mustn't write them another way.
+    struct expression *iterated = &for_statement->iterated;
+    while (iterated->kind == GROUP_EXPRESSION) {
+        iterated = iterated->grouped;
+    }
+    if (for_statement->end == NULL && statement_assigns_into(for_statement->do_statement, iterated, context)) {
+        struct list_char *root = access_root_name(iterated);
+        if (root == NULL) {
+            append_list_char_slice(&error_message, "the elements can't be assigned while a `for` iterates them.");
+        } else if (iterated->kind == LITERAL_EXPRESSION) {
+            append_list_char_slice(&error_message, "the elements of `");
+            append_list_char_slice(&error_message, root->data);
+            append_list_char_slice(&error_message, "` can't be assigned while a `for` iterates them.");
+        } else {
+            append_list_char_slice(&error_message, "the elements a `for` iterates within `");
+            append_list_char_slice(&error_message, root->data);
+            append_list_char_slice(&error_message, "` can't be assigned while it iterates them.");
+        }
+        add_error_inner(&metadata, error_message.data, error);
+        return 0;
+    }
+
+    return check_statement_soundness(for_statement->do_statement, global_context, context, error);
+}
+
+int same_pattern(struct switch_pattern *l, struct switch_pattern *r)
+{
+    if (l->switch_pattern_kind != r->switch_pattern_kind) {
+        return 0;
+    }
+
+    switch (l->switch_pattern_kind) {
+        case NUMBER_PATTERN_KIND:
+            return l->number_pattern.number == r->number_pattern.number;
+        case STRING_PATTERN_KIND:
+            return list_char_eq(&l->string_pattern.str, &r->string_pattern.str);
+        default:
+            return 0;
+    }
+}
+
+int is_catch_all_pattern(struct switch_pattern *p)
+{
+    return p->switch_pattern_kind == VARIABLE_PATTERN_KIND
+        || p->switch_pattern_kind == UNDERSCORE_PATTERN_KIND;
+}
+
+int check_switch_statement_soundness(struct statement *s,
+                                     struct global_context *global_context,
+                                     struct context *context,
+                                     struct error *error)
+{
+    assert(s->kind == SWITCH_STATEMENT);
+    struct switch_statement *switch_statement = &s->switch_statement;
+    struct list_char error_message = list_create(char, 100);
+    struct list_scoped_variable *scoped_variables =
+        &lut_get(&context->statement_scope_lookup, s->id).scoped_variables;
+    struct statement_metadata metadata =
+        lut_get(&global_context->metadata_lookup, s->id);
+
+    if (!check_expression_soundness(&switch_statement->switch_expression,
+                                    global_context,
+                                    scoped_variables,
+                                    &error_message))
+    {
+        add_error_inner(&metadata, error_message.data, error);
+        return 0;
+    }
+
+    for (size_t i = 0; i < switch_statement->cases.size; i++) {
+        struct switch_pattern *pattern = &switch_statement->cases.data[i].pattern;
+        switch (pattern->switch_pattern_kind) {
+            case REST_PATTERN_KIND:
+            {
+                add_error_inner(&metadata, "`..` can only be used within an object or array pattern.", error);
+                return 0;
+            }
+            case OBJECT_PATTERN_KIND:
+            case ARRAY_PATTERN_KIND:
+            case NUMBER_PATTERN_KIND:
+            case STRING_PATTERN_KIND:
+            case VARIABLE_PATTERN_KIND:
+            case UNDERSCORE_PATTERN_KIND:
+                break;
+        }
+
+        if (is_catch_all_pattern(pattern) && i + 1 < switch_statement->cases.size) {
+            add_error_inner(&metadata, "cases after a catch all pattern can never match.", error);
+            return 0;
+        }
+
+        for (size_t j = 0; j < i; j++) {
+            if (same_pattern(&switch_statement->cases.data[j].pattern, pattern)) {
+                add_error_inner(&metadata, "a switch cannot match the same pattern twice.", error);
+                return 0;
+            }
+        }
+
+        if (!check_statement_soundness(switch_statement->cases.data[i].statement,
+                                       global_context,
+                                       context,
+                                       error))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 int check_statement_soundness(struct statement *s,
                               struct global_context *global_context,
                               struct context *context,
@@ -483,9 +1033,12 @@ int check_statement_soundness(struct statement *s,
             return check_action_statement_soundness(s, global_context, context, error);
         case WHILE_LOOP_STATEMENT:
             return check_while_statement_soundness(s, global_context, context, error);
-        case BREAK_STATEMENT:
+        case FOR_LOOP_STATEMENT:
+            return check_for_statement_soundness(s, global_context, context, error);
         case SWITCH_STATEMENT:
-            return 0;
+            return check_switch_statement_soundness(s, global_context, context, error);
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
         case C_BLOCK_STATEMENT:
             return 1;
         case TYPE_DECLARATION_STATEMENT:
@@ -496,18 +1049,623 @@ int check_statement_soundness(struct statement *s,
 }
 
 
+int has_argument_named(struct attribute *attribute, char *argument)
+{
+    return attribute->has_argument
+        && attribute->argument.data != NULL
+        && strcmp(attribute->argument.data, argument) == 0;
+}
+
+int check_attribute_soundness(struct attribute *attribute,
+                              enum type_kind declaration_kind,
+                              struct list_char *error)
+{
+    char *name = attribute->name.data;
+    if (declaration_kind == TY_STRUCT && strcmp(name, "repr") == 0) {
+        if (has_argument_named(attribute, "declared")) return 1;
+        append_list_char_slice(error, "`repr` must be given `declared`, as in `#[repr(declared)]`.");
+        return 0;
+    }
+
+    // packing and alignment are GCC's, the layout follows them.
+    if (declaration_kind == TY_STRUCT && strcmp(name, "packed") == 0) {
+        if (!attribute->has_argument) return 1;
+        append_list_char_slice(error, "`packed` takes no argument.");
+        return 0;
+    }
+    // arrays of the struct are laid out as an array per field.
+    if (declaration_kind == TY_STRUCT && strcmp(name, "soa") == 0) {
+        if (!attribute->has_argument) return 1;
+        append_list_char_slice(error, "`soa` takes no argument.");
+        return 0;
+    }
+    if ((declaration_kind == TY_STRUCT || declaration_kind == TY_FUNCTION) && strcmp(name, "align") == 0) {
+        double n = attribute->numeric_argument;
+        size_t whole = (size_t)n;
+        if (attribute->has_argument
+            && attribute->argument.data == NULL
+            && n >= 1
+            && (double)whole == n
+            && (whole & (whole - 1)) == 0)
+        {
+            return 1;
+        }
+        append_list_char_slice(error, "`align` must be given a power of two, as in `#[align(64)]`.");
+        return 0;
+    }
+
+    // hints to GCC's optimiser.
+    char *hints[] = { "hot", "cold", "inline", "noinline", "flatten" };
+    for (size_t i = 0; i < sizeof(hints) / sizeof(*hints); i++) {
+        if (declaration_kind != TY_FUNCTION || strcmp(name, hints[i]) != 0) continue;
+        if (!attribute->has_argument) return 1;
+        append_list_char_slice(error, "`");
+        append_list_char_slice(error, name);
+        append_list_char_slice(error, "` takes no argument.");
+        return 0;
+    }
+
+    // kept through dead code elimination, whether or not `main` uses it.
+    if (strcmp(name, "export") == 0) {
+        if (!attribute->has_argument) return 1;
+        append_list_char_slice(error, "`export` takes no argument.");
+        return 0;
+    }
+
+    append_list_char_slice(error, "`");
+    append_list_char_slice(error, name);
+    append_list_char_slice(error, "` is not an attribute this declaration understands.");
+    return 0;
+}
+
+int check_attribute_conflicts(struct list_attribute *attributes, struct list_char *error)
+{
+    char *conflicts[][2] = { { "hot", "cold" }, { "inline", "noinline" } };
+    for (size_t i = 0; i < sizeof(conflicts) / sizeof(*conflicts); i++) {
+        if (!has_attribute(attributes, conflicts[i][0], NULL)
+            || !has_attribute(attributes, conflicts[i][1], NULL))
+        {
+            continue;
+        }
+        append_list_char_slice(error, "`");
+        append_list_char_slice(error, conflicts[i][0]);
+        append_list_char_slice(error, "` and `");
+        append_list_char_slice(error, conflicts[i][1]);
+        append_list_char_slice(error, "` can't both be given.");
+        return 0;
+    }
+    return 1;
+}
+
+// What a `parallel for` body may touch. Its iterations run at once, so beyond its own variables it
+// only writes the elements its loop variable indexes, and only reads the variables it writes at
+// that index too.
+struct parallel_loop {
+    struct list_char *variable;
+    // the variables in scope outside the loop, which every iteration shares.
+    struct list_scoped_variable *outer;
+    // those the body writes at the loop variable's index.
+    struct list_string written;
+    struct global_context *global_context;
+    struct context *context;
+    int *writes;
+};
+
+int is_outer_variable(struct parallel_loop *loop, struct list_char *name)
+{
+    if (list_char_eq(name, loop->variable)) return 0;
+    for (size_t i = 0; i < loop->outer->size; i++) {
+        if (list_char_eq(&loop->outer->data[i].name, name)) return 1;
+    }
+    return 0;
+}
+
+int is_written_variable(struct parallel_loop *loop, struct list_char *name)
+{
+    for (size_t i = 0; i < loop->written.size; i++) {
+        if (list_char_eq(&loop->written.data[i].name, name)) return 1;
+    }
+    return 0;
+}
+
+// The variable the body writes that `name` could reach the memory of, `name` itself or one it was
+// copied from or to, NULL when there's none.
+struct list_char *written_memory(struct parallel_loop *loop, struct list_char *name)
+{
+    for (size_t i = 0; i < loop->written.size; i++) {
+        struct list_char *written = &loop->written.data[i].name;
+        if (list_char_eq(written, name)
+            || (checked_function.body != NULL
+                && may_share_memory(checked_function.body, name, written, loop->context)))
+        {
+            return written;
+        }
+    }
+    return NULL;
+}
+
+int is_access(struct expression *e)
+{
+    return e->kind == GROUP_EXPRESSION
+        || e->kind == MEMBER_ACCESS_EXPRESSION
+        || e->kind == INDEX_EXPRESSION
+        || (e->kind == UNARY_EXPRESSION && e->unary.unary_operator == STAR_UNARY);
+}
+
+struct expression *accessed_by(struct expression *e)
+{
+    switch (e->kind) {
+        case GROUP_EXPRESSION:
+            return e->grouped;
+        case MEMBER_ACCESS_EXPRESSION:
+            return e->member_access.accessed;
+        case INDEX_EXPRESSION:
+            return e->index.indexed;
+        default:
+            return e->unary.expression;
+    }
+}
+
+struct list_char *access_root_name(struct expression *e)
+{
+    while (is_access(e)) {
+        e = accessed_by(e);
+    }
+    return e->kind == LITERAL_EXPRESSION && e->literal.kind == LITERAL_NAME ? e->literal.name : NULL;
+}
+
+// Whether the accesses reach a part of the variable only this iteration touches, by indexing it
+// with the loop variable and following no pointer past that index.
+int reaches_own_element(struct expression *e, struct parallel_loop *loop)
+{
+    int dereferenced = 0;
+    struct expression *lowest_index = NULL;
+    int dereferenced_above_lowest = 0;
+    for (; is_access(e); e = accessed_by(e)) {
+        if (e->kind == INDEX_EXPRESSION) {
+            lowest_index = e;
+            dereferenced_above_lowest = dereferenced;
+        }
+        if (e->kind == UNARY_EXPRESSION
+            || (e->kind == MEMBER_ACCESS_EXPRESSION && is_indirect(e->member_access.accessed, loop->context))
+            || (e->kind == INDEX_EXPRESSION && is_indirect(e->index.indexed, loop->context)))
+        {
+            dereferenced = 1;
+        }
+    }
+    if (lowest_index == NULL || lowest_index->index.end != NULL || dereferenced_above_lowest) return 0;
+
+    struct expression *index = lowest_index->index.index;
+    while (index->kind == GROUP_EXPRESSION) {
+        index = index->grouped;
+    }
+    return index->kind == LITERAL_EXPRESSION
+        && index->literal.kind == LITERAL_NAME
+        && list_char_eq(index->literal.name, loop->variable);
+}
+
+int check_parallel_target(struct expression *target, struct parallel_loop *loop, struct list_char *error)
+{
+    struct list_char *root = access_root_name(target);
+    if (root != NULL && list_char_eq(root, loop->variable)) {
+        append_list_char_slice(error, "a `parallel for` can't assign its loop variable.");
+        return 0;
+    }
+    if (root != NULL && is_outer_variable(loop, root)) {
+        if (!reaches_own_element(target, loop)) {
+            append_list_char_slice(error, "a `parallel for` can only assign `");
+            append_list_char_slice(error, root->data);
+            append_list_char_slice(error, "` at an index of the loop variable, other iterations share it.");
+            return 0;
+        }
+        if (!is_written_variable(loop, root)) {
+            list_append(&loop->written, ((struct string) { .name = *root }));
+        }
+        return 1;
+    }
+
+    // a variable of the body's own is fine, unless it points somewhere shared.
+    for (struct expression *e = target; is_access(e); e = accessed_by(e)) {
+        if (e->kind == UNARY_EXPRESSION
+            || (e->kind == MEMBER_ACCESS_EXPRESSION && is_indirect(e->member_access.accessed, loop->context))
+            || (e->kind == INDEX_EXPRESSION && is_indirect(e->index.indexed, loop->context)))
+        {
+            append_list_char_slice(error, "a `parallel for` can't assign through a pointer or slice, other iterations could share what it points to.");
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Finds what the body writes when `reading` is 0, and checks what it reads when it's 1, once every
+// write is known.
+int check_parallel_expression(struct expression *e, struct parallel_loop *loop, int reading, struct list_char *error)
+{
+    if (is_access(e) || (e->kind == LITERAL_EXPRESSION && e->literal.kind == LITERAL_NAME)) {
+        struct list_char *root = access_root_name(e);
+        struct list_char *written = reading && root != NULL ? written_memory(loop, root) : NULL;
+        if (written != NULL) {
+            struct type ty = lut_get(&loop->context->expression_type_lookup, e->id);
+            int whole_scalar = ty.kind == TY_PRIMITIVE && ty.modifiers.size == 0;
+            int has_index = 0;
+            for (struct expression *a = e; is_access(a); a = accessed_by(a)) {
+                if (a->kind == INDEX_EXPRESSION) has_index = 1;
+            }
+            if (!reaches_own_element(e, loop) && (has_index || !whole_scalar)) {
+                append_list_char_slice(error, "a `parallel for` assigns elements of `");
+                append_list_char_slice(error, written->data);
+                if (list_char_eq(written, root)) {
+                    append_list_char_slice(error, "`, so it can only read the one at the loop variable's index.");
+                } else {
+                    append_list_char_slice(error, "`, which `");
+                    append_list_char_slice(error, root->data);
+                    append_list_char_slice(error, "` could point into, so it can only read the one at the loop variable's index.");
+                }
+                return 0;
+            }
+        }
+
+        struct expression *a = e;
+        for (; is_access(a); a = accessed_by(a)) {
+            if (a->kind != INDEX_EXPRESSION) continue;
+            if (!check_parallel_expression(a->index.index, loop, reading, error)) return 0;
+            if (a->index.end != NULL && !check_parallel_expression(a->index.end, loop, reading, error)) return 0;
+        }
+        return root != NULL || check_parallel_expression(a, loop, reading, error);
+    }
+
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    if (!check_parallel_expression(pairs->data[i].expression, loop, reading, error)) return 0;
+                }
+            }
+            return 1;
+        }
+        case UNARY_EXPRESSION:
+            return check_parallel_expression(e->unary.expression, loop, reading, error);
+        case BINARY_EXPRESSION:
+            if (e->binary.binary_op == ASSIGN_BINARY && !reading && !check_parallel_target(e->binary.l, loop, error)) {
+                return 0;
+            }
+            return check_parallel_expression(e->binary.l, loop, reading, error)
+                && check_parallel_expression(e->binary.r, loop, reading, error);
+        case FUNCTION_EXPRESSION:
+        {
+            // atomics are how iterations share what they write.
+            enum primitive_type primitive = 0;
+            char *operation = NULL;
+            int atomic = atomic_function(e->function.function_name, &primitive, &operation);
+            int index = function_index(loop->global_context, e->function.function_name);
+            if (index < 0 || (loop->writes[index] && !atomic)) {
+                append_list_char_slice(error, "a `parallel for` can't call `");
+                append_list_char_slice(error, e->function.function_name->data);
+                append_list_char_slice(error, "`, it could write memory other iterations share.");
+                return 0;
+            }
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                if (!check_parallel_expression(&e->function.params->data[i], loop, reading, error)) return 0;
+            }
+            return 1;
+        }
+        case GROUP_EXPRESSION:
+        case MEMBER_ACCESS_EXPRESSION:
+        case INDEX_EXPRESSION:
+        case VOID_EXPRESSION:
+            return 1;
+    }
+
+    UNREACHABLE("check_parallel_expression fell out of a switch");
+}
+
+int check_parallel_binds(struct list_char *name, struct parallel_loop *loop, struct list_char *error)
+{
+    if (!is_outer_variable(loop, name) && !list_char_eq(name, loop->variable)) return 1;
+    append_list_char_slice(error, "`");
+    append_list_char_slice(error, name->data);
+    append_list_char_slice(error, "` can't be shadowed within a `parallel for`.");
+    return 0;
+}
+
+// `loops` counts the loops within the body that a `break` would leave.
+int check_parallel_statement(struct statement *s,
+                             struct parallel_loop *loop,
+                             int loops,
+                             int reading,
+                             struct statement **failed,
+                             struct list_char *error)
+{
+    *failed = s;
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            return check_parallel_binds(&s->binding_statement.variable_name, loop, error)
+                && check_parallel_expression(&s->binding_statement.value, loop, reading, error);
+        case ACTION_STATEMENT:
+            return check_parallel_expression(&s->expression, loop, reading, error);
+        case RETURN_STATEMENT:
+            append_list_char_slice(error, "a `parallel for` can't be returned from.");
+            return 0;
+        case BREAK_STATEMENT:
+            if (loops > 0) return 1;
+            append_list_char_slice(error, "a `parallel for` can't be broken out of, its iterations run at once.");
+            return 0;
+        case CONTINUE_STATEMENT:
+            return 1;
+        case C_BLOCK_STATEMENT:
+            append_list_char_slice(error, "a `parallel for` can't run C, it couldn't be checked for races.");
+            return 0;
+        case IF_STATEMENT:
+            if (!check_parallel_expression(&s->if_statement.condition, loop, reading, error)
+                || !check_parallel_statement(s->if_statement.success_statement, loop, loops, reading, failed, error))
+            {
+                return 0;
+            }
+            return s->if_statement.else_statement == NULL
+                || check_parallel_statement(s->if_statement.else_statement, loop, loops, reading, failed, error);
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (!check_parallel_statement(&s->statements->data[i], loop, loops, reading, failed, error)) return 0;
+            }
+            return 1;
+        case WHILE_LOOP_STATEMENT:
+            return check_parallel_expression(&s->while_loop_statement.condition, loop, reading, error)
+                && check_parallel_statement(s->while_loop_statement.do_statement, loop, loops + 1, reading, failed, error);
+        case FOR_LOOP_STATEMENT:
+        {
+            struct for_loop_statement *for_statement = &s->for_loop_statement;
+            if (for_statement->parallel) {
+                append_list_char_slice(error, "a `parallel for` can't be nested in another.");
+                return 0;
+            }
+            return check_parallel_binds(&for_statement->variable_name, loop, error)
+                && check_parallel_expression(&for_statement->iterated, loop, reading, error)
+                && (for_statement->end == NULL
+                    || check_parallel_expression(for_statement->end, loop, reading, error))
+                && check_parallel_statement(for_statement->do_statement, loop, loops + 1, reading, failed, error);
+        }
+        case SWITCH_STATEMENT:
+        {
+            struct switch_statement *switch_statement = &s->switch_statement;
+            if (!check_parallel_expression(&switch_statement->switch_expression, loop, reading, error)) return 0;
+            for (size_t i = 0; i < switch_statement->cases.size; i++) {
+                struct case_statement *c = &switch_statement->cases.data[i];
+                for (size_t j = 0; j < loop->outer->size; j++) {
+                    if (pattern_binds(&c->pattern, &loop->outer->data[j].name)) {
+                        return check_parallel_binds(&loop->outer->data[j].name, loop, error);
+                    }
+                }
+                if (pattern_binds(&c->pattern, loop->variable)) return check_parallel_binds(loop->variable, loop, error);
+                if (!check_parallel_statement(c->statement, loop, loops, reading, failed, error)) return 0;
+            }
+            return 1;
+        }
+        case TYPE_DECLARATION_STATEMENT:
+            return 1;
+    }
+
+    UNREACHABLE("check_parallel_statement fell out of a switch");
+}
+
+int check_parallel_loop(struct statement *s,
+                        struct global_context *global_context,
+                        struct context *context,
+                        int *writes,
+                        struct error *error)
+{
+    struct for_loop_statement *for_statement = &s->for_loop_statement;
+    struct list_char error_message = list_create(char, 100);
+    struct statement *failed = s;
+    struct parallel_loop loop = {
+        .variable = &for_statement->variable_name,
+        .outer = &lut_get(&context->statement_scope_lookup, s->id).scoped_variables,
+        .written = list_create(string, 4),
+        .global_context = global_context,
+        .context = context,
+        .writes = writes
+    };
+
+    int sound = 1;
+    if (for_statement->end == NULL) {
+        append_list_char_slice(&error_message, "a `parallel for` runs over a range, as in `parallel for (i in 0..n)`.");
+        sound = 0;
+    }
+    sound = sound
+        && check_parallel_statement(for_statement->do_statement, &loop, 0, 0, &failed, &error_message)
+        && check_parallel_statement(for_statement->do_statement, &loop, 0, 1, &failed, &error_message);
+    if (!sound) {
+        struct statement_metadata metadata = lut_get(&global_context->metadata_lookup, failed->id);
+        add_error_inner(&metadata, error_message.data, error);
+    }
+    return sound;
+}
+
+// Checks each `parallel for` within the statement, `writes` is worked out for the first.
+int check_parallel_loops(struct statement *s,
+                         struct parsed_file *parsed_file,
+                         struct context *context,
+                         int **writes,
+                         struct error *error)
+{
+    switch (s->kind) {
+        case IF_STATEMENT:
+            return check_parallel_loops(s->if_statement.success_statement, parsed_file, context, writes, error)
+                && (s->if_statement.else_statement == NULL
+                    || check_parallel_loops(s->if_statement.else_statement, parsed_file, context, writes, error));
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (!check_parallel_loops(&s->statements->data[i], parsed_file, context, writes, error)) return 0;
+            }
+            return 1;
+        case WHILE_LOOP_STATEMENT:
+            return check_parallel_loops(s->while_loop_statement.do_statement, parsed_file, context, writes, error);
+        case FOR_LOOP_STATEMENT:
+            if (!s->for_loop_statement.parallel) {
+                return check_parallel_loops(s->for_loop_statement.do_statement, parsed_file, context, writes, error);
+            }
+            if (*writes == NULL) *writes = functions_writing_memory(parsed_file, context);
+            return check_parallel_loop(s, &parsed_file->global_context, context, *writes, error);
+        case SWITCH_STATEMENT:
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                struct statement *case_statement = s->switch_statement.cases.data[i].statement;
+                if (!check_parallel_loops(case_statement, parsed_file, context, writes, error)) return 0;
+            }
+            return 1;
+        case BINDING_STATEMENT:
+        case ACTION_STATEMENT:
+        case RETURN_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+        case TYPE_DECLARATION_STATEMENT:
+            return 1;
+    }
+
+    UNREACHABLE("check_parallel_loops fell out of a switch");
+}
+
+int await_placement_error(struct statement *s,
+                          char *message,
+                          struct global_context *global_context,
+                          struct error *error)
+{
+    struct statement_metadata metadata = lut_get(&global_context->metadata_lookup, s->id);
+    add_error_inner(&metadata, message, error);
+    return 0;
+}
+
+// An `await` is the whole value of a binding, action or return statement within an async fn. It
+// can't be within a `switch` or a `for` over elements, whose C keeps state of its own that resuming
+// would jump past. `outside` says why there can't be one here, NULL where there can.
+int check_await_placement(struct statement *s,
+                          int in_async,
+                          char *outside,
+                          struct global_context *global_context,
+                          struct error *error)
+{
+    char *nested = "an `await` must be the whole value of a `let`, a `return` or a statement of its own.";
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+        case ACTION_STATEMENT:
+        case RETURN_STATEMENT:
+        {
+            struct expression *await = awaited(s);
+            if (await == NULL && !statement_awaits(s)) return 1;
+            if (outside != NULL) return await_placement_error(s, outside, global_context, error);
+            if (await == NULL || expression_awaits(await->unary.expression)) {
+                return await_placement_error(s, nested, global_context, error);
+            }
+            return 1;
+        }
+        case IF_STATEMENT:
+            if (expression_awaits(&s->if_statement.condition)) {
+                return await_placement_error(s, outside != NULL ? outside : nested, global_context, error);
+            }
+            return check_await_placement(s->if_statement.success_statement, in_async, outside, global_context, error)
+                && (s->if_statement.else_statement == NULL
+                    || check_await_placement(s->if_statement.else_statement, in_async, outside, global_context, error));
+        case WHILE_LOOP_STATEMENT:
+            if (expression_awaits(&s->while_loop_statement.condition)) {
+                return await_placement_error(s, outside != NULL ? outside : nested, global_context, error);
+            }
+            return check_await_placement(s->while_loop_statement.do_statement, in_async, outside, global_context, error);
+        case FOR_LOOP_STATEMENT:
+        {
+            struct for_loop_statement *for_statement = &s->for_loop_statement;
+            if (expression_awaits(&for_statement->iterated)
+                || (for_statement->end != NULL && expression_awaits(for_statement->end)))
+            {
+                return await_placement_error(s, outside != NULL ? outside : nested, global_context, error);
+            }
+            // its body is a function of its own, which can't reach the frame.
+            if (in_async && for_statement->parallel) {
+                return await_placement_error(s, "a `parallel for` can't be within an `async fn`.", global_context, error);
+            }
+            if (outside == NULL && for_statement->end == NULL) {
+                outside = "an `await` can't be within a `for` over elements, loop over their indexes instead.";
+            }
+            return check_await_placement(for_statement->do_statement, in_async, outside, global_context, error);
+        }
+        case SWITCH_STATEMENT:
+            if (expression_awaits(&s->switch_statement.switch_expression)) {
+                return await_placement_error(s, outside != NULL ? outside : nested, global_context, error);
+            }
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                if (!check_await_placement(s->switch_statement.cases.data[i].statement,
+                                           in_async,
+                                           outside != NULL ? outside : "an `await` can't be within a `switch`.",
+                                           global_context,
+                                           error))
+                {
+                    return 0;
+                }
+            }
+            return 1;
+        case BLOCK_STATEMENT:
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (!check_await_placement(&s->statements->data[i], in_async, outside, global_context, error)) return 0;
+            }
+            return 1;
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+        case TYPE_DECLARATION_STATEMENT:
+            return 1;
+    }
+
+    UNREACHABLE("check_await_placement fell out of a switch");
+}
+
 int soundness_check(struct parsed_file *parsed_file,
                     struct context *context,
                     struct error *error)
 {
+    int *writes = NULL;
     for (size_t i = 0; i < parsed_file->statements.size; i++) {
         struct statement *s = &parsed_file->statements.data[i];
         switch (s->kind) {
             case TYPE_DECLARATION_STATEMENT:
             {
+                struct list_attribute *attributes = &s->type_declaration.attributes;
+                for (size_t a = 0; a < attributes->size; a++) {
+                    struct list_char error_message = list_create(char, 100);
+                    if (!check_attribute_soundness(&attributes->data[a],
+                                                   s->type_declaration.type.kind,
+                                                   &error_message))
+                    {
+                        struct statement_metadata metadata =
+                            lut_get(&parsed_file->global_context.metadata_lookup, s->id);
+                        add_error_inner(&metadata, error_message.data, error);
+                        return 0;
+                    }
+                }
+                struct list_char conflict_message = list_create(char, 100);
+                if (!check_attribute_conflicts(attributes, &conflict_message)) {
+                    struct statement_metadata metadata =
+                        lut_get(&parsed_file->global_context.metadata_lookup, s->id);
+                    add_error_inner(&metadata, conflict_message.data, error);
+                    return 0;
+                }
+
                 switch (s->type_declaration.type.kind) {
                     case TY_FUNCTION:
                     {
+                        struct function_type *function_type = &s->type_declaration.type.function_type;
+                        struct list_char error_message = list_create(char, 100);
+                        int signature_sound = check_atomic_type_soundness(function_type->return_type, 0, &error_message);
+                        for (size_t j = 0; j < function_type->params.size && signature_sound; j++) {
+                            signature_sound = check_atomic_type_soundness(function_type->params.data[j].field_type,
+                                                                          0,
+                                                                          &error_message);
+                        }
+                        if (!signature_sound) {
+                            struct statement_metadata metadata =
+                                lut_get(&parsed_file->global_context.metadata_lookup, s->id);
+                            add_error_inner(&metadata, error_message.data, error);
+                            return 0;
+                        }
                         if (!check_fn_soundness(&s->type_declaration,
                                                 &parsed_file->global_context,
                                                 context,
@@ -515,6 +1673,25 @@ int soundness_check(struct parsed_file *parsed_file,
                         {
                             return 0;
                         }
+                        int is_async = function_type->is_async;
+                        if (is_async && !strcmp(s->type_declaration.type.name->data, "main")) {
+                            struct statement_metadata metadata =
+                                lut_get(&parsed_file->global_context.metadata_lookup, s->id);
+                            add_error_inner(&metadata, "`main` can't be `async`, it's what resumes the tasks.", error);
+                            return 0;
+                        }
+                        for (size_t j = 0; j < s->type_declaration.statements->size; j++) {
+                            struct statement *statement = &s->type_declaration.statements->data[j];
+                            if (!check_await_placement(statement,
+                                                       is_async,
+                                                       is_async ? NULL : "`await` can only be used within an `async fn`.",
+                                                       &parsed_file->global_context,
+                                                       error))
+                            {
+                                return 0;
+                            }
+                            if (!check_parallel_loops(statement, parsed_file, context, &writes, error)) return 0;
+                        }
                         break;
                     }
                     case TY_STRUCT:
@@ -534,9 +1711,9 @@ int soundness_check(struct parsed_file *parsed_file,
                     case TY_ENUM:
                     {
                         struct list_char error_message = list_create(char, 100);
-                        if (!check_enum_soundness(s->type_declaration.type.enum_type,
+                        if (!check_enum_soundness(&s->type_declaration.type,
                                                   &parsed_file->global_context,
-                                                  error))
+                                                  &error_message))
                         {
                             struct statement_metadata metadata =
                                 lut_get(&parsed_file->global_context.metadata_lookup, s->id);
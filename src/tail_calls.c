@@ -0,0 +1,577 @@
+#include <assert.h>
+#include <string.h>
+#include "ast.h"
+#include "parser.h"
+#include "error.h"
+#include "tail_calls.h"
+#include "../lib/collections.h"
+#include "../lib/utils.h"
+
+// Self recursive functions are rewritten into a `while (true)` loop around their body, where
+// a tail call reassigns the parameters and `continue`s. Returns of the form `e + f(..)` or
+// `e * f(..)` are also handled by threading an accumulator through the loop:
+//
+// fn factorial(input: i32) -> i32 {      fn factorial(input: i32) -> i32 {
+//     if input == 0 {                        let __tail_acc: i32 = 1;
+//         return 1;                          while (true) {
+//     }                              =>          if input == 0 { return __tail_acc; }
+//     return input * factorial(input - 1);       { __tail_acc = __tail_acc * (input); input = input - 1; continue; }
+// }                                              break;
+//                                            }
+//                                        }
+
+enum tail_kind {
+    TAIL_NONE = 1,
+    TAIL_DIRECT,
+    TAIL_ACCUMULATE,
+    TAIL_UNSUPPORTED
+};
+
+struct tail_call_state {
+    struct parsed_file *parsed_file;
+    struct type *fn;
+    struct statement_metadata metadata;
+    int found_tail_call;
+    int accumulate;
+    enum binary_operator accumulator_op;
+    int c_block_returns;
+};
+
+struct expression *strip_groups(struct expression *e)
+{
+    while (e->kind == GROUP_EXPRESSION) {
+        e = e->grouped;
+    }
+    return e;
+}
+
+int is_self_call(struct expression *e, struct type *fn)
+{
+    e = strip_groups(e);
+    return e->kind == FUNCTION_EXPRESSION
+        && !e->function.method_call
+        && list_char_eq(e->function.function_name, fn->name)
+        && e->function.params->size == fn->function_type.params.size;
+}
+
+int mentions_self(struct expression *e, struct type *fn)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            if (e->literal.kind == LITERAL_NAME) {
+                return list_char_eq(e->literal.name, fn->name);
+            }
+
+            if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    if (mentions_self(pairs->data[i].expression, fn)) return 1;
+                }
+            }
+            return 0;
+        }
+        case UNARY_EXPRESSION:
+            return mentions_self(e->unary.expression, fn);
+        case BINARY_EXPRESSION:
+            return mentions_self(e->binary.l, fn) || mentions_self(e->binary.r, fn);
+        case GROUP_EXPRESSION:
+            return mentions_self(e->grouped, fn);
+        case FUNCTION_EXPRESSION:
+        {
+            if (list_char_eq(e->function.function_name, fn->name)) return 1;
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                if (mentions_self(&e->function.params->data[i], fn)) return 1;
+            }
+            return 0;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+            return mentions_self(e->member_access.accessed, fn);
+        case INDEX_EXPRESSION:
+            return mentions_self(e->index.indexed, fn)
+                || mentions_self(e->index.index, fn)
+                || (e->index.end != NULL && mentions_self(e->index.end, fn));
+        case VOID_EXPRESSION:
+            return 0;
+    }
+
+    UNREACHABLE("mentions_self fell out of a switch");
+}
+
+int is_accumulator_op(enum binary_operator op)
+{
+    return op == PLUS_BINARY || op == MULTIPLY_BINARY;
+}
+
+// For `return e OP f(..)` (or `f(..) OP e`) sets the call and the other operand.
+enum tail_kind classify_return(struct expression *e,
+                               struct type *fn,
+                               struct expression **call,
+                               struct expression **other,
+                               enum binary_operator *op)
+{
+    if (!mentions_self(e, fn)) {
+        return TAIL_NONE;
+    }
+
+    if (is_self_call(e, fn)) {
+        struct expression *stripped = strip_groups(e);
+        for (size_t i = 0; i < stripped->function.params->size; i++) {
+            if (mentions_self(&stripped->function.params->data[i], fn)) return TAIL_UNSUPPORTED;
+        }
+        *call = stripped;
+        return TAIL_DIRECT;
+    }
+
+    struct expression *stripped = strip_groups(e);
+    if (stripped->kind != BINARY_EXPRESSION || !is_accumulator_op(stripped->binary.binary_op)) {
+        return TAIL_UNSUPPORTED;
+    }
+
+    struct expression *l = stripped->binary.l;
+    struct expression *r = stripped->binary.r;
+    if (is_self_call(r, fn) && !mentions_self(l, fn)) {
+        *call = strip_groups(r);
+        *other = l;
+    } else if (is_self_call(l, fn) && !mentions_self(r, fn)) {
+        *call = strip_groups(l);
+        *other = r;
+    } else {
+        return TAIL_UNSUPPORTED;
+    }
+
+    for (size_t i = 0; i < (*call)->function.params->size; i++) {
+        if (mentions_self(&(*call)->function.params->data[i], fn)) return TAIL_UNSUPPORTED;
+    }
+
+    *op = stripped->binary.binary_op;
+    return TAIL_ACCUMULATE;
+}
+
+// Checks every self reference is a call in tail position, outside of any user written loop.
+int analyse_statement(struct statement *s, struct tail_call_state *state, int loop_depth)
+{
+    switch (s->kind) {
+        case RETURN_STATEMENT:
+        {
+            struct expression *call = NULL;
+            struct expression *other = NULL;
+            enum binary_operator op = 0;
+            switch (classify_return(&s->expression, state->fn, &call, &other, &op)) {
+                case TAIL_NONE:
+                    return 1;
+                case TAIL_DIRECT:
+                    state->found_tail_call = 1;
+                    return loop_depth == 0;
+                case TAIL_ACCUMULATE:
+                {
+                    if (loop_depth > 0) return 0;
+                    if (state->accumulate && state->accumulator_op != op) return 0;
+                    state->found_tail_call = 1;
+                    state->accumulate = 1;
+                    state->accumulator_op = op;
+                    return 1;
+                }
+                case TAIL_UNSUPPORTED:
+                    return 0;
+            }
+            return 0;
+        }
+        case BINDING_STATEMENT:
+            return !mentions_self(&s->binding_statement.value, state->fn);
+        case ACTION_STATEMENT:
+            return !mentions_self(&s->expression, state->fn);
+        case IF_STATEMENT:
+        {
+            if (mentions_self(&s->if_statement.condition, state->fn)) return 0;
+            if (!analyse_statement(s->if_statement.success_statement, state, loop_depth)) return 0;
+            return s->if_statement.else_statement == NULL
+                || analyse_statement(s->if_statement.else_statement, state, loop_depth);
+        }
+        case WHILE_LOOP_STATEMENT:
+        {
+            if (mentions_self(&s->while_loop_statement.condition, state->fn)) return 0;
+            return analyse_statement(s->while_loop_statement.do_statement, state, loop_depth + 1);
+        }
+        case FOR_LOOP_STATEMENT:
+        {
+            if (mentions_self(&s->for_loop_statement.iterated, state->fn)) return 0;
+            if (s->for_loop_statement.end != NULL && mentions_self(s->for_loop_statement.end, state->fn)) {
+                return 0;
+            }
+            return analyse_statement(s->for_loop_statement.do_statement, state, loop_depth + 1);
+        }
+        case BLOCK_STATEMENT:
+        {
+            for (size_t i = 0; i < s->statements->size; i++) {
+                if (!analyse_statement(&s->statements->data[i], state, loop_depth)) return 0;
+            }
+            return 1;
+        }
+        case SWITCH_STATEMENT:
+        {
+            if (mentions_self(&s->switch_statement.switch_expression, state->fn)) return 0;
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                struct case_statement *c = &s->switch_statement.cases.data[i];
+                if (!analyse_statement(c->statement, state, loop_depth)) return 0;
+            }
+            return 1;
+        }
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+            // these would now target the loop we introduce.
+            return loop_depth > 0;
+        case C_BLOCK_STATEMENT:
+        {
+            char *raw_c = s->c_block_statement.raw_c->data;
+            if (mentions_identifier(raw_c, state->fn->name->data)) return 0;
+            if (loop_depth == 0
+                && (mentions_identifier(raw_c, "break") || mentions_identifier(raw_c, "continue")))
+            {
+                return 0;
+            }
+            state->c_block_returns |= mentions_identifier(raw_c, "return");
+            return 1;
+        }
+        case TYPE_DECLARATION_STATEMENT:
+            return 1;
+    }
+
+    UNREACHABLE("analyse_statement fell out of a switch");
+}
+
+struct list_char prefixed_name(char *prefix, struct list_char *name)
+{
+    struct list_char output = list_create(char, 20);
+    append_list_char_slice(&output, prefix);
+    copy_list_char(&output, name);
+    list_append(&output, '\0');
+    return output;
+}
+
+struct statement new_statement(struct tail_call_state *state, enum statement_kind kind)
+{
+    struct statement output = (struct statement) {
+        .kind = kind,
+        .id = state->parsed_file->next_statement_id++
+    };
+    lut_add(&state->parsed_file->global_context.metadata_lookup, output.id, state->metadata);
+    return output;
+}
+
+struct expression *new_expression(struct tail_call_state *state, struct expression e)
+{
+    struct expression *output = malloc(sizeof(*output));
+    *output = e;
+    output->id = state->parsed_file->next_expression_id++;
+    return output;
+}
+
+struct expression *name_expression(struct tail_call_state *state, struct list_char name)
+{
+    struct list_char *boxed = malloc(sizeof(*boxed));
+    *boxed = name;
+    return new_expression(state, (struct expression) {
+        .kind = LITERAL_EXPRESSION,
+        .literal = (struct literal_expression) {
+            .kind = LITERAL_NAME,
+            .name = boxed
+        }
+    });
+}
+
+struct expression *binary_expression(struct tail_call_state *state,
+                                     enum binary_operator op,
+                                     struct expression *l,
+                                     struct expression *r)
+{
+    return new_expression(state, (struct expression) {
+        .kind = BINARY_EXPRESSION,
+        .binary = (struct binary_expression) {
+            .binary_op = op,
+            .l = l,
+            .r = r
+        }
+    });
+}
+
+struct expression *group_expression(struct tail_call_state *state, struct expression *e)
+{
+    return new_expression(state, (struct expression) {
+        .kind = GROUP_EXPRESSION,
+        .grouped = e
+    });
+}
+
+struct statement assign_statement(struct tail_call_state *state,
+                                  struct list_char name,
+                                  struct expression *value)
+{
+    struct statement output = new_statement(state, ACTION_STATEMENT);
+    output.expression = *binary_expression(state, ASSIGN_BINARY, name_expression(state, name), value);
+    return output;
+}
+
+int is_name(struct expression *e, struct list_char *name)
+{
+    e = strip_groups(e);
+    return e->kind == LITERAL_EXPRESSION
+        && e->literal.kind == LITERAL_NAME
+        && list_char_eq(e->literal.name, name);
+}
+
+// Reassigns the parameters from the call's arguments, via temporaries when more than one
+// changes so every argument sees the previous iteration's values.
+void append_parameter_updates(struct tail_call_state *state,
+                              struct expression *call,
+                              struct list_statement *out)
+{
+    struct list_key_type_pair *params = &state->fn->function_type.params;
+    struct list_int changed = list_create(int, params->size);
+    for (size_t i = 0; i < params->size; i++) {
+        if (!is_name(&call->function.params->data[i], &params->data[i].field_name)) {
+            list_append(&changed, (int)i);
+        }
+    }
+
+    if (changed.size == 1) {
+        int i = changed.data[0];
+        list_append(out, assign_statement(state, params->data[i].field_name, &call->function.params->data[i]));
+        return;
+    }
+
+    for (size_t c = 0; c < changed.size; c++) {
+        int i = changed.data[c];
+        struct statement binding = new_statement(state, BINDING_STATEMENT);
+        binding.binding_statement = (struct binding_statement) {
+            .variable_name = prefixed_name("__tail_param_", &params->data[i].field_name),
+            .value = call->function.params->data[i]
+        };
+        list_append(out, binding);
+    }
+
+    for (size_t c = 0; c < changed.size; c++) {
+        int i = changed.data[c];
+        struct list_char temporary = prefixed_name("__tail_param_", &params->data[i].field_name);
+        list_append(out, assign_statement(state, params->data[i].field_name, name_expression(state, temporary)));
+    }
+}
+
+struct list_char accumulator_name()
+{
+    struct list_char output = list_create(char, 12);
+    append_list_char_slice(&output, "__tail_acc");
+    list_append(&output, '\0');
+    return output;
+}
+
+int is_accumulator_identity(struct tail_call_state *state, struct expression *e)
+{
+    e = strip_groups(e);
+    if (e->kind != LITERAL_EXPRESSION || e->literal.kind != LITERAL_NUMERIC) {
+        return 0;
+    }
+    double identity = state->accumulator_op == MULTIPLY_BINARY ? 1 : 0;
+    return e->literal.numeric == identity;
+}
+
+void rewrite_statement(struct statement *s, struct tail_call_state *state)
+{
+    switch (s->kind) {
+        case RETURN_STATEMENT:
+        {
+            struct expression *call = NULL;
+            struct expression *other = NULL;
+            enum binary_operator op = 0;
+            enum tail_kind kind = classify_return(&s->expression, state->fn, &call, &other, &op);
+            if (kind == TAIL_NONE) {
+                if (state->accumulate && !is_accumulator_identity(state, &s->expression)) {
+                    // the returned value moves out to its own node, the statement's is overwritten.
+                    struct expression *returned = malloc(sizeof(*returned));
+                    *returned = s->expression;
+                    s->expression = *binary_expression(state,
+                                                       state->accumulator_op,
+                                                       name_expression(state, accumulator_name()),
+                                                       group_expression(state, returned));
+                } else if (state->accumulate) {
+                    s->expression = *name_expression(state, accumulator_name());
+                }
+                return;
+            }
+
+            assert(kind == TAIL_DIRECT || kind == TAIL_ACCUMULATE);
+            struct list_statement *statements = malloc(sizeof(*statements));
+            *statements = list_create(statement, 5);
+            if (kind == TAIL_ACCUMULATE) {
+                struct expression *accumulated =
+                    binary_expression(state,
+                                      state->accumulator_op,
+                                      name_expression(state, accumulator_name()),
+                                      group_expression(state, other));
+                list_append(statements, assign_statement(state, accumulator_name(), accumulated));
+            }
+            append_parameter_updates(state, call, statements);
+            list_append(statements, new_statement(state, CONTINUE_STATEMENT));
+
+            struct statement block = new_statement(state, BLOCK_STATEMENT);
+            block.statements = statements;
+            *s = block;
+            return;
+        }
+        case IF_STATEMENT:
+        {
+            rewrite_statement(s->if_statement.success_statement, state);
+            if (s->if_statement.else_statement != NULL) {
+                rewrite_statement(s->if_statement.else_statement, state);
+            }
+            return;
+        }
+        case WHILE_LOOP_STATEMENT:
+            rewrite_statement(s->while_loop_statement.do_statement, state);
+            return;
+        case FOR_LOOP_STATEMENT:
+            rewrite_statement(s->for_loop_statement.do_statement, state);
+            return;
+        case BLOCK_STATEMENT:
+        {
+            for (size_t i = 0; i < s->statements->size; i++) {
+                rewrite_statement(&s->statements->data[i], state);
+            }
+            return;
+        }
+        case SWITCH_STATEMENT:
+        {
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                rewrite_statement(s->switch_statement.cases.data[i].statement, state);
+            }
+            return;
+        }
+        case BINDING_STATEMENT:
+        case ACTION_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+        case TYPE_DECLARATION_STATEMENT:
+            return;
+    }
+}
+
+int is_integer_type(struct type *ty)
+{
+    if (ty->kind != TY_PRIMITIVE || ty->modifiers.size > 0) {
+        return 0;
+    }
+
+    switch (ty->primitive_type) {
+        case U8:
+        case I8:
+        case I16:
+        case U16:
+        case I32:
+        case U32:
+        case I64:
+        case U64:
+        case USIZE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int has_array_parameter(struct type *fn)
+{
+    struct list_key_type_pair *params = &fn->function_type.params;
+    for (size_t i = 0; i < params->size; i++) {
+        struct list_type_modifier *modifiers = &params->data[i].field_type->modifiers;
+        for (size_t m = 0; m < modifiers->size; m++) {
+            if (modifiers->data[m].kind == ARRAY_MODIFIER_KIND) return 1;
+        }
+    }
+    return 0;
+}
+
+void eliminate_function_tail_calls(struct statement *s, struct parsed_file *parsed_file)
+{
+    struct type_declaration_statement *declaration = &s->type_declaration;
+    struct tail_call_state state = {
+        .parsed_file = parsed_file,
+        .fn = &declaration->type,
+        .metadata = lut_get(&parsed_file->global_context.metadata_lookup, s->id)
+    };
+
+    // C arrays can't be reassigned, so those parameters can't be rebound per iteration, and an
+    // async fn's parameters live in its frame.
+    if (has_array_parameter(state.fn) || state.fn->function_type.is_async) return;
+
+    for (size_t i = 0; i < declaration->statements->size; i++) {
+        if (!analyse_statement(&declaration->statements->data[i], &state, 0)) return;
+    }
+
+    if (!state.found_tail_call) return;
+    // reassociating only holds for integer arithmetic, and inline C can't see the accumulator.
+    if (state.accumulate
+        && (!is_integer_type(state.fn->function_type.return_type) || state.c_block_returns))
+    {
+        return;
+    }
+
+    struct list_statement *loop_body = malloc(sizeof(*loop_body));
+    *loop_body = list_create(statement, (declaration->statements->size + 1));
+    for (size_t i = 0; i < declaration->statements->size; i++) {
+        struct statement this = declaration->statements->data[i];
+        rewrite_statement(&this, &state);
+        list_append(loop_body, this);
+    }
+    // falling off the end of the body shouldn't loop forever.
+    list_append(loop_body, new_statement(&state, BREAK_STATEMENT));
+
+    struct statement *do_statement = malloc(sizeof(*do_statement));
+    *do_statement = new_statement(&state, BLOCK_STATEMENT);
+    do_statement->statements = loop_body;
+
+    struct statement loop = new_statement(&state, WHILE_LOOP_STATEMENT);
+    loop.while_loop_statement = (struct while_loop_statement) {
+        .condition = *new_expression(&state, (struct expression) {
+            .kind = LITERAL_EXPRESSION,
+            .literal = (struct literal_expression) {
+                .kind = LITERAL_BOOLEAN,
+                .boolean = 1
+            }
+        }),
+        .do_statement = do_statement
+    };
+
+    struct list_statement *body = malloc(sizeof(*body));
+    *body = list_create(statement, 2);
+    if (state.accumulate) {
+        struct statement accumulator = new_statement(&state, BINDING_STATEMENT);
+        accumulator.binding_statement = (struct binding_statement) {
+            .variable_name = accumulator_name(),
+            .variable_type = *state.fn->function_type.return_type,
+            .has_type = 1,
+            .value = *new_expression(&state, (struct expression) {
+                .kind = LITERAL_EXPRESSION,
+                .literal = (struct literal_expression) {
+                    .kind = LITERAL_NUMERIC,
+                    .numeric = state.accumulator_op == MULTIPLY_BINARY ? 1 : 0
+                }
+            })
+        };
+        list_append(body, accumulator);
+    }
+    list_append(body, loop);
+    declaration->statements = body;
+}
+
+int eliminate_tail_calls(struct parsed_file *parsed_file, struct error *error)
+{
+    for (size_t i = 0; i < parsed_file->statements.size; i++) {
+        struct statement *s = &parsed_file->statements.data[i];
+        if (s->kind != TYPE_DECLARATION_STATEMENT || s->type_declaration.type.kind != TY_FUNCTION) {
+            continue;
+        }
+        eliminate_function_tail_calls(s, parsed_file);
+    }
+
+    return 1;
+}
@@ -0,0 +1,9 @@
+#ifndef TAIL_CALLS_H
+#define TAIL_CALLS_H
+
+#include "parser.h"
+#include "error.h"
+
+int eliminate_tail_calls(struct parsed_file *parsed_file, struct error *error);
+
+#endif
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <math.h>
 #include <string.h>
 #include "ast.h"
 #include "context.h"
@@ -7,6 +8,12 @@
 #include "../lib/utils.h"
 #include <string.h>
 #include "type_checker.h"
+#include "type_inference.h"
+#include "decision_tree.h"
+#include "vectors.h"
+#include "atomics.h"
+#include "coroutines.h"
+#include "layout.h"
 #include "error.h"
 
 struct list_char show_type(struct type *ty);
@@ -77,6 +84,8 @@ int type_modifier_eq(struct type_modifier *l, struct type_modifier *r)
         case POINTER_MODIFIER_KIND:
         case NULLABLE_MODIFIER_KIND:
         case MUTABLE_MODIFIER_KIND:
+        case SLICE_MODIFIER_KIND:
+        case ATOMIC_MODIFIER_KIND:
             return 1;
     }
 
@@ -168,6 +177,96 @@ int is_boolean(struct type *ty)
     }
 }
 
+int is_numeric_primitive(struct type *ty)
+{
+    if (ty->kind != TY_PRIMITIVE || ty->modifiers.size > 0) {
+        return 0;
+    }
+
+    switch (ty->primitive_type) {
+        case VOID:
+        case BOOL:
+        case ARENA:
+            return 0;
+        default:
+            return !is_vector_primitive(ty->primitive_type);
+    }
+}
+
+// Arithmetic on a vector takes another of the same type, or a scalar each lane is combined with
+// that's a literal or of the lanes' type, as GCC won't narrow it. Comparisons take two of the same
+// type, and only integer lanes have bits to `|` and `&`.
+int vector_operands_allowed(struct binary_expression *binary,
+                            struct type *left,
+                            struct type *right,
+                            struct list_char *error_message)
+{
+    int left_vector = is_vector_type(left);
+    int right_vector = is_vector_type(right);
+    if (!left_vector && !right_vector) return 1;
+
+    struct type *vector = left_vector ? left : right;
+    struct type *other = left_vector ? right : left;
+    struct expression *other_expression = left_vector ? binary->r : binary->l;
+    while (other_expression->kind == GROUP_EXPRESSION) {
+        other_expression = other_expression->grouped;
+    }
+    enum primitive_type element = vector_element(vector->primitive_type);
+
+    switch (binary->binary_op) {
+        case OR_BINARY:
+        case AND_BINARY:
+            append_list_char_slice(error_message, "`&&` and `||` take booleans, not vectors.");
+            return 0;
+        case BITWISE_OR_BINARY:
+        case BITWISE_AND_BINARY:
+            if (element == F32) {
+                append_list_char_slice(error_message, "`|` and `&` need a vector with integer lanes.");
+                return 0;
+            }
+            break;
+        case GREATER_THAN_BINARY:
+        case LESS_THAN_BINARY:
+        case EQUAL_TO_BINARY:
+        case ASSIGN_BINARY:
+            if (!left_vector || !right_vector) {
+                append_list_char_slice(error_message, "a vector can only be compared with, or assigned, a vector.");
+                return 0;
+            }
+            break;
+        case PLUS_BINARY:
+        case MINUS_BINARY:
+        case MULTIPLY_BINARY:
+            break;
+    }
+
+    if (left_vector && right_vector) {
+        if (left->primitive_type != right->primitive_type) {
+            append_list_char_slice(error_message, "both vectors must have the same type, `");
+            append_list_char_slice(error_message, show_type(left).data);
+            append_list_char_slice(error_message, "` and `");
+            append_list_char_slice(error_message, show_type(right).data);
+            append_list_char_slice(error_message, "` differ.");
+            return 0;
+        }
+        return 1;
+    }
+
+    double value = other_expression->literal.numeric;
+    int literal = other_expression->kind == LITERAL_EXPRESSION
+        && other_expression->literal.kind == LITERAL_NUMERIC
+        && (element == F32 || floor(value) == value)
+        && (element != U8 || (value >= 0 && value <= 255));
+    int lane_typed = other->kind == TY_PRIMITIVE && other->modifiers.size == 0 && other->primitive_type == element;
+    if (!literal && !lane_typed) {
+        append_list_char_slice(error_message, "a scalar combined with a `");
+        append_list_char_slice(error_message, show_type(vector).data);
+        append_list_char_slice(error_message, "` must be a literal, or of its lanes' type.");
+        return 0;
+    }
+    return 1;
+}
+
 int binding_statement_check(struct statement *s,
                             struct global_context *global_context,
                             struct context *context,
@@ -186,14 +285,39 @@ int binding_statement_check(struct statement *s,
         return 0;
     }
 
+    struct type bound_type = lut_get(&context->expression_type_lookup, s->binding_statement.value.id);
+    if (awaited(s) != NULL && is_void_type(&bound_type)) {
+        add_error_inner(&metadata, "what's awaited gives no value to bind.", error);
+        return 0;
+    }
+
+    // numeric literals infer to `i32`, but can initialise any numeric binding, nullable or not.
+    struct expression *value = &s->binding_statement.value;
+    struct type numeric_type = s->binding_statement.variable_type;
+    if (numeric_type.modifiers.size == 1 && numeric_type.modifiers.data[0].kind == NULLABLE_MODIFIER_KIND) {
+        numeric_type.modifiers = pop(&numeric_type.modifiers);
+    }
+    // an atomic is initialised with a plain value, before anything else can see it.
+    struct type variable_type = s->binding_statement.variable_type;
+    if (is_atomic_type(&variable_type)) {
+        variable_type.modifiers = list_create(type_modifier, 1);
+        numeric_type = variable_type;
+    }
+    if (s->binding_statement.has_type
+        && value->kind == LITERAL_EXPRESSION
+        && value->literal.kind == LITERAL_NUMERIC
+        && is_numeric_primitive(&numeric_type))
+    {
+        return 1;
+    }
+
     if (s->binding_statement.has_type)
     {
         struct type actual_type =
             lut_get(&context->expression_type_lookup, s->binding_statement.value.id);
-        if (!type_eq(&s->binding_statement.variable_type, &actual_type)) {
+        if (!type_eq(&variable_type, &actual_type)) {
             add_error_inner(&metadata,
-                            type_mismatch_generic_error(&s->binding_statement.variable_type, 
-                                                        &actual_type).data,
+                            type_mismatch_generic_error(&variable_type, &actual_type).data,
                             error);
             return 0;
         }
@@ -231,9 +355,16 @@ void all_return_statements_inner(struct statement *s, struct list_statement *out
             all_return_statements_inner(s->while_loop_statement.do_statement, out);
             return;
         }
+        case FOR_LOOP_STATEMENT:
+        {
+            all_return_statements_inner(s->for_loop_statement.do_statement, out);
+            return;
+        }
         case SWITCH_STATEMENT:
         {
-            TODO("switch_statement is not part of the context yet.");
+            for (size_t i = 0; i < s->switch_statement.cases.size; i++) {
+                all_return_statements_inner(s->switch_statement.cases.data[i].statement, out);
+            }
             return;
         }
         // cases to ignore
@@ -241,6 +372,7 @@ void all_return_statements_inner(struct statement *s, struct list_statement *out
         case ACTION_STATEMENT:
         case TYPE_DECLARATION_STATEMENT:
         case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
         case C_BLOCK_STATEMENT:
             return;
     }
@@ -286,6 +418,10 @@ int type_check_action_statement(struct statement *s,
     // assumption: fn's list of name:type is ordered how it's defined in the source code,
     // and the params list of expressions is ordered how it's written in the source code.
     assert(fn_expr->params->size <= fn.function_type.params.size);
+    enum primitive_type primitive = 0;
+    char *operation = NULL;
+    int atomic = atomic_function(fn_expr->function_name, &primitive, &operation);
+    int task = task_method(fn_expr->function_name, global_context, &operation) != NULL;
     for (size_t i = 0; i < fn_expr->params->size; i++) {
         // TODO: this expression should already have a type attached.
         struct expression *param_expr = &fn_expr->params->data[i];
@@ -293,6 +429,17 @@ int type_check_action_statement(struct statement *s,
         struct type actual_type =
             lut_get(&context->expression_type_lookup, param_expr->id);
 
+        // an atomic's or a task's method is called on it or through a pointer to it, and the value
+        // an atomic's given can be a literal, as a binding's can.
+        if ((atomic || task) && i == 0) continue;
+        if (atomic
+            && param_expr->kind == LITERAL_EXPRESSION
+            && param_expr->literal.kind == LITERAL_NUMERIC
+            && is_numeric_primitive(expected))
+        {
+            continue;
+        }
+
         if (!type_eq(&actual_type, expected)) {
             struct list_char error_message = list_create(char, 100);
             append_list_char_slice(&error_message, "mismatch types; expected `");
@@ -327,13 +474,47 @@ int unary_operator_allowed(enum unary_operator op,
             return 1;
         }
         case STAR_UNARY:
+        {
+            size_t m = 0;
+            while (m < expression_type->modifiers.size
+                   && expression_type->modifiers.data[m].kind == MUTABLE_MODIFIER_KIND)
+            {
+                m++;
+            }
+            if (m == expression_type->modifiers.size
+                || expression_type->modifiers.data[m].kind != POINTER_MODIFIER_KIND)
+            {
+                append_list_char_slice(error_message, "`*` can only be applied to pointers.");
+                return 0;
+            }
+            return 1;
+        }
         case MINUS_UNARY:
         {
-            return 0;
+            struct type value = *expression_type;
+            while (value.modifiers.size > 0 && value.modifiers.data[0].kind == MUTABLE_MODIFIER_KIND) {
+                value.modifiers.data++;
+                value.modifiers.size--;
+            }
+            if (!is_numeric_primitive(&value) && !is_vector_type(&value)) {
+                append_list_char_slice(error_message, "`-` can only be applied to numbers.");
+                return 0;
+            }
+            return 1;
         }
+        // what's awaited is checked by `type_check_expression`, the await itself is void or the
+        // result of what's awaited.
+        case AWAIT_UNARY:
+            return 1;
     }
 }
 
+int type_check_expression(struct expression *e,
+                          struct statement_metadata *statement_metadata,
+                          struct global_context *global_context,
+                          struct context *context,
+                          struct error *error);
+
 int type_check_function_expression(struct function_expression *fn,
                                    struct statement_metadata *statement_metadata,
                                    struct global_context *global_context,
@@ -348,11 +529,13 @@ int type_check_function_expression(struct function_expression *fn,
         add_error_inner(statement_metadata, "more params than fn allows.", error);
         return 0;
     }
-    // TODO
+    // a method's receiver included, as in `(!t).resume()`.
+    for (size_t i = 0; i < fn->params->size; i++) {
+        if (!type_check_expression(&fn->params->data[i], statement_metadata, global_context, context, error)) {
+            return 0;
+        }
+    }
     return 1;
-    // for (size_t i = 0; i < fn_type.function_type.params.size; i++) {
-    //     struct key_type_pair *param = &fn_type.function_type.params.data[i];
-    // }
 }
 
 int type_check_expression(struct expression *e,
@@ -372,6 +555,14 @@ int type_check_expression(struct expression *e,
         }
         case UNARY_EXPRESSION:
         {
+            struct type operand_type = lut_get(&context->expression_type_lookup, e->unary.expression->id);
+            if (e->unary.unary_operator == AWAIT_UNARY
+                && async_call(e->unary.expression, global_context) == NULL
+                && !is_boolean(&operand_type))
+            {
+                add_error_inner(statement_metadata, "only a call to an `async fn`, or a bool, can be awaited.", error);
+                return 0;
+            }
             if (!unary_operator_allowed(e->unary.unary_operator,
                                         &expression_type,
                                         &error_message))
@@ -387,7 +578,22 @@ int type_check_expression(struct expression *e,
         }
         case BINARY_EXPRESSION:
         {
-            TODO("binary fun");
+            struct type left = lut_get(&context->expression_type_lookup, e->binary.l->id);
+            struct type right = lut_get(&context->expression_type_lookup, e->binary.r->id);
+            if (!vector_operands_allowed(&e->binary, &left, &right, &error_message)) {
+                add_error_inner(statement_metadata, error_message.data, error);
+                return 0;
+            }
+            return type_check_expression(e->binary.l,
+                                         statement_metadata,
+                                         global_context,
+                                         context,
+                                         error)
+                && type_check_expression(e->binary.r,
+                                         statement_metadata,
+                                         global_context,
+                                         context,
+                                         error);
         }
         case GROUP_EXPRESSION:
             return type_check_expression(e->grouped,
@@ -401,17 +607,363 @@ int type_check_expression(struct expression *e,
                                                   global_context,
                                                   context,
                                                   error);
+        case INDEX_EXPRESSION:
+            return type_check_expression(e->index.indexed,
+                                         statement_metadata,
+                                         global_context,
+                                         context,
+                                         error)
+                && type_check_expression(e->index.index,
+                                         statement_metadata,
+                                         global_context,
+                                         context,
+                                         error)
+                && (e->index.end == NULL
+                    || type_check_expression(e->index.end,
+                                             statement_metadata,
+                                             global_context,
+                                             context,
+                                             error));
         case VOID_EXPRESSION:
         case MEMBER_ACCESS_EXPRESSION:
             return 1;
     };
 }
 
+int type_check_switch_statement(struct statement *s,
+                                struct global_context *global_context,
+                                struct context *context,
+                                struct error *error)
+{
+    assert(s->kind == SWITCH_STATEMENT);
+    struct switch_statement *switch_statement = &s->switch_statement;
+    struct statement_metadata metadata =
+        lut_get(&global_context->metadata_lookup, s->id);
+    struct type subject_type =
+        lut_get(&context->expression_type_lookup, switch_statement->switch_expression.id);
+    enum switch_subject_kind subject_kind = classify_switch_subject(&subject_type);
+
+    // anything but a number or string, like an enum, is only matched through a decision tree.
+    if (needs_decision_tree(switch_statement) || subject_kind == SWITCH_ON_OTHER) {
+        struct list_char error_message = list_create(char, 100);
+        struct list_int unreachable_arms = list_create(int, 4);
+        if (!compile_decision_tree(switch_statement,
+                                   &subject_type,
+                                   global_context,
+                                   &switch_statement->decision_tree,
+                                   &unreachable_arms,
+                                   &error_message))
+        {
+            add_error_inner(&metadata, error_message.data, error);
+            return 0;
+        }
+
+        for (size_t i = 0; i < unreachable_arms.size; i++) {
+            struct statement_metadata arm_metadata =
+                lut_get(&global_context->metadata_lookup,
+                        switch_statement->cases.data[unreachable_arms.data[i]].statement->id);
+            write_warning(stderr,
+                          arm_metadata.row,
+                          arm_metadata.col,
+                          arm_metadata.file_name,
+                          "this case can never match, earlier cases cover everything it does.");
+        }
+    }
+
+    for (size_t i = 0; i < switch_statement->cases.size; i++) {
+        struct switch_pattern *pattern = &switch_statement->cases.data[i].pattern;
+        switch (pattern->switch_pattern_kind) {
+            case NUMBER_PATTERN_KIND:
+            {
+                if (subject_kind != SWITCH_ON_INTEGER && subject_kind != SWITCH_ON_FLOAT) {
+                    struct list_char error_message = list_create(char, 100);
+                    append_list_char_slice(&error_message, "cannot match a number against `");
+                    append_list_char_slice(&error_message, show_type(&subject_type).data);
+                    append_list_char_slice(&error_message, "`.");
+                    add_error_inner(&metadata, error_message.data, error);
+                    return 0;
+                }
+
+                double number = pattern->number_pattern.number;
+                if (subject_kind == SWITCH_ON_INTEGER && number != floor(number)) {
+                    add_error_inner(&metadata, "cannot match a fractional number against an integer.", error);
+                    return 0;
+                }
+                break;
+            }
+            case STRING_PATTERN_KIND:
+            {
+                if (subject_kind != SWITCH_ON_STRING) {
+                    struct list_char error_message = list_create(char, 100);
+                    append_list_char_slice(&error_message, "cannot match a string against `");
+                    append_list_char_slice(&error_message, show_type(&subject_type).data);
+                    append_list_char_slice(&error_message, "`.");
+                    add_error_inner(&metadata, error_message.data, error);
+                    return 0;
+                }
+                break;
+            }
+            case VARIABLE_PATTERN_KIND:
+            case UNDERSCORE_PATTERN_KIND:
+            case OBJECT_PATTERN_KIND:
+            case ARRAY_PATTERN_KIND:
+            case REST_PATTERN_KIND:
+                break;
+        }
+
+        if (!type_check_single(switch_statement->cases.data[i].statement,
+                               global_context,
+                               context,
+                               error))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Atomic storage is only accessed through its methods, which take it as their first argument. Any
+// other use, reading it into a value, assigning it or passing it on, is an access without an order.
+// A struct holding it is only reached through, its field taken or the struct indexed out of an
+// array, as copying or assigning it whole would access the atomic fields without an order too.
+int atomic_accesses_allowed(struct expression *e,
+                            int method_receiver,
+                            int reached_through,
+                            struct global_context *global_context,
+                            struct context *context,
+                            struct list_char *error_message)
+{
+    struct type expression_type = lut_get(&context->expression_type_lookup, e->id);
+    if (!method_receiver && is_atomic_type(&expression_type)) {
+        append_list_char_slice(error_message, "`");
+        append_list_char_slice(error_message, show_type(&expression_type).data);
+        append_list_char_slice(error_message,
+                               "` is only read and written through its methods, like `load(order)` and `store(value, order)`.");
+        return 0;
+    }
+    // a struct literal makes the value, the copy is of its fields.
+    int constructed = e->kind == LITERAL_EXPRESSION
+        && (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM);
+    if (!method_receiver
+        && !reached_through
+        && !constructed
+        && holds_atomic_storage(&expression_type, global_context))
+    {
+        append_list_char_slice(error_message, "`");
+        append_list_char_slice(error_message, show_type(&expression_type).data);
+        append_list_char_slice(error_message,
+                               "` holds atomic storage, so it can't be copied or assigned whole, only passed by pointer.");
+        return 0;
+    }
+
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    if (!atomic_accesses_allowed(pairs->data[i].expression, 0, 0, global_context, context, error_message)) return 0;
+                }
+            }
+            return 1;
+        }
+        case UNARY_EXPRESSION:
+            return atomic_accesses_allowed(e->unary.expression, 0, 0, global_context, context, error_message);
+        case BINARY_EXPRESSION:
+            return atomic_accesses_allowed(e->binary.l, 0, 0, global_context, context, error_message)
+                && atomic_accesses_allowed(e->binary.r, 0, 0, global_context, context, error_message);
+        case GROUP_EXPRESSION:
+            return atomic_accesses_allowed(e->grouped, method_receiver, reached_through, global_context, context, error_message);
+        case FUNCTION_EXPRESSION:
+        {
+            enum primitive_type primitive = 0;
+            char *operation = NULL;
+            int atomic = atomic_function(e->function.function_name, &primitive, &operation);
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                if (!atomic_accesses_allowed(&e->function.params->data[i], atomic && i == 0, 0, global_context, context, error_message)) {
+                    return 0;
+                }
+            }
+            return 1;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+            return atomic_accesses_allowed(e->member_access.accessed, 0, 1, global_context, context, error_message);
+        case INDEX_EXPRESSION:
+            return atomic_accesses_allowed(e->index.indexed, 0, 1, global_context, context, error_message)
+                && atomic_accesses_allowed(e->index.index, 0, 0, global_context, context, error_message)
+                && (e->index.end == NULL || atomic_accesses_allowed(e->index.end, 0, 0, global_context, context, error_message));
+        case VOID_EXPRESSION:
+            return 1;
+    }
+
+    UNREACHABLE("atomic_accesses_allowed fell out of a switch");
+}
+
+// The expressions a statement holds itself, not those of the statements within it.
+int statement_atomic_accesses_allowed(struct statement *s,
+                                      struct global_context *global_context,
+                                      struct context *context,
+                                      struct list_char *error_message)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            return atomic_accesses_allowed(&s->binding_statement.value, 0, 0, global_context, context, error_message);
+        case ACTION_STATEMENT:
+        case RETURN_STATEMENT:
+            return atomic_accesses_allowed(&s->expression, 0, 0, global_context, context, error_message);
+        case IF_STATEMENT:
+            return atomic_accesses_allowed(&s->if_statement.condition, 0, 0, global_context, context, error_message);
+        case WHILE_LOOP_STATEMENT:
+            return atomic_accesses_allowed(&s->while_loop_statement.condition, 0, 0, global_context, context, error_message);
+        case FOR_LOOP_STATEMENT:
+        {
+            // a loop over the elements copies each into its variable.
+            struct for_loop_statement *for_statement = &s->for_loop_statement;
+            struct type iterated_type = lut_get(&context->expression_type_lookup, for_statement->iterated.id);
+            if (for_statement->end == NULL && iterated_type.modifiers.size > 0) {
+                struct type element = element_type(&iterated_type);
+                if (is_atomic_type(&element) || holds_atomic_storage(&element, global_context)) {
+                    append_list_char_slice(error_message,
+                                           "a loop can't copy out atomic elements, loop over their indexes instead.");
+                    return 0;
+                }
+            }
+            return atomic_accesses_allowed(&for_statement->iterated, 0, 0, global_context, context, error_message)
+                && (for_statement->end == NULL
+                    || atomic_accesses_allowed(for_statement->end, 0, 0, global_context, context, error_message));
+        }
+        case SWITCH_STATEMENT:
+            return atomic_accesses_allowed(&s->switch_statement.switch_expression, 0, 0, global_context, context, error_message);
+        case TYPE_DECLARATION_STATEMENT:
+        case BLOCK_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return 1;
+    }
+
+    UNREACHABLE("statement_atomic_accesses_allowed fell out of a switch");
+}
+
+// An element of an array of a `#[soa]` struct is spread over an array per field, so it's only
+// reached through one of its fields, as in `rows[i].field`, never whole.
+int soa_accesses_allowed(struct expression *e,
+                         int field_accessed,
+                         struct context *context,
+                         struct list_char *error_message)
+{
+    switch (e->kind) {
+        case LITERAL_EXPRESSION:
+        {
+            if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    if (!soa_accesses_allowed(pairs->data[i].expression, 0, context, error_message)) return 0;
+                }
+            }
+            return 1;
+        }
+        case UNARY_EXPRESSION:
+            return soa_accesses_allowed(e->unary.expression, 0, context, error_message);
+        case BINARY_EXPRESSION:
+            return soa_accesses_allowed(e->binary.l, 0, context, error_message)
+                && soa_accesses_allowed(e->binary.r, 0, context, error_message);
+        case GROUP_EXPRESSION:
+            return soa_accesses_allowed(e->grouped, field_accessed, context, error_message);
+        case FUNCTION_EXPRESSION:
+        {
+            for (size_t i = 0; i < e->function.params->size; i++) {
+                if (!soa_accesses_allowed(&e->function.params->data[i], 0, context, error_message)) return 0;
+            }
+            return 1;
+        }
+        case MEMBER_ACCESS_EXPRESSION:
+            return soa_accesses_allowed(e->member_access.accessed, 1, context, error_message);
+        case INDEX_EXPRESSION:
+        {
+            struct type indexed_type = lut_get(&context->expression_type_lookup, e->index.indexed->id);
+            if (is_soa_array(&indexed_type) && e->index.end != NULL) {
+                append_list_char_slice(error_message,
+                                       "an array of a `#[soa]` struct can't be sliced, its elements aren't stored whole.");
+                return 0;
+            }
+            if (is_soa_array(&indexed_type) && !field_accessed) {
+                struct type element = element_type(&indexed_type);
+                append_list_char_slice(error_message, "an element of `");
+                append_list_char_slice(error_message, show_type(&indexed_type).data);
+                append_list_char_slice(error_message, "` is only reached through its fields, as `");
+                append_list_char_slice(error_message, show_type(&element).data);
+                append_list_char_slice(error_message, "` is `#[soa]`.");
+                return 0;
+            }
+            return soa_accesses_allowed(e->index.indexed, 0, context, error_message)
+                && soa_accesses_allowed(e->index.index, 0, context, error_message)
+                && (e->index.end == NULL || soa_accesses_allowed(e->index.end, 0, context, error_message));
+        }
+        case VOID_EXPRESSION:
+            return 1;
+    }
+
+    UNREACHABLE("soa_accesses_allowed fell out of a switch");
+}
+
+// The expressions a statement holds itself, not those of the statements within it.
+int statement_soa_accesses_allowed(struct statement *s,
+                                   struct context *context,
+                                   struct list_char *error_message)
+{
+    switch (s->kind) {
+        case BINDING_STATEMENT:
+            return soa_accesses_allowed(&s->binding_statement.value, 0, context, error_message);
+        case ACTION_STATEMENT:
+        case RETURN_STATEMENT:
+            return soa_accesses_allowed(&s->expression, 0, context, error_message);
+        case IF_STATEMENT:
+            return soa_accesses_allowed(&s->if_statement.condition, 0, context, error_message);
+        case WHILE_LOOP_STATEMENT:
+            return soa_accesses_allowed(&s->while_loop_statement.condition, 0, context, error_message);
+        case FOR_LOOP_STATEMENT:
+        {
+            // a loop over the elements copies each into its variable.
+            struct for_loop_statement *for_statement = &s->for_loop_statement;
+            struct type iterated_type = lut_get(&context->expression_type_lookup, for_statement->iterated.id);
+            if (for_statement->end == NULL && is_soa_array(&iterated_type)) {
+                append_list_char_slice(error_message,
+                                       "a loop can't copy out the elements of a `#[soa]` array, loop over their indexes instead.");
+                return 0;
+            }
+            return soa_accesses_allowed(&for_statement->iterated, 0, context, error_message)
+                && (for_statement->end == NULL
+                    || soa_accesses_allowed(for_statement->end, 0, context, error_message));
+        }
+        case SWITCH_STATEMENT:
+            return soa_accesses_allowed(&s->switch_statement.switch_expression, 0, context, error_message);
+        case TYPE_DECLARATION_STATEMENT:
+        case BLOCK_STATEMENT:
+        case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
+        case C_BLOCK_STATEMENT:
+            return 1;
+    }
+
+    UNREACHABLE("statement_soa_accesses_allowed fell out of a switch");
+}
+
 int type_check_single(struct statement *s,
                       struct global_context *global_context,
                       struct context *context,
                       struct error *error)
 {
+    struct list_char access_error = list_create(char, 100);
+    if (!statement_atomic_accesses_allowed(s, global_context, context, &access_error)
+        || !statement_soa_accesses_allowed(s, context, &access_error))
+    {
+        struct statement_metadata metadata = lut_get(&global_context->metadata_lookup, s->id);
+        add_error_inner(&metadata, access_error.data, error);
+        return 0;
+    }
+
     switch (s->kind) {
         case BINDING_STATEMENT:
             return binding_statement_check(s, global_context, context, error);
@@ -439,14 +991,14 @@ int type_check_single(struct statement *s,
                             return 0;
                         }
                     }
-                } else {
-                    if (!type_check_single(&s->type_declaration.statements->data[i],
-                                           global_context,
-                                           context,
-                                           error))
-                    {
-                        return 0;
-                    }
+                }
+
+                if (!type_check_single(&s->type_declaration.statements->data[i],
+                                       global_context,
+                                       context,
+                                       error))
+                {
+                    return 0;
                 }
             }
             return 1;
@@ -463,6 +1015,10 @@ int type_check_single(struct statement *s,
                 add_error_inner(&metadata, "the condition of an if statement must be a boolean.", error);
                 return 0;
             }
+            struct statement_metadata metadata = lut_get(&global_context->metadata_lookup, s->id);
+            if (!type_check_expression(&if_statement->condition, &metadata, global_context, context, error)) {
+                return 0;
+            }
             if (!type_check_single(if_statement->success_statement, global_context, context, error)) return 0;
             if (if_statement->else_statement != NULL
                 && !type_check_single(if_statement->else_statement, global_context, context, error)) return 0;
@@ -480,9 +1036,26 @@ int type_check_single(struct statement *s,
                 add_error_inner(&metadata, "the condition of a while loop must be a boolean.", error);
                 return 0;
             }
+            struct statement_metadata metadata = lut_get(&global_context->metadata_lookup, s->id);
+            if (!type_check_expression(&while_statement->condition, &metadata, global_context, context, error)) {
+                return 0;
+            }
             if (!type_check_single(while_statement->do_statement, global_context, context, error)) return 0;
             return 1;
         }
+        case FOR_LOOP_STATEMENT:
+        {
+            struct for_loop_statement *for_statement = &s->for_loop_statement;
+            struct statement_metadata metadata =
+                lut_get(&global_context->metadata_lookup, s->id);
+            if (!type_check_expression(&for_statement->iterated, &metadata, global_context, context, error)
+                || (for_statement->end != NULL
+                    && !type_check_expression(for_statement->end, &metadata, global_context, context, error)))
+            {
+                return 0;
+            }
+            return type_check_single(for_statement->do_statement, global_context, context, error);
+        }
         case BLOCK_STATEMENT:
         {
             for (size_t i = 0; i < s->statements->size; i++) {
@@ -491,13 +1064,16 @@ int type_check_single(struct statement *s,
             return 1;
         }
         case ACTION_STATEMENT:
-            return type_check_action_statement(s, global_context, context, error);
-        case SWITCH_STATEMENT:
+        case RETURN_STATEMENT:
         {
-            TODO("switch statement type check");
+            struct statement_metadata metadata = lut_get(&global_context->metadata_lookup, s->id);
+            if (!type_check_expression(&s->expression, &metadata, global_context, context, error)) return 0;
+            return s->kind == RETURN_STATEMENT || type_check_action_statement(s, global_context, context, error);
         }
-        case RETURN_STATEMENT:
+        case SWITCH_STATEMENT:
+            return type_check_switch_statement(s, global_context, context, error);
         case BREAK_STATEMENT:
+        case CONTINUE_STATEMENT:
         case C_BLOCK_STATEMENT:
             return 1;
     }
@@ -546,6 +1122,16 @@ struct list_char show_modifier(struct type_modifier *m)
             append_list_char_slice(&output, "]");
             break; 
         }
+        case SLICE_MODIFIER_KIND:
+        {
+            append_list_char_slice(&output, "[]");
+            break;
+        }
+        case ATOMIC_MODIFIER_KIND:
+        {
+            append_list_char_slice(&output, "atomic ");
+            break;
+        }
     }
 
     return output;
@@ -605,6 +1191,17 @@ struct list_char show_type(struct type *ty)
                 case F64:
                     append_list_char_slice(&output, "f64");
                     break;
+                case ARENA:
+                    append_list_char_slice(&output, "arena");
+                    break;
+                case F32X4:
+                case F32X8:
+                case I32X4:
+                case I32X8:
+                case U8X16:
+                case U8X32:
+                    append_list_char_slice(&output, vector_name(ty->primitive_type));
+                    break;
             }
             break;
         }
@@ -6,5 +6,7 @@
 #include "error.h"
 
 int type_check(struct parsed_file *parsed_file, struct context *context, struct error *error);
+int type_eq(struct type *l, struct type *r);
+struct list_char show_type(struct type *ty);
 
 #endif
@@ -1,8 +1,14 @@
 #include "type_inference.h"
 #include "ast.h"
+#include "arena.h"
+#include "vectors.h"
+#include "atomics.h"
+#include "coroutines.h"
+#include "layout.h"
 #include "../lib/collections.h"
 #include "../lib/utils.h"
 #include <assert.h>
+#include <string.h>
 
 int get_scoped_variable_type(struct list_scoped_variable *scoped_variables,
                              struct global_context *c,
@@ -82,14 +88,16 @@ int get_field_type(struct list_key_type_pair *pairs,
 {
     for (size_t i = 0; i < pairs->size; i++) {
         if (list_char_eq(field_name, &pairs->data[i].field_name)) {
+            // the field's type is shared with its declaration, so it's resolved into a copy.
             struct type *found = pairs->data[i].field_type;
-
+            struct type resolved = *found;
             if (found->kind == TY_STRUCT && found->struct_type.predefined) {
-                if (!find_struct_definition(global_context, found->name, found, error)) return 0;
+                if (!find_struct_definition(global_context, found->name, &resolved, error)) return 0;
             } else if (found->kind == TY_ENUM && found->enum_type.predefined) {
-                if (!find_enum_definition(global_context, found->name, found, error)) return 0;
+                if (!find_enum_definition(global_context, found->name, &resolved, error)) return 0;
             }
-            *out = *found;
+            resolved.modifiers = found->modifiers;
+            *out = resolved;
             return 1;
         }
     }
@@ -112,11 +120,13 @@ int infer_literal_expression_type(struct literal_expression *e,
             for (size_t i = 0; i < scoped_variables->size; i++) {
                 if (list_char_eq(e->name, &scoped_variables->data[i].name)) {
                     struct type *t = &scoped_variables->data[i].type;
+                    struct type resolved = *t;
                     // TODO: enums
                     if (t->kind == TY_STRUCT) {
-                        if (!find_struct_definition(global_context, t->name, t, error)) return 0;
+                        if (!find_struct_definition(global_context, t->name, &resolved, error)) return 0;
+                        resolved.modifiers = t->modifiers;
                     }
-                    *out = *t;
+                    *out = resolved;
                     return 1;
                 }
             }
@@ -202,6 +212,37 @@ int infer_literal_expression_type(struct literal_expression *e,
     UNREACHABLE("infer_literal_expression_type: dropped out of switch.");
 }
 
+// `x.f(y)` calls `t_f(x, y)`, where `t` names the type `x` has or points to.
+int resolve_method(struct function_expression *fn, struct type *receiver, struct list_char *error)
+{
+    char *type_name = NULL;
+    if (atomic_method_prefix(receiver) != NULL) {
+        // an atomic's methods are called on it, or through a pointer to it.
+        type_name = atomic_method_prefix(receiver);
+    } else if (receiver->kind == TY_STRUCT || receiver->kind == TY_ENUM) {
+        type_name = receiver->name->data;
+    } else if (receiver->kind == TY_PRIMITIVE && receiver->primitive_type == ARENA) {
+        type_name = "arena";
+    } else if (receiver->kind == TY_PRIMITIVE && is_vector_primitive(receiver->primitive_type)) {
+        type_name = vector_name(receiver->primitive_type);
+    } else {
+        append_list_char_slice(error, "`");
+        append_list_char_slice(error, fn->function_name->data);
+        append_list_char_slice(error, "` can only be called on a struct, an enum, an arena, a vector or an atomic.");
+        return 0;
+    }
+
+    struct list_char *name = malloc(sizeof(*name));
+    *name = list_create(char, (strlen(type_name) + fn->function_name->size + 2));
+    append_list_char_slice(name, type_name);
+    append_list_char_slice(name, "_");
+    append_list_char_slice(name, fn->function_name->data);
+    list_append(name, '\0');
+    fn->function_name = name;
+    fn->method_call = 0;
+    return 1;
+}
+
 int infer_function_type(struct type *matched_fn,
                         struct global_context *global_context,
                         size_t value_count,
@@ -217,11 +258,10 @@ int infer_function_type(struct type *matched_fn,
     }
 
     if (matched_fn->function_type.params.size == value_count) {
-        if (matched_fn->function_type.return_type->kind == TY_STRUCT) {
-            return find_struct_definition(global_context,
-                                          matched_fn->function_type.return_type->name,
-                                          out,
-                                          error_message);
+        struct type *return_type = matched_fn->function_type.return_type;
+        if (return_type->kind == TY_STRUCT || return_type->kind == TY_ENUM) {
+            // keeps the return type's modifiers, like a pointer to the struct.
+            return infer_full_type(return_type, global_context, NULL, out, error_message);
         }
 
         *out = *matched_fn->function_type.return_type;
@@ -245,6 +285,41 @@ int infer_function_type(struct type *matched_fn,
 }
 
 
+// The type of an array or slice's elements, less its outermost modifier.
+struct type element_type(struct type *indexed)
+{
+    struct type output = *indexed;
+    output.modifiers = list_create(type_modifier, (indexed->modifiers.size));
+    for (size_t i = 1; i < indexed->modifiers.size; i++) {
+        list_append(&output.modifiers, indexed->modifiers.data[i]);
+    }
+    return output;
+}
+
+struct type slice_of(struct type *element)
+{
+    struct type output = *element;
+    output.modifiers = list_create(type_modifier, (element->modifiers.size + 1));
+    list_append(&output.modifiers, ((struct type_modifier) { .kind = SLICE_MODIFIER_KIND }));
+    for (size_t i = 0; i < element->modifiers.size; i++) {
+        list_append(&output.modifiers, element->modifiers.data[i]);
+    }
+    return output;
+}
+
+// Arithmetic reads the value out of a nullable, as a null one reads as zero, so what it gives
+// isn't nullable.
+struct type read_value_type(struct type *ty)
+{
+    for (size_t i = 0; i < ty->modifiers.size; i++) {
+        enum type_modifier_kind kind = ty->modifiers.data[i].kind;
+        if (kind == MUTABLE_MODIFIER_KIND) continue;
+        if (kind != NULLABLE_MODIFIER_KIND || ty->kind == TY_ANY) return *ty;
+        return modifier_inner_type(ty, i);
+    }
+    return *ty;
+}
+
 int infer_expression_type(struct expression *e,
                           struct global_context *global_context,
                           struct context *context,
@@ -255,6 +330,22 @@ int infer_expression_type(struct expression *e,
     switch (e->kind) {
         case LITERAL_EXPRESSION:
         {
+            if (e->literal.kind == LITERAL_STRUCT || e->literal.kind == LITERAL_ENUM) {
+                struct list_key_expression *pairs = &e->literal.struct_enum.key_expr_pairs;
+                for (size_t i = 0; i < pairs->size; i++) {
+                    struct type field_type = {0};
+                    if (!infer_expression_type(pairs->data[i].expression,
+                                               global_context,
+                                               context,
+                                               scoped_variables,
+                                               &field_type,
+                                               error))
+                    {
+                        return 0;
+                    }
+                }
+            }
+
             if (!infer_literal_expression_type(&e->literal,
                                                global_context,
                                                scoped_variables,
@@ -277,6 +368,23 @@ int infer_expression_type(struct expression *e,
             {
                 return 0;
             }
+            // awaiting an async fn gives what it returns, awaiting a bool gives nothing.
+            struct type *callee = async_call(e->unary.expression, global_context);
+            if (e->unary.unary_operator == MINUS_UNARY || e->unary.unary_operator == BANG_UNARY) {
+                *out = read_value_type(out);
+            }
+            if (e->unary.unary_operator == AWAIT_UNARY && callee != NULL) {
+                *out = *async_result_type(callee, global_context);
+            } else if (e->unary.unary_operator == AWAIT_UNARY
+                       && out->kind == TY_PRIMITIVE
+                       && out->primitive_type == BOOL
+                       && out->modifiers.size == 0)
+            {
+                *out = (struct type) {
+                    .kind = TY_PRIMITIVE,
+                    .primitive_type = VOID
+                };
+            }
             lut_add(&context->expression_type_lookup, e->id, *out);
             return 1;
         }
@@ -315,6 +423,13 @@ int infer_expression_type(struct expression *e,
                     // TODO: do we need a different, w.r.t ast, repersentation of what a type is here?
                     // for now I'll just return left
                     *out = left;
+                    // a scalar is applied to every lane of a vector, on either side.
+                    if (is_vector_type(&right) && !is_vector_type(&left) && e->binary.binary_op != ASSIGN_BINARY) {
+                        *out = right;
+                    }
+                    if (e->binary.binary_op != ASSIGN_BINARY) {
+                        *out = read_value_type(out);
+                    }
                     lut_add(&context->expression_type_lookup, e->id, *out);
                     return 1;
                 }
@@ -324,6 +439,16 @@ int infer_expression_type(struct expression *e,
                 case OR_BINARY:
                 case AND_BINARY:
                 {
+                    // vectors compare lane by lane, into a mask.
+                    struct type *vector = is_vector_type(&left) ? &left : is_vector_type(&right) ? &right : NULL;
+                    if (vector != NULL) {
+                        *out = (struct type) {
+                            .kind = TY_PRIMITIVE,
+                            .primitive_type = vector_mask(vector->primitive_type)
+                        };
+                        lut_add(&context->expression_type_lookup, e->id, *out);
+                        return 1;
+                    }
                     *out = (struct type) {
                         .kind = TY_PRIMITIVE,
                         .primitive_type = BOOL
@@ -351,20 +476,53 @@ int infer_expression_type(struct expression *e,
         case FUNCTION_EXPRESSION:
         {
             size_t value_count = e->function.params->size;
-            for (size_t i = 0; i < global_context->fn_types.size; i++) {
-                struct type *global_fn = &global_context->fn_types.data[i];
+            struct list_type param_types = list_create(type, (value_count + 1));
+            for (size_t i = 0; i < value_count; i++) {
+                struct type param_type = {0};
+                if (!infer_expression_type(&e->function.params->data[i],
+                                           global_context,
+                                           context,
+                                           scoped_variables,
+                                           &param_type,
+                                           error))
+                {
+                    return 0;
+                }
+                list_append(&param_types, param_type);
+            }
+
+            if (e->function.method_call && !resolve_method(&e->function, &param_types.data[0], error)) {
+                return 0;
+            }
+
+            if (is_arena_allocation(&e->function)) {
+                *out = arena_allocation_type(&param_types.data[1]);
+                lut_add(&context->expression_type_lookup, e->id, *out);
+                return 1;
+            }
+
+            struct type *matched_fn = NULL;
+            for (size_t i = 0; i < global_context->fn_types.size && matched_fn == NULL; i++) {
                 if (list_char_eq(e->function.function_name, global_context->fn_types.data[i].name)) {
-                    return infer_function_type(global_fn, global_context, value_count, out, error);
+                    matched_fn = &global_context->fn_types.data[i];
                 }
             }
 
-            for (size_t i = 0; i < scoped_variables->size; i++) {
+            for (size_t i = 0; i < scoped_variables->size && matched_fn == NULL; i++) {
                 struct type *fn = &scoped_variables->data[i].type;
-                if (fn->kind == TY_FUNCTION) {
-                    if (list_char_eq(e->function.function_name, &scoped_variables->data[i].name)) {
-                        return infer_function_type(fn, global_context, value_count, out, error);
-                    }
+                if (fn->kind == TY_FUNCTION
+                    && list_char_eq(e->function.function_name, &scoped_variables->data[i].name))
+                {
+                    matched_fn = fn;
+                }
+            }
+
+            if (matched_fn != NULL) {
+                if (!infer_function_type(matched_fn, global_context, value_count, out, error)) {
+                    return 0;
                 }
+                lut_add(&context->expression_type_lookup, e->id, *out);
+                return 1;
             }
 
             append_list_char_slice(error, "the function `");
@@ -385,6 +543,19 @@ int infer_expression_type(struct expression *e,
                 return 0;
             }
 
+            if (accessed.modifiers.size > 0 && accessed.modifiers.data[0].kind == SLICE_MODIFIER_KIND) {
+                if (strcmp(e->member_access.member_name->data, "len") != 0) {
+                    append_list_char_slice(error, "a slice only has a `len`.");
+                    return 0;
+                }
+                *out = (struct type) {
+                    .kind = TY_PRIMITIVE,
+                    .primitive_type = USIZE
+                };
+                lut_add(&context->expression_type_lookup, e->id, *out);
+                return 1;
+            }
+
             // TODO: enums
             if (accessed.kind != TY_STRUCT) {
                 append_list_char_slice(error, "can only access fields of structs.");
@@ -405,6 +576,79 @@ int infer_expression_type(struct expression *e,
                 return 0;
             }
 
+            lut_add(&context->expression_type_lookup, e->id, *out);
+            return 1;
+        }
+        case INDEX_EXPRESSION:
+        {
+            struct type indexed = {0};
+            if (!infer_expression_type(e->index.indexed,
+                                       global_context,
+                                       context,
+                                       scoped_variables,
+                                       &indexed,
+                                       error))
+            {
+                return 0;
+            }
+
+            struct type index = {0};
+            if (!infer_expression_type(e->index.index,
+                                       global_context,
+                                       context,
+                                       scoped_variables,
+                                       &index,
+                                       error))
+            {
+                return 0;
+            }
+
+            // a vector's lanes are indexed like an array's elements.
+            if (is_vector_type(&indexed)) {
+                if (e->index.end != NULL) {
+                    append_list_char_slice(error, "a vector can't be sliced.");
+                    return 0;
+                }
+                if (classify_switch_subject(&index) != SWITCH_ON_INTEGER) {
+                    append_list_char_slice(error, "a lane index must be an integer.");
+                    return 0;
+                }
+                *out = (struct type) {
+                    .kind = TY_PRIMITIVE,
+                    .primitive_type = vector_element(indexed.primitive_type)
+                };
+                lut_add(&context->expression_type_lookup, e->id, *out);
+                return 1;
+            }
+
+            enum type_modifier_kind indexed_kind = indexed.modifiers.size > 0
+                ? indexed.modifiers.data[0].kind
+                : 0;
+            if (indexed_kind != ARRAY_MODIFIER_KIND && indexed_kind != SLICE_MODIFIER_KIND) {
+                append_list_char_slice(error, "can only index arrays and slices.");
+                return 0;
+            }
+
+            if (classify_switch_subject(&index) != SWITCH_ON_INTEGER) {
+                append_list_char_slice(error, "an array index must be an integer.");
+                return 0;
+            }
+
+            *out = element_type(&indexed);
+            if (e->index.end != NULL) {
+                struct type end = {0};
+                if (!infer_expression_type(e->index.end, global_context, context, scoped_variables, &end, error)) {
+                    return 0;
+                }
+                if (classify_switch_subject(&end) != SWITCH_ON_INTEGER) {
+                    append_list_char_slice(error, "the end of a slice must be an integer.");
+                    return 0;
+                }
+
+                // `a[start..end]` is a slice of the elements between.
+                *out = slice_of(out);
+            }
+            lut_add(&context->expression_type_lookup, e->id, *out);
             return 1;
         }
         case VOID_EXPRESSION:
@@ -433,11 +677,15 @@ int infer_full_type(struct type *incomplete_type,
         }
         case TY_STRUCT:
         {
-            return find_struct_definition(global_context, incomplete_type->name, out, error);
+            if (!find_struct_definition(global_context, incomplete_type->name, out, error)) return 0;
+            out->modifiers = incomplete_type->modifiers;
+            return 1;
         }
         case TY_ENUM:
         {
-            return find_enum_definition(global_context, incomplete_type->name, out, error);
+            if (!find_enum_definition(global_context, incomplete_type->name, out, error)) return 0;
+            out->modifiers = incomplete_type->modifiers;
+            return 1;
         }
         case TY_ANY:
         case TY_PRIMITIVE:
@@ -449,3 +697,100 @@ int infer_full_type(struct type *incomplete_type,
 
     UNREACHABLE("dropped out of type switch within infer_full_type");
 }
+
+int for_loop_variable_type(struct for_loop_statement *s,
+                           struct global_context *global_context,
+                           struct context *context,
+                           struct list_scoped_variable *scoped_variables,
+                           struct type *out,
+                           struct list_char *error)
+{
+    struct type iterated = {0};
+    if (!infer_expression_type(&s->iterated, global_context, context, scoped_variables, &iterated, error)) {
+        return 0;
+    }
+
+    if (s->end != NULL) {
+        struct type end = {0};
+        if (!infer_expression_type(s->end, global_context, context, scoped_variables, &end, error)) {
+            return 0;
+        }
+        if (classify_switch_subject(&iterated) != SWITCH_ON_INTEGER
+            || classify_switch_subject(&end) != SWITCH_ON_INTEGER)
+        {
+            append_list_char_slice(error, "a range must start and end with integers.");
+            return 0;
+        }
+
+        // numeric literals are `i32`s, so `0..n` counts in whatever `n` is.
+        int end_is_literal = s->end->kind == LITERAL_EXPRESSION && s->end->literal.kind == LITERAL_NUMERIC;
+        *out = end_is_literal ? iterated : end;
+        return 1;
+    }
+
+    struct type_modifier *outer = iterated.modifiers.size > 0 ? &iterated.modifiers.data[0] : NULL;
+    int iterable = outer != NULL
+        && (outer->kind == SLICE_MODIFIER_KIND
+            || (outer->kind == ARRAY_MODIFIER_KIND && outer->array_modifier.literally_sized));
+    if (!iterable) {
+        append_list_char_slice(error, "`for` can only iterate slices, arrays of a known length and ranges.");
+        return 0;
+    }
+
+    *out = element_type(&iterated);
+    return 1;
+}
+
+// A variant declared as `name: void` carries no payload.
+int is_void_type(struct type *ty)
+{
+    return ty->kind == TY_PRIMITIVE && ty->primitive_type == VOID && ty->modifiers.size == 0;
+}
+
+enum switch_subject_kind classify_switch_subject(struct type *subject)
+{
+    if (subject->kind != TY_PRIMITIVE) {
+        return SWITCH_ON_OTHER;
+    }
+
+    if (subject->modifiers.size == 1
+        && (subject->primitive_type == U8 || subject->primitive_type == I8))
+    {
+        enum type_modifier_kind kind = subject->modifiers.data[0].kind;
+        if (kind == ARRAY_MODIFIER_KIND || kind == POINTER_MODIFIER_KIND) {
+            return SWITCH_ON_STRING;
+        }
+    }
+
+    if (subject->modifiers.size > 0) {
+        return SWITCH_ON_OTHER;
+    }
+
+    switch (subject->primitive_type) {
+        case F32:
+        case F64:
+            return SWITCH_ON_FLOAT;
+        case VOID:
+        case BOOL:
+            return SWITCH_ON_OTHER;
+        default:
+            return SWITCH_ON_INTEGER;
+    }
+}
+
+// An array is bound by a pointer to its first element, as C arrays can't be copied into a new
+// variable.
+struct type switch_binding_type(struct type *subject)
+{
+    if (subject->modifiers.size == 0 || subject->modifiers.data[0].kind != ARRAY_MODIFIER_KIND) {
+        return *subject;
+    }
+
+    struct type output = *subject;
+    output.modifiers = list_create(type_modifier, subject->modifiers.size);
+    list_append(&output.modifiers, (struct type_modifier) { .kind = POINTER_MODIFIER_KIND });
+    for (size_t i = 1; i < subject->modifiers.size; i++) {
+        list_append(&output.modifiers, subject->modifiers.data[i]);
+    }
+    return output;
+}
@@ -18,4 +18,35 @@ int infer_full_type(struct type *incomplete_type,
                     struct type *out,
                     struct list_char *error);
 
+int find_struct_definition(struct global_context *c,
+                           struct list_char *struct_name,
+                           struct type *out,
+                           struct list_char *error);
+
+int find_enum_definition(struct global_context *c,
+                         struct list_char *enum_name,
+                         struct type *out,
+                         struct list_char *error);
+
+int is_void_type(struct type *ty);
+struct type element_type(struct type *indexed);
+struct type slice_of(struct type *element);
+// The type of a for loop's variable, an element of what it iterates or an integer in its range.
+int for_loop_variable_type(struct for_loop_statement *s,
+                           struct global_context *global_context,
+                           struct context *context,
+                           struct list_scoped_variable *scoped_variables,
+                           struct type *out,
+                           struct list_char *error);
+
+enum switch_subject_kind {
+    SWITCH_ON_INTEGER = 1,
+    SWITCH_ON_FLOAT,
+    SWITCH_ON_STRING,
+    SWITCH_ON_OTHER
+};
+
+enum switch_subject_kind classify_switch_subject(struct type *subject);
+struct type switch_binding_type(struct type *subject);
+
 #endif
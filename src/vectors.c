@@ -0,0 +1,163 @@
+#include <string.h>
+#include "vectors.h"
+#include "../lib/collections.h"
+
+struct vector_info {
+    enum primitive_type vector;
+    char *name;
+    size_t lanes;
+    enum primitive_type element;
+    enum primitive_type mask;
+};
+
+static struct vector_info vectors[] = {
+    { F32X4, "f32x4", 4, F32, I32X4 },
+    { F32X8, "f32x8", 8, F32, I32X8 },
+    { I32X4, "i32x4", 4, I32, I32X4 },
+    { I32X8, "i32x8", 8, I32, I32X8 },
+    { U8X16, "u8x16", 16, U8, U8X16 },
+    { U8X32, "u8x32", 32, U8, U8X32 },
+};
+
+#define VECTOR_COUNT (sizeof(vectors) / sizeof(*vectors))
+
+static char *vector_operations[] = { "splat", "load", "store", "shuffle", "sum", "min", "max" };
+
+struct vector_info *find_vector(enum primitive_type primitive)
+{
+    for (size_t i = 0; i < VECTOR_COUNT; i++) {
+        if (vectors[i].vector == primitive) return &vectors[i];
+    }
+    return NULL;
+}
+
+int is_vector_primitive(enum primitive_type primitive)
+{
+    return find_vector(primitive) != NULL;
+}
+
+int is_vector_type(struct type *ty)
+{
+    return ty->kind == TY_PRIMITIVE && ty->modifiers.size == 0 && is_vector_primitive(ty->primitive_type);
+}
+
+size_t vector_lanes(enum primitive_type vector)
+{
+    return find_vector(vector)->lanes;
+}
+
+enum primitive_type vector_element(enum primitive_type vector)
+{
+    return find_vector(vector)->element;
+}
+
+enum primitive_type vector_mask(enum primitive_type vector)
+{
+    return find_vector(vector)->mask;
+}
+
+char *vector_name(enum primitive_type vector)
+{
+    return find_vector(vector)->name;
+}
+
+struct type *scalar_type(enum primitive_type primitive)
+{
+    struct type *ty = malloc(sizeof(*ty));
+    *ty = (struct type) {
+        .kind = TY_PRIMITIVE,
+        .modifiers = list_create(type_modifier, 1),
+        .primitive_type = primitive
+    };
+    return ty;
+}
+
+struct type *slice_type(enum primitive_type element)
+{
+    struct type *ty = scalar_type(element);
+    list_append(&ty->modifiers, ((struct type_modifier) { .kind = SLICE_MODIFIER_KIND }));
+    return ty;
+}
+
+struct key_type_pair vector_param(char *name, struct type *ty)
+{
+    struct key_type_pair pair = { .field_name = list_create(char, (strlen(name) + 1)), .field_type = ty };
+    append_list_char_slice(&pair.field_name, name);
+    list_append(&pair.field_name, '\0');
+    return pair;
+}
+
+void declare_vector_function(struct vector_info *info,
+                             char *operation,
+                             struct type *return_type,
+                             struct list_key_type_pair params,
+                             struct global_context *global_context)
+{
+    struct list_char *name = malloc(sizeof(*name));
+    *name = list_create(char, (strlen(info->name) + strlen(operation) + 2));
+    append_list_char_slice(name, info->name);
+    append_list_char_slice(name, "_");
+    append_list_char_slice(name, operation);
+    list_append(name, '\0');
+
+    list_append(&global_context->fn_types, ((struct type) {
+        .kind = TY_FUNCTION,
+        .name = name,
+        .modifiers = list_create(type_modifier, 1),
+        .function_type = (struct function_type) {
+            .params = params,
+            .return_type = return_type
+        }
+    }));
+}
+
+void declare_vector_functions(struct global_context *global_context)
+{
+    for (size_t i = 0; i < VECTOR_COUNT; i++) {
+        struct vector_info *info = &vectors[i];
+
+        struct list_key_type_pair splat = list_create(key_type_pair, 1);
+        list_append(&splat, vector_param("value", scalar_type(info->element)));
+        declare_vector_function(info, "splat", scalar_type(info->vector), splat, global_context);
+
+        struct list_key_type_pair load = list_create(key_type_pair, 2);
+        list_append(&load, vector_param("from", slice_type(info->element)));
+        list_append(&load, vector_param("at", scalar_type(USIZE)));
+        declare_vector_function(info, "load", scalar_type(info->vector), load, global_context);
+
+        struct list_key_type_pair store = list_create(key_type_pair, 3);
+        list_append(&store, vector_param("vector", scalar_type(info->vector)));
+        list_append(&store, vector_param("to", slice_type(info->element)));
+        list_append(&store, vector_param("at", scalar_type(USIZE)));
+        declare_vector_function(info, "store", scalar_type(VOID), store, global_context);
+
+        struct list_key_type_pair shuffle = list_create(key_type_pair, 2);
+        list_append(&shuffle, vector_param("vector", scalar_type(info->vector)));
+        list_append(&shuffle, vector_param("mask", scalar_type(info->mask)));
+        declare_vector_function(info, "shuffle", scalar_type(info->vector), shuffle, global_context);
+
+        char *reductions[] = { "sum", "min", "max" };
+        for (size_t j = 0; j < sizeof(reductions) / sizeof(*reductions); j++) {
+            struct list_key_type_pair params = list_create(key_type_pair, 1);
+            list_append(&params, vector_param("vector", scalar_type(info->vector)));
+            declare_vector_function(info, reductions[j], scalar_type(info->element), params, global_context);
+        }
+    }
+}
+
+int vector_function(struct list_char *name, enum primitive_type *vector, char **operation)
+{
+    for (size_t i = 0; i < VECTOR_COUNT; i++) {
+        size_t length = strlen(vectors[i].name);
+        if (strncmp(name->data, vectors[i].name, length) != 0 || name->data[length] != '_') continue;
+
+        for (size_t j = 0; j < sizeof(vector_operations) / sizeof(*vector_operations); j++) {
+            if (!strcmp(name->data + length + 1, vector_operations[j])) {
+                *vector = vectors[i].vector;
+                *operation = vector_operations[j];
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef VECTORS_H
+#define VECTORS_H
+
+#include "ast.h"
+#include "parser.h"
+
+// The vector primitives lower to GCC vector extension types, arithmetic and comparisons apply lane
+// by lane, and a comparison gives a mask of the integer vector with lanes of the same width.
+int is_vector_primitive(enum primitive_type primitive);
+int is_vector_type(struct type *ty);
+size_t vector_lanes(enum primitive_type vector);
+enum primitive_type vector_element(enum primitive_type vector);
+enum primitive_type vector_mask(enum primitive_type vector);
+char *vector_name(enum primitive_type vector);
+
+// Declares, for each vector type `v` with elements `e`, `v_splat(e)`, `v_load([]e, at)` and the
+// methods `store([]e, at)`, `shuffle(mask)`, `sum()`, `min()` and `max()`. They've no body, the
+// lowering writes the ones called into the header.
+void declare_vector_functions(struct global_context *global_context);
+// Which vector function it is, its vector and the part of its name after the vector's.
+int vector_function(struct list_char *name, enum primitive_type *vector, char **operation);
+
+#endif